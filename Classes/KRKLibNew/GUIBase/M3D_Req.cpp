@@ -14,18 +14,51 @@
 //
 
 #include "M3D_Req.h"
+#include "M3D_ConfigBase.h"
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
 
 namespace CEGUI
 {
 
+//! binding rec and request command of the prefetch worker, NULL on every other thread
+#ifdef _WIN32
+static __declspec(thread) void* t_prefetchTarget = NULL;
+static __declspec(thread) M3DReqCmd_t* t_prefetchCmd = NULL;
+#else
+static __thread void* t_prefetchTarget = NULL;
+static __thread M3DReqCmd_t* t_prefetchCmd = NULL;
+#endif
+
 //----------------------------------------------------------------------------//
 M3D_Req::M3D_Req(void* para1, int para2)
 {
+	pthread_mutex_init(&d_reqLock, NULL);
+	pthread_mutex_init(&d_windowLock, NULL);
+	pthread_cond_init(&d_windowCond, NULL);
+	d_prefetchRun = false;
+	d_prefetchOff = false;
+	d_windowRadius = 0;
+	d_windowPageItems = 0;
+	d_windowTotal = 0;
+	d_windowCenter = -1;
+	d_windowGen = 0;
+	for (int i = 0; i < M3DREQ_PREFETCH_SLOTS; i++) {
+		d_windowPage[i].page = -1;
+		d_windowPage[i].data = NULL;
+	}
+	memset(&d_prefetchStat, 0, sizeof(d_prefetchStat));
+	memset(&d_windowCmd, 0, sizeof(d_windowCmd));
 }
 	
 //----------------------------------------------------------------------------//
 M3D_Req::~M3D_Req(void)
 {
+	reqPrefetchStop();
+	pthread_cond_destroy(&d_windowCond);
+	pthread_mutex_destroy(&d_windowLock);
+	pthread_mutex_destroy(&d_reqLock);
 }
 
 //----------------------------------------------------------------------------//
@@ -41,6 +74,7 @@ int M3D_Req::reqInit(M3DReqCmd_t& cmd, int onePageItems)
 	      handle.totalPage = 1;
 	handle.curStartItem = 0;
 	handle.reqCmd.itemIndex = 0;
+	prefetchReset();
 
 	return handle.totalItems;
 }
@@ -116,5 +150,314 @@ int M3D_Req::reqPrevPage(void)
 	return ret;
 }
 
+//----------------------------------------------------------------------------//
+int M3D_Req::reqPrefetchStart(int radius)
+{
+	int size;
+
+	if (d_prefetchRun)
+		return 0;
+	if (radius <= 0 || getBindingRecCount() <= 0)
+		return -1;
+	if (radius > M3DREQ_PREFETCH_MAX_RADIUS)
+		radius = M3DREQ_PREFETCH_MAX_RADIUS;
+
+	size = getBindingRecCount()*getBindingRecLength();
+	for (int i = 0; i < radius*2+1; i++) {
+		d_windowPage[i].page = -1;
+		d_windowPage[i].data = new char[size];
+	}
+	d_windowRadius = radius;
+	d_prefetchRun = true;
+	if (pthread_create(&d_prefetchThread, NULL, threadPrefetch, this) != 0) {
+		d_prefetchRun = false;
+		for (int i = 0; i < radius*2+1; i++) {
+			delete [] d_windowPage[i].data;
+			d_windowPage[i].data = NULL;
+		}
+		return -1;
+	}
+	return 0;
+}
+
+//----------------------------------------------------------------------------//
+void M3D_Req::reqPrefetchStop(void)
+{
+	if (!d_prefetchRun)
+		return;
+
+	pthread_mutex_lock(&d_windowLock);
+	d_prefetchRun = false;
+	pthread_cond_signal(&d_windowCond);
+	pthread_mutex_unlock(&d_windowLock);
+	pthread_join(d_prefetchThread, NULL);
+
+	for (int i = 0; i < M3DREQ_PREFETCH_SLOTS; i++) {
+		delete [] d_windowPage[i].data;
+		d_windowPage[i].data = NULL;
+		d_windowPage[i].page = -1;
+	}
+	M3D_DebugPrint("<reqPrefetchStop> hits[%u] misses[%u] missTime[%u/%u] prefetch[%u/%u] discard[%u]\n",
+		d_prefetchStat.hits, d_prefetchStat.misses, d_prefetchStat.missTime, d_prefetchStat.missTimeMax,
+		d_prefetchStat.prefetchPages, d_prefetchStat.prefetchTime, d_prefetchStat.discardPages);
+}
+
+//----------------------------------------------------------------------------//
+void M3D_Req::reqPrefetchInvalidate(void)
+{
+	pthread_mutex_lock(&d_windowLock);
+	d_windowGen++;
+	d_windowCmd = handle.reqCmd;
+	d_windowCmd.itemIndex = 0;				// a slot holds its page from item 0
+	// nothing is fetched until the ui asks for a record again
+	d_windowCenter = -1;
+	for (int i = 0; i < M3DREQ_PREFETCH_SLOTS; i++)
+		d_windowPage[i].page = -1;
+	pthread_cond_signal(&d_windowCond);
+	pthread_mutex_unlock(&d_windowLock);
+}
+
+//----------------------------------------------------------------------------//
+void M3D_Req::getPrefetchStat(M3DReqPrefetchStat_t& stat)
+{
+	pthread_mutex_lock(&d_windowLock);
+	stat = d_prefetchStat;
+	pthread_mutex_unlock(&d_windowLock);
+}
+
+//----------------------------------------------------------------------------//
+void M3D_Req::resetPrefetchStat(void)
+{
+	pthread_mutex_lock(&d_windowLock);
+	memset(&d_prefetchStat, 0, sizeof(d_prefetchStat));
+	pthread_mutex_unlock(&d_windowLock);
+}
+
+//----------------------------------------------------------------------------//
+void* M3D_Req::prefetchTarget(void)
+{
+	return t_prefetchTarget;
+}
+
+//----------------------------------------------------------------------------//
+M3DReqCmd_t& M3D_Req::reqCmd(void)
+{
+	return t_prefetchCmd? *t_prefetchCmd : handle.reqCmd;
+}
+
+//----------------------------------------------------------------------------//
+int M3D_Req::reqRecCached(int reqStart, int reqCount)
+{
+	unsigned long tick;
+	int ret;
+
+	ret = reqRecWindow(reqStart, reqCount);
+	if (ret >= 0)
+		return ret;
+
+	// a new list query rebuilds the results the worker reads, stop it first
+	if (reqCount <= 0)
+		reqPrefetchInvalidate();
+
+	tick = GetTickCount();
+	reqLock();
+	ret = reqRecDirect(reqStart, reqCount);
+	reqUnlock();
+
+	if (reqCount > 0) {
+		tick = GetTickCount() - tick;
+		pthread_mutex_lock(&d_windowLock);
+		d_prefetchStat.misses += reqCount;
+		d_prefetchStat.missTime += tick;
+		if (tick > d_prefetchStat.missTimeMax)
+			d_prefetchStat.missTimeMax = tick;
+		pthread_mutex_unlock(&d_windowLock);
+	}
+	return ret;
+}
+
+//----------------------------------------------------------------------------//
+// copy the records from the window into the binding rec, -1 if not cached
+int M3D_Req::reqRecWindow(int reqStart, int reqCount)
+{
+	int ret = -1;
+	int page, offset, len;
+	int index = handle.reqCmd.itemIndex;
+
+	if (reqCount <= 0 || reqStart < 0 || index+reqCount > getBindingRecCount())
+		return -1;
+
+	pthread_mutex_lock(&d_windowLock);
+	if (!d_prefetchRun || d_prefetchOff || d_windowPageItems <= 0) {
+		pthread_mutex_unlock(&d_windowLock);
+		return -1;
+	}
+
+	page = reqStart/d_windowPageItems;
+	offset = reqStart - page*d_windowPageItems;
+	if (page != d_windowCenter) {
+		d_windowCenter = page;
+		pthread_cond_signal(&d_windowCond);
+	}
+
+	if (offset+reqCount <= d_windowPageItems) {
+		for (int i = 0; i < d_windowRadius*2+1; i++) {
+			M3DReqWindowPage_t& slot = d_windowPage[i];
+			if (slot.page != page || slot.gen != d_windowGen)
+				continue;
+
+			len = getBindingRecLength();
+			memcpy(getBindingRec(index), slot.data+offset*len, reqCount*len);
+			ret = slot.ret - offset;
+			if (ret < 0)
+				ret = 0;
+			else if (ret > reqCount)
+				ret = reqCount;
+			d_prefetchStat.hits += reqCount;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&d_windowLock);
+
+	if (ret >= 0) {
+		for (int i = 0; i < reqCount; i++)
+			reqPrefetchHit(getBindingRec(index+i));
+	}
+	return ret;
+}
+
+//----------------------------------------------------------------------------//
+void M3D_Req::prefetchReset(void)
+{
+	int pageItems = handle.onePageItems;
+
+	if (pageItems > getBindingRecCount())
+		pageItems = getBindingRecCount();
+
+	pthread_mutex_lock(&d_windowLock);
+	d_windowGen++;
+	d_windowCmd = handle.reqCmd;
+	d_windowCmd.itemIndex = 0;				// a slot holds its page from item 0
+	d_windowTotal = handle.totalItems;
+	d_windowPageItems = pageItems;
+	d_windowCenter = -1;
+	d_prefetchOff = false;
+	for (int i = 0; i < M3DREQ_PREFETCH_SLOTS; i++)
+		d_windowPage[i].page = -1;
+	pthread_mutex_unlock(&d_windowLock);
+}
+
+//----------------------------------------------------------------------------//
+unsigned int M3D_Req::prefetchGen(void)
+{
+	unsigned int gen;
+
+	pthread_mutex_lock(&d_windowLock);
+	gen = d_windowGen;
+	pthread_mutex_unlock(&d_windowLock);
+	return gen;
+}
+
+//----------------------------------------------------------------------------//
+// the missing page nearest to the cursor, called with d_windowLock held
+int M3D_Req::prefetchNextPage(void)
+{
+	int totalPage, page, i, j;
+
+	if (d_prefetchOff || d_windowCenter < 0 || d_windowPageItems <= 0)
+		return -1;
+
+	totalPage = (d_windowTotal+d_windowPageItems-1)/d_windowPageItems;
+	for (i = 0; i < d_windowRadius*2+1; i++) {
+		// center, +1, -1, +2, -2 ...
+		page = d_windowCenter + ((i & 1)? (i+1)/2 : -(i/2));
+		if (page < 0 || page >= totalPage)
+			continue;
+		for (j = 0; j < d_windowRadius*2+1; j++) {
+			if (d_windowPage[j].page == page && d_windowPage[j].gen == d_windowGen)
+				break;
+		}
+		if (j == d_windowRadius*2+1)
+			return page;
+	}
+	return -1;
+}
+
+//----------------------------------------------------------------------------//
+void M3D_Req::prefetchLoop(void)
+{
+	M3DReqWindowPage_t* slot;
+	M3DReqCmd_t cmd;
+	unsigned long tick;
+	unsigned int gen;
+	int page, pageItems, dist, maxDist, ret;
+
+	pthread_mutex_lock(&d_windowLock);
+	while (d_prefetchRun) {
+		page = prefetchNextPage();
+		if (page < 0) {
+			pthread_cond_wait(&d_windowCond, &d_windowLock);
+			continue;
+		}
+
+		// reuse the slot farthest from the cursor
+		slot = &d_windowPage[0];
+		maxDist = -1;
+		for (int i = 0; i < d_windowRadius*2+1; i++) {
+			if (d_windowPage[i].page < 0 || d_windowPage[i].gen != d_windowGen)
+				dist = INT_MAX;
+			else
+				dist = abs(d_windowPage[i].page - d_windowCenter);
+			if (dist > maxDist) {
+				maxDist = dist;
+				slot = &d_windowPage[i];
+			}
+		}
+		slot->page = -1;
+		gen = d_windowGen;
+		cmd = d_windowCmd;
+		pageItems = d_windowPageItems;
+		pthread_mutex_unlock(&d_windowLock);
+
+		// the ui changes handle.reqCmd without a lock, the worker queries with the
+		// command of its generation; a list query invalidates before it takes the
+		// request lock, so the results are those of this command while the generation holds
+		tick = GetTickCount();
+		reqLock();
+		ret = -1;
+		if (gen == prefetchGen()) {
+			t_prefetchTarget = slot->data;
+			t_prefetchCmd = &cmd;
+			ret = reqPrefetchable()? reqRecDirect(page*pageItems, pageItems) : -1;
+			t_prefetchCmd = NULL;
+			t_prefetchTarget = NULL;
+		}
+		reqUnlock();
+		tick = GetTickCount() - tick;
+
+		pthread_mutex_lock(&d_windowLock);
+		if (gen != d_windowGen) {
+			d_prefetchStat.discardPages++;
+		}
+		else if (ret < 0) {
+			d_prefetchOff = true;
+		}
+		else {
+			slot->page = page;
+			slot->ret = ret;
+			slot->gen = gen;
+			d_prefetchStat.prefetchPages++;
+			d_prefetchStat.prefetchTime += tick;
+		}
+	}
+	pthread_mutex_unlock(&d_windowLock);
+}
+
+//----------------------------------------------------------------------------//
+void* M3D_Req::threadPrefetch(void* param)
+{
+	((M3D_Req*)param)->prefetchLoop();
+	return NULL;
 }
 
+}
@@ -16,12 +16,15 @@
 #ifndef M3DREQ_H
 #define M3DREQ_H
 
+#include <pthread.h>
 #include "M3D_Notify.h"
 
 namespace CEGUI
 {
 
 #define M3DREQ_STRPARA_LEN		32
+#define M3DREQ_PREFETCH_MAX_RADIUS	4		// max pages kept ahead of / behind the cursor
+#define M3DREQ_PREFETCH_SLOTS		(M3DREQ_PREFETCH_MAX_RADIUS*2+1)
 
 /*!
 \brief
@@ -78,6 +81,33 @@ public:
 	int curStartItem;
 };
 
+/*!
+\brief
+	prefetch window counters, times are in ms
+*/
+typedef struct {
+	unsigned int hits;				// records served from the window
+	unsigned int misses;			// records fetched synchronously
+	unsigned int missTime;			// total time spent in synchronous fetches
+	unsigned int missTimeMax;
+	unsigned int prefetchPages;		// pages filled by the worker
+	unsigned int prefetchTime;		// total time spent by the worker
+	unsigned int discardPages;		// pages dropped because the request changed
+
+} M3DReqPrefetchStat_t;
+
+/*!
+\brief
+	one page of the prefetch window, records are stored as binding rec items
+*/
+typedef struct {
+	int page;
+	int ret;
+	unsigned int gen;
+	char* data;
+
+} M3DReqWindowPage_t;
+
 class M3D_Req : public M3D_Notify
 {
 public:
@@ -107,13 +137,64 @@ public:
 	int reqPage(int reqStart, int cursor);
 	int reqNextPage(void);
 	int reqPrevPage(void);
+
+	/*!
+	\brief
+		background prefetch, the worker keeps <radius> pages ahead of and behind
+		the last requested record, reqRecCached() serves them without a query.
+		only request types accepted by reqPrefetchable() are prefetched.
+	*/
+	int reqPrefetchStart(int radius);
+	void reqPrefetchStop(void);
+	void reqPrefetchInvalidate(void);
+	void getPrefetchStat(M3DReqPrefetchStat_t& stat);
+	void resetPrefetchStat(void);
+	virtual int getBindingRecCount(void) {return 0;}
 	
 	//! request command handle
 	handleM3DRec handle;
-	
-private:
 
+protected:
+	/*!
+	\brief
+		prefetch hooks for the subclass
+		reqRecDirect() does the real query, it is called with the request lock held,
+		from the worker the binding rec items must be written to prefetchTarget()
+		and the command read from reqCmd(), never from handle.reqCmd.
+		reqPrefetchHit() refreshes volatile fields of a record copied from the window.
+	*/
+	virtual bool reqPrefetchable(void) {return false;}
+	virtual int reqRecDirect(int reqStart, int reqCount) {return 0;}
+	virtual void reqPrefetchHit(void* item) {}
+
+	int reqRecCached(int reqStart, int reqCount);
+	void reqLock(void) {pthread_mutex_lock(&d_reqLock);}
+	void reqUnlock(void) {pthread_mutex_unlock(&d_reqLock);}
+	static void* prefetchTarget(void);
+	M3DReqCmd_t& reqCmd(void);
 	
+private:
+	int reqRecWindow(int reqStart, int reqCount);
+	void prefetchReset(void);
+	unsigned int prefetchGen(void);
+	int prefetchNextPage(void);
+	void prefetchLoop(void);
+	static void* threadPrefetch(void* param);
+
+	pthread_mutex_t d_reqLock;				// serializes reqRecDirect() between ui and worker
+	pthread_mutex_t d_windowLock;			// guards the window, never held during a query
+	pthread_cond_t d_windowCond;
+	pthread_t d_prefetchThread;
+	bool d_prefetchRun;
+	bool d_prefetchOff;						// current request can't be prefetched
+	int d_windowRadius;
+	int d_windowPageItems;
+	int d_windowTotal;
+	int d_windowCenter;
+	unsigned int d_windowGen;
+	M3DReqCmd_t d_windowCmd;				// handle.reqCmd when the window was reset
+	M3DReqWindowPage_t d_windowPage[M3DREQ_PREFETCH_SLOTS];
+	M3DReqPrefetchStat_t d_prefetchStat;
 };
 
 }
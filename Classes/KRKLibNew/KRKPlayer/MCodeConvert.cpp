@@ -1,5 +1,8 @@
 
 #include "MCodeConvert.h"
+#include <stdlib.h>
+#include <ctype.h>
+#include <pthread.h>
 
 static unsigned char gPinYin[]=
 {
@@ -608,35 +611,323 @@ int GetWordsCount(char *GBString)
 	return Ret;
 }
 
+//----------------------------------------------------------------------------//
+// transcoding engine
+//	iconv converters are cached per thread (an iconv_t must not be shared between
+//	threads) and reset before each use instead of iconv_open/iconv_close per call.
+//	gb18030 <-> UTF-8 text made of ascii and the GB2312 two-byte area (lead 0xA1~0xF7,
+//	trail 0xA1~0xFE) goes through lookup tables built once from iconv itself,
+//	the rest of the buffer is handed on to iconv from the first byte not in them.
+//----------------------------------------------------------------------------//
+#define MCODE_CACHE_SIZE		4
+#define MCODE_NAME_LEN			24
+#define MCODE_GB_LEAD_MIN		0xA1
+#define MCODE_GB_LEAD_MAX		0xF7
+#define MCODE_GB_TRAIL_MIN		0xA1
+#define MCODE_GB_TRAIL_MAX		0xFE
+#define MCODE_GB_TRAIL_COUNT	(MCODE_GB_TRAIL_MAX - MCODE_GB_TRAIL_MIN + 1)
+#define MCODE_GB_COUNT			((MCODE_GB_LEAD_MAX - MCODE_GB_LEAD_MIN + 1) * MCODE_GB_TRAIL_COUNT)
+
+enum
+{
+	MCODE_CHARSET_OTHER = 0,
+	MCODE_CHARSET_UTF8,
+	MCODE_CHARSET_GB18030,
+};
+
+typedef struct
+{
+	char from[MCODE_NAME_LEN];
+	char to[MCODE_NAME_LEN];
+	iconv_t cd;
+} MCodeCacheEntry_t;
+
+typedef struct
+{
+	MCodeCacheEntry_t entry[MCODE_CACHE_SIZE];
+	int next;
+} MCodeCache_t;
+
+static pthread_key_t gCodeCacheKey;
+static pthread_once_t gCodeCacheOnce = PTHREAD_ONCE_INIT;
+static pthread_once_t gCodeTableOnce = PTHREAD_ONCE_INIT;
+static unsigned short gGBToUcs[MCODE_GB_COUNT];		// 0 - not in table
+static unsigned short* gUcsToGB[256];				// pages by ucs high byte, 0 - not in table
+
+static int codeNameIs(const char* name, const char* ref)
+{
+	while (*name && tolower((unsigned char)*name) == tolower((unsigned char)*ref))
+	{
+		name++;
+		ref++;
+	}
+	return (*name == '\0' && *ref == '\0');
+}
+
+static int codeCharset(const char* name)
+{
+	if (codeNameIs(name, "UTF-8") || codeNameIs(name, "UTF8"))
+		return MCODE_CHARSET_UTF8;
+	if (codeNameIs(name, "gb18030"))
+		return MCODE_CHARSET_GB18030;
+	return MCODE_CHARSET_OTHER;
+}
+
+static void codeCacheFree(void* p)
+{
+	MCodeCache_t* cache = (MCodeCache_t*)p;
+	int i;
+
+	for (i = 0; i < MCODE_CACHE_SIZE; i++)
+	{
+		if (cache->entry[i].cd != (iconv_t)-1)
+			iconv_close(cache->entry[i].cd);
+	}
+	free(cache);
+}
+
+static void codeCacheInit(void)
+{
+	pthread_key_create(&gCodeCacheKey, codeCacheFree);
+}
+
+// converter of this thread, names must be shorter than MCODE_NAME_LEN
+static iconv_t codeCacheGet(const char* from_charset, const char* to_charset)
+{
+	MCodeCache_t* cache;
+	MCodeCacheEntry_t* e;
+	int i;
+
+	pthread_once(&gCodeCacheOnce, codeCacheInit);
+	cache = (MCodeCache_t*)pthread_getspecific(gCodeCacheKey);
+	if (cache == NULL)
+	{
+		cache = (MCodeCache_t*)calloc(1, sizeof(MCodeCache_t));
+		if (cache == NULL)
+			return (iconv_t)-1;
+		for (i = 0; i < MCODE_CACHE_SIZE; i++)
+			cache->entry[i].cd = (iconv_t)-1;
+		pthread_setspecific(gCodeCacheKey, cache);
+	}
+
+	for (i = 0; i < MCODE_CACHE_SIZE; i++)
+	{
+		e = &cache->entry[i];
+		if (e->cd != (iconv_t)-1 && strcmp(e->from, from_charset) == 0 && strcmp(e->to, to_charset) == 0)
+		{
+			iconv(e->cd, NULL, NULL, NULL, NULL);
+			return e->cd;
+		}
+	}
+
+	e = &cache->entry[cache->next];
+	cache->next = (cache->next + 1) % MCODE_CACHE_SIZE;
+	if (e->cd != (iconv_t)-1)
+		iconv_close(e->cd);
+	e->cd = iconv_open(to_charset, from_charset);
+	strcpy(e->from, from_charset);
+	strcpy(e->to, to_charset);
+	return e->cd;
+}
+
+// return bytes written, -1 if there is no such converter
+static int codeIconv(const char* from_charset, const char* to_charset, const char* in_buffer, int Len1, char* out_buffer, int Len2)
+{
+	const char* pin = in_buffer;
+	char* pout = out_buffer;
+	size_t inLeft = Len1;
+	size_t outLeft = Len2;
+	int cached = (strlen(from_charset) < MCODE_NAME_LEN && strlen(to_charset) < MCODE_NAME_LEN);
+	iconv_t cd = cached ? codeCacheGet(from_charset, to_charset) : iconv_open(to_charset, from_charset);
+
+	if (cd == (iconv_t)-1)
+		return -1;
+	iconv(cd, &pin, &inLeft, &pout, &outLeft);
+	if (!cached)
+		iconv_close(cd);
+	return (int)(pout - out_buffer);
+}
+
+static void codeTableInit(void)
+{
+	iconv_t toUcs = iconv_open("UCS-2LE", "gb18030");
+	iconv_t toGB = iconv_open("gb18030", "UCS-2LE");
+	unsigned char gb[2];
+	unsigned char ucs[2];
+	unsigned char back[4];
+	int lead;
+	int trail;
+
+	if (toUcs != (iconv_t)-1 && toGB != (iconv_t)-1)
+	{
+		for (lead = MCODE_GB_LEAD_MIN; lead <= MCODE_GB_LEAD_MAX; lead++)
+		{
+			for (trail = MCODE_GB_TRAIL_MIN; trail <= MCODE_GB_TRAIL_MAX; trail++)
+			{
+				const char* pin = (const char*)gb;
+				char* pout = (char*)ucs;
+				size_t inLeft = 2;
+				size_t outLeft = 2;
+				unsigned short code;
+
+				gb[0] = lead;
+				gb[1] = trail;
+				iconv(toUcs, NULL, NULL, NULL, NULL);
+				if (iconv(toUcs, &pin, &inLeft, &pout, &outLeft) == (size_t)-1 || outLeft != 0)
+					continue;
+				code = ucs[0] | (ucs[1] << 8);
+				if (code < 0x80)
+					continue;
+				gGBToUcs[(lead - MCODE_GB_LEAD_MIN) * MCODE_GB_TRAIL_COUNT + trail - MCODE_GB_TRAIL_MIN] = code;
+
+				// reverse entry only if iconv encodes the character back to the same pair
+				pin = (const char*)ucs;
+				pout = (char*)back;
+				inLeft = 2;
+				outLeft = sizeof(back);
+				iconv(toGB, NULL, NULL, NULL, NULL);
+				if (iconv(toGB, &pin, &inLeft, &pout, &outLeft) == (size_t)-1
+					|| outLeft != sizeof(back) - 2 || back[0] != gb[0] || back[1] != gb[1])
+					continue;
+				if (gUcsToGB[code >> 8] == NULL)
+					gUcsToGB[code >> 8] = (unsigned short*)calloc(256, sizeof(unsigned short));
+				if (gUcsToGB[code >> 8] != NULL)
+					gUcsToGB[code >> 8][code & 0xFF] = (lead << 8) | trail;
+			}
+		}
+	}
+	if (toUcs != (iconv_t)-1)
+		iconv_close(toUcs);
+	if (toGB != (iconv_t)-1)
+		iconv_close(toGB);
+}
+
+// gb18030 -> UTF-8 while the text is in the table, return bytes read
+static int codeFastGBToUTF8(const unsigned char* in, int Len1, unsigned char* out, int Len2, int* written)
+{
+	int i = 0;
+	int n = 0;
+
+	while (i < Len1)
+	{
+		unsigned char b = in[i];
+		unsigned short code;
+
+		if (b < 0x80)
+		{
+			if (n + 1 > Len2)
+				break;
+			out[n++] = b;
+			i++;
+			continue;
+		}
+		if (i + 1 >= Len1 || b < MCODE_GB_LEAD_MIN || b > MCODE_GB_LEAD_MAX
+			|| in[i + 1] < MCODE_GB_TRAIL_MIN || in[i + 1] > MCODE_GB_TRAIL_MAX)
+			break;
+		code = gGBToUcs[(b - MCODE_GB_LEAD_MIN) * MCODE_GB_TRAIL_COUNT + in[i + 1] - MCODE_GB_TRAIL_MIN];
+		if (code == 0 || n + ((code < 0x800) ? 2 : 3) > Len2)
+			break;
+		n += UCS2toUTF8Code(code, out + n);
+		i += 2;
+	}
+	*written = n;
+	return i;
+}
+
+// UTF-8 -> gb18030 while the text is in the table, return bytes read
+static int codeFastUTF8ToGB(const unsigned char* in, int Len1, unsigned char* out, int Len2, int* written)
+{
+	int i = 0;
+	int n = 0;
+
+	while (i < Len1)
+	{
+		unsigned char b = in[i];
+		unsigned short code;
+		unsigned short gb;
+		int step;
+
+		if (b < 0x80)
+		{
+			if (n + 1 > Len2)
+				break;
+			out[n++] = b;
+			i++;
+			continue;
+		}
+		if (b >= 0xC2 && b <= 0xDF && i + 1 < Len1 && isNotHead(in[i + 1]))
+		{
+			code = ((b & 0x1F) << 6) | (in[i + 1] & 0x3F);
+			step = 2;
+		}
+		else if (b >= 0xE0 && b <= 0xEF && i + 2 < Len1 && isNotHead(in[i + 1]) && isNotHead(in[i + 2]))
+		{
+			code = ((b & 0x0F) << 12) | ((in[i + 1] & 0x3F) << 6) | (in[i + 2] & 0x3F);
+			if (code < 0x800 || (code >= 0xD800 && code <= 0xDFFF))
+				break;
+			step = 3;
+		}
+		else
+		{
+			break;
+		}
+		if (gUcsToGB[code >> 8] == NULL || (gb = gUcsToGB[code >> 8][code & 0xFF]) == 0 || n + 2 > Len2)
+			break;
+		out[n++] = gb >> 8;
+		out[n++] = gb & 0xFF;
+		i += step;
+	}
+	*written = n;
+	return i;
+}
+
+int MCodeConvertBuffer(const char* from_charset, const char* to_charset, const char* in_buffer, int Len1, char* out_buffer, int Len2)
+{
+	int from = codeCharset(from_charset);
+	int to = codeCharset(to_charset);
+	int used = 0;
+	int written = 0;
+	int ret;
+
+	if (from != to && from != MCODE_CHARSET_OTHER && to != MCODE_CHARSET_OTHER)
+	{
+		pthread_once(&gCodeTableOnce, codeTableInit);
+		if (from == MCODE_CHARSET_GB18030)
+			used = codeFastGBToUTF8((const unsigned char*)in_buffer, Len1, (unsigned char*)out_buffer, Len2, &written);
+		else
+			used = codeFastUTF8ToGB((const unsigned char*)in_buffer, Len1, (unsigned char*)out_buffer, Len2, &written);
+		if (used == Len1)
+			return written;
+	}
+
+	ret = codeIconv(from_charset, to_charset, in_buffer + used, Len1 - used, out_buffer + written, Len2 - written);
+	if (ret < 0)
+		return (used > 0) ? written : -1;
+	return written + ret;
+}
+
 int MCodeConvertAPI(const char* from_charset, const char *to_charset, char* in_buffer, char* out_buffer, int Len1, int Len2)
 {
-	int a;
-	CodeConverter cc = CodeConverter(from_charset, to_charset);//use gb18030 to insteadof gb2312
-	a = cc.convert(in_buffer, &Len1, out_buffer, &Len2);
-	return Len2;
+	int ret;
+	memset(out_buffer, 0, Len2);
+	ret = MCodeConvertBuffer(from_charset, to_charset, in_buffer, Len1, out_buffer, Len2);
+	return (ret > 0) ? (Len2 - ret) : Len2;
 }
 
 int MCodeConvert_UTF8toGB2312(char* in_utf8, char* out_gb2312, int Len1, int Len2)
 {
-	int a;
-	CodeConverter cc = CodeConverter("UTF-8", "gb18030");//use gb18030 to insteadof gb2312
-	a = cc.convert(in_utf8, &Len1, out_gb2312, &Len2);
-	return Len2;
+	return MCodeConvertAPI("UTF-8", "gb18030", in_utf8, out_gb2312, Len1, Len2);//use gb18030 to insteadof gb2312
 }
 int MCodeConvert_GB2312toUTF8(char* in_gb2312, char* out_utf8, int Len1, int Len2)
 {
-	int a;
-	CodeConverter cc = CodeConverter("gb18030", "UTF-8");//use gb18030 to insteadof gb2312
-	a = cc.convert(in_gb2312, &Len1, out_utf8, &Len2);
-	return Len2;
+	return MCodeConvertAPI("gb18030", "UTF-8", in_gb2312, out_utf8, Len1, Len2);//use gb18030 to insteadof gb2312
 }
 int MCodeConvert_GB2312toUCS2(char* in_gb2312, char* out_ucs2, int Len1,int Len2)
 {
 	int i;
 	char Val;
 	int LEN = Len1;
-	CodeConverter cc = CodeConverter("gb18030","UCS-2");//use gb18030 to insteadof gb2312
-	cc.convert(in_gb2312, &Len1, out_ucs2, &Len2);
+	MCodeConvertAPI("gb18030", "UCS-2", in_gb2312, out_ucs2, Len1, Len2);//use gb18030 to insteadof gb2312
 	for (i = 0; i < LEN; i++)
 	{
 		Val = out_ucs2[i * 2];
@@ -661,8 +952,7 @@ int MCodeConvert_UCS2toGB2312(char* in_ucs2, char* out_gb2312, int Len1,int Len2
 {
 	//int i;
 	//char Val;
-	CodeConverter cc = CodeConverter("UCS-2","gb18030");//use gb18030 to insteadof gb2312
-	cc.convert(in_ucs2, &Len1, out_gb2312, &Len2);
+	MCodeConvertAPI("UCS-2", "gb18030", in_ucs2, out_gb2312, Len1, Len2);//use gb18030 to insteadof gb2312
 	//1111 not finish yet.............
 	return 1;
 }
@@ -2132,10 +2422,83 @@ int ChineseGBSort[] = {
 
 #include <assert.h>
 
+//----------------------------------------------------------------------------//
+// rank of every code in ChineseGBSort indexed directly by the code: ascii and the
+// gbk area (lead 0x81~0xFE, trail 0x40~0xFF), which holds every code of the table.
+// 0 - not in the table, else rank + 1. built once on first use.
+//----------------------------------------------------------------------------//
+#define GBSORT_LEAD_MIN		0x81
+#define GBSORT_LEAD_MAX		0xFE
+#define GBSORT_TRAIL_MIN	0x40
+#define GBSORT_TRAIL_COUNT	(0xFF - GBSORT_TRAIL_MIN + 1)
+#define GBSORT_ASCII_COUNT	0x80
+#define GBSORT_INDEX_COUNT	(GBSORT_ASCII_COUNT + (GBSORT_LEAD_MAX - GBSORT_LEAD_MIN + 1) * GBSORT_TRAIL_COUNT)
+
+static unsigned short gGBSortRank[GBSORT_INDEX_COUNT];
+static int gGBSortCount;							// rank of codes not in the table
+static pthread_once_t gGBSortOnce = PTHREAD_ONCE_INIT;
+
+static int GBSortIndex(int Code)
+{
+	if (Code >= 0 && Code < GBSORT_ASCII_COUNT)
+		return Code;
+	if ((Code >> 8) >= GBSORT_LEAD_MIN && (Code >> 8) <= GBSORT_LEAD_MAX && (Code & 0xFF) >= GBSORT_TRAIL_MIN)
+		return GBSORT_ASCII_COUNT + ((Code >> 8) - GBSORT_LEAD_MIN) * GBSORT_TRAIL_COUNT + (Code & 0xFF) - GBSORT_TRAIL_MIN;
+	return -1;
+}
+
+static void GBSortInit(void)
+{
+	int i;
+	int index;
+
+	for (i = 0; ChineseGBSort[i] != 0xFFFF; i++)
+	{
+		index = GBSortIndex(ChineseGBSort[i]);
+		assert(index >= 0);
+		if (index >= 0 && gGBSortRank[index] == 0)
+			gGBSortRank[index] = i + 1;
+	}
+	gGBSortCount = i;
+}
+
+static inline int GBSortRank(int Code)
+{
+	int index = GBSortIndex(Code);
+
+	if (index < 0 || gGBSortRank[index] == 0)
+		return gGBSortCount;
+	return gGBSortRank[index] - 1;
+}
+
+// next character of a gb string, return its code, 0 at the end
+static inline int GBSortNextCode(const unsigned char* SrcString, int* Length)
+{
+	int Code = SrcString[*Length];
+
+	if (Code == 0)
+		return 0;
+	if (Code >= 0x80 && SrcString[*Length + 1] != '\0')
+	{
+		Code = (Code << 8) + SrcString[*Length + 1];
+		*Length += 2;
+	}
+	else
+	{
+		*Length += 1;
+	}
+	return Code;
+}
+
 int SearchSortRule(int Code, int *RULE)
 {
 	long i = 0;
-	signed int code = Code;
+
+	if (RULE == ChineseGBSort)
+	{
+		pthread_once(&gGBSortOnce, GBSortInit);
+		return GBSortRank(Code);
+	}
 	while(RULE[i] != 0xFFFF)
 	{
 		if(RULE[i] == (int)Code)
@@ -2151,52 +2514,119 @@ int SearchSortRule(int Code, int *RULE)
 //中文直接根据定好顺序排列,4个字节一?
 int GBRULE(unsigned char *SrcString, unsigned char *SortString, int *RULE)
 {
+	static const char HexDigit[] = "0123456789abcdef";
 	int ReturnLength = 0, Length = 0, SortTurn = 0;
-	char buffer[10];
 	int  Code;
-	while(SrcString[Length] != '\0')
+
+	if (RULE == ChineseGBSort)
+		pthread_once(&gGBSortOnce, GBSortInit);
+	while((Code = GBSortNextCode(SrcString, &Length)) != 0)
 	{
-		memset(buffer, 0, 10);
-		if(SrcString[Length] >= 0x80)
-		{
-			Code = (SrcString[Length] << 8) + SrcString[Length + 1];
-			Length += 2;
-		}
-		else
+		SortTurn = (RULE == ChineseGBSort) ? GBSortRank(Code) : SearchSortRule(Code, RULE);
+		SortString[ReturnLength++] = HexDigit[(SortTurn >> 12) & 0xF];
+		SortString[ReturnLength++] = HexDigit[(SortTurn >> 8) & 0xF];
+		SortString[ReturnLength++] = HexDigit[(SortTurn >> 4) & 0xF];
+		SortString[ReturnLength++] = HexDigit[SortTurn & 0xF];
+		SortString[ReturnLength] = '\0';
+	}
+	return ReturnLength;
+}
+
+//----------------------------------------------------------------------------//
+// binary sort key of a gb string, 2 bytes big endian per character so keys compare
+// with MCodeCompareSortKey in the same order as the GBRULE strings
+int MCodeGBSortKey(const unsigned char* gb, unsigned char* key, int keySize)
+{
+	int Length = 0;
+	int ReturnLength = 0;
+	int Code;
+	int SortTurn;
+
+	pthread_once(&gGBSortOnce, GBSortInit);
+	while(ReturnLength + 2 <= keySize && (Code = GBSortNextCode(gb, &Length)) != 0)
+	{
+		SortTurn = GBSortRank(Code);
+		key[ReturnLength++] = SortTurn >> 8;
+		key[ReturnLength++] = SortTurn & 0xFF;
+	}
+	return ReturnLength;
+}
+
+//----------------------------------------------------------------------------//
+int MCodeCompareSortKey(const unsigned char* a, int lenA, const unsigned char* b, int lenB)
+{
+	int ret = memcmp(a, b, (lenA < lenB) ? lenA : lenB);
+
+	if (ret != 0)
+		return ret;
+	return lenA - lenB;
+}
+
+//----------------------------------------------------------------------------//
+// sort keys (and optionally shoupin) of a whole name list in one pass, names are utf-8.
+// key of names[i] is keys[offsets[i]] ~ keys[offsets[i+1]], offsets needs count+1 entries.
+// shoupin, if not NULL, gets shoupinSize bytes per name, zero terminated.
+// names are cut at MCODE_SORT_NAME_MAX gb bytes. no heap is used.
+// return number of names done, less than count if keys is full
+int MCodeUTF8SortKeys(const char* const* names, int count, unsigned char* keys, int keySize, int* offsets, char* shoupin, int shoupinSize)
+{
+	unsigned char strGB[MCODE_SORT_NAME_MAX + 1];
+	unsigned char strPin[MCODE_SORT_NAME_MAX + 1];
+	int used = 0;
+	int len;
+	int i;
+
+	pthread_once(&gGBSortOnce, GBSortInit);
+	offsets[0] = 0;
+	for (i = 0; i < count; i++)
+	{
+		len = MCodeConvertBuffer("UTF-8", "gb18030", names[i], strlen(names[i]), (char*)strGB, MCODE_SORT_NAME_MAX);
+		strGB[(len > 0) ? len : 0] = '\0';
+		if (used + len * 2 > keySize)
+			break;
+		used += MCodeGBSortKey(strGB, keys + used, keySize - used);
+		offsets[i + 1] = used;
+
+		if (shoupin != NULL && shoupinSize > 0)
 		{
-			Code = SrcString[Length];
-			Length++;
+			GetShouPin(strGB, strPin);
+			strncpy(shoupin + i * shoupinSize, (char*)strPin, shoupinSize - 1);
+			shoupin[i * shoupinSize + shoupinSize - 1] = '\0';
 		}
-		SortTurn = SearchSortRule(Code, RULE);
-		//ok
-		sprintf((char *)(SortString+ReturnLength), "%04x", SortTurn);
-		ReturnLength += 4;
 	}
-	return ReturnLength;
+	return i;
 }
 
 //----------------------------------------------------------------------------//
 int getUtf8StringGBArrayIndex(char *strUtf8, char *strSort)
 {
+	char strBuf[MCODE_SORT_NAME_MAX + 1];
 	char *strGB;
+	int utf8Len = strlen(strUtf8);
+	int gbLen;
 	int sortLen;
 
-	strGB = (char *)calloc(strlen(strUtf8)*2, 1);
+	// a 2 or 3 byte utf-8 character may take 4 bytes in gb18030, the heap is only for very long strings
+	strGB = (utf8Len * 2 < (int)sizeof(strBuf)) ? strBuf : (char *)malloc(utf8Len * 2 + 1);
 
 	if(strGB == NULL)
 	{
 		return 0;
 	}
 
-	if(MCodeConvert_UTF8toGB2312(strUtf8, strGB, strlen(strUtf8), strlen(strUtf8)*2) == 0)
+	gbLen = MCodeConvertBuffer("UTF-8", "gb18030", strUtf8, utf8Len, strGB, utf8Len * 2);
+	if(gbLen <= 0)
 	{
-		free(strGB);
+		if(strGB != strBuf)
+			free(strGB);
 		return 0;
 	}
+	strGB[gbLen] = '\0';
 
 	sortLen = GBRULE((unsigned char *)strGB, (unsigned char *)strSort, ChineseGBSort);
 
-	free(strGB);
+	if(strGB != strBuf)
+		free(strGB);
 	return sortLen;
 }
 
@@ -28,6 +28,21 @@ extern unsigned char UCS2toUTF8Code(unsigned short ucs2_code, unsigned char* utf
 
 int MCodeConvertAPI(const char* from_charset, const char *to_charset, char* in_buffer, char* out_buffer, int Len1, int Len2);
 
+// convert a whole buffer with the converter cached for this thread, gb18030 <-> UTF-8
+// takes a table fast path. stops at the first byte that can not be converted or when
+// out_buffer is full, out_buffer is not cleared or terminated.
+// return bytes written, -1 if iconv has no such conversion
+int MCodeConvertBuffer(const char* from_charset, const char* to_charset, const char* in_buffer, int Len1, char* out_buffer, int Len2);
+
+#define MCODE_SORT_NAME_MAX		254		// gb bytes of a name used by MCodeUTF8SortKeys
+
+// sort string by the ChineseGBSort order, 4 hex digits per character, see MCodeConvert.cpp
+extern int getUtf8StringGBArrayIndex(char *strUtf8, char *strSort);
+// binary sort keys in the same order, 2 bytes per character, compared with MCodeCompareSortKey
+int MCodeGBSortKey(const unsigned char* gb, unsigned char* key, int keySize);
+int MCodeCompareSortKey(const unsigned char* a, int lenA, const unsigned char* b, int lenB);
+int MCodeUTF8SortKeys(const char* const* names, int count, unsigned char* keys, int keySize, int* offsets, char* shoupin, int shoupinSize);
+
 int isNotHead(unsigned char b);   //......
 unsigned short makeChar(int b1, int b2);  //.....
 
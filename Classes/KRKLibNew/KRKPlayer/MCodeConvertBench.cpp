@@ -0,0 +1,268 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : MCodeConvertBench.cpp
+//
+// Description: standalone benchmark for the GB2312/UTF-8 transcoding, not part
+//				of the app. converts song name sized lines with iconv_open/iconv/
+//				iconv_close per call (the old CodeConverter path) and with
+//				MCodeConvertBuffer, and checks both give the same bytes.
+//				times GBRULE sort strings against the table based sort keys.
+//
+//	build:	g++ -O2 -DMCODE_CONVERT_BENCH -DMCODE_CONVERT_BENCH_LIBC -I../CEGUI MCodeConvertBench.cpp MCodeConvert.cpp -lpthread
+//			(MCODE_CONVERT_BENCH_LIBC maps libiconv to the C library's iconv)
+//	run:	./a.out [lines]		(default 100000)
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#ifdef MCODE_CONVERT_BENCH
+
+#include "MCodeConvert.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#ifdef MCODE_CONVERT_BENCH_LIBC
+#undef iconv_open
+#undef iconv
+#undef iconv_close
+extern "C" iconv_t iconv_open(const char* tocode, const char* fromcode);
+extern "C" size_t iconv(iconv_t cd, char** inbuf, size_t* inbytesleft, char** outbuf, size_t* outbytesleft);
+extern "C" int iconv_close(iconv_t cd);
+
+extern "C" iconv_t libiconv_open(const char* tocode, const char* fromcode)
+{
+	return iconv_open(tocode, fromcode);
+}
+extern "C" size_t libiconv(iconv_t cd, const char** inbuf, size_t* inbytesleft, char** outbuf, size_t* outbytesleft)
+{
+	return iconv(cd, (char**)inbuf, inbytesleft, outbuf, outbytesleft);
+}
+extern "C" int libiconv_close(iconv_t cd)
+{
+	return iconv_close(cd);
+}
+#define benchIconvOpen	libiconv_open
+#define benchIconv		libiconv
+#define benchIconvClose	libiconv_close
+#else
+#define benchIconvOpen	iconv_open
+#define benchIconv		iconv
+#define benchIconvClose	iconv_close
+#endif
+
+#define BENCH_LINE_SIZE		256
+
+//----------------------------------------------------------------------------//
+static long long benchNowUs(void)
+{
+#ifdef WIN32
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return now.QuadPart * 1000000 / freq.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+//----------------------------------------------------------------------------//
+// the per call path MCodeConvertAPI had before the converter cache
+static int convertOld(const char* from, const char* to, const char* in, int Len1, char* out, int Len2)
+{
+	iconv_t cd = benchIconvOpen(to, from);
+	const char* pin = in;
+	char* pout = out;
+	size_t inLeft = Len1;
+	size_t outLeft = Len2;
+
+	memset(out, 0, Len2);
+	if (cd == (iconv_t)-1)
+		return Len2;
+	benchIconv(cd, &pin, &inLeft, &pout, &outLeft);
+	benchIconvClose(cd);
+	return (int)outLeft;
+}
+
+//----------------------------------------------------------------------------//
+// 4~30 bytes of gb2312 hanzi and ascii, every 16th line has a gbk/gb18030 only
+// character or a broken tail so the iconv fallback is covered as well
+static void makeLine(std::string& line, int n)
+{
+	int len = 4 + rand()%27;
+
+	line.clear();
+	while ((int)line.size() < len) {
+		if (rand()%4 == 0) {
+			line += (char)('a' + rand()%26);
+		}
+		else {
+			line += (char)(0xB0 + rand()%40);
+			line += (char)(0xA1 + rand()%94);
+		}
+	}
+	if (n%16 == 5) {
+		line += (char)0x81;
+		line += (char)(0x40 + rand()%60);
+		line += "end";
+	}
+	else if (n%16 == 11) {
+		line += (char)0xC4;
+	}
+}
+
+//----------------------------------------------------------------------------//
+static bool run(const char* title, const char* from, const char* to, const std::vector<std::string>& lines, std::vector<std::string>* result)
+{
+	char outOld[BENCH_LINE_SIZE];
+	char outNew[BENCH_LINE_SIZE];
+	long long t0, usOld, usNew;
+	int remainOld, remainNew;
+	size_t i;
+
+	t0 = benchNowUs();
+	for (i = 0; i < lines.size(); i++)
+		convertOld(from, to, lines[i].data(), lines[i].size(), outOld, sizeof(outOld));
+	usOld = benchNowUs()-t0;
+
+	t0 = benchNowUs();
+	for (i = 0; i < lines.size(); i++)
+		MCodeConvertAPI(from, to, (char*)lines[i].data(), outNew, lines[i].size(), sizeof(outNew));
+	usNew = benchNowUs()-t0;
+
+	for (i = 0; i < lines.size(); i++) {
+		remainOld = convertOld(from, to, lines[i].data(), lines[i].size(), outOld, sizeof(outOld));
+		remainNew = MCodeConvertAPI(from, to, (char*)lines[i].data(), outNew, lines[i].size(), sizeof(outNew));
+		if (remainOld != remainNew || memcmp(outOld, outNew, sizeof(outOld)) != 0) {
+			printf("%s: line %d differs, remain %d/%d\n", title, (int)i, remainOld, remainNew);
+			return false;
+		}
+		if (result)
+			result->push_back(std::string(outNew, sizeof(outNew)-remainNew));
+	}
+
+	printf("%-12s lines[%d] per call iconv[%lldms %.0fns/line] cached+table[%lldms %.0fns/line] x%.1f\n",
+		title, (int)lines.size(), usOld/1000, usOld*1000.0/lines.size(), usNew/1000, usNew*1000.0/lines.size(),
+		(double)usOld/(usNew ? usNew : 1));
+	return true;
+}
+
+//----------------------------------------------------------------------------//
+// GBRULE as it was: linear search of ChineseGBSort and sprintf per character
+extern int ChineseGBSort[];
+extern int GBRULE(unsigned char *SrcString, unsigned char *SortString, int *RULE);
+static int GBRULEOld(const unsigned char* SrcString, char* SortString)
+{
+	int ReturnLength = 0, Length = 0, i, Code;
+
+	while (SrcString[Length] != '\0') {
+		if (SrcString[Length] >= 0x80 && SrcString[Length + 1] != '\0') {
+			Code = (SrcString[Length] << 8) + SrcString[Length + 1];
+			Length += 2;
+		}
+		else {
+			Code = SrcString[Length];
+			Length++;
+		}
+		for (i = 0; ChineseGBSort[i] != 0xFFFF && ChineseGBSort[i] != Code; i++)
+			;
+		sprintf(SortString + ReturnLength, "%04x", i);
+		ReturnLength += 4;
+	}
+	return ReturnLength;
+}
+
+//----------------------------------------------------------------------------//
+static bool runSortKeys(const std::vector<std::string>& gb, const std::vector<std::string>& utf8)
+{
+	std::vector<const char*> names;
+	std::vector<unsigned char> keys(utf8.size() * MCODE_SORT_NAME_MAX);
+	std::vector<int> offsets(utf8.size() + 1);
+	char sortOld[BENCH_LINE_SIZE * 4];
+	char sortNew[BENCH_LINE_SIZE * 4];
+	long long t0, usOld, usRule, usBatch;
+	int lenOld, lenNew, done;
+	size_t i, j;
+
+	for (i = 0; i < utf8.size(); i++)
+		names.push_back(utf8[i].c_str());
+
+	t0 = benchNowUs();
+	for (i = 0; i < gb.size(); i++)
+		GBRULEOld((const unsigned char*)gb[i].c_str(), sortOld);
+	usOld = benchNowUs()-t0;
+
+	t0 = benchNowUs();
+	for (i = 0; i < gb.size(); i++)
+		GBRULE((unsigned char*)gb[i].c_str(), (unsigned char*)sortNew, ChineseGBSort);
+	usRule = benchNowUs()-t0;
+
+	t0 = benchNowUs();
+	done = MCodeUTF8SortKeys(&names[0], names.size(), &keys[0], keys.size(), &offsets[0], NULL, 0);
+	usBatch = benchNowUs()-t0;
+
+	for (i = 0; i < gb.size(); i++) {
+		lenOld = GBRULEOld((const unsigned char*)gb[i].c_str(), sortOld);
+		lenNew = GBRULE((unsigned char*)gb[i].c_str(), (unsigned char*)sortNew, ChineseGBSort);
+		if (lenOld != lenNew || strcmp(sortOld, sortNew) != 0) {
+			printf("sort: line %d differs\n", (int)i);
+			return false;
+		}
+	}
+	// the binary keys must order the names like the sort strings do
+	for (i = 1; i < utf8.size() && (int)i < done; i++) {
+		char prev[BENCH_LINE_SIZE * 4];
+		j = i - 1;
+		getUtf8StringGBArrayIndex((char*)names[j], prev);
+		getUtf8StringGBArrayIndex((char*)names[i], sortNew);
+		int a = strcmp(prev, sortNew);
+		int b = MCodeCompareSortKey(&keys[offsets[j]], offsets[j+1]-offsets[j], &keys[offsets[i]], offsets[i+1]-offsets[i]);
+		if ((a < 0) != (b < 0) || (a == 0) != (b == 0)) {
+			printf("sort key: line %d orders differently\n", (int)i);
+			return false;
+		}
+	}
+
+	printf("%-12s lines[%d] linear+sprintf[%lldms] GBRULE[%lldms] batch keys from utf-8[%lldms] x%.1f\n",
+		"sort", (int)gb.size(), usOld/1000, usRule/1000, usBatch/1000, (double)usOld/(usRule ? usRule : 1));
+	return true;
+}
+
+//----------------------------------------------------------------------------//
+int main(int argc, char* argv[])
+{
+	int count = (argc > 1)? atoi(argv[1]) : 100000;
+	std::vector<std::string> gb, utf8;
+	std::string line;
+
+	srand(1234);
+	for (int i = 0; i < count; i++) {
+		makeLine(line, i);
+		gb.push_back(line);
+	}
+
+	if (!run("gb->utf8", "gb18030", "UTF-8", gb, &utf8))
+		return 1;
+	if (!run("utf8->gb", "UTF-8", "gb18030", utf8, NULL))
+		return 1;
+	if (!runSortKeys(gb, utf8))
+		return 1;
+	return 0;
+}
+
+#endif
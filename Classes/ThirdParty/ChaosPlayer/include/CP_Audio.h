@@ -34,6 +34,24 @@ typedef long (*FuncAudioSrcClose)(AUDIO_IN_HANDLE);
 //ɹضȡʧܷ-1
 typedef long (*FuncAudioSrcRead)(AUDIO_IN_HANDLE, void *, unsigned long);
 
+// capture stream state that comes with a srcwait read
+typedef struct tagAUDIO_IN_STAT
+{
+	unsigned long long	Time;			// capture time of the first frame read, us of the monotonic clock, 0 not known
+	unsigned long		Queued;			// bytes still queued after the read
+	unsigned long		Overruns;		// blocks the device dropped since open, the reader fell behind
+	unsigned long		OverrunBytes;
+}AUDIO_IN_STAT;
+
+// arg 1: audio in handle
+// arg 2: buffer address
+// arg 3: bytes to read
+// arg 4: timeout in ms, -1 waits until the bytes are there
+// arg 5: stat of this read, may be NULL
+// blocks until the device has the bytes or the timeout passes instead of
+// being polled, returns the bytes read, less on timeout, -1 on error
+typedef long (*FuncAudioSrcWait)(AUDIO_IN_HANDLE, void *, unsigned long, long, AUDIO_IN_STAT *);
+
 //1Ƶ
 //2Ƶ
 //ɹؾʧܷNULL
@@ -92,6 +110,8 @@ typedef struct tagAudioIFs
 	FuncAudio_Finish     finish;
 	
 	FuncAudio_Set			setAudio;
+
+	FuncAudioSrcWait		srcwait;		// NULL when the source can only be polled with srcread
 } CP_AudioIFs;
 
 #endif
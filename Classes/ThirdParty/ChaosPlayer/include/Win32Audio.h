@@ -10,6 +10,7 @@ extern "C" {
 AUDIO_IN_HANDLE Win32AudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 long Win32AudioIn_Close (AUDIO_IN_HANDLE Handle);
 long Win32AudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size);
+long Win32AudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat);
 
 AUDIO_OUT_HANDLE Win32AudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 long Win32AudioOut_Close (AUDIO_OUT_HANDLE Handle);
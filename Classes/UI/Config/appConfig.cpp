@@ -17,6 +17,9 @@
 #include <gui/widgets/GuiWidgets.h>
 #include <lib/ezbase/ez_config.h>
 #include "appConfig.h"
+#include <sys/stat.h>
+#include <time.h>
+#include <ctype.h>
 
 #define isSettingsConfig()	(strcmp(ez_config_get_config_name(appMICConfig.handle), appMICConfig.configs[appMIC_Config_Settings]) == 0)
 
@@ -713,8 +716,11 @@ int appConfig_save(void)
  * Description    	: load config from file to memory
  *					
 */
+static void songPath_init(void);
+
 int appConfig_load(const char* filePath)
 {
+	songPath_init();
 	appMICConfig.handle = ez_config_load(filePath);
 	if (appMICConfig.handle != NULL)
 	{
@@ -762,52 +768,512 @@ int appConfig_unload(int autosave)
 	return false;
 }
 
-bool appConfig_getSongPath(char *path, int songIndex)
+/* 
+* song path index
+*	song number -> bit mask of the candidate files found on disk. candidates keep
+*	the probing order of the old fopen chain, the first one set wins.
+*	folders are scanned once at build, later a folder is scanned again only when
+*	its mtime changes, checked on lookup at most once per SONGPATH_CHECK_MS.
+*/
+#define SONGPATH_ROOT_COUNT		3
+#define SONGPATH_SUB_COUNT		100			// SONG/00/ ~ SONG/99/
+#define SONGPATH_CAND_COUNT		7
+#define SONGPATH_CHECK_MS		2000
+#define SONGPATH_MTIME_RES		2			// FAT keeps mtime in 2 seconds
+#define SONGPATH_MTIME_RECENT	((time_t)-1)
+#define SONGPATH_HASH_MIN		4096
+#define SONGPATH_HASH_EMPTY		-1
+
+enum
+{
+	SONGPATH_ROOT_EXT = 0,
+	SONGPATH_ROOT_UPDATE,
+	SONGPATH_ROOT_INT,
+};
+
+typedef struct
+{
+	int root;
+	int digits;
+	const char* ext;
+	
+} appSongPathCand_t;
+
+typedef struct
+{
+	int song;								// SONGPATH_HASH_EMPTY - free slot
+	unsigned int mask;						// candidates found on disk
+	
+} appSongPathEntry_t;
+
+typedef struct
+{
+	time_t mtime;							// 0 - folder not exist, SONGPATH_MTIME_RECENT - changed just now
+	unsigned long checkTime;
+	int valid;								// 0 - must scan again
+	int filled;								// songs of this folder may be in the table
+	
+} appSongPathDir_t;
+
+typedef struct
+{
+	int songs;								// songs found on disk
+	int hits;								// lookups resolved by the index
+	int misses;								// lookups of songs not on disk
+	int stales;								// indexed files gone at lookup
+	int rescans;							// folders scanned again after a change
+	
+} appSongPathStat_t;
+
+typedef struct
+{
+	int ready;
+	int lockReady;
+	krk_os_sema_t lock;
+	krk_os_task_t task;
+	char base[SONGPATH_ROOT_COUNT][MIC_RES_FILE_STR_MAX];
+	appSongPathDir_t dirs[SONGPATH_ROOT_COUNT][SONGPATH_SUB_COUNT];	// update root uses dirs[][0] only
+	appSongPathEntry_t* table;
+	int tableSize;							// power of 2
+	int tableUsed;
+	appSongPathStat_t stat;
+	
+} appSongPathIndex_t;
+
+static const appSongPathCand_t songPathCands[SONGPATH_CAND_COUNT] = 
 {
-	FILE* fp;
-	char temppath[10] = {0};
-	sprintf(temppath, "%05d", songIndex);
-	temppath[2] = '/';
-	temppath[3] = '\0';
+	{SONGPATH_ROOT_EXT, 5, ".MUK"},
+	{SONGPATH_ROOT_EXT, 5, ".MUS"},
+	{SONGPATH_ROOT_EXT, 6, ".MUK"},
+	{SONGPATH_ROOT_UPDATE, 5, ".MUK"},
+	{SONGPATH_ROOT_UPDATE, 6, ".MUK"},
+	{SONGPATH_ROOT_INT, 5, ".MUK"},
+	{SONGPATH_ROOT_INT, 6, ".MUK"},
+};
+
+static const int songPathRootType[SONGPATH_ROOT_COUNT] = 
+{
+	APPMIC_PATH_KARAOKE_EXT, 
+	APPMIC_PATH_UPDATESONG, 
+	APPMIC_PATH_KARAOKE_INT,
+};
+
+#define songPathRootHasSub(root)	((root) != SONGPATH_ROOT_UPDATE)
+
+static appSongPathIndex_t songPathIndex;
 
-	sprintf(path, "%s%s%s%05d%s", appConfig_getPath(APPMIC_PATH_KARAOKE_EXT),(char*)MIC_SONG_PATH, temppath, songIndex, ".MUK");
-	fp = fopen(path, "rb");
-	if (fp == NULL)
+/* once at config load, before any thread looks a song up */
+static void songPath_init(void)
+{
+	if (songPathIndex.lockReady)
+		return;
+	if (krk_os_sema_create(&songPathIndex.lock, "songpath", 1, NULL) == KRK_OS_RET_FAIL)
 	{
-		sprintf(path, "%s%s%s%05d%s", appConfig_getPath(APPMIC_PATH_KARAOKE_EXT),(char*)MIC_SONG_PATH, temppath, songIndex, ".MUS"); 
-		fp = fopen(path, "rb");
-		if (fp == NULL)
+		gui_printf("Fail to create song path lock\n");
+		KRK_ASSERT(0);
+		return;
+	}
+	songPathIndex.lockReady = true;
+}
+
+static void songPath_lock(void)
+{
+	krk_os_sema_pend(&songPathIndex.lock, KRK_OS_WAIT, NULL);
+}
+
+static void songPath_unlock(void)
+{
+	krk_os_sema_post(&songPathIndex.lock, NULL);
+}
+
+/* sub folder of a song, the first two characters of its 5 digits number */
+static int songPath_sub(int song)
+{
+	if (song < 0)
+		return 0;
+	while (song >= 100000)
+		song /= 10;
+	return song / 1000;
+}
+
+static void songPath_dirPath(char* path, int root, int sub)
+{
+	if (songPathRootHasSub(root))
+		sprintf(path, "%s%s%02d/", songPathIndex.base[root], (char*)MIC_SONG_PATH, sub);
+	else
+		sprintf(path, "%s", songPathIndex.base[root]);
+}
+
+static void songPath_filePath(char* path, int cand, int song)
+{
+	const appSongPathCand_t* c = &songPathCands[cand];
+
+	if (songPathRootHasSub(c->root))
+		sprintf(path, "%s%s%02d/%0*d%s", songPathIndex.base[c->root], (char*)MIC_SONG_PATH, songPath_sub(song), c->digits, song, c->ext);
+	else
+		sprintf(path, "%s%0*d%s", songPathIndex.base[c->root], c->digits, song, c->ext);
+}
+
+static time_t songPath_dirTime(const char* path)
+{
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return 0;
+	return st.st_mtime;
+}
+
+static unsigned int songPath_hash(int song, int size)
+{
+	return ((unsigned int)song * 2654435761u) & (size - 1);
+}
+
+static void songPath_resize(int size)
+{
+	appSongPathIndex_t* index = &songPathIndex;
+	appSongPathEntry_t* old = index->table;
+	int oldSize = index->tableSize;
+	int i;
+
+	index->table = (appSongPathEntry_t*)malloc(size * sizeof(appSongPathEntry_t));
+	index->tableSize = size;
+	index->tableUsed = 0;
+	for (i = 0; i < size; i++)
+	{
+		index->table[i].song = SONGPATH_HASH_EMPTY;
+		index->table[i].mask = 0;
+	}
+
+	/* songs gone from disk are dropped here */
+	for (i = 0; i < oldSize; i++)
+	{
+		if (old[i].song != SONGPATH_HASH_EMPTY && old[i].mask != 0)
 		{
-			sprintf(path, "%s%s%s%06d%s", appConfig_getPath(APPMIC_PATH_KARAOKE_EXT),(char*)MIC_SONG_PATH, temppath, songIndex, ".MUK"); 
-			fp = fopen(path, "rb");
-			if (fp == NULL)
+			unsigned int h = songPath_hash(old[i].song, size);
+			while (index->table[h].song != SONGPATH_HASH_EMPTY)
+				h = (h + 1) & (size - 1);
+			index->table[h] = old[i];
+			index->tableUsed++;
+		}
+	}
+	if (old != NULL)
+		free(old);
+}
+
+static appSongPathEntry_t* songPath_find(int song, int add)
+{
+	appSongPathIndex_t* index = &songPathIndex;
+	unsigned int h;
+
+	/* grow, or just drop the songs gone from disk if that frees enough */
+	if (add && (index->tableUsed + 1) * 2 > index->tableSize)
+	{
+		if ((index->stat.songs + 1) * 4 > index->tableSize)
+			songPath_resize(index->tableSize * 2);
+		else
+			songPath_resize(index->tableSize);
+	}
+
+	h = songPath_hash(song, index->tableSize);
+	while (index->table[h].song != SONGPATH_HASH_EMPTY)
+	{
+		if (index->table[h].song == song)
+			return &index->table[h];
+		h = (h + 1) & (index->tableSize - 1);
+	}
+	if (!add)
+		return NULL;
+
+	index->table[h].song = song;
+	index->table[h].mask = 0;
+	index->tableUsed++;
+	return &index->table[h];
+}
+
+static void songPath_setMask(appSongPathEntry_t* entry, unsigned int mask)
+{
+	if (entry->mask == 0 && mask != 0)
+		songPathIndex.stat.songs++;
+	else if (entry->mask != 0 && mask == 0)
+		songPathIndex.stat.songs--;
+	entry->mask = mask;
+}
+
+static unsigned int songPath_rootMask(int root)
+{
+	unsigned int mask = 0;
+	int i;
+
+	for (i = 0; i < SONGPATH_CAND_COUNT; i++)
+	{
+		if (songPathCands[i].root == root)
+			mask |= (1 << i);
+	}
+	return mask;
+}
+
+/* drop the candidates of a root, sub < 0 for all sub folders */
+static void songPath_clear(int root, int sub)
+{
+	appSongPathIndex_t* index = &songPathIndex;
+	unsigned int mask = songPath_rootMask(root);
+	int filled = false;
+	int i;
+
+	for (i = 0; i < SONGPATH_SUB_COUNT; i++)
+	{
+		if ((sub < 0 || !songPathRootHasSub(root) || i == sub) && index->dirs[root][i].filled)
+		{
+			index->dirs[root][i].filled = false;
+			filled = true;
+		}
+	}
+	/* nothing of these folders indexed yet, a fresh build never walks the table */
+	if (!filled)
+		return;
+
+	for (i = 0; i < index->tableSize; i++)
+	{
+		appSongPathEntry_t* entry = &index->table[i];
+		if (entry->song != SONGPATH_HASH_EMPTY && (entry->mask & mask)
+			&& (sub < 0 || !songPathRootHasSub(root) || songPath_sub(entry->song) == sub))
+			songPath_setMask(entry, entry->mask & ~mask);
+	}
+}
+
+static void songPath_scanDir(int root, int sub, time_t mtime, unsigned long now)
+{
+	appSongPathIndex_t* index = &songPathIndex;
+	appSongPathDir_t* d = &index->dirs[root][sub];
+	time_t t = time(NULL);
+	char path[MIC_RES_FILE_STR_MAX + 16];
+	DIR* dir;
+	struct dirent* entry;
+
+	songPath_clear(root, sub);
+
+	/* a file added in the same mtime tick would not move mtime, scan again at next check */
+	d->mtime = (mtime != 0 && t >= mtime && t - mtime <= SONGPATH_MTIME_RES) ? SONGPATH_MTIME_RECENT : mtime;
+	d->checkTime = now;
+	d->valid = true;
+	if (mtime == 0)
+		return;
+
+	songPath_dirPath(path, root, sub);
+	if ((dir = opendir(path)) == NULL)
+		return;
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		const char* name = krk_get_entry_name(entry);
+		int digits = strspn(name, "0123456789");
+		int song;
+		int i;
+
+		if (krk_entryisdir(entry) || (digits != 5 && digits != 6))
+			continue;
+		song = atoi(name);
+		if (songPathRootHasSub(root) && songPath_sub(song) != sub)
+			continue;
+
+		for (i = 0; i < SONGPATH_CAND_COUNT; i++)
+		{
+			const appSongPathCand_t* c = &songPathCands[i];
+			if (c->root == root && c->digits == digits && stricmp(name + digits, c->ext) == 0)
 			{
-				sprintf(path, "%s%05d%s", appConfig_getPath(APPMIC_PATH_UPDATESONG), songIndex, ".MUK");
-				fp = fopen(path, "rb");
-				if (fp == NULL)
+				appSongPathEntry_t* e = songPath_find(song, true);
+				songPath_setMask(e, e->mask | (1 << i));
+				d->filled = true;
+			}
+		}
+	}
+	closedir(dir);
+}
+
+/* follow the configured path, a changed root is scanned again lazily */
+static void songPath_syncBase(int root)
+{
+	appSongPathIndex_t* index = &songPathIndex;
+	const char* base = appConfig_getPath(songPathRootType[root]);
+	int sub;
+
+	if (base == NULL)
+		base = "";
+	if (strcmp(index->base[root], base) == 0)
+		return;
+
+	songPath_clear(root, -1);
+	memset(index->base[root], 0, sizeof(index->base[root]));
+	strncpy(index->base[root], base, sizeof(index->base[root]) - 1);
+	for (sub = 0; sub < SONGPATH_SUB_COUNT; sub++)
+		index->dirs[root][sub].valid = false;
+}
+
+static void songPath_checkDir(int root, int sub, unsigned long now)
+{
+	appSongPathDir_t* d = &songPathIndex.dirs[root][sub];
+	char path[MIC_RES_FILE_STR_MAX + 16];
+	time_t mtime;
+
+	if (songPathIndex.base[root][0] == '\0')
+		return;
+	if (d->valid && now - d->checkTime < SONGPATH_CHECK_MS)
+		return;
+
+	songPath_dirPath(path, root, sub);
+	mtime = songPath_dirTime(path);
+	if (!d->valid || mtime != d->mtime)
+	{
+		songPath_scanDir(root, sub, mtime, now);
+		songPathIndex.stat.rescans++;
+	}
+	else
+	{
+		d->checkTime = now;
+	}
+}
+
+/* called with the lock held */
+static void songPath_build(void)
+{
+	appSongPathIndex_t* index = &songPathIndex;
+	unsigned long now = krk_curTime();
+	char path[MIC_RES_FILE_STR_MAX + 16];
+	int root;
+	int sub;
+
+	if (index->table != NULL)
+		free(index->table);
+	index->table = NULL;
+	index->tableSize = 0;
+	memset(&index->stat, 0, sizeof(index->stat));
+	memset(index->base, 0, sizeof(index->base));
+	memset(index->dirs, 0, sizeof(index->dirs));
+	songPath_resize(SONGPATH_HASH_MIN);
+
+	for (root = 0; root < SONGPATH_ROOT_COUNT; root++)
+	{
+		songPath_syncBase(root);
+		if (index->base[root][0] == '\0')
+			continue;
+
+		if (songPathRootHasSub(root))
+		{
+			DIR* dir;
+			struct dirent* entry;
+			char present[SONGPATH_SUB_COUNT];
+
+			/* stat only the sub folders that exist, d_type is not reliable on every fs */
+			memset(present, 0, sizeof(present));
+			sprintf(path, "%s%s", index->base[root], (char*)MIC_SONG_PATH);
+			if ((dir = opendir(path)) != NULL)
+			{
+				while ((entry = readdir(dir)) != NULL)
+				{
+					const char* name = krk_get_entry_name(entry);
+					if (isdigit((unsigned char)name[0]) && isdigit((unsigned char)name[1]) && name[2] == '\0')
+						present[(name[0]-'0')*10 + (name[1]-'0')] = true;
+				}
+				closedir(dir);
+			}
+			
+			for (sub = 0; sub < SONGPATH_SUB_COUNT; sub++)
+			{
+				if (present[sub])
+				{
+					songPath_dirPath(path, root, sub);
+					songPath_scanDir(root, sub, songPath_dirTime(path), now);
+				}
+				else
 				{
-					sprintf(path, "%s%06d%s", appConfig_getPath(APPMIC_PATH_UPDATESONG), songIndex, ".MUK");
-					fp = fopen(path, "rb");
-					if (fp == NULL)
-					{
-						sprintf(path, "%s%s%s%05d%s", appConfig_getPath(APPMIC_PATH_KARAOKE_INT), (char*)MIC_SONG_PATH, temppath, songIndex, ".MUK");
-						fp = fopen(path, "rb");
-						if (fp == NULL)
-						{
-							sprintf(path, "%s%s%s%06d%s", appConfig_getPath(APPMIC_PATH_KARAOKE_INT), (char*)MIC_SONG_PATH, temppath, songIndex, ".MUK");
-							fp = fopen(path, "rb");
-							if (fp == NULL)
-							{
-								return false;
-							}
-						}
-					}
+					songPath_scanDir(root, sub, 0, now);
 				}
 			}
 		}
+		else
+		{
+			songPath_dirPath(path, root, 0);
+			songPath_scanDir(root, 0, songPath_dirTime(path), now);
+		}
 	}
-	fclose(fp);
-	return true;
+	index->ready = true;
+	gui_printf("song path index: %d songs, %lums\n", index->stat.songs, krk_curTime() - now);
+}
+
+static KRK_TASK_RET_TYPE songPath_buildThread(KRK_TASK_ENTRY_ARG arg)
+{
+	songPath_lock();
+	if (!songPathIndex.ready)
+		songPath_build();
+	songPath_unlock();
+
+	krk_os_task_selfdel();
+	return KRK_TASK_RET_VAL;
+}
+
+/*
+ * Function name  	: appConfig_buildSongPathIndex
+ * Arguments      	: none
+ * Return         	: none
+ * Description    	: scan song folders on a low priority task and index song files by number,
+ *					a lookup meanwhile waits for the scan to end
+*/
+void appConfig_buildSongPathIndex(void)
+{
+	if (!songPathIndex.lockReady || songPathIndex.ready)
+		return;
+	if (krk_os_task_create(&songPathIndex.task, "songpath", songPath_buildThread, 0x8000, KRK_TASK_PRIORITY_LOW, NULL) == KRK_OS_RET_FAIL)
+		gui_printf("Fail to create song path task, index is built at first lookup\n");
+}
+
+bool appConfig_getSongPath(char *path, int songIndex)
+{
+	appSongPathIndex_t* index = &songPathIndex;
+	appSongPathEntry_t* entry;
+	unsigned long now;
+	int root;
+	int i;
+
+	if (!index->lockReady)
+	{
+		path[0] = '\0';
+		return false;
+	}
+
+	songPath_lock();
+	if (!index->ready)
+		songPath_build();
+	now = krk_curTime();
+	for (root = 0; root < SONGPATH_ROOT_COUNT; root++)
+	{
+		songPath_syncBase(root);
+		if (songIndex >= 0)
+			songPath_checkDir(root, songPathRootHasSub(root) ? songPath_sub(songIndex) : 0, now);
+	}
+
+	entry = (songIndex >= 0) ? songPath_find(songIndex, false) : NULL;
+	for (i = 0; entry != NULL && i < SONGPATH_CAND_COUNT; i++)
+	{
+		if (!(entry->mask & (1 << i)))
+			continue;
+
+		songPath_filePath(path, i, songIndex);
+		if (krk_fexist(path))
+		{
+			index->stat.hits++;
+			songPath_unlock();
+			return true;
+		}
+
+		/* removed behind our back, mtime did not catch it yet */
+		index->stat.stales++;
+		songPath_setMask(entry, entry->mask & ~(1 << i));
+		index->dirs[songPathCands[i].root][songPathRootHasSub(songPathCands[i].root) ? songPath_sub(songIndex) : 0].valid = false;
+	}
+
+	index->stat.misses++;
+	songPath_filePath(path, SONGPATH_CAND_COUNT - 1, songIndex);
+	songPath_unlock();
+	return false;
 }
 
 #include "api/filesToLstbin.h"
@@ -35,6 +35,7 @@
 #define M3D_CONFIG_FILE				"config.bin"
 #define M3D_CONFIG_KARAOKE_FILE		"Setting.bin"
 #define M3D_CONFIG_PROG_ID_FILE			"ProgIdEx.bin"
+#define M3D_CONFIG_PROG_JNL_FILE		"ProgIdEx.jnl"
 #define M3D_CONFIG_SONGINFO_FILE		"SongPlayInfo.bin"
 #define M3D_CONFIG_MYHOT_FILE			"MyHot.bin"
 #define M3D_CONFIG_FAVO_FILE			"Favo.bin"
@@ -769,6 +770,15 @@ extern int appConfig_load(const char* filePath);
 */
 extern int appConfig_unload(int autosave);
 
+/*
+ * Function name  	: appConfig_buildSongPathIndex
+ * Arguments      	: none
+ * Return         	: none
+ * Description    	: scan song folders on a low priority task and index song files by number,
+ *					appConfig_getSongPath builds it on first use if not called
+*/
+extern void appConfig_buildSongPathIndex(void);
+
 //
 extern bool appConfig_getSongPath(char *path, int songIndex);
 extern bool appConfig_getCDGPath(char *path, int songIndex);
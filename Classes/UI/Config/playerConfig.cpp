@@ -370,6 +370,7 @@ CP_AudioIFs AudioIFs =
 	_Win32Audio_Init,
 	Win32Audio_Finish,
 	NULL,
+	Win32AudioIn_Wait,
 };
 #elif defined F20_AUDIO
 #include "F20Audio.h"
@@ -398,7 +399,8 @@ CP_AudioIFs AudioIFs =
 	A20AudioOut_Write,
 	A20Audio_Init,
 	A20Audio_Finish,
-	A20Audio_Set
+	A20Audio_Set,
+	A20AudioIn_Wait,
 };
 #elif defined A10_AUDIO
 #include "A10Audio.h"
@@ -426,7 +428,8 @@ CP_AudioIFs AudioIFs =
 	OpenSLESAudioOut_Write,
 	OpenSLESAudio_Init,
 	OpenSLESAudio_Finish,
-	NULL
+	NULL,
+	OpenSLESAudioIn_Wait,
 };
 #elif defined JAVA_AUDIO
 #include "AndroidJavaAudio.h"
@@ -440,7 +443,8 @@ CP_AudioIFs AudioIFs =
 	AndroidJavaAudioOut_Write,
 	AndroidJavaAudio_Init,
 	AndroidJavaAudio_Finish,
-	AndroidJavaAudio_Set
+	AndroidJavaAudio_Set,
+	AndroidJavaAudioIn_Wait,
 };
 #elif defined AWJAVA_AUDIO
 #include "AWJavaAudio.h"
@@ -454,7 +458,8 @@ CP_AudioIFs AudioIFs =
 	AWJavaAudioOut_Write,
 	NULL,
 	AWJavaAudio_Finish,
-	AWJavaAudio_Set
+	AWJavaAudio_Set,
+	AWJavaAudioIn_Wait,
 };
 
 
@@ -208,9 +208,7 @@ namespace	CEGUI
 	}
 	int FormMain::MCodeConvert_GB2312toUTF8(const char* in_utf8, char* out_gb2312, int Len1, int Len2)
 	{
-		CodeConverter cc = CodeConverter("gb18030","UTF-8");//use gb18030 to instead of gb2312
-		cc.convert(in_utf8, &Len1, out_gb2312, &Len2);
-		return Len2;
+		return ::MCodeConvertAPI("gb18030", "UTF-8", (char*)in_utf8, out_gb2312, Len1, Len2);//use gb18030 to instead of gb2312
 	}
 	
 	void FormMain::handleMenuClicked(M3D_Item *item, int position)
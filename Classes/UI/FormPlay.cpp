@@ -937,8 +937,6 @@ void FormPlay::hidePlayTitle(void)
 
 int FormPlay::MCodeConvert_UTF8toGB2312(const char* in_utf8, char* out_gb2312, int Len1, int Len2)
 {
-    CodeConverter cc = CodeConverter("UTF-8","gb18030");//use gb18030 to instead of gb2312
-    cc.convert(in_utf8, &Len1, out_gb2312, &Len2);
-    return Len2;
+    return ::MCodeConvertAPI("UTF-8", "gb18030", (char*)in_utf8, out_gb2312, Len1, Len2);//use gb18030 to instead of gb2312
 }
 }
@@ -30,6 +30,8 @@
 
 #include "ReqListBuffer.h"
 #include "ReqDB.h"
+#include "ReqDecrypt.h"
+#include <system/file_copy.h>
 #include "PVRTString.h"
 #include "PVRTResourceFile.h"
 #define REQ_TEST
@@ -432,7 +434,7 @@ ReqDB::ReqDB(void* para1, int para2) : M3D_Req(para1, para2)
 	d_db = NULL;
 	g_stmt = NULL;
 	g_ztail = NULL;
-	result_buf = NULL;
+	memset(&result_songInf, 0, sizeof(result_songInf));
 	result_nrow = 0;
 	result_ncolumn = 0;
 
@@ -474,70 +476,76 @@ ReqDB::ReqDB(void* para1, int para2) : M3D_Req(para1, para2)
 	regSQLString(REQDB_SQL_ALLSONGINF, sqlstr);
 	sqlstr.assign("SELECT COUNT(SongIndex) FROM TableSong;");// count of songs
 	regSQLString(REQDB_SQL_SONGCOUNT, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_PINYIN WHERE SongIndex=%d;");// song info by SongIndex
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_PINYIN WHERE SongIndex=?;");// song info by SongIndex
 	regSQLString(REQDB_SQL_SONGINF, sqlstr);
-	sqlstr.assign("SELECT SongIndex FROM TableSong ORDER BY FirstWord LIMIT %d;");// SongIndex by Index
+	sqlstr.assign("SELECT SongIndex FROM TableSong ORDER BY FirstWord LIMIT 1 OFFSET ?;");// SongIndex by Index
 	regSQLString(REQDB_SQL_SONGINF_BY_INDEX, sqlstr);
+	sqlstr.assign("SELECT SongIndex FROM TableSong ORDER BY OrderIndex LIMIT 1 OFFSET ?;");// SongIndex by OrderIndex order
+	regSQLString(REQDB_SQL_SONGINDEX_BY_ORDER, sqlstr);
+	sqlstr.assign("SELECT SongIndex FROM TableSong WHERE OrderIndex=?;");
+	regSQLString(REQDB_SQL_SONGINDEX_BY_ORDERINDEX, sqlstr);
+	sqlstr.assign("SELECT OrderIndex FROM TableSong WHERE SongIndex=?;");
+	regSQLString(REQDB_SQL_ORDERINDEX_BY_SONGINDEX, sqlstr);
 
 	//singer
-	sqlstr.assign("SELECT SingerIndex, SingerName, FirstWord FROM View_SingerMale WHERE FirstWord>='%s' and FirstWord<='%szz' LIMIT %d OFFSET %d;");// singer male
+	sqlstr.assign("SELECT SingerIndex, SingerName, FirstWord FROM View_SingerMale WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// singer male
 	regSQLString(REQDB_SQL_SINGER_MALE, sqlstr);
-	sqlstr.assign("SELECT SingerIndex, SingerName, FirstWord FROM View_SingerFeMale WHERE FirstWord>='%s' and FirstWord<='%szz' LIMIT %d OFFSET %d;");// singer female
+	sqlstr.assign("SELECT SingerIndex, SingerName, FirstWord FROM View_SingerFeMale WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// singer female
 	regSQLString(REQDB_SQL_SINGER_FEMALE, sqlstr);
-	sqlstr.assign("SELECT SingerIndex, SingerName, FirstWord FROM View_SingerBand WHERE FirstWord>='%s' and FirstWord<='%szz' LIMIT %d OFFSET %d;");// singer female
+	sqlstr.assign("SELECT SingerIndex, SingerName, FirstWord FROM View_SingerBand WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// singer female
 	regSQLString(REQDB_SQL_SINGER_BAND, sqlstr);
 
-	sqlstr.assign("SELECT TableSong.SongIndex, TableSong.OrderIndex, TableSong.FileType, TableSong.SongName, TableSong.FirstWord, TableSinger.SingerName, TableSong.SubFileType FROM TableSongSinger1, TableSong, TableSinger WHERE TableSongSinger1.SongIndex=TableSong.SongIndex AND TableSongSinger1.SingerIndex=%d AND TableSongSinger1.SingerIndex=TableSinger.SingerIndex AND TableSong.FirstWord>='%s' COLLATE NOCASE and TableSong.FirstWord<='%szz' COLLATE NOCASE ORDER BY TableSong.FirstWord COLLATE NOCASE LIMIT %d OFFSET %d;");// singer song
+	sqlstr.assign("SELECT TableSong.SongIndex, TableSong.OrderIndex, TableSong.FileType, TableSong.SongName, TableSong.FirstWord, TableSinger.SingerName, TableSong.SubFileType FROM TableSongSinger1, TableSong, TableSinger WHERE TableSongSinger1.SongIndex=TableSong.SongIndex AND TableSongSinger1.SingerIndex=?5 AND TableSongSinger1.SingerIndex=TableSinger.SingerIndex AND TableSong.FirstWord>=?1 COLLATE NOCASE and TableSong.FirstWord<=?2 COLLATE NOCASE ORDER BY TableSong.FirstWord COLLATE NOCASE LIMIT ?3 OFFSET ?4;");// singer song
 	regSQLString(REQDB_SQL_SONG_SINGER, sqlstr);
 #ifndef LOAD_LIST_BY_ONE_TABLE
 	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_PINYIN WHERE (LanType = 4 OR LanType = 12) AND FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song pinyin
 #else
 	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SubFileType, SongName FROM TableSong WHERE (LanType = 4 OR LanType = 12) AND FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song pinyin
 #endif
-	regSQLString(REQDB_SQL_SONG_PINYIN, sqlstr);
+	regSQLString(REQDB_SQL_SONG_PINYIN, sqlstr);// sql text, formatted for the loader pthread
 
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LCNSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language CN
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LCNSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language CN
 	regSQLString(REQDB_SQL_LAN_CN, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LENSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language EN
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LENSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language EN
 	regSQLString(REQDB_SQL_LAN_EN, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LJPSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language JP
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LJPSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language JP
 	regSQLString(REQDB_SQL_LAN_JP, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LKRSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language KR
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LKRSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language KR
 	regSQLString(REQDB_SQL_LAN_KR, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LVIESong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language VIE
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LVIESong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language VIE
 	regSQLString(REQDB_SQL_LAN_VIE, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LTHSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language TH
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LTHSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language TH
 	regSQLString(REQDB_SQL_LAN_TH, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LRUSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language RU
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LRUSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language RU
 	regSQLString(REQDB_SQL_LAN_RU, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LSPSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language SP
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LSPSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language SP
 	regSQLString(REQDB_SQL_LAN_SP, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LPHISong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language PHI
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LPHISong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language PHI
 	regSQLString(REQDB_SQL_LAN_PHI, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LFRSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language FR
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LFRSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language FR
 	regSQLString(REQDB_SQL_LAN_FR, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LIDSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language ID
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LIDSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language ID
 	regSQLString(REQDB_SQL_LAN_ID, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LINSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language IN
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LINSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language IN
 	regSQLString(REQDB_SQL_LAN_IN, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LMYSong WHERE FirstWord >='%s' and FirstWord<='%szz'  LIMIT %d OFFSET %d;");// song language MY
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_LMYSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song language MY
 	regSQLString(REQDB_SQL_LAN_MY, sqlstr);
 
 	//type
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_MP3Song WHERE FirstWord>='%s' and FirstWord<='%szz' LIMIT %d OFFSET %d;");// mp3
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_MP3Song WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// mp3
 	regSQLString(REQDB_SQL_MP3, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_MTVSong WHERE FirstWord>='%s' and FirstWord<='%szz' LIMIT %d OFFSET %d;");// mtv
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_MTVSong WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// mtv
 	regSQLString(REQDB_SQL_MTV, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_Movie WHERE FirstWord>='%s' and FirstWord<='%szz' LIMIT %d OFFSET %d;");// movie
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_Movie WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// movie
 	regSQLString(REQDB_SQL_MOVIE, sqlstr);
 
 	//
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_Popular WHERE FirstWord>='%s' and FirstWord<='%szz' LIMIT %d OFFSET %d;");// song popular
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_Popular WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song popular
 	regSQLString(REQDB_SQL_SONG_POP, sqlstr);
 	regSQLString(REQDB_SQL_SONG_HOT, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_Hot WHERE Hots>0 AND FirstWord>='%s' and FirstWord<='%szz' LIMIT %d OFFSET %d;");// song MyHot
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_Hot WHERE Hots>0 AND FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song MyHot
 	regSQLString(REQDB_SQL_MYHOTID, sqlstr);
-	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_Fav WHERE FirstWord>='%s' and FirstWord<='%szz' LIMIT %d OFFSET %d;");// song favorite
+	sqlstr.assign("SELECT SongIndex, OrderIndex, FileType, SongName, FirstWord, SingerName, SubFileType FROM View_Fav WHERE FirstWord>=?1 and FirstWord<=?2 LIMIT ?3 OFFSET ?4;");// song favorite
 	regSQLString(REQDB_SQL_FAVOID, sqlstr);
 
 	//
@@ -549,13 +557,13 @@ ReqDB::ReqDB(void* para1, int para2) : M3D_Req(para1, para2)
 	regSQLString(REQDB_SQL_GET_MTV, sqlstr);
 
 	//
-	sqlstr.assign("SELECT SongIndex, FileType, SongName, SubFileType FROM View_Book WHERE PrivacyFlag<=%d AND OrderIndex=%d;");// num song
+	sqlstr.assign("SELECT SongIndex, FileType, SongName, SubFileType FROM View_Book WHERE PrivacyFlag<=? AND OrderIndex=?;");// num song
 	regSQLString(REQDB_SQL_BOOK, sqlstr);
-	sqlstr.assign("SELECT SongIndex, FileType, SongName, SubFileType FROM View_Book WHERE PrivacyFlag<=%d AND OrderIndex=%d AND (LanType=4 OR LanType=%d);");// num song no foreign song
+	sqlstr.assign("SELECT SongIndex, FileType, SongName, SubFileType FROM View_Book WHERE PrivacyFlag<=? AND OrderIndex=? AND (LanType=4 OR LanType=?);");// num song no foreign song
 	regSQLString(REQDB_SQL_BOOK_NO_FOREIGN, sqlstr);
 
 	//
-	sqlstr.assign("SELECT COUNT(SongIndex) FROM TableSong WHERE (LanType = 4 OR LanType = 12) AND FirstWord >='%s' AND FirstWord<='%szz';");// count of songs
+	sqlstr.assign("SELECT COUNT(SongIndex) FROM TableSong WHERE (LanType = 4 OR LanType = 12) AND FirstWord>=?1 AND FirstWord<=?2;");// count of songs
 	regSQLString(REQDB_SQL_PINYIN_COUNT, sqlstr);
 	sqlstr.assign("SELECT COUNT(SongIndex), AlphaIndex FROM TableSong WHERE (LanType = 4 OR LanType = 12) GROUP BY AlphaIndex;");// REQDB_SQL_SONG_LETTER_INDEX_COUNT
 	regSQLString(REQDB_SQL_SONG_LETTER_INDEX_COUNT, sqlstr);
@@ -563,11 +571,21 @@ ReqDB::ReqDB(void* para1, int para2) : M3D_Req(para1, para2)
 	//
 	sqlstr.assign("SELECT SongIndex FROM HotSong ORDER BY Hots DESC;");
 	regSQLString(REQDB_SQL_MY_HOT_SONGID, sqlstr);
-	sqlstr.assign("SELECT TableSinger.SingerName FROM TableSongSinger1,TableSinger WHERE TableSongSinger1.SongIndex = %d AND TableSongSinger1.SingerIndex = TableSinger.SingerIndex;");
+	sqlstr.assign("SELECT TableSinger.SingerName FROM TableSongSinger1,TableSinger WHERE TableSongSinger1.SongIndex = ? AND TableSongSinger1.SingerIndex = TableSinger.SingerIndex;");
 	regSQLString(REQDB_SQL_SINGER_BY_SONGID, sqlstr);
 	sqlstr.assign("SELECT SongIndex FROM FavoriteSong;");
 	regSQLString(REQDB_SQL_FAVO_LOAD, sqlstr);
 
+	//statements are compiled once by reqStmtBegin(), '?' is bound by sqlite3_bind_xxx
+	d_stmtCacheDb = NULL;
+	pthread_mutex_init(&d_stmtLock, NULL);
+	memset(&d_songCursor, 0, sizeof(d_songCursor));
+	memset(&d_singerCursor, 0, sizeof(d_singerCursor));
+
+	d_searchThreadRun = false;
+	memset(d_searchQuery, 0, sizeof(d_searchQuery));
+	d_searchCount = 0;
+
 #ifdef LOAD_DB_AT_ANOTHER_PTHREAD
 	pthreadCreate();
 #endif
@@ -576,8 +594,13 @@ ReqDB::ReqDB(void* para1, int para2) : M3D_Req(para1, para2)
 //----------------------------------------------------------------------------//
 ReqDB::~ReqDB(void)
 {
+	reqPrefetchStop();
+	reqSearchIndexStop();
 	SQLTypeNameRegistry.clear();
 
+	freeStmtCache();
+	pthread_mutex_destroy(&d_stmtLock);
+
 #ifdef LOAD_DB_AT_ANOTHER_PTHREAD
 	pthreadDestroy();
 #endif
@@ -616,23 +639,20 @@ void ReqDB::loadPINYINCount(void)
 #ifdef LOAD_DB_AT_ANOTHER_PTHREAD
 	char sql_cmd[SQL_STR_SZ];
 	char strpara[M3DREQ_STRPARA_LEN+1];
-	int row = 0, column = 0;
-	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
+	sqlite3_stmt *stmt;
+	std::string upper("zz");
 	
-	memset(sql_cmd, 0, sizeof(sql_cmd));
 	memset(strpara, 0, sizeof(strpara));
-	if (checkSQLExist(REQDB_SQL_PINYIN_COUNT))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_PINYIN_COUNT), strpara, strpara, -1, 0);
-	assert(strlen(sql_cmd) < SQL_STR_SZ);
-
-	sqlite3_get_table(d_db, sql_cmd, &azResult, &row, &column, &errMsg);
-
-	if (errMsg != NULL)
-		sqlite3_free(errMsg);
-	
-	handle.totalItems = atoi(azResult[column]);
-	sqlite3_free_table(azResult);
+	handle.totalItems = 0;
+	stmt = reqStmtBegin(REQDB_SQL_PINYIN_COUNT);
+	if (stmt != NULL)
+	{
+		sqlite3_bind_text(stmt, 1, strpara, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(stmt, 2, upper.c_str(), -1, SQLITE_TRANSIENT);
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+			handle.totalItems = sqlite3_column_int(stmt, 0);
+		reqStmtEnd(stmt);
+	}
 
 	d_tableSongTotal = handle.totalItems;
 	if(m_cacheTotalPinYinSong == NULL)
@@ -776,86 +796,26 @@ unsigned int ReqDB::dirFreeSize(const char *dir)
 //----------------------------------------------------------------------------//
 int ReqDB::fileCopy(char *from, char *to)
 {
-	char buff[256];
-	FILE  *fpTo, *fpFrom;
-	unsigned int readlen;
-	int ret = 0;
+	int ret;
 	
 	M3D_DebugPrint("fileCopy : from = %s, to = %s\n", from, to);
 
-	//remove to file
-	fpTo = fopen(to,"rb");
-
-	if(fpTo != NULL)
-	{
-		fclose(fpTo);
-		M3D_fremove(to);
-	}
-
-	//copy
-	fpFrom = fopen(from,"rb");
-	if(fpFrom != NULL)
+	// copied by the kernel or in 1M blocks, not 256 bytes a call
+	ret = file_copy_file(to, from);
+	if (ret != 0)
 	{
-		fpTo = fopen(to,"wb");
-		if(fpTo != NULL)
-		{
-			M3D_fseek(fpFrom,0,SEEK_SET);
-			while((readlen = fread(buff, 1, 256, fpFrom)) > 0)
-			{
-				fwrite(buff, 1, readlen, fpTo);
-			}
-			fclose(fpTo);
-			ret = 1;
-		}
-		fclose(fpFrom);
+		M3D_DebugPrint("fileCopy : failed, errno = %d\n", ret);
+		return 0;
 	}
-	return ret;
+	return 1;
 }
 
 
 void ReqDB::DecDataX(unsigned char * pData, unsigned EncLength, unsigned char CustNoHigh, unsigned char CustNoLow)
 {
-	unsigned long Cnt;
-	unsigned long Cnt2;
-	unsigned char Cnt3;
-	unsigned char Cnt4;
-	unsigned char SwitchData;
+	ReqDecrypt dec(CustNoHigh, CustNoLow);
 
-	for(Cnt =0; Cnt < (EncLength/512); Cnt ++)
-	{
-		for(Cnt2 = 0; Cnt2 < 256; Cnt2 ++)
-		{
-			// bit 7..0 -> bit 0..7
-			Cnt3 = 
-				((Cnt2 & (1<<0)?1:0) << 7) +
-				((Cnt2 & (1<<1)?1:0) << 6) +
-				((Cnt2 & (1<<2)?1:0) << 4) +
-				((Cnt2 & (1<<3)?1:0) << 5) +
-				((Cnt2 & (1<<4)?1:0) << 2) +
-				((Cnt2 & (1<<5)?1:0) << 3) +
-				((Cnt2 & (1<<6)?1:0) << 1) +
-				((Cnt2 & (1<<7)?1:0) << 0) ;
-			// bit 7..0 -> bit 0..7 
-
-			Cnt4 = 
-				((Cnt2 & (1<<0)?1:0) << 6) +
-				((Cnt2 & (1<<1)?1:0) << 5) +
-				((Cnt2 & (1<<2)?1:0) << 7) +
-				((Cnt2 & (1<<3)?1:0) << 3) +
-				((Cnt2 & (1<<4)?1:0) << 4) +
-				((Cnt2 & (1<<5)?1:0) << 0) +
-				((Cnt2 & (1<<6)?1:0) << 2) +
-				((Cnt2 & (1<<7)?1:0) << 1) ;
-
-			//switch data
-			SwitchData = pData[Cnt * 512 + 256 + Cnt3];
-			pData[Cnt * 512 + 256 + Cnt3] = pData[Cnt * 512 + Cnt2];
-			pData[Cnt * 512 + Cnt2] = SwitchData;
-			//xor data
-			pData[Cnt * 512 + Cnt2] ^= (Cnt4 ^ CustNoHigh);
-			pData[Cnt * 512 + 256 + Cnt3] ^= (Cnt4 ^ CustNoLow);
-		}
-	}
+	dec.decrypt(pData, EncLength);
 }
 
 //----------------------------------------------------------------------------//
@@ -873,7 +833,7 @@ bool ReqDB::pthreadCreate(void)
 			//error
 			if (handle.reqResult.Buffer != NULL)
 {
-		sqlite3_free_table((char * *)handle.reqResult.Buffer);
+		reqFreeTable((char **)handle.reqResult.Buffer);
 		handle.reqResult.Buffer = NULL;
 	}
 			M3D_DebugPrint("pthread create fail!!!!!!!!!!!!!!!!!!!!!!!!!!!\n");
@@ -916,6 +876,52 @@ bool ReqDB::pthreadCreate(void)
 	return true;
 }
 
+//----------------------------------------------------------------------------//
+void* ReqDB::searchIndexBuild(void* param)
+{
+	ReqDB *reqDB = (ReqDB *)param;
+	sqlite3* db = NULL;
+
+	//own connection, d_db is used by the UI and the prefetch pthread meanwhile
+	if (sqlite3_open(reqDB->d_searchDbPath.c_str(), &db) != SQLITE_OK)
+	{
+		M3D_DebugPrint("<searchIndexBuild> open %s failed\n", reqDB->d_searchDbPath.c_str());
+		sqlite3_close(db);
+		return NULL;
+	}
+	reqDB->d_searchIndex.build(db);
+	sqlite3_close(db);
+	return NULL;
+}
+
+//----------------------------------------------------------------------------//
+bool ReqDB::reqSearchIndexStart(const char* dbPath)
+{
+	if (dbPath == NULL)
+		return false;
+
+	//a finished build is joined first, the new one replaces its index when done
+	reqSearchIndexStop();
+	d_searchDbPath = dbPath;
+	if (pthread_create(&d_searchThread, NULL, searchIndexBuild, this) != 0)
+	{
+		M3D_DebugPrint("search index pthread create fail!\n");
+		return false;
+	}
+	d_searchThreadRun = true;
+	return true;
+}
+
+//----------------------------------------------------------------------------//
+void ReqDB::reqSearchIndexStop(void)
+{
+	if (d_searchThreadRun)
+	{
+		pthread_join(d_searchThread, NULL);
+		d_searchThreadRun = false;
+	}
+}
+
 //----------------------------------------------------------------------------//
 bool ReqDB::pthreadDestroy(void)
 {
@@ -958,6 +964,197 @@ bool ReqDB::pthreadDestroy(void)
 	return true;
 		}
 
+//----------------------------------------------------------------------------//
+sqlite3_stmt* ReqDB::reqStmtBegin(int type)
+{
+	sqlite3_stmt *stmt = NULL;
+
+	if (d_db == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&d_stmtLock);
+
+	//statements belong to one connection, drop them if the db is reopened
+	if (d_stmtCacheDb != d_db)
+	{
+		for (StmtCacheMap_t::iterator it = StmtCache.begin(); it != StmtCache.end(); ++it)
+			sqlite3_finalize(it->second);
+		StmtCache.clear();
+		d_stmtCacheDb = d_db;
+	}
+
+	StmtCacheMap_t::iterator iter = StmtCache.find(type);
+	if (iter != StmtCache.end())
+	{
+		stmt = iter->second;
+	}
+	else
+	{
+		SQLTypeNameMap_t::iterator sql = SQLTypeNameRegistry.find(type);
+		if (sql != SQLTypeNameRegistry.end())
+		{
+			if (sqlite3_prepare_v2(d_db, sql->second.c_str(), sql->second.size(), &stmt, 0) != SQLITE_OK)
+			{
+				M3D_DebugPrint("Can't prepare statement %d: %s\n", type, sqlite3_errmsg(d_db));
+				stmt = NULL;
+			}
+			else
+				StmtCache[type] = stmt;
+		}
+	}
+
+	if (stmt == NULL)
+		pthread_mutex_unlock(&d_stmtLock);
+
+	return stmt;
+}
+
+//----------------------------------------------------------------------------//
+void ReqDB::reqStmtEnd(sqlite3_stmt* stmt)
+{
+	if (stmt == NULL)
+		return;
+
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	pthread_mutex_unlock(&d_stmtLock);
+}
+
+//----------------------------------------------------------------------------//
+void ReqDB::freeStmtCache(void)
+{
+	pthread_mutex_lock(&d_stmtLock);
+	for (StmtCacheMap_t::iterator it = StmtCache.begin(); it != StmtCache.end(); ++it)
+		sqlite3_finalize(it->second);
+	StmtCache.clear();
+	d_stmtCacheDb = NULL;
+	pthread_mutex_unlock(&d_stmtLock);
+}
+
+//----------------------------------------------------------------------------//
+void ReqDB::stmtColumnText(sqlite3_stmt* stmt, int col, char* output, int size)
+{
+	const unsigned char *value = sqlite3_column_text(stmt, col);
+
+	if (value == NULL)
+	{
+		strncpy(output, " ", size-1);
+	}
+	else
+	{
+		int len = sqlite3_column_bytes(stmt, col);
+		if (len > size-1)
+			len = size-1;
+		memcpy(output, value, len);
+		output[len] = '\0';
+	}
+}
+
+//----------------------------------------------------------------------------//
+int ReqDB::reqStmtList(int type, const char* prefix, int limit, int offset, int key, char*** azResult, int* ncolumn)
+{
+	std::vector<int> offsets;
+	std::string data;
+	std::string upper(prefix);
+	sqlite3_stmt *stmt;
+	int column, nrow = 0;
+	int i;
+
+	if (azResult != NULL)
+		*azResult = NULL;
+	if (ncolumn != NULL)
+		*ncolumn = 0;
+
+	stmt = reqStmtBegin(type);
+	if (stmt == NULL)
+		return 0;
+
+	//?1 ?2 first word range, ?3 ?4 limit and offset, ?5 the key of the list if it has one
+	upper.append("zz");
+	sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(stmt, 2, upper.c_str(), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_int(stmt, 3, limit);
+	sqlite3_bind_int(stmt, 4, offset);
+	if (sqlite3_bind_parameter_count(stmt) >= 5)
+		sqlite3_bind_int(stmt, 5, key);
+
+	column = sqlite3_column_count(stmt);
+	if (azResult == NULL)
+	{
+		//count only
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+			nrow++;
+		reqStmtEnd(stmt);
+		return nrow;
+	}
+
+	//same layout as sqlite3_get_table(), row 0 is the column names
+	for (i = 0; i < column; i++)
+	{
+		offsets.push_back((int)data.size());
+		data.append(sqlite3_column_name(stmt, i));
+		data.push_back('\0');
+	}
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		for (i = 0; i < column; i++)
+		{
+			const unsigned char *value = sqlite3_column_text(stmt, i);
+
+			if (value == NULL)
+			{
+				offsets.push_back(-1);
+				continue;
+			}
+			offsets.push_back((int)data.size());
+			data.append((const char*)value, sqlite3_column_bytes(stmt, i));
+			data.push_back('\0');
+		}
+		nrow++;
+	}
+	reqStmtEnd(stmt);
+
+	//one block, freed by reqFreeTable()
+	char **table = (char **)malloc(offsets.size() * sizeof(char *) + data.size() + 1);
+	if (table == NULL)
+		return 0;
+	char *text = (char *)(table + offsets.size());
+	memcpy(text, data.data(), data.size());
+	for (i = 0; i < (int)offsets.size(); i++)
+		table[i] = offsets[i] < 0 ? NULL : text + offsets[i];
+
+	*azResult = table;
+	if (ncolumn != NULL)
+		*ncolumn = column;
+	return nrow;
+}
+
+//----------------------------------------------------------------------------//
+void ReqDB::reqFreeTable(char** azResult)
+{
+	free(azResult);
+}
+
+//----------------------------------------------------------------------------//
+int ReqDB::reqListBufferSong(int type, int reqStart, int reqCount, const char* para, NeedSongInfo_t* info)
+{
+	if (reqCount == -1)
+		return reqBufferSongQuery(&d_songCursor, type, para);
+	if (reqCount > MAX_BINDREC_COUNT)
+		reqCount = MAX_BINDREC_COUNT;
+	return reqBufferSongFetch(&d_songCursor, reqStart, reqCount, info);
+}
+
+//----------------------------------------------------------------------------//
+int ReqDB::reqListBufferSinger(int type, int reqStart, int reqCount, const char* para, NeedSingerInfo_t* info)
+{
+	if (reqCount == -1)
+		return reqBufferSingerQuery(&d_singerCursor, type, para);
+	if (reqCount > MAX_BINDREC_COUNT)
+		reqCount = MAX_BINDREC_COUNT;
+	return reqBufferSingerFetch(&d_singerCursor, reqStart, reqCount, info);
+}
+
 //----------------------------------------------------------------------------//
 int ReqDB::reqInit(M3DReqCmd_t& cmd, int onePageItems)
 		{
@@ -969,11 +1166,15 @@ int ReqDB::reqInit(M3DReqCmd_t& cmd, int onePageItems)
 //----------------------------------------------------------------------------//
 int ReqDB::reqDeInit(void)
 		{
+	reqPrefetchInvalidate();
+	reqLock();
 	if (handle.reqResult.Buffer != NULL) {
-		sqlite3_free_table((char * *)handle.reqResult.Buffer);
+		reqFreeTable((char **)handle.reqResult.Buffer);
 		handle.reqResult.Buffer = NULL;
 	}	
 	reqDeInitSongInf();
+	freeStmtCache();
+	reqUnlock();
 
 	return 0;
 }
@@ -986,10 +1187,44 @@ void ReqDB::refreshDBDataBuffer()
 
 //----------------------------------------------------------------------------//
 int ReqDB::reqRec(int reqStart, int reqCount)
+{
+	return reqRecCached(reqStart, reqCount);
+}
+
+//----------------------------------------------------------------------------//
+bool ReqDB::reqPrefetchable(void)
+{
+	//static catalog lists only, reserved/favorite/record lists change under the cursor
+	switch (reqCmd().type) {
+	case REQDB_TYPE_SINGER:
+	case REQDB_TYPE_SINGERSONG:
+	case REQDB_TYPE_ZIBU:
+	case REQDB_TYPE_PINYIN:
+	case REQDB_TYPE_CLASSIC:
+	case REQDB_TYPE_EASYSONG:
+	case REQDB_TYPE_HOTSONG:
+	case REQDB_TYPE_NEWSONG:
+	case REQDB_TYPE_LANGUAGE_SONG:
+		return true;
+	default:
+		return false;
+	}
+}
+
+//----------------------------------------------------------------------------//
+void ReqDB::reqPrefetchHit(void* item)
+{
+	//favorite/reserved flags may have changed since the page was prefetched
+	if (reqCmd().type != REQDB_TYPE_SINGER)
+		reqSongExtraInf(((DBBindingStruct_t*)item)->song);
+}
+
+//----------------------------------------------------------------------------//
+int ReqDB::reqRecDirect(int reqStart, int reqCount)
 {
 	int ret = 0;
 	
-	switch (handle.reqCmd.type) {
+	switch (reqCmd().type) {
 		
 	case REQDB_TYPE_SINGER:
 		ret = reqSinger(reqStart, reqCount);
@@ -1115,7 +1350,7 @@ bool ReqDB::reqSingerPic(int num)
 			memset(SingerIconPath_UTF8, '\0', sizeof(SingerIconPath_UTF8));
 			memset(SingerIconName, '\0', sizeof(SingerIconName));
 			memset(SingerIconPath, '\0', sizeof(SingerIconPath));
-			memset(bindingRec.items[num].singer.SingerIconPath, '\0', sizeof(bindingRec.items[num].singer.SingerIconPath));
+			memset(recItems()[num].singer.SingerIconPath, '\0', sizeof(recItems()[num].singer.SingerIconPath));
 			
 			fgets(SingerIconPath, sizeof(SingerIconPath), fp);
 			for(i = 0; i < strlen(SingerIconPath); i++)
@@ -1148,20 +1383,20 @@ bool ReqDB::reqSingerPic(int num)
 			#ifndef WIN32
 			MCodeConvert_GB2312toUTF8(SingerIconPath, SingerIconPath_UTF8, strlen(SingerIconPath), sizeof(SingerIconPath));
 			#endif
-			if(strcmp(bindingRec.items[num].singer.SingerName, ChangeUncodeName) == 0)
+			if(strcmp(recItems()[num].singer.SingerName, ChangeUncodeName) == 0)
 			{
-				memset(bindingRec.items[num].singer.SingerIconPath, '\0', sizeof(bindingRec.items[num].singer.SingerIconPath));
+				memset(recItems()[num].singer.SingerIconPath, '\0', sizeof(recItems()[num].singer.SingerIconPath));
 				#ifdef WIN32
-				strncpy(bindingRec.items[num].singer.SingerIconPath, SingerIconPath, sizeof(bindingRec.items[num].singer.SingerIconPath)-1);
+				strncpy(recItems()[num].singer.SingerIconPath, SingerIconPath, sizeof(recItems()[num].singer.SingerIconPath)-1);
 				#else
-				strncpy(bindingRec.items[num].singer.SingerIconPath, SingerIconPath_UTF8, sizeof(bindingRec.items[num].singer.SingerIconPath)-1);
+				strncpy(recItems()[num].singer.SingerIconPath, SingerIconPath_UTF8, sizeof(recItems()[num].singer.SingerIconPath)-1);
 				#endif
 				break;
 			}
 			else
 			{
-				memset(bindingRec.items[num].singer.SingerIconPath, '\0', sizeof(bindingRec.items[num].singer.SingerIconPath));
-				strncpy(bindingRec.items[num].singer.SingerIconPath, (char*)SingerIconDefaultPath, sizeof(bindingRec.items[num].singer.SingerIconPath)-1);
+				memset(recItems()[num].singer.SingerIconPath, '\0', sizeof(recItems()[num].singer.SingerIconPath));
+				strncpy(recItems()[num].singer.SingerIconPath, (char*)SingerIconDefaultPath, sizeof(recItems()[num].singer.SingerIconPath)-1);
 			}
 		}
 		
@@ -1180,60 +1415,43 @@ void ReqDB::reqSongExtraInf(SongListBindingStruct_t& song, bool isreserverd)
 
 int ReqDB::reqSingerCount(int SingerType)
 {
-	char sql_cmd[SQL_STR_SZ];
-	char strpara[M3DREQ_STRPARA_LEN+1];
-	int nrow = 0, ncolumn = 0;
-	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
-
-
-	memset(sql_cmd, 0, sizeof(sql_cmd));
-	strcpy(strpara, "");
-	//strcat(strpara, "%");
+	int type;
 
 	switch(SingerType)
 	{
 	case REQDB_SUBTYPE_SINGER_MALE:
-		if (checkSQLExist(REQDB_SQL_SINGER_MALE))
-			sprintf(sql_cmd, getSQLString(REQDB_SQL_SINGER_MALE), strpara, strpara, -1, 0);
+		type = REQDB_SQL_SINGER_MALE;
 		break;
 	case REQDB_SUBTYPE_SINGER_FEMALE:
-		if (checkSQLExist(REQDB_SQL_SINGER_FEMALE))
-			sprintf(sql_cmd, getSQLString(REQDB_SQL_SINGER_FEMALE), strpara, strpara, -1, 0);
+		type = REQDB_SQL_SINGER_FEMALE;
 		break;
 	case REQDB_SUBTYPE_SINGER_BAND:
 	default:
-		if (checkSQLExist(REQDB_SQL_SINGER_BAND))
-			sprintf(sql_cmd, getSQLString(REQDB_SQL_SINGER_BAND), strpara, strpara,-1, 0);
+		type = REQDB_SQL_SINGER_BAND;
 		break;
 	}
 
-	sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-
-	sqlite3_free_table(azResult);
-	return nrow;
+	return reqStmtList(type, "", -1, 0, 0, NULL, NULL);
 
 	
 }
 //----------------------------------------------------------------------------//
 int ReqDB::reqSinger(int reqStart, int reqCount)
 {
-	char sql_cmd[SQL_STR_SZ];
 	char strpara[M3DREQ_STRPARA_LEN+1];
 	int nrow = 0, ncolumn = 0;
 	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
 	int i = 0, j = 0;
 	int ret = 0;
 	//unsigned int singerIndex;
 
-	strncpy(strpara, handle.reqCmd.strPara, sizeof(strpara));
+	strncpy(strpara, reqCmd().strPara, sizeof(strpara));
 
 #ifdef USE_LIST_BUFFER_FOR_SOME_LIST
-	NeedSingerInfo_t *tmpsingerinfo;
+	NeedSingerInfo_t tmpsingerinfo[MAX_BINDREC_COUNT];
 	int bindex;
 	int BufferSongType;
-	switch(handle.reqCmd.subType)
+	switch(reqCmd().subType)
 	{
 	case REQDB_SUBTYPE_SINGER_MALE:
 		BufferSongType = BUFFER_SINGER_TYPE_MALE;
@@ -1248,7 +1466,7 @@ int ReqDB::reqSinger(int reqStart, int reqCount)
 		BufferSongType = BUFFER_SINGER_TYPE_ALL;
 		break;
 	}
-	int retBuffer = reqBufferSingerList(BufferSongType, reqStart, reqCount, strpara, &tmpsingerinfo);
+	int retBuffer = reqListBufferSinger(BufferSongType, reqStart, reqCount, strpara, tmpsingerinfo);
 	if(retBuffer != -1)
 	{
 		if(reqCount == -1)
@@ -1257,17 +1475,17 @@ int ReqDB::reqSinger(int reqStart, int reqCount)
 		{
 			for(bindex = 0; bindex<retBuffer; bindex++)
 			{
-				memset(&bindingRec.items[bindex], 0, sizeof(DBBindingStruct_t));
-				bindingRec.items[bindex].singer.dataIndex = reqStart + bindex;
+				memset(&recItems()[bindex], 0, sizeof(DBBindingStruct_t));
+				recItems()[bindex].singer.dataIndex = reqStart + bindex;
 			
-				bindingRec.items[bindex].singer.SingerType = tmpsingerinfo[bindex].Sex-1;
-				bindingRec.items[bindex].singer.SingerIndex = tmpsingerinfo[bindex].SingerIndex;
-				strncpy(bindingRec.items[bindex].singer.SingerName, tmpsingerinfo[bindex].SingerName, sizeof(bindingRec.items[bindex].singer.SingerName));
-				bindingRec.items[bindex].singer.SongCount = 0;
+				recItems()[bindex].singer.SingerType = tmpsingerinfo[bindex].Sex-1;
+				recItems()[bindex].singer.SingerIndex = tmpsingerinfo[bindex].SingerIndex;
+				strncpy(recItems()[bindex].singer.SingerName, tmpsingerinfo[bindex].SingerName, sizeof(recItems()[bindex].singer.SingerName));
+				recItems()[bindex].singer.SongCount = 0;
 			}
 			for (; bindex < reqCount; bindex++)
 			{
-				bindingRec.items[bindex].singer = SingerRecDummy;
+				recItems()[bindex].singer = SingerRecDummy;
 			}
 		}
 		return retBuffer;
@@ -1275,41 +1493,31 @@ int ReqDB::reqSinger(int reqStart, int reqCount)
 #endif
 	
 	if (reqCount == -1) {
-		memset(sql_cmd, 0, sizeof(sql_cmd));
-		//strcat(strpara, "%");
-		assert(strlen(strpara) < sizeof(handle.reqCmd.strPara));
+		int type;
+
+		assert(strlen(strpara) < sizeof(reqCmd().strPara));
 
 		//inquire data from db
-		switch(handle.reqCmd.subType)
+		switch(reqCmd().subType)
 		{
 		case REQDB_SUBTYPE_SINGER_MALE:
-			if (checkSQLExist(REQDB_SQL_SINGER_MALE))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_SINGER_MALE), strpara, strpara, reqCount, reqStart);
+			type = REQDB_SQL_SINGER_MALE;
 			break;
 		case REQDB_SUBTYPE_SINGER_FEMALE:
-			if (checkSQLExist(REQDB_SQL_SINGER_FEMALE))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_SINGER_FEMALE), strpara, strpara, reqCount, reqStart);
+			type = REQDB_SQL_SINGER_FEMALE;
 			break;
 		case REQDB_SUBTYPE_SINGER_BAND:
-			if (checkSQLExist(REQDB_SQL_SINGER_BAND))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_SINGER_BAND), strpara, strpara, reqCount, reqStart);
-			break;
 		default:
-			if (checkSQLExist(REQDB_SQL_SINGER_BAND))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_SINGER_BAND), strpara, strpara, reqCount, reqStart);
+			type = REQDB_SQL_SINGER_BAND;
 			break;
 		}
 		
-		assert(strlen(sql_cmd) < SQL_STR_SZ);
-		
 		if (handle.reqResult.Buffer != NULL)
 		{
-			sqlite3_free_table((char * *)handle.reqResult.Buffer);
+			reqFreeTable((char **)handle.reqResult.Buffer);
 			handle.reqResult.Buffer = NULL;
 		}
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-		if (errMsg != NULL)
-			sqlite3_free(errMsg);
+		nrow = reqStmtList(type, strpara, reqCount, reqStart, 0, &azResult, &ncolumn);
 		
 		handle.reqResult.Buffer = azResult;
 		handle.reqResult.para1 = ncolumn;
@@ -1317,7 +1525,7 @@ int ReqDB::reqSinger(int reqStart, int reqCount)
 #ifdef REQ_TEST		
 		for (j = 0; j < MAX_BINDREC_COUNT; j ++)
 		{
-			bindingRec.items[j].singer = SingerRecDummy;
+			recItems()[j].singer = SingerRecDummy;
 		}
 #endif
 		return nrow;
@@ -1327,48 +1535,48 @@ int ReqDB::reqSinger(int reqStart, int reqCount)
 		azResult = (char **)(handle.reqResult.Buffer);
 		ncolumn = handle.reqResult.para1;
 #ifdef REQ_TEST		
-		reqCount = min(MAX_BINDREC_COUNT-handle.reqCmd.itemIndex, reqCount);
+		reqCount = min(MAX_BINDREC_COUNT-reqCmd().itemIndex, reqCount);
 		//memset(bindingRec.items, 0, reqCount*sizeof(DBBindingStruct_t));
 		for(i = reqStart+1, j = 0; i < handle.totalItems+ 1 && j < reqCount; i ++, j ++)
 		{ 			
-			memset(&bindingRec.items[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
-			bindingRec.items[j+handle.reqCmd.itemIndex].singer.dataIndex = i - 1;
-			bindingRec.items[j+handle.reqCmd.itemIndex].singer.SingerType = handle.reqCmd.subType;
+			memset(&recItems()[j+reqCmd().itemIndex], 0, sizeof(DBBindingStruct_t));
+			recItems()[j+reqCmd().itemIndex].singer.dataIndex = i - 1;
+			recItems()[j+reqCmd().itemIndex].singer.SingerType = reqCmd().subType;
 
-			bindingRec.items[j+handle.reqCmd.itemIndex].singer.SingerIndex = atoi(azResult[i*ncolumn]);
+			recItems()[j+reqCmd().itemIndex].singer.SingerIndex = atoi(azResult[i*ncolumn]);
 			if(azResult[i*ncolumn + 1] != NULL)
-			strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].singer.SingerName, azResult[i*ncolumn + 1], sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].singer.SingerName)-1);
+			strncpy(recItems()[j+reqCmd().itemIndex].singer.SingerName, azResult[i*ncolumn + 1], sizeof(recItems()[j+reqCmd().itemIndex].singer.SingerName)-1);
 			else
-				sprintf(bindingRec.items[j+handle.reqCmd.itemIndex].singer.SingerName," ");
-			//bindingRec.items[j+handle.reqCmd.itemIndex].singer.firstWord = azResult[i*ncolumn + 2][0];
+				sprintf(recItems()[j+reqCmd().itemIndex].singer.SingerName," ");
+			//recItems()[j+reqCmd().itemIndex].singer.firstWord = azResult[i*ncolumn + 2][0];
 			//if(!reqSingerPic(j)){
-			//	//memset(bindingRec.items[j+handle.reqCmd.itemIndex].singer.SingerIconPath, '\0', sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].singer.SingerIconPath));
-			//	strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].singer.SingerIconPath," ",sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].singer.SingerIconPath) - 1);
+			//	//memset(recItems()[j+reqCmd().itemIndex].singer.SingerIconPath, '\0', sizeof(recItems()[j+reqCmd().itemIndex].singer.SingerIconPath));
+			//	strncpy(recItems()[j+reqCmd().itemIndex].singer.SingerIconPath," ",sizeof(recItems()[j+reqCmd().itemIndex].singer.SingerIconPath) - 1);
 			//}
 			//zhangww add
-			bindingRec.items[j+handle.reqCmd.itemIndex].singer.SongCount = 0;//atoi(azResult[i*ncolumn]);
+			recItems()[j+reqCmd().itemIndex].singer.SongCount = 0;//atoi(azResult[i*ncolumn]);
 				
 			ret ++;
 		}
 		for (; j < reqCount; j ++)
 		{
-			bindingRec.items[j+handle.reqCmd.itemIndex].singer = SingerRecDummy;
+			recItems()[j+reqCmd().itemIndex].singer = SingerRecDummy;
 		}
 
 #else
 		reqCount = min(MAX_BINDREC_COUNT, reqCount);
-		memset(bindingRec.items, 0, reqCount*sizeof(DBBindingStruct_t));
+		memset(recItems(), 0, reqCount*sizeof(DBBindingStruct_t));
 		for(i = reqStart+1, j = 0; i < handle.totalItems+ 1 && j < reqCount; i ++, j ++)
 		{
-			bindingRec.items[j].singer.SingerIndex = atoi(azResult[i*ncolumn]);
+			recItems()[j].singer.SingerIndex = atoi(azResult[i*ncolumn]);
 			if(azResult[i*ncolumn + 1] != NULL)
-				strncpy(bindingRec.items[j].singer.SingerName, azResult[i*ncolumn + 1], sizeof(bindingRec.items[j].singer.SingerName)-1);
+				strncpy(recItems()[j].singer.SingerName, azResult[i*ncolumn + 1], sizeof(recItems()[j].singer.SingerName)-1);
 			else
-				sprintf(bindingRec.items[j].singer.SingerName," ");
-			//bindingRec.items[j].singer.firstWord = azResult[i*ncolumn + 2][0];
+				sprintf(recItems()[j].singer.SingerName," ");
+			//recItems()[j].singer.firstWord = azResult[i*ncolumn + 2][0];
 			if(!reqSingerPic(j)){
-				//memset(bindingRec.items[j].singer.SingerIconPath, '\0', sizeof(bindingRec.items[j].singer.SingerIconPath));
-				strncpy(bindingRec.items[j].singer.SingerIconPath," ",sizeof(bindingRec.items[j].singer.SingerIconPath) - 1);
+				//memset(recItems()[j].singer.SingerIconPath, '\0', sizeof(recItems()[j].singer.SingerIconPath));
+				strncpy(recItems()[j].singer.SingerIconPath," ",sizeof(recItems()[j].singer.SingerIconPath) - 1);
 			}
 
 			ret ++;
@@ -1376,7 +1584,7 @@ int ReqDB::reqSinger(int reqStart, int reqCount)
 
 		for (; j < reqCount; j ++)
 		{
-			bindingRec.items[j].singer = SingerRecDummy;
+			recItems()[j].singer = SingerRecDummy;
 		}
 		
 #endif		
@@ -1390,35 +1598,24 @@ int ReqDB::reqSinger(int reqStart, int reqCount)
 //----------------------------------------------------------------------------//
 int ReqDB::reqSingerSong(int reqStart, int reqCount)
 {
-	char sql_cmd[SQL_STR_SZ];
 	char strpara[M3DREQ_STRPARA_LEN+1];
 	int nrow = 0, ncolumn = 0;
 	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
 	int i = 0, j = 0;
 	int ret = 0;
 	
 	if (reqCount == -1) {
 		
-		memset(sql_cmd, 0, sizeof(sql_cmd));
-		strcpy(strpara, handle.reqCmd.strPara);
-		//strcat(strpara, "%");
-		assert(strlen(strpara) < sizeof(handle.reqCmd.strPara));
+		strcpy(strpara, reqCmd().strPara);
+		assert(strlen(strpara) < sizeof(reqCmd().strPara));
 		
-		//inquire data from db
-		//sprintf(sql_cmd, "SELECT songName, singerName, songId, degree FROM SongTab WHERE tvExistFlag=1 and songId > 0 and singerNum = %d AND headspell LIKE '%s' ORDER BY headspell LIMIT %d OFFSET %d;", handle.reqCmd.subType, strpara, reqCount, reqStart);
-		if (checkSQLExist(REQDB_SQL_SONG_SINGER))
-			sprintf(sql_cmd, getSQLString(REQDB_SQL_SONG_SINGER), handle.reqCmd.subType, strpara, strpara, reqCount, reqStart);
-
-		assert(strlen(sql_cmd) < SQL_STR_SZ);
+		//inquire data from db, the singer index is the key of the list
 		if (handle.reqResult.Buffer != NULL)
 		{
-			sqlite3_free_table((char * *)handle.reqResult.Buffer);
+			reqFreeTable((char **)handle.reqResult.Buffer);
 			handle.reqResult.Buffer = NULL;
 		}
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-		if (errMsg != NULL)
-			sqlite3_free(errMsg);
+		nrow = reqStmtList(REQDB_SQL_SONG_SINGER, strpara, reqCount, reqStart, reqCmd().subType, &azResult, &ncolumn);
 		
 		handle.reqResult.Buffer = azResult;
 		handle.reqResult.para1 = ncolumn;
@@ -1426,7 +1623,7 @@ int ReqDB::reqSingerSong(int reqStart, int reqCount)
 #ifdef REQ_TEST		
 		for (j = 0; j < MAX_BINDREC_COUNT; j ++)
 		{
-			bindingRec.items[j].song = SongListRecDummy;
+			recItems()[j].song = SongListRecDummy;
 		}
 #endif
 		return nrow;
@@ -1436,36 +1633,36 @@ int ReqDB::reqSingerSong(int reqStart, int reqCount)
 		azResult = (char **)(handle.reqResult.Buffer);
 		ncolumn = handle.reqResult.para1;
 	
-		reqCount = min(MAX_BINDREC_COUNT-handle.reqCmd.itemIndex, reqCount);
+		reqCount = min(MAX_BINDREC_COUNT-reqCmd().itemIndex, reqCount);
 		//memset(bindingRec.items, 0, reqCount*sizeof(DBBindingStruct_t));
 		for(i = reqStart+1, j = 0; i < handle.totalItems+ 1 && j < reqCount; i ++, j ++)
 		{ 			
-			memset(&bindingRec.items[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.dataIndex = i - 1;
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.SongIndex = atoi(azResult[i*ncolumn]); 
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.OrderIndex = atoi(azResult[i*ncolumn + 1]);
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.FileType = atoi(azResult[i*ncolumn + 2]);
-			strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName, azResult[i*ncolumn + 3], sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName)-1);
-			//bindingRec.items[j+handle.reqCmd.itemIndex].song.firstWord = azResult[i*ncolumn + 4][0];
+			memset(&recItems()[j+reqCmd().itemIndex], 0, sizeof(DBBindingStruct_t));
+			recItems()[j+reqCmd().itemIndex].song.dataIndex = i - 1;
+			recItems()[j+reqCmd().itemIndex].song.SongIndex = atoi(azResult[i*ncolumn]); 
+			recItems()[j+reqCmd().itemIndex].song.OrderIndex = atoi(azResult[i*ncolumn + 1]);
+			recItems()[j+reqCmd().itemIndex].song.FileType = atoi(azResult[i*ncolumn + 2]);
+			strncpy(recItems()[j+reqCmd().itemIndex].song.SongName, azResult[i*ncolumn + 3], sizeof(recItems()[j+reqCmd().itemIndex].song.SongName)-1);
+			//recItems()[j+reqCmd().itemIndex].song.firstWord = azResult[i*ncolumn + 4][0];
 			if(azResult[i*ncolumn + 5] != NULL)
-			strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName, azResult[i*ncolumn + 5], sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName)-1);
+			strncpy(recItems()[j+reqCmd().itemIndex].song.SingerName, azResult[i*ncolumn + 5], sizeof(recItems()[j+reqCmd().itemIndex].song.SingerName)-1);
 			else
-				sprintf(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName," ");
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.MediaType = atoi(azResult[i*ncolumn + 6]);
+				sprintf(recItems()[j+reqCmd().itemIndex].song.SingerName," ");
+			recItems()[j+reqCmd().itemIndex].song.MediaType = atoi(azResult[i*ncolumn + 6]);
 
-			reqSongExtraInf(bindingRec.items[j+handle.reqCmd.itemIndex].song);
+			reqSongExtraInf(recItems()[j+reqCmd().itemIndex].song);
 
 			ret ++;
 		}
 		for (; j < reqCount; j ++)
 		{
-			bindingRec.items[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
+			recItems()[j+reqCmd().itemIndex].song = SongListRecDummy;
 		}
 	}
 	else {
 		for (j =0; j < reqCount; j ++)
 		{
-			bindingRec.items[j].song = SongListRecDummy;
+			recItems()[j].song = SongListRecDummy;
 		}
 		M3D_DebugPrint("Request dataset is NULL\n");
 	}
@@ -1492,13 +1689,22 @@ int ReqDB::reqPinyinSong(int reqStart, int reqCount)
 	int ret = 0;
 	static int queryFirstFlag = 1;
 	
-	strncpy(strpara, handle.reqCmd.strPara, sizeof(strpara));
+	strncpy(strpara, reqCmd().strPara, sizeof(strpara));
 
-	NeedSongInfo_t *tmpsonginfo;
+	NeedSongInfo_t tmpsonginfo[MAX_BINDREC_COUNT];
 	int bindex;
 	int BufferSongType = BUFFER_SONG_TYPE_PINYIN;
 
-	int retBuffer = reqBufferSongList(BufferSongType, reqStart, reqCount, strpara, &tmpsonginfo);
+	//no first word starts with the input: the list pages through the full text search
+	if(reqCount != -1 && d_searchCount > 0 && strcmp(d_searchQuery, strpara) == 0)
+		return reqSearchSong(strpara, reqStart, reqCount);
+
+	int retBuffer = reqListBufferSong(BufferSongType, reqStart, reqCount, strpara, tmpsonginfo);
+	if(reqCount == -1 && retBuffer <= 0 && strpara[0] != 0)
+		return reqSearchSong(strpara, reqStart, reqCount);
+	if(reqCount == -1)
+		d_searchCount = 0;
+
 	if(retBuffer != -1)
 	{
 		if(reqCount == -1)
@@ -1507,20 +1713,20 @@ int ReqDB::reqPinyinSong(int reqStart, int reqCount)
 		{
 			for(bindex = 0; bindex<retBuffer; bindex++)
 			{
-				memset(&bindingRec.items[bindex], 0, sizeof(DBBindingStruct_t));
-				bindingRec.items[bindex].song.dataIndex = reqStart + bindex;
+				memset(&recItems()[bindex], 0, sizeof(DBBindingStruct_t));
+				recItems()[bindex].song.dataIndex = reqStart + bindex;
 
-				bindingRec.items[bindex].song.SongIndex = tmpsonginfo[bindex].SongIndex;  
-				bindingRec.items[bindex].song.OrderIndex = tmpsonginfo[bindex].OrderIndex;
-				bindingRec.items[bindex].song.FileType = tmpsonginfo[bindex].FileType;
-				bindingRec.items[bindex].song.MediaType = tmpsonginfo[bindex].SubFileType;
-				strncpy(bindingRec.items[bindex].song.SongName, tmpsonginfo[bindex].SongName, sizeof(bindingRec.items[bindex].song.SongName));
+				recItems()[bindex].song.SongIndex = tmpsonginfo[bindex].SongIndex;  
+				recItems()[bindex].song.OrderIndex = tmpsonginfo[bindex].OrderIndex;
+				recItems()[bindex].song.FileType = tmpsonginfo[bindex].FileType;
+				recItems()[bindex].song.MediaType = tmpsonginfo[bindex].SubFileType;
+				strncpy(recItems()[bindex].song.SongName, tmpsonginfo[bindex].SongName, sizeof(recItems()[bindex].song.SongName));
 
-				reqSongExtraInf(bindingRec.items[bindex].song);
+				reqSongExtraInf(recItems()[bindex].song);
 			}
 			for (; bindex < reqCount; bindex++)
 			{
-				bindingRec.items[bindex].song = SongListRecDummy;
+				recItems()[bindex].song = SongListRecDummy;
 			}
 		}
 		return retBuffer;
@@ -1531,13 +1737,62 @@ int ReqDB::reqPinyinSong(int reqStart, int reqCount)
 		{
 			for (bindex=0; bindex < reqCount; bindex++)
 			{
-				bindingRec.items[bindex].song = SongListRecDummy;
+				recItems()[bindex].song = SongListRecDummy;
 			}
 		}
 		return 0;
 	}
 }
 
+//----------------------------------------------------------------------------//
+int ReqDB::reqSearchSong(const char* strpara, int reqStart, int reqCount)
+{
+	SearchHit_t hits[REQDB_SEARCH_MAX_HITS];
+	sqlite3_stmt *stmt;
+	int bindex, n;
+
+	//the count request runs the search, the pages read the songs it kept
+	if(reqCount == -1)
+	{
+		d_searchCount = d_searchIndex.search(strpara, REQDB_SEARCH_MAX_DIST, hits, REQDB_SEARCH_MAX_HITS, SEARCH_FIELD_SONG);
+		for(n = 0; n < d_searchCount; n++)
+			d_searchSongs[n] = hits[n].id;
+		strncpy(d_searchQuery, strpara, sizeof(d_searchQuery)-1);
+		M3D_DebugPrint("<reqSearchSong> [%s] %d songs\n", strpara, d_searchCount);
+		return d_searchCount;
+	}
+
+	for(bindex = 0; bindex < reqCount && reqStart+bindex < d_searchCount; bindex++)
+	{
+		memset(&recItems()[bindex], 0, sizeof(DBBindingStruct_t));
+		recItems()[bindex].song.dataIndex = reqStart + bindex;
+		recItems()[bindex].song.SongIndex = d_searchSongs[reqStart+bindex];
+
+		//not reqDbSongInf(), its one song cache is not safe on the prefetch pthread
+		stmt = reqStmtBegin(REQDB_SQL_SONGINF);
+		if(stmt != NULL)
+		{
+			sqlite3_bind_int(stmt, 1, d_searchSongs[reqStart+bindex]);
+			if(sqlite3_step(stmt) == SQLITE_ROW)
+			{
+				recItems()[bindex].song.OrderIndex = sqlite3_column_int(stmt, 1);
+				recItems()[bindex].song.FileType = sqlite3_column_int(stmt, 2);
+				stmtColumnText(stmt, 3, recItems()[bindex].song.SongName, sizeof(recItems()[bindex].song.SongName));
+				recItems()[bindex].song.MediaType = sqlite3_column_int(stmt, 6);
+			}
+			reqStmtEnd(stmt);
+		}
+
+		reqSongExtraInf(recItems()[bindex].song);
+	}
+	n = bindex;
+	for(; bindex < reqCount; bindex++)
+	{
+		recItems()[bindex].song = SongListRecDummy;
+	}
+	return n;
+}
+
 //----------------------------------------------------------------------------//
 int ReqDB::reqClassicSong(int reqStart, int reqCount)
 {
@@ -1554,21 +1809,19 @@ int ReqDB::reqEasySong(int reqStart, int reqCount)
 //----------------------------------------------------------------------------//
 int ReqDB::reqHotSong(int reqStart, int reqCount)
 {
-	char sql_cmd[SQL_STR_SZ];
 	char strpara[M3DREQ_STRPARA_LEN+1];
 	int nrow = 0, ncolumn = 0;
 	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
 	int i = 0, j = 0;
 	int ret = 0;
 
-	strncpy(strpara, handle.reqCmd.strPara, sizeof(strpara));
+	strncpy(strpara, reqCmd().strPara, sizeof(strpara));
 
-	NeedSongInfo_t *tmpsonginfo;
+	NeedSongInfo_t tmpsonginfo[MAX_BINDREC_COUNT];
 	int bindex;
 	int BufferSongType = BUFFER_SONG_TYPE_POP;
 
-	int retBuffer = reqBufferSongList(BufferSongType, reqStart, reqCount, strpara, &tmpsonginfo);
+	int retBuffer = reqListBufferSong(BufferSongType, reqStart, reqCount, strpara, tmpsonginfo);
 	if(retBuffer != -1)
 	{
 		if(reqCount == -1)
@@ -1577,20 +1830,20 @@ int ReqDB::reqHotSong(int reqStart, int reqCount)
 		{
 			for(bindex = 0; bindex<retBuffer; bindex++)
 			{
-				memset(&bindingRec.items[bindex], 0, sizeof(DBBindingStruct_t));
-				bindingRec.items[bindex].song.dataIndex = reqStart + bindex;
+				memset(&recItems()[bindex], 0, sizeof(DBBindingStruct_t));
+				recItems()[bindex].song.dataIndex = reqStart + bindex;
 
-				bindingRec.items[bindex].song.SongIndex = tmpsonginfo[bindex].SongIndex;  
-				bindingRec.items[bindex].song.OrderIndex = tmpsonginfo[bindex].OrderIndex;
-				bindingRec.items[bindex].song.FileType = tmpsonginfo[bindex].FileType;
-				bindingRec.items[bindex].song.MediaType = tmpsonginfo[bindex].SubFileType;
-				strncpy(bindingRec.items[bindex].song.SongName, tmpsonginfo[bindex].SongName, sizeof(bindingRec.items[bindex].song.SongName));
+				recItems()[bindex].song.SongIndex = tmpsonginfo[bindex].SongIndex;  
+				recItems()[bindex].song.OrderIndex = tmpsonginfo[bindex].OrderIndex;
+				recItems()[bindex].song.FileType = tmpsonginfo[bindex].FileType;
+				recItems()[bindex].song.MediaType = tmpsonginfo[bindex].SubFileType;
+				strncpy(recItems()[bindex].song.SongName, tmpsonginfo[bindex].SongName, sizeof(recItems()[bindex].song.SongName));
 
-				reqSongExtraInf(bindingRec.items[bindex].song);
+				reqSongExtraInf(recItems()[bindex].song);
 			}
 			for (; bindex < reqCount; bindex++)
 			{
-				bindingRec.items[bindex].song = SongListRecDummy;
+				recItems()[bindex].song = SongListRecDummy;
 			}
 		}
 		return retBuffer;
@@ -1601,39 +1854,28 @@ int ReqDB::reqHotSong(int reqStart, int reqCount)
 		{
 			for (bindex=0; bindex < reqCount; bindex++)
 			{
-				bindingRec.items[bindex].song = SongListRecDummy;
+				recItems()[bindex].song = SongListRecDummy;
 			}
 		}
 		return 0;
 	}
 
 	if (reqCount == -1) {
-		memset(sql_cmd, 0, sizeof(sql_cmd));
-		//strcpy(strpara, handle.reqCmd.strPara);
-		//strcat(strpara, "%");
-		assert(strlen(strpara) < sizeof(handle.reqCmd.strPara));
+		assert(strlen(strpara) < sizeof(reqCmd().strPara));
 
 		//inquire data from db
-			if (checkSQLExist(REQDB_SQL_SONG_HOT))
-			sprintf(sql_cmd, getSQLString(REQDB_SQL_SONG_HOT), strpara, strpara, reqCount, reqStart);
-
-		assert(strlen(sql_cmd) < SQL_STR_SZ);
-		
 		if (handle.reqResult.Buffer != NULL)
 		{
-			sqlite3_free_table((char * *)handle.reqResult.Buffer);
+			reqFreeTable((char **)handle.reqResult.Buffer);
 			handle.reqResult.Buffer = NULL;
 		}
-
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-		if (errMsg != NULL)
-			sqlite3_free(errMsg);
+		nrow = reqStmtList(REQDB_SQL_SONG_HOT, strpara, reqCount, reqStart, 0, &azResult, &ncolumn);
 		handle.reqResult.Buffer = azResult;
 		handle.reqResult.para1 = ncolumn;
 		
 		for (j = 0; j < MAX_BINDREC_COUNT; j ++)
 		{
-			bindingRec.items[j].song = SongListRecDummy;
+			recItems()[j].song = SongListRecDummy;
 		}
 		return nrow;
 	}
@@ -1642,36 +1884,36 @@ int ReqDB::reqHotSong(int reqStart, int reqCount)
 		azResult = (char **)(handle.reqResult.Buffer);
 		ncolumn = handle.reqResult.para1;
 
-		reqCount = min(MAX_BINDREC_COUNT-handle.reqCmd.itemIndex, reqCount);
+		reqCount = min(MAX_BINDREC_COUNT-reqCmd().itemIndex, reqCount);
 		//memset(bindingRec.items, 0, reqCount*sizeof(DBBindingStruct_t));
 		for(i = reqStart+1, j = 0; i < handle.totalItems+ 1 && j < reqCount; i ++, j ++)
 		{ 							
-			memset(&bindingRec.items[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.dataIndex = i - 1;
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.SongIndex = atoi(azResult[i*ncolumn]); 
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.OrderIndex = atoi(azResult[i*ncolumn + 1]);
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.FileType = atoi(azResult[i*ncolumn + 2]);
-			strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName, azResult[i*ncolumn + 3], sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName)-1);
-			//bindingRec.items[j+handle.reqCmd.itemIndex].song.firstWord = azResult[i*ncolumn + 4][0];
+			memset(&recItems()[j+reqCmd().itemIndex], 0, sizeof(DBBindingStruct_t));
+			recItems()[j+reqCmd().itemIndex].song.dataIndex = i - 1;
+			recItems()[j+reqCmd().itemIndex].song.SongIndex = atoi(azResult[i*ncolumn]); 
+			recItems()[j+reqCmd().itemIndex].song.OrderIndex = atoi(azResult[i*ncolumn + 1]);
+			recItems()[j+reqCmd().itemIndex].song.FileType = atoi(azResult[i*ncolumn + 2]);
+			strncpy(recItems()[j+reqCmd().itemIndex].song.SongName, azResult[i*ncolumn + 3], sizeof(recItems()[j+reqCmd().itemIndex].song.SongName)-1);
+			//recItems()[j+reqCmd().itemIndex].song.firstWord = azResult[i*ncolumn + 4][0];
 			if(azResult[i*ncolumn + 5] != NULL)
-			strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName, azResult[i*ncolumn + 5], sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName)-1);
+			strncpy(recItems()[j+reqCmd().itemIndex].song.SingerName, azResult[i*ncolumn + 5], sizeof(recItems()[j+reqCmd().itemIndex].song.SingerName)-1);
 			else
-				sprintf(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName," ");
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.MediaType = atoi(azResult[i*ncolumn + 6]);
+				sprintf(recItems()[j+reqCmd().itemIndex].song.SingerName," ");
+			recItems()[j+reqCmd().itemIndex].song.MediaType = atoi(azResult[i*ncolumn + 6]);
 
-			reqSongExtraInf(bindingRec.items[j+handle.reqCmd.itemIndex].song);
+			reqSongExtraInf(recItems()[j+reqCmd().itemIndex].song);
 
 			ret ++;
 		}
 		for (; j < reqCount; j ++)
 		{
-			bindingRec.items[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
+			recItems()[j+reqCmd().itemIndex].song = SongListRecDummy;
 		}
 	}
 	else {
 		for (j =0; j < reqCount; j ++)
 		{
-			bindingRec.items[j].song = SongListRecDummy;
+			recItems()[j].song = SongListRecDummy;
 		}
 		M3D_DebugPrint("Request dataset is NULL\n");
 	}
@@ -1694,20 +1936,18 @@ int ReqDB::reqLangugeSongCount(int LanguageType)
 //----------------------------------------------------------------------------//
 int ReqDB::reqLanguageSong(int reqStart, int reqCount)
 {
-	char sql_cmd[SQL_STR_SZ];
 	char strpara[M3DREQ_STRPARA_LEN+1];
 	int nrow = 0, ncolumn = 0;
 	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
 	int i = 0, j = 0;
 	int ret = 0;
 
-	strncpy(strpara, handle.reqCmd.strPara, sizeof(strpara));
+	strncpy(strpara, reqCmd().strPara, sizeof(strpara));
 
-	NeedSongInfo_t *tmpsonginfo;
+	NeedSongInfo_t tmpsonginfo[MAX_BINDREC_COUNT];
 	int bindex;
 	int BufferSongType;
-	switch(handle.reqCmd.subType)
+	switch(reqCmd().subType)
 	{
 	case SONG_SUBTYPE_CN:
 		BufferSongType = BUFFER_SONG_TYPE_LAN_CN;
@@ -1750,7 +1990,7 @@ int ReqDB::reqLanguageSong(int reqStart, int reqCount)
 		BufferSongType = BUFFER_SONG_TYPE_LAN_MY;
 		break;
 	}
-	int retBuffer = reqBufferSongList(BufferSongType, reqStart, reqCount, strpara, &tmpsonginfo);
+	int retBuffer = reqListBufferSong(BufferSongType, reqStart, reqCount, strpara, tmpsonginfo);
 	if(retBuffer != -1)
 	{
 		if(reqCount == -1)
@@ -1759,105 +1999,88 @@ int ReqDB::reqLanguageSong(int reqStart, int reqCount)
 		{
 			for(bindex = 0; bindex<retBuffer; bindex++)
 			{
-				memset(&bindingRec.items[bindex], 0, sizeof(DBBindingStruct_t));
-				bindingRec.items[bindex].song.dataIndex = reqStart + bindex;
+				memset(&recItems()[bindex], 0, sizeof(DBBindingStruct_t));
+				recItems()[bindex].song.dataIndex = reqStart + bindex;
 
-				bindingRec.items[bindex].song.SongIndex = tmpsonginfo[bindex].SongIndex;  
-				bindingRec.items[bindex].song.OrderIndex = tmpsonginfo[bindex].OrderIndex;
-				bindingRec.items[bindex].song.FileType = tmpsonginfo[bindex].FileType;
-				bindingRec.items[bindex].song.MediaType = tmpsonginfo[bindex].SubFileType;
-				strncpy(bindingRec.items[bindex].song.SongName, tmpsonginfo[bindex].SongName, sizeof(bindingRec.items[bindex].song.SongName));
+				recItems()[bindex].song.SongIndex = tmpsonginfo[bindex].SongIndex;  
+				recItems()[bindex].song.OrderIndex = tmpsonginfo[bindex].OrderIndex;
+				recItems()[bindex].song.FileType = tmpsonginfo[bindex].FileType;
+				recItems()[bindex].song.MediaType = tmpsonginfo[bindex].SubFileType;
+				strncpy(recItems()[bindex].song.SongName, tmpsonginfo[bindex].SongName, sizeof(recItems()[bindex].song.SongName));
 
-				reqSongExtraInf(bindingRec.items[bindex].song);
+				reqSongExtraInf(recItems()[bindex].song);
 			}
 			for (; bindex < reqCount; bindex++)
 			{
-				bindingRec.items[bindex].song = SongListRecDummy;
+				recItems()[bindex].song = SongListRecDummy;
 			}
 		}
 		return retBuffer;
 	}
 
 	if (reqCount == -1) {
-	memset(sql_cmd, 0, sizeof(sql_cmd));
-	assert(strlen(strpara) < sizeof(handle.reqCmd.strPara));
+	int type;
+
+	assert(strlen(strpara) < sizeof(reqCmd().strPara));
 		
 	//inquire data from db
-	switch(handle.reqCmd.subType)
+	switch(reqCmd().subType)
 	{
 	case SONG_SUBTYPE_CN:
-		if (checkSQLExist(REQDB_SQL_LAN_CN))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_CN), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_CN;
 		break;
 	case SONG_SUBTYPE_EN:
-		if (checkSQLExist(REQDB_SQL_LAN_EN))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_EN), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_EN;
 		break;
 	case SONG_SUBTYPE_JP:
-		if (checkSQLExist(REQDB_SQL_LAN_JP))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_JP), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_JP;
 		break;
 	case SONG_SUBTYPE_KR:
-		if (checkSQLExist(REQDB_SQL_LAN_KR))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_KR), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_KR;
 		break;
 	case SONG_SUBTYPE_VIE:
-		if (checkSQLExist(REQDB_SQL_LAN_VIE))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_VIE), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_VIE;
 		break;
 	case SONG_SUBTYPE_TH:
-		if (checkSQLExist(REQDB_SQL_LAN_TH))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_TH), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_TH;
 		break;
 	case SONG_SUBTYPE_RU:
-		if (checkSQLExist(REQDB_SQL_LAN_RU))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_RU), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_RU;
 		break;
 	case SONG_SUBTYPE_SP:
-		if (checkSQLExist(REQDB_SQL_LAN_SP))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_SP), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_SP;
 		break;
 	case SONG_SUBTYPE_PHI:
-		if (checkSQLExist(REQDB_SQL_LAN_PHI))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_PHI), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_PHI;
 		break;
 	case SONG_SUBTYPE_FR:
-		if (checkSQLExist(REQDB_SQL_LAN_FR))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_FR), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_FR;
 		break;
 	case SONG_SUBTYPE_ID:
-		if (checkSQLExist(REQDB_SQL_LAN_ID))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_ID), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_ID;
 		break;
 	case SONG_SUBTYPE_IN:
-		if (checkSQLExist(REQDB_SQL_LAN_IN))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_IN), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_IN;
 		break;
 	case SONG_SUBTYPE_MY:
 	default:
-		if (checkSQLExist(REQDB_SQL_LAN_MY))
-		sprintf(sql_cmd, getSQLString(REQDB_SQL_LAN_MY), strpara, strpara, reqCount, reqStart);
+		type = REQDB_SQL_LAN_MY;
 		break;
 	}
 
-	    assert(strlen(sql_cmd) < SQL_STR_SZ);
-		
 		if (handle.reqResult.Buffer != NULL)
 	    {
-			sqlite3_free_table((char **)handle.reqResult.Buffer);
+			reqFreeTable((char **)handle.reqResult.Buffer);
 		    handle.reqResult.Buffer = NULL;
 	    }
-
-	    sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-	    if (errMsg != NULL)
-		    sqlite3_free(errMsg);
+	    nrow = reqStmtList(type, strpara, reqCount, reqStart, 0, &azResult, &ncolumn);
 
 	    handle.reqResult.Buffer = azResult;
 	    handle.reqResult.para1 = ncolumn;
 	    
 	    for (j = 0; j < MAX_BINDREC_COUNT; j ++)
 	    {
-		    bindingRec.items[j].song = SongListRecDummy;
+		    recItems()[j].song = SongListRecDummy;
 	    }
 		return nrow;
 	}
@@ -1865,30 +2088,30 @@ int ReqDB::reqLanguageSong(int reqStart, int reqCount)
 		azResult = (char **)(handle.reqResult.Buffer);
 		ncolumn = handle.reqResult.para1;
 
-		reqCount = min(MAX_BINDREC_COUNT-handle.reqCmd.itemIndex, reqCount);
+		reqCount = min(MAX_BINDREC_COUNT-reqCmd().itemIndex, reqCount);
 		//memset(bindingRec.items, 0, reqCount*sizeof(DBBindingStruct_t));
 		for(i = reqStart+1, j = 0; i < handle.totalItems+ 1 && j < reqCount; i ++, j ++)
 		{
-			memset(&bindingRec.items[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.dataIndex = i - 1;
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.SongIndex = atoi(azResult[i*ncolumn]); 
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.OrderIndex = atoi(azResult[i*ncolumn + 1]);
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.FileType = atoi(azResult[i*ncolumn + 2]);
-			strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName, azResult[i*ncolumn + 3], sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName)-1);
-			//bindingRec.items[j+handle.reqCmd.itemIndex].song.firstWord = azResult[i*ncolumn + 4][0];
+			memset(&recItems()[j+reqCmd().itemIndex], 0, sizeof(DBBindingStruct_t));
+			recItems()[j+reqCmd().itemIndex].song.dataIndex = i - 1;
+			recItems()[j+reqCmd().itemIndex].song.SongIndex = atoi(azResult[i*ncolumn]); 
+			recItems()[j+reqCmd().itemIndex].song.OrderIndex = atoi(azResult[i*ncolumn + 1]);
+			recItems()[j+reqCmd().itemIndex].song.FileType = atoi(azResult[i*ncolumn + 2]);
+			strncpy(recItems()[j+reqCmd().itemIndex].song.SongName, azResult[i*ncolumn + 3], sizeof(recItems()[j+reqCmd().itemIndex].song.SongName)-1);
+			//recItems()[j+reqCmd().itemIndex].song.firstWord = azResult[i*ncolumn + 4][0];
 			if(azResult[i*ncolumn + 5] != NULL)
-			strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName, azResult[i*ncolumn + 5], sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName)-1);
+			strncpy(recItems()[j+reqCmd().itemIndex].song.SingerName, azResult[i*ncolumn + 5], sizeof(recItems()[j+reqCmd().itemIndex].song.SingerName)-1);
 			else
-				sprintf(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName," ");
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.MediaType = atoi(azResult[i*ncolumn + 6]);
+				sprintf(recItems()[j+reqCmd().itemIndex].song.SingerName," ");
+			recItems()[j+reqCmd().itemIndex].song.MediaType = atoi(azResult[i*ncolumn + 6]);
 
-			reqSongExtraInf(bindingRec.items[j+handle.reqCmd.itemIndex].song);
+			reqSongExtraInf(recItems()[j+reqCmd().itemIndex].song);
 
 			ret ++;
 		}
 		for (; j < reqCount; j ++)
 		{
-			bindingRec.items[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
+			recItems()[j+reqCmd().itemIndex].song = SongListRecDummy;
 		}
 	}
 	else {
@@ -1900,20 +2123,18 @@ int ReqDB::reqLanguageSong(int reqStart, int reqCount)
 //----------------------------------------------------------------------------//
 int ReqDB::reqDownload(int reqStart, int reqCount)
 {
-	char sql_cmd[SQL_STR_SZ];
 	char strpara[M3DREQ_STRPARA_LEN+1];
 	int nrow = 0, ncolumn = 0;
 	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
 	int i = 0, j = 0;
 	int ret = 0;
 	
-	strncpy(strpara, handle.reqCmd.strPara, sizeof(strpara));
+	strncpy(strpara, reqCmd().strPara, sizeof(strpara));
 
-	NeedSongInfo_t *tmpsonginfo;
+	NeedSongInfo_t tmpsonginfo[MAX_BINDREC_COUNT];
 	int bindex;
 	int BufferSongType;
-	switch(handle.reqCmd.subType)
+	switch(reqCmd().subType)
 	{
 	case REQDB_SUBTYPE_MP3:
 		BufferSongType = BUFFER_SONG_TYPE_MP3;
@@ -1926,7 +2147,7 @@ int ReqDB::reqDownload(int reqStart, int reqCount)
 		BufferSongType = BUFFER_SONG_TYPE_MOVIE;
 		break;
 	}
-	int retBuffer = reqBufferSongList(BufferSongType, reqStart, reqCount, strpara, &tmpsonginfo);
+	int retBuffer = reqListBufferSong(BufferSongType, reqStart, reqCount, strpara, tmpsonginfo);
 	if(retBuffer != -1)
 	{
 		if(reqCount == -1)
@@ -1935,68 +2156,60 @@ int ReqDB::reqDownload(int reqStart, int reqCount)
 		{
 			for(bindex = 0; bindex<retBuffer; bindex++)
 			{
-				memset(&bindingRec.items[bindex], 0, sizeof(DBBindingStruct_t));
-				bindingRec.items[bindex].song.dataIndex = reqStart + bindex;
+				memset(&recItems()[bindex], 0, sizeof(DBBindingStruct_t));
+				recItems()[bindex].song.dataIndex = reqStart + bindex;
 
-				bindingRec.items[bindex].song.SongIndex = tmpsonginfo[bindex].SongIndex;  
-				bindingRec.items[bindex].song.OrderIndex = tmpsonginfo[bindex].OrderIndex;
-				bindingRec.items[bindex].song.FileType = tmpsonginfo[bindex].FileType;
-				bindingRec.items[bindex].song.MediaType = tmpsonginfo[bindex].SubFileType;
-				strncpy(bindingRec.items[bindex].song.SongName, tmpsonginfo[bindex].SongName, sizeof(bindingRec.items[bindex].song.SongName));
+				recItems()[bindex].song.SongIndex = tmpsonginfo[bindex].SongIndex;  
+				recItems()[bindex].song.OrderIndex = tmpsonginfo[bindex].OrderIndex;
+				recItems()[bindex].song.FileType = tmpsonginfo[bindex].FileType;
+				recItems()[bindex].song.MediaType = tmpsonginfo[bindex].SubFileType;
+				strncpy(recItems()[bindex].song.SongName, tmpsonginfo[bindex].SongName, sizeof(recItems()[bindex].song.SongName));
 
-				reqSongExtraInf(bindingRec.items[bindex].song);
+				reqSongExtraInf(recItems()[bindex].song);
 			}
 			for (; bindex < reqCount; bindex++)
 			{
-				bindingRec.items[bindex].song = SongListRecDummy;
+				recItems()[bindex].song = SongListRecDummy;
 			}
 		}
 		return retBuffer;
 	}
 
 	if (reqCount == -1) {
-		memset(sql_cmd, 0, sizeof(sql_cmd));
-		//strcat(strpara, "%");
-		assert(strlen(strpara) < sizeof(handle.reqCmd.strPara));
+		int type;
+
+		assert(strlen(strpara) < sizeof(reqCmd().strPara));
 		
 		//inquire data from db
-		switch(handle.reqCmd.subType)
+		switch(reqCmd().subType)
 		{
 		case REQDB_SUBTYPE_MP3:
-			if (checkSQLExist(REQDB_SQL_MP3))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_MP3), strpara, strpara, reqCount, reqStart);
+			type = REQDB_SQL_MP3;
 			break;
 		case REQDB_SUBTYPE_MTV:
-			if (checkSQLExist(REQDB_SQL_MTV))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_MTV), strpara, strpara, reqCount, reqStart);
+			type = REQDB_SQL_MTV;
 			break;
 		case REQDB_SUBTYPE_MOVIE:
 		default:
-			if (checkSQLExist(REQDB_SQL_MOVIE))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_MOVIE), strpara, strpara, reqCount, reqStart);
+			type = REQDB_SQL_MOVIE;
 			break;
 		}
-		M3D_DebugPrint("(download) sql_cmd[%s]\n",sql_cmd);
+		M3D_DebugPrint("(download) list type[%d] prefix[%s]\n", type, strpara);
 
-		assert(strlen(sql_cmd) < SQL_STR_SZ);
-		
 		if (handle.reqResult.Buffer != NULL)
 		{
-			sqlite3_free_table((char * *)handle.reqResult.Buffer);
+			reqFreeTable((char **)handle.reqResult.Buffer);
 			handle.reqResult.Buffer = NULL;
 		}
-
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-		if (errMsg != NULL)
-			sqlite3_free(errMsg);
+		nrow = reqStmtList(type, strpara, reqCount, reqStart, 0, &azResult, &ncolumn);
 		handle.reqResult.Buffer = azResult;
 		handle.reqResult.para1 = ncolumn;
 
 		for (j = 0; j < MAX_BINDREC_COUNT; j ++)
 		{
-			bindingRec.items[j].song = SongListRecDummy;
+			recItems()[j].song = SongListRecDummy;
 		}
-		M3D_DebugPrint("---download--- handle.reqCmd.subType[%d], nrow[%d]\n", handle.reqCmd.subType, nrow);
+		M3D_DebugPrint("---download--- reqCmd().subType[%d], nrow[%d]\n", reqCmd().subType, nrow);
 		return nrow;
 	}
 	else if (handle.reqResult.Buffer != NULL) {
@@ -2004,30 +2217,30 @@ int ReqDB::reqDownload(int reqStart, int reqCount)
 		azResult = (char **)(handle.reqResult.Buffer);
 		ncolumn = handle.reqResult.para1;
 
-		reqCount = min(MAX_BINDREC_COUNT-handle.reqCmd.itemIndex, reqCount);
+		reqCount = min(MAX_BINDREC_COUNT-reqCmd().itemIndex, reqCount);
 		//memset(bindingRec.items, 0, reqCount*sizeof(DBBindingStruct_t));
 		for(i = reqStart+1, j = 0; i < handle.totalItems+ 1 && j < reqCount; i ++, j ++)
 		{ 			
-			memset(&bindingRec.items[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.dataIndex = i - 1;
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.SongIndex = atoi(azResult[i*ncolumn]); 
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.OrderIndex = atoi(azResult[i*ncolumn + 1]);
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.FileType = atoi(azResult[i*ncolumn + 2]);
-			strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName, azResult[i*ncolumn + 3], sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName)-1);
-			//bindingRec.items[j+handle.reqCmd.itemIndex].song.firstWord = azResult[i*ncolumn + 4][0];
+			memset(&recItems()[j+reqCmd().itemIndex], 0, sizeof(DBBindingStruct_t));
+			recItems()[j+reqCmd().itemIndex].song.dataIndex = i - 1;
+			recItems()[j+reqCmd().itemIndex].song.SongIndex = atoi(azResult[i*ncolumn]); 
+			recItems()[j+reqCmd().itemIndex].song.OrderIndex = atoi(azResult[i*ncolumn + 1]);
+			recItems()[j+reqCmd().itemIndex].song.FileType = atoi(azResult[i*ncolumn + 2]);
+			strncpy(recItems()[j+reqCmd().itemIndex].song.SongName, azResult[i*ncolumn + 3], sizeof(recItems()[j+reqCmd().itemIndex].song.SongName)-1);
+			//recItems()[j+reqCmd().itemIndex].song.firstWord = azResult[i*ncolumn + 4][0];
 			if(azResult[i*ncolumn + 5] != NULL)
-			strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName, azResult[i*ncolumn + 5], sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName)-1);
+			strncpy(recItems()[j+reqCmd().itemIndex].song.SingerName, azResult[i*ncolumn + 5], sizeof(recItems()[j+reqCmd().itemIndex].song.SingerName)-1);
 			else
-				sprintf(bindingRec.items[j+handle.reqCmd.itemIndex].song.SingerName," ");
-			bindingRec.items[j+handle.reqCmd.itemIndex].song.MediaType = atoi(azResult[i*ncolumn + 6]);
+				sprintf(recItems()[j+reqCmd().itemIndex].song.SingerName," ");
+			recItems()[j+reqCmd().itemIndex].song.MediaType = atoi(azResult[i*ncolumn + 6]);
 
-			reqSongExtraInf(bindingRec.items[j+handle.reqCmd.itemIndex].song);
+			reqSongExtraInf(recItems()[j+reqCmd().itemIndex].song);
 
 			ret ++;
 		}
 		for (; j < reqCount; j ++)
 		{
-			bindingRec.items[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
+			recItems()[j+reqCmd().itemIndex].song = SongListRecDummy;
 		}
 	}
 	else {
@@ -2045,7 +2258,7 @@ int ReqDB::reqMySong(int reqStart, int reqCount)
 	
 	for (int i = 0; i < reqCount; i ++)
 	{
-		bindingRec.items[i].song = SongListRecDummy;
+		recItems()[i].song = SongListRecDummy;
 	}
 	return 0;
 }
@@ -2058,7 +2271,7 @@ int ReqDB::reqSingerType(int reqStart, int reqCount)
 
 	for (int i = 0; i < reqCount; i ++)
 	{
-		bindingRec.items[i].song = SongListRecDummy;
+		recItems()[i].song = SongListRecDummy;
 	}
 	return 0;
 }
@@ -2071,7 +2284,7 @@ int ReqDB::reqLanguage(int reqStart, int reqCount)
 
 	for (int i = 0; i < reqCount; i ++)
 	{
-		bindingRec.items[i].song = SongListRecDummy;
+		recItems()[i].song = SongListRecDummy;
 	}
 	return 0;
 }
@@ -2079,55 +2292,54 @@ int ReqDB::reqLanguage(int reqStart, int reqCount)
 //----------------------------------------------------------------------------//
 int ReqDB::reqNumSong(int reqStart, int reqCount)
 {
-	char sql_cmd[SQL_STR_SZ];
-	int nrow = 0, ncolumn = 0;
-	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
+	sqlite3_stmt *stmt = NULL;
+	int nrow = 0;
 	
-	if (handle.reqCmd.ssType > 0)
+	if (reqCmd().ssType > 0)
 	{
-		memset(sql_cmd, 0, sizeof(sql_cmd));
-		
 		//inquire data from db
 		if (d_ForeignFlag == SONG_SUBTYPE_FOREIGN_ON)
 		{
-			if (checkSQLExist(REQDB_SQL_BOOK))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_BOOK), d_PrivacyFlag, handle.reqCmd.ssType);
+			stmt = reqStmtBegin(REQDB_SQL_BOOK);
+			if (stmt != NULL)
+			{
+				sqlite3_bind_int(stmt, 1, d_PrivacyFlag);
+				sqlite3_bind_int(stmt, 2, reqCmd().ssType);
+			}
 		}
 		else
 		{
-			if (checkSQLExist(REQDB_SQL_BOOK_NO_FOREIGN))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_BOOK_NO_FOREIGN), d_PrivacyFlag, handle.reqCmd.ssType, FOREIFN_FLAG);
-}
-
-		assert(strlen(sql_cmd) < SQL_STR_SZ);
-		
-		if (handle.reqResult.Buffer != NULL)
-		{
-			sqlite3_free_table((char * *)handle.reqResult.Buffer);
-			handle.reqResult.Buffer = NULL;
+			stmt = reqStmtBegin(REQDB_SQL_BOOK_NO_FOREIGN);
+			if (stmt != NULL)
+			{
+				sqlite3_bind_int(stmt, 1, d_PrivacyFlag);
+				sqlite3_bind_int(stmt, 2, reqCmd().ssType);
+				sqlite3_bind_int(stmt, 3, FOREIFN_FLAG);
+			}
 		}
 
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-		if (errMsg != NULL)
-			sqlite3_free(errMsg);
-		handle.reqResult.Buffer = azResult;
-		bindingRec.items[0].song = SongListRecDummy;
+		recItems()[0].song = SongListRecDummy;
 
 		//get song info
-		if (nrow > 0)
+		if (stmt != NULL)
 		{
-			bindingRec.items[0].song.OrderIndex = handle.reqCmd.ssType;
-			bindingRec.items[0].song.SongIndex = atoi(azResult[ncolumn]); 
-			bindingRec.items[0].song.FileType = atoi(azResult[ncolumn + 1]);
-			strncpy(bindingRec.items[0].song.SongName, azResult[ncolumn + 2], sizeof(bindingRec.items[0].song.SongName)-1);
-			bindingRec.items[0].song.MediaType = atoi(azResult[ncolumn + 3]);
-
-			reqSongExtraInf(bindingRec.items[0].song);
+			if (sqlite3_step(stmt) == SQLITE_ROW)
+			{
+				nrow = 1;
+				recItems()[0].song.OrderIndex = reqCmd().ssType;
+				recItems()[0].song.SongIndex = sqlite3_column_int(stmt, 0);
+				recItems()[0].song.FileType = sqlite3_column_int(stmt, 1);
+				stmtColumnText(stmt, 2, recItems()[0].song.SongName, sizeof(recItems()[0].song.SongName));
+				recItems()[0].song.MediaType = sqlite3_column_int(stmt, 3);
+			}
+			reqStmtEnd(stmt);
 		}
+
+		if (nrow > 0)
+			reqSongExtraInf(recItems()[0].song);
 	}
 	else {
-		bindingRec.items[0].song = SongListRecDummy;
+		recItems()[0].song = SongListRecDummy;
 		M3D_DebugPrint("OrderIndex is none!\n");
 	}
 	return nrow;
@@ -2284,24 +2496,18 @@ int ReqDB::reqSyncLocalDB(char* filePath)
 //----------------------------------------------------------------------------//
 int ReqDB::reqInitSongInf(void)
 {
-	char sql_cmd[SQL_STR_SZ];
-	int nrow = 0, ncolumn = 0;
-	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
+	int nrow = 0;
+	sqlite3_stmt *stmt = reqStmtBegin(REQDB_SQL_SONGCOUNT);
 
-	memset(sql_cmd, 0, sizeof(sql_cmd));
-	
-	if (checkSQLExist(REQDB_SQL_SONGCOUNT))
-		sprintf(sql_cmd, "%s", getSQLString(REQDB_SQL_SONGCOUNT));
-	sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-
-	if (nrow)
-		result_nrow = atoi(azResult[ncolumn]);
-	
-	if (errMsg != NULL)
-		sqlite3_free(errMsg);
-
-	sqlite3_free_table(azResult);
+	if (stmt != NULL)
+	{
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			result_nrow = sqlite3_column_int(stmt, 0);
+			nrow = 1;
+		}
+		reqStmtEnd(stmt);
+	}
 	
 #ifdef A_BUFFER_FOR_NORMAL_LIST
 	d_pbNormalBuffer = new ReqDBSongInf_t[result_nrow];
@@ -2325,77 +2531,45 @@ void ReqDB::reqDeInitSongInf(void)
 		d_pbNormalBuffer = NULL;
 	}
 #endif
-	if (result_buf != NULL)
-	{
-		sqlite3_free_table(result_buf);
-		result_buf = NULL;
-	}
+	memset(&result_songInf, 0, sizeof(result_songInf));
 }
 
 //----------------------------------------------------------------------------//
 int ReqDB::reqDbSongInf(unsigned int songNo, ReqDBSongInf_t* output)
 {
-	char sql_cmd[SQL_STR_SZ];
-	int nrow = 0, ncolumn = 0;
-	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
+	int nrow = 0;
+	sqlite3_stmt *stmt;
 
-	memset(output, 0, sizeof(ReqDBSongInf_t));
-	memset(sql_cmd, 0, sizeof(sql_cmd));
-	
-	if (result_buf != NULL)
+	//same song is asked again and again while a list is drawn
+	if (result_songInf.SongIndex > 0 && (unsigned int)result_songInf.SongIndex == songNo)
 	{
-		if(atoi(result_buf[result_ncolumn]) == songNo)
-		{
-			azResult = result_buf;
-			ncolumn = result_ncolumn;
-			nrow = 1;
-		}
-		else
-		{
-			sqlite3_free_table(result_buf);
-			result_buf = NULL;
-			
-			if (checkSQLExist(REQDB_SQL_SONGINF))
-				sprintf(sql_cmd, getSQLString(REQDB_SQL_SONGINF), songNo);
-			sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-			if (errMsg != NULL)
-				sqlite3_free(errMsg);
-		}
+		memcpy(output, &result_songInf, sizeof(ReqDBSongInf_t));
+		return 1;
 	}
-	else
+
+	memset(output, 0, sizeof(ReqDBSongInf_t));
+
+	stmt = reqStmtBegin(REQDB_SQL_SONGINF);
+	if (stmt == NULL)
+		return 0;
+
+	sqlite3_bind_int(stmt, 1, songNo);
+	if (sqlite3_step(stmt) == SQLITE_ROW)
 	{
-		if (checkSQLExist(REQDB_SQL_SONGINF))
-			sprintf(sql_cmd, getSQLString(REQDB_SQL_SONGINF),songNo);
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-		if (errMsg != NULL)
-			sqlite3_free(errMsg);
+		output->SongIndex = sqlite3_column_int(stmt, 0);
+		output->OrderIndex = sqlite3_column_int(stmt, 1);
+		output->FileType = sqlite3_column_int(stmt, 2);
+		stmtColumnText(stmt, 3, output->SongName, sizeof(output->SongName));
+		stmtColumnText(stmt, 4, output->FirstWord, sizeof(output->FirstWord));
+		stmtColumnText(stmt, 5, output->SingerName, sizeof(output->SingerName));
+		output->SubFileType = sqlite3_column_int(stmt, 6);
+		nrow = 1;
 	}
+	reqStmtEnd(stmt);
 
 	if (nrow)
-	{
-		result_buf = azResult;
-		result_ncolumn = ncolumn;
-
-		output->SongIndex = atoi(azResult[ncolumn]); 
-		output->OrderIndex = atoi(azResult[ncolumn + 1]);
-		output->FileType = atoi(azResult[ncolumn + 2]);
-		strncpy(output->SongName, azResult[ncolumn + 3], sizeof(output->SongName)-1);
-		strncpy(output->FirstWord, azResult[ncolumn + 4], sizeof(output->FirstWord)-1);
-		if(azResult[ncolumn + 5] == NULL)
-		{
-			M3D_DebugPrint("SingerName == NULL \n");
-			sprintf(output->SingerName," ");
-		}
-		else
-			
-		strncpy(output->SingerName, azResult[ncolumn + 5], sizeof(output->SingerName)-1);
-		output->SubFileType = atoi(azResult[ncolumn + 6]);
-	}
-	
-	if (errMsg != NULL)
-		sqlite3_free(errMsg);
-	
+		memcpy(&result_songInf, output, sizeof(ReqDBSongInf_t));
+
 	return nrow;
 }
 
@@ -2403,98 +2577,77 @@ int ReqDB::reqDbSongInf(unsigned int songNo, ReqDBSongInf_t* output)
 int ReqDB::reqDbSongIndexByIndex(unsigned int index)
 {
 	int songIndex = -1;
-	char sql_cmd[SQL_STR_SZ];
-	int nrow = 0, ncolumn = 0;
-	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
+	sqlite3_stmt *stmt;
 		
 	if(index <= (unsigned int)result_nrow)
 	{
-		memset(sql_cmd, 0, sizeof(sql_cmd));
-		if (checkSQLExist(REQDB_SQL_SONGINF_BY_INDEX))
-			sprintf(sql_cmd, getSQLString(REQDB_SQL_SONGINF_BY_INDEX),index);
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-	
-		songIndex = atoi(azResult[ncolumn*nrow]);
-		sqlite3_free_table(azResult);
-}
+		stmt = reqStmtBegin(REQDB_SQL_SONGINF_BY_INDEX);
+		if (stmt != NULL)
+		{
+			sqlite3_bind_int(stmt, 1, (index > 0)? index-1 : 0);
+			if (sqlite3_step(stmt) == SQLITE_ROW)
+				songIndex = sqlite3_column_int(stmt, 0);
+			reqStmtEnd(stmt);
+		}
+	}
 
 	return songIndex;
-	}
-	
+}
 
+//----------------------------------------------------------------------------//
 int ReqDB::reqDbSongindexByOrder(unsigned int index)
 {
 	int songIndex = -1;
-	char sql_cmd[SQL_STR_SZ];
-	int nrow = 0, ncolumn = 0;
-	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
+	sqlite3_stmt *stmt;
 		
 	if(index <= (unsigned int)result_nrow)
 	{
-		memset(sql_cmd, 0, sizeof(sql_cmd));
-		
-		sprintf(sql_cmd, "SELECT SongIndex FROM TableSong ORDER BY OrderIndex LIMIT %d", index);
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-
-		songIndex = atoi(azResult[ncolumn*nrow]);
-		sqlite3_free_table(azResult);
+		stmt = reqStmtBegin(REQDB_SQL_SONGINDEX_BY_ORDER);
+		if (stmt != NULL)
+		{
+			sqlite3_bind_int(stmt, 1, (index > 0)? index-1 : 0);
+			if (sqlite3_step(stmt) == SQLITE_ROW)
+				songIndex = sqlite3_column_int(stmt, 0);
+			reqStmtEnd(stmt);
+		}
 	}
 	
 	return songIndex;
-
-
 }
 
-
+//----------------------------------------------------------------------------//
 int ReqDB::reqDbSongindexByOrderIndex(unsigned int OrderIndex)
 {
 	int songIndex = -1;
-	char sql_cmd[SQL_STR_SZ];
-	int nrow = 0, ncolumn = 0;
-	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
-		
-	
-		memset(sql_cmd, 0, sizeof(sql_cmd));
-		
-		sprintf(sql_cmd, "SELECT SongIndex FROM TableSong where OrderIndex = %d", OrderIndex);
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-
-		songIndex = atoi(azResult[ncolumn*nrow]);
-		sqlite3_free_table(azResult);
+	sqlite3_stmt *stmt = reqStmtBegin(REQDB_SQL_SONGINDEX_BY_ORDERINDEX);
 
+	if (stmt != NULL)
+	{
+		sqlite3_bind_int(stmt, 1, OrderIndex);
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+			songIndex = sqlite3_column_int(stmt, 0);
+		reqStmtEnd(stmt);
+	}
 	
 	return songIndex;
-
-
 }
 
+//----------------------------------------------------------------------------//
 int ReqDB::reqDbOrderindexBySongIndex(unsigned int SongIndex)
 {
 	int orderindex = -1;
-	char sql_cmd[SQL_STR_SZ];
-	int nrow = 0, ncolumn = 0;
-	char **azResult; //save inquire result from db	
-	char * errMsg = NULL;
-		
-	
-		memset(sql_cmd, 0, sizeof(sql_cmd));
-		
-		sprintf(sql_cmd, "SELECT Orderindex FROM TableSong where SongIndex = %d", SongIndex);
-		sqlite3_get_table(d_db, sql_cmd, &azResult, &nrow, &ncolumn, &errMsg);
-
-		orderindex = atoi(azResult[ncolumn*nrow]);
-		sqlite3_free_table(azResult);
+	sqlite3_stmt *stmt = reqStmtBegin(REQDB_SQL_ORDERINDEX_BY_SONGINDEX);
 
+	if (stmt != NULL)
+	{
+		sqlite3_bind_int(stmt, 1, SongIndex);
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+			orderindex = sqlite3_column_int(stmt, 0);
+		reqStmtEnd(stmt);
+	}
 	
 	return orderindex;
-
-
 }
 
 
 }
-
-
@@ -27,6 +27,8 @@
 #include "GUIBase/M3D_Req.h"
 
 #include "ReqBindingStruct.h"
+#include "ReqListBuffer.h"
+#include "ReqSearchIndex.h"
 #include <unordered_map>
 
 namespace CEGUI
@@ -40,6 +42,10 @@ namespace CEGUI
 
 #define MAX_ABC_COUNT 	28
 
+#define REQDB_PREFETCH_RADIUS	2		//pages prefetched ahead of and behind the list cursor
+#define REQDB_SEARCH_MAX_HITS	200		//songs kept from a full text search
+#define REQDB_SEARCH_MAX_DIST	1		//typos accepted by the full text search
+
 /*!
 \brief
 	database request data type
@@ -248,6 +254,10 @@ enum
 	REQDB_SQL_MY_HOT_SONGID,
 	REQDB_SQL_SINGER_BY_SONGID,
 	REQDB_SQL_FAVO_LOAD,
+
+	REQDB_SQL_SONGINDEX_BY_ORDER,
+	REQDB_SQL_SONGINDEX_BY_ORDERINDEX,
+	REQDB_SQL_ORDERINDEX_BY_SONGINDEX,
 };
 
 /*!
@@ -354,6 +364,7 @@ public:
 	virtual void* getBindingRec(void) {return bindingRec.items;}
 	virtual void* getBindingRec(int id) {return &(bindingRec.items[id]);}
 	virtual int getBindingRecLength(void) {return sizeof(DBBindingStruct_t);}
+	virtual int getBindingRecCount(void) {return MAX_BINDREC_COUNT;}
 	
 	/*!
 	\brief
@@ -420,6 +431,14 @@ public:
 	bool pthreadCreate(void);
 	bool pthreadDestroy(void);
 
+	/*!
+	\brief
+		build the song full text index on its own pthread and connection,
+		the pinyin list searches it when no first word starts with the input
+	*/
+	bool reqSearchIndexStart(const char* dbPath);
+	void reqSearchIndexStop(void);
+
 	DBBindingRec_t bindingRec;
 	int d_ForeignFlag;
 	sqlite3* d_db;
@@ -463,6 +482,7 @@ protected:
 	int reqEasySong(int reqStart, int reqCount);
 	int reqLanguageSong(int reqStart, int reqCount);
 	int reqDownload(int reqStart, int reqCount);
+	int reqSearchSong(const char* strpara, int reqStart, int reqCount);
 	
 	/*!
 	\brief
@@ -491,13 +511,68 @@ protected:
 	typedef std::unordered_map<int, std::string> SQLTypeNameMap_t;
 	SQLTypeNameMap_t SQLTypeNameRegistry;
 
+	/*!
+	\brief
+		prefetch hooks, see M3D_Req. reqXxx() write their records to recItems()
+		and read the command from reqCmd(), both differ on the prefetch worker.
+	*/
+	virtual bool reqPrefetchable(void);
+	virtual int reqRecDirect(int reqStart, int reqCount);
+	virtual void reqPrefetchHit(void* item);
+	DBBindingStruct_t* recItems(void)
+	{
+		DBBindingStruct_t* items = (DBBindingStruct_t*)prefetchTarget();
+		return items? items : bindingRec.items;
+	}
+
+	/*!
+	\brief
+		prepared statement cache, one compiled sqlite3_stmt per REQDB_SQL_* command.
+		the SQL text uses '?' parameters and is compiled once per connection,
+		reqStmtBegin() returns it reset and locked, reqStmtEnd() releases it.
+	*/
+	sqlite3_stmt* reqStmtBegin(int type);
+	void reqStmtEnd(sqlite3_stmt* stmt);
+	void freeStmtCache(void);
+	static void stmtColumnText(sqlite3_stmt* stmt, int col, char* output, int size);
+	//list of a browse command, ?1 ?2 first word range, ?3 limit, ?4 offset, ?5 key; azResult NULL - count only
+	int reqStmtList(int type, const char* prefix, int limit, int offset, int key, char*** azResult, int* ncolumn);
+	static void reqFreeTable(char** azResult);
+
+	typedef std::unordered_map<int, sqlite3_stmt*> StmtCacheMap_t;
+	StmtCacheMap_t StmtCache;
+	sqlite3* d_stmtCacheDb;
+	pthread_mutex_t d_stmtLock;
+
+	/*!
+	\brief
+		list buffer queries, each ReqDB keeps its own cursor so the UI list
+		and remote phone requests page through the buffer independently.
+	*/
+	int reqListBufferSong(int type, int reqStart, int reqCount, const char* para, NeedSongInfo_t* info);
+	int reqListBufferSinger(int type, int reqStart, int reqCount, const char* para, NeedSingerInfo_t* info);
+
+	ReqBufCursor_t d_songCursor;
+	ReqBufCursor_t d_singerCursor;
+
+	//! full text search, the last query and its songs are kept for paging
+	static void* searchIndexBuild(void* param);
+
+	ReqSearchIndex d_searchIndex;
+	pthread_t d_searchThread;
+	bool d_searchThreadRun;
+	std::string d_searchDbPath;
+	char d_searchQuery[M3DREQ_STRPARA_LEN+1];
+	int d_searchSongs[REQDB_SEARCH_MAX_HITS];
+	int d_searchCount;
+
 	//! internel parameter for database access
 	//sqlite3* d_db;
 	sqlite3_stmt *g_stmt;
 	char *g_ztail;
 
 	//save song table
-	char** 		result_buf;
+	ReqDBSongInf_t	result_songInf;
 	int 		result_nrow;
 	int 		result_ncolumn;
 
@@ -0,0 +1,363 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : ReqDecrypt.cpp
+//
+// Description: block decryption of protected song data and resources
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#include "ReqDecrypt.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DECRYPT_NEON
+#include <arm_neon.h>
+#if defined(__linux__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DECRYPT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace CEGUI
+{
+
+#define DECRYPT_HALF_SZ		(DECRYPT_BLOCK_SZ/2)
+
+/*
+	the swap of DecDataX pairs byte i of the low half with byte 256+P(i) of the
+	high half, P moves the low nibble of i to the high nibble and the other way
+	round, each reordered. so byte (row a, column b) of one half comes from
+	byte (row DecryptRowTab[b], column DecryptColTab[a]) of the other half,
+	the same tables for both directions.
+*/
+static const unsigned char DecryptColTab[16] =
+{
+	0, 4, 8, 12, 2, 6, 10, 14, 1, 5, 9, 13, 3, 7, 11, 15,
+};
+
+static const unsigned char DecryptRowTab[16] =
+{
+	0, 8, 4, 12, 1, 9, 5, 13, 2, 10, 6, 14, 3, 11, 7, 15,
+};
+
+//! the bit shuffle DecDataX xors byte i of the low half with
+static const unsigned char DecryptMaskLo[DECRYPT_HALF_SZ] =
+{
+	0x00, 0x40, 0x20, 0x60, 0x80, 0xC0, 0xA0, 0xE0, 0x08, 0x48, 0x28, 0x68, 0x88, 0xC8, 0xA8, 0xE8,
+	0x10, 0x50, 0x30, 0x70, 0x90, 0xD0, 0xB0, 0xF0, 0x18, 0x58, 0x38, 0x78, 0x98, 0xD8, 0xB8, 0xF8,
+	0x01, 0x41, 0x21, 0x61, 0x81, 0xC1, 0xA1, 0xE1, 0x09, 0x49, 0x29, 0x69, 0x89, 0xC9, 0xA9, 0xE9,
+	0x11, 0x51, 0x31, 0x71, 0x91, 0xD1, 0xB1, 0xF1, 0x19, 0x59, 0x39, 0x79, 0x99, 0xD9, 0xB9, 0xF9,
+	0x04, 0x44, 0x24, 0x64, 0x84, 0xC4, 0xA4, 0xE4, 0x0C, 0x4C, 0x2C, 0x6C, 0x8C, 0xCC, 0xAC, 0xEC,
+	0x14, 0x54, 0x34, 0x74, 0x94, 0xD4, 0xB4, 0xF4, 0x1C, 0x5C, 0x3C, 0x7C, 0x9C, 0xDC, 0xBC, 0xFC,
+	0x05, 0x45, 0x25, 0x65, 0x85, 0xC5, 0xA5, 0xE5, 0x0D, 0x4D, 0x2D, 0x6D, 0x8D, 0xCD, 0xAD, 0xED,
+	0x15, 0x55, 0x35, 0x75, 0x95, 0xD5, 0xB5, 0xF5, 0x1D, 0x5D, 0x3D, 0x7D, 0x9D, 0xDD, 0xBD, 0xFD,
+	0x02, 0x42, 0x22, 0x62, 0x82, 0xC2, 0xA2, 0xE2, 0x0A, 0x4A, 0x2A, 0x6A, 0x8A, 0xCA, 0xAA, 0xEA,
+	0x12, 0x52, 0x32, 0x72, 0x92, 0xD2, 0xB2, 0xF2, 0x1A, 0x5A, 0x3A, 0x7A, 0x9A, 0xDA, 0xBA, 0xFA,
+	0x03, 0x43, 0x23, 0x63, 0x83, 0xC3, 0xA3, 0xE3, 0x0B, 0x4B, 0x2B, 0x6B, 0x8B, 0xCB, 0xAB, 0xEB,
+	0x13, 0x53, 0x33, 0x73, 0x93, 0xD3, 0xB3, 0xF3, 0x1B, 0x5B, 0x3B, 0x7B, 0x9B, 0xDB, 0xBB, 0xFB,
+	0x06, 0x46, 0x26, 0x66, 0x86, 0xC6, 0xA6, 0xE6, 0x0E, 0x4E, 0x2E, 0x6E, 0x8E, 0xCE, 0xAE, 0xEE,
+	0x16, 0x56, 0x36, 0x76, 0x96, 0xD6, 0xB6, 0xF6, 0x1E, 0x5E, 0x3E, 0x7E, 0x9E, 0xDE, 0xBE, 0xFE,
+	0x07, 0x47, 0x27, 0x67, 0x87, 0xC7, 0xA7, 0xE7, 0x0F, 0x4F, 0x2F, 0x6F, 0x8F, 0xCF, 0xAF, 0xEF,
+	0x17, 0x57, 0x37, 0x77, 0x97, 0xD7, 0xB7, 0xF7, 0x1F, 0x5F, 0x3F, 0x7F, 0x9F, 0xDF, 0xBF, 0xFF,
+};
+
+//! the same for the high half, indexed by the position in the high half
+static const unsigned char DecryptMaskHi[DECRYPT_HALF_SZ] =
+{
+	0x00, 0x02, 0x04, 0x06, 0x10, 0x12, 0x14, 0x16, 0x01, 0x03, 0x05, 0x07, 0x11, 0x13, 0x15, 0x17,
+	0x80, 0x82, 0x84, 0x86, 0x90, 0x92, 0x94, 0x96, 0x81, 0x83, 0x85, 0x87, 0x91, 0x93, 0x95, 0x97,
+	0x08, 0x0A, 0x0C, 0x0E, 0x18, 0x1A, 0x1C, 0x1E, 0x09, 0x0B, 0x0D, 0x0F, 0x19, 0x1B, 0x1D, 0x1F,
+	0x88, 0x8A, 0x8C, 0x8E, 0x98, 0x9A, 0x9C, 0x9E, 0x89, 0x8B, 0x8D, 0x8F, 0x99, 0x9B, 0x9D, 0x9F,
+	0x20, 0x22, 0x24, 0x26, 0x30, 0x32, 0x34, 0x36, 0x21, 0x23, 0x25, 0x27, 0x31, 0x33, 0x35, 0x37,
+	0xA0, 0xA2, 0xA4, 0xA6, 0xB0, 0xB2, 0xB4, 0xB6, 0xA1, 0xA3, 0xA5, 0xA7, 0xB1, 0xB3, 0xB5, 0xB7,
+	0x28, 0x2A, 0x2C, 0x2E, 0x38, 0x3A, 0x3C, 0x3E, 0x29, 0x2B, 0x2D, 0x2F, 0x39, 0x3B, 0x3D, 0x3F,
+	0xA8, 0xAA, 0xAC, 0xAE, 0xB8, 0xBA, 0xBC, 0xBE, 0xA9, 0xAB, 0xAD, 0xAF, 0xB9, 0xBB, 0xBD, 0xBF,
+	0x40, 0x42, 0x44, 0x46, 0x50, 0x52, 0x54, 0x56, 0x41, 0x43, 0x45, 0x47, 0x51, 0x53, 0x55, 0x57,
+	0xC0, 0xC2, 0xC4, 0xC6, 0xD0, 0xD2, 0xD4, 0xD6, 0xC1, 0xC3, 0xC5, 0xC7, 0xD1, 0xD3, 0xD5, 0xD7,
+	0x48, 0x4A, 0x4C, 0x4E, 0x58, 0x5A, 0x5C, 0x5E, 0x49, 0x4B, 0x4D, 0x4F, 0x59, 0x5B, 0x5D, 0x5F,
+	0xC8, 0xCA, 0xCC, 0xCE, 0xD8, 0xDA, 0xDC, 0xDE, 0xC9, 0xCB, 0xCD, 0xCF, 0xD9, 0xDB, 0xDD, 0xDF,
+	0x60, 0x62, 0x64, 0x66, 0x70, 0x72, 0x74, 0x76, 0x61, 0x63, 0x65, 0x67, 0x71, 0x73, 0x75, 0x77,
+	0xE0, 0xE2, 0xE4, 0xE6, 0xF0, 0xF2, 0xF4, 0xF6, 0xE1, 0xE3, 0xE5, 0xE7, 0xF1, 0xF3, 0xF5, 0xF7,
+	0x68, 0x6A, 0x6C, 0x6E, 0x78, 0x7A, 0x7C, 0x7E, 0x69, 0x6B, 0x6D, 0x6F, 0x79, 0x7B, 0x7D, 0x7F,
+	0xE8, 0xEA, 0xEC, 0xEE, 0xF8, 0xFA, 0xFC, 0xFE, 0xE9, 0xEB, 0xED, 0xEF, 0xF9, 0xFB, 0xFD, 0xFF,
+};
+
+//! one half of a block out of the other one, dst and src do not overlap
+typedef void (*DecryptHalfFunc)(unsigned char* dst, const unsigned char* src, const unsigned char* key);
+
+//----------------------------------------------------------------------------//
+//- C
+//----------------------------------------------------------------------------//
+static void DecryptHalfC(unsigned char* dst, const unsigned char* src, const unsigned char* key)
+{
+	int a;
+	int b;
+
+	for (a = 0; a < 16; a++)
+	{
+		const unsigned char* col = src + DecryptColTab[a];
+
+		for (b = 0; b < 16; b++)
+			dst[b] = col[DecryptRowTab[b]*16] ^ key[b];
+		dst += 16;
+		key += 16;
+	}
+}
+
+//----------------------------------------------------------------------------//
+//- SSE2 / NEON
+//----------------------------------------------------------------------------//
+/*
+	the rows are loaded in DecryptRowTab order and transposed with four rounds
+	of byte interleaves, row k with row k+8. every round rotates the 8 bit
+	(row, column) index by one bit, after four the rows are the columns.
+*/
+#ifdef DECRYPT_SSE2
+static void DecryptHalfSimd(unsigned char* dst, const unsigned char* src, const unsigned char* key)
+{
+	__m128i v[16];
+	__m128i t[16];
+	int i;
+	int k;
+
+	for (i = 0; i < 16; i++)
+		v[i] = _mm_loadu_si128((const __m128i*)(src + DecryptRowTab[i]*16));
+	for (i = 0; i < 4; i++)
+	{
+		for (k = 0; k < 8; k++)
+		{
+			t[2*k]   = _mm_unpacklo_epi8(v[k], v[k+8]);
+			t[2*k+1] = _mm_unpackhi_epi8(v[k], v[k+8]);
+		}
+		memcpy(v, t, sizeof(v));
+	}
+	for (i = 0; i < 16; i++)
+	{
+		__m128i mask = _mm_loadu_si128((const __m128i*)(key + i*16));
+		_mm_storeu_si128((__m128i*)(dst + i*16), _mm_xor_si128(v[DecryptColTab[i]], mask));
+	}
+}
+
+#define DECRYPT_SIMD_NAME	"sse2"
+#endif
+
+#ifdef DECRYPT_NEON
+static void DecryptHalfSimd(unsigned char* dst, const unsigned char* src, const unsigned char* key)
+{
+	uint8x16_t v[16];
+	uint8x16_t t[16];
+	int i;
+	int k;
+
+	for (i = 0; i < 16; i++)
+		v[i] = vld1q_u8(src + DecryptRowTab[i]*16);
+	for (i = 0; i < 4; i++)
+	{
+		for (k = 0; k < 8; k++)
+		{
+			uint8x16x2_t z = vzipq_u8(v[k], v[k+8]);
+
+			t[2*k]   = z.val[0];
+			t[2*k+1] = z.val[1];
+		}
+		memcpy(v, t, sizeof(v));
+	}
+	for (i = 0; i < 16; i++)
+		vst1q_u8(dst + i*16, veorq_u8(v[DecryptColTab[i]], vld1q_u8(key + i*16)));
+}
+
+#define DECRYPT_SIMD_NAME	"neon"
+#endif
+
+//----------------------------------------------------------------------------//
+//- dispatch
+//----------------------------------------------------------------------------//
+static DecryptHalfFunc DecryptHalf = NULL;
+
+static bool DecryptCpuHasSimd(void)
+{
+#if defined(DECRYPT_NEON) && defined(__linux__) && !defined(__aarch64__) && defined(AT_HWCAP)
+	// armv7 builds with -mfpu=neon may still land on a core without it
+	return (getauxval(AT_HWCAP) & (1 << 12)) != 0;		// HWCAP_NEON
+#elif defined(DECRYPT_NEON) || defined(DECRYPT_SSE2)
+	return true;
+#else
+	return false;
+#endif
+}
+
+const char* ReqDecrypt::setSimd(bool enable)
+{
+#if defined(DECRYPT_NEON) || defined(DECRYPT_SSE2)
+	if (enable && DecryptCpuHasSimd())
+	{
+		DecryptHalf = DecryptHalfSimd;
+		return DECRYPT_SIMD_NAME;
+	}
+#endif
+	DecryptHalf = DecryptHalfC;
+	return "c";
+}
+
+//----------------------------------------------------------------------------//
+//- ReqDecrypt
+//----------------------------------------------------------------------------//
+ReqDecrypt::ReqDecrypt(unsigned char custNoHigh, unsigned char custNoLow)
+{
+	setKey(custNoHigh, custNoLow);
+}
+
+void ReqDecrypt::setKey(unsigned char custNoHigh, unsigned char custNoLow)
+{
+	int i;
+
+	for (i = 0; i < DECRYPT_HALF_SZ; i++)
+	{
+		d_key[i] = DecryptMaskLo[i] ^ custNoHigh;
+		d_key[DECRYPT_HALF_SZ + i] = DecryptMaskHi[i] ^ custNoLow;
+	}
+}
+
+void ReqDecrypt::decrypt(unsigned char* pData, unsigned int length) const
+{
+	unsigned char low[DECRYPT_HALF_SZ];
+	unsigned int count = length / DECRYPT_BLOCK_SZ;
+
+	// the first caller picks, racing callers pick the same
+	if (DecryptHalf == NULL)
+		setSimd(true);
+	while (count--)
+	{
+		// the new low half is kept aside until the old one is used up
+		DecryptHalf(low, pData + DECRYPT_HALF_SZ, d_key);
+		DecryptHalf(pData + DECRYPT_HALF_SZ, pData, d_key + DECRYPT_HALF_SZ);
+		memcpy(pData, low, DECRYPT_HALF_SZ);
+		pData += DECRYPT_BLOCK_SZ;
+	}
+}
+
+//----------------------------------------------------------------------------//
+//- ReqDecryptFile
+//----------------------------------------------------------------------------//
+ReqDecryptFile::ReqDecryptFile(void) :
+	d_fp(NULL),
+	d_buf(NULL),
+	d_size(0),
+	d_pos(0),
+	d_bufPos(0),
+	d_bufLen(0)
+{
+}
+
+ReqDecryptFile::~ReqDecryptFile(void)
+{
+	close();
+}
+
+bool ReqDecryptFile::open(const char* path, unsigned char custNoHigh, unsigned char custNoLow)
+{
+	close();
+	d_buf = (unsigned char*)malloc(DECRYPT_READ_SZ);
+	if (d_buf == NULL)
+		return false;
+	d_fp = fopen(path, "rb");
+	if (d_fp == NULL || fseek(d_fp, 0, SEEK_END) != 0 || (d_size = ftell(d_fp)) < 0)
+	{
+		close();
+		return false;
+	}
+	d_dec.setKey(custNoHigh, custNoLow);
+	d_pos = 0;
+	d_bufPos = 0;
+	d_bufLen = 0;
+	return true;
+}
+
+void ReqDecryptFile::close(void)
+{
+	if (d_fp != NULL)
+	{
+		fclose(d_fp);
+		d_fp = NULL;
+	}
+	if (d_buf != NULL)
+	{
+		free(d_buf);
+		d_buf = NULL;
+	}
+	d_size = 0;
+	d_pos = 0;
+	d_bufLen = 0;
+}
+
+bool ReqDecryptFile::fill(long pos)
+{
+	long start = pos - pos % DECRYPT_BLOCK_SZ;
+	int len = 0;
+	int ret;
+
+	d_bufLen = 0;
+	if (fseek(d_fp, start, SEEK_SET) != 0)
+		return false;
+	while (len < DECRYPT_READ_SZ && start + len < d_size)
+	{
+		ret = (int)fread(d_buf + len, 1, DECRYPT_READ_SZ - len, d_fp);
+		if (ret <= 0)
+			break;
+		len += ret;
+	}
+	// a short read before the end is cut to whole blocks, the rest is read again
+	if (start + len < d_size)
+		len -= len % DECRYPT_BLOCK_SZ;
+	if (len <= pos - start)
+		return false;
+	d_dec.decrypt(d_buf, len);
+	d_bufPos = start;
+	d_bufLen = len;
+	return true;
+}
+
+int ReqDecryptFile::read(void* buf, int size)
+{
+	unsigned char* out = (unsigned char*)buf;
+	int done = 0;
+	int len;
+
+	if (d_fp == NULL)
+		return -1;
+	while (done < size && d_pos < d_size)
+	{
+		if (d_pos < d_bufPos || d_pos >= d_bufPos + d_bufLen)
+		{
+			if (!fill(d_pos))
+				return done > 0 ? done : -1;
+		}
+		len = (int)(d_bufPos + d_bufLen - d_pos);
+		if (len > size - done)
+			len = size - done;
+		memcpy(out + done, d_buf + (d_pos - d_bufPos), len);
+		done += len;
+		d_pos += len;
+	}
+	return done;
+}
+
+bool ReqDecryptFile::seek(long offset)
+{
+	if (d_fp == NULL || offset < 0 || offset > d_size)
+		return false;
+	d_pos = offset;
+	return true;
+}
+
+}
@@ -0,0 +1,100 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : ReqDecrypt.h
+//
+// Description: block decryption of protected song data and resources
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#ifndef REQDECRYPT_H
+#define REQDECRYPT_H
+
+#include <stdio.h>
+
+namespace CEGUI
+{
+
+#define DECRYPT_BLOCK_SZ		512					//! bytes of an encrypted block
+#define DECRYPT_READ_SZ			(1024*64)			//! bytes ReqDecryptFile reads at a time
+
+/*!
+\brief
+	decryption of the data ReqDB::DecDataX takes. every 512 byte block is
+	scrambled on its own: byte i of one half is swapped with a byte of the other
+	half picked by a bit shuffle of i, then xored with a shuffle of i and the
+	customer number. bytes after the last whole block are not encrypted.
+	seen as two 16x16 byte matrices the swap is a transpose with the rows and
+	the columns reordered, decrypt() does it with table lookups, or 16 rows at a
+	time with SSE2/NEON when the cpu has it. all paths give the same bytes.
+*/
+class ReqDecrypt
+{
+public:
+	ReqDecrypt(unsigned char custNoHigh = 0, unsigned char custNoLow = 0);
+
+	void setKey(unsigned char custNoHigh, unsigned char custNoLow);
+
+	/*!
+	\brief
+		decrypt in place, the bytes after the last whole block are left alone
+	*/
+	void decrypt(unsigned char* pData, unsigned int length) const;
+
+	/*!
+	\brief
+		use SSE2/NEON when the cpu has it, or the plain C path
+		return ---- "sse2", "neon" or "c", the path in use now
+	*/
+	static const char* setSimd(bool enable);
+
+private:
+	unsigned char d_key[DECRYPT_BLOCK_SZ];		//! xor mask of a block, customer number included
+};
+
+/*!
+\brief
+	read only file that is decrypted on the way in, reads DECRYPT_READ_SZ of
+	whole blocks and hands out any part of it, so callers can read and seek at
+	any offset without keeping the whole file in memory.
+*/
+class ReqDecryptFile
+{
+public:
+	ReqDecryptFile(void);
+	~ReqDecryptFile(void);
+
+	bool open(const char* path, unsigned char custNoHigh, unsigned char custNoLow);
+	void close(void);
+	bool isOpen(void) const {return d_fp != NULL;}
+
+	/*!
+	\brief
+		return ---- bytes read, 0 at the end of the file, -1 on a read error
+	*/
+	int read(void* buf, int size);
+	bool seek(long offset);
+	long tell(void) const {return d_pos;}
+	long size(void) const {return d_size;}
+
+private:
+	bool fill(long pos);
+
+	FILE* d_fp;
+	ReqDecrypt d_dec;
+	unsigned char* d_buf;					//! DECRYPT_READ_SZ, decrypted
+	long d_size;
+	long d_pos;
+	long d_bufPos;							//! file offset of d_buf, a block boundary
+	int d_bufLen;
+};
+
+}
+
+#endif
@@ -0,0 +1,259 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : ReqDecryptBench.cpp
+//
+// Description: standalone check and benchmark for ReqDecrypt, not part of the app.
+//				compares the C and SIMD paths and ReqDecryptFile with the
+//				original DecDataX loop, then times all of them in MB/s.
+//
+//	build:	g++ -O2 -DREQ_DECRYPT_BENCH ReqDecryptBench.cpp ReqDecrypt.cpp
+//	run:	./a.out [MB] [tmp file]		(default 64, ./decrypt_bench.bin)
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#ifdef REQ_DECRYPT_BENCH
+
+#include "ReqDecrypt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+using namespace CEGUI;
+
+#define BENCH_CHECK_ROUNDS	200
+#define BENCH_REPEAT		4
+
+//----------------------------------------------------------------------------//
+static long long benchNowUs(void)
+{
+#ifdef WIN32
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return now.QuadPart * 1000000 / freq.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+//----------------------------------------------------------------------------//
+// ReqDB::DecDataX before ReqDecrypt, the reference
+static void DecDataXRef(unsigned char * pData, unsigned EncLength, unsigned char CustNoHigh, unsigned char CustNoLow)
+{
+	unsigned long Cnt;
+	unsigned long Cnt2;
+	unsigned char Cnt3;
+	unsigned char Cnt4;
+	unsigned char SwitchData;
+
+	for(Cnt =0; Cnt < (EncLength/512); Cnt ++)
+	{
+		for(Cnt2 = 0; Cnt2 < 256; Cnt2 ++)
+		{
+			Cnt3 =
+				((Cnt2 & (1<<0)?1:0) << 7) +
+				((Cnt2 & (1<<1)?1:0) << 6) +
+				((Cnt2 & (1<<2)?1:0) << 4) +
+				((Cnt2 & (1<<3)?1:0) << 5) +
+				((Cnt2 & (1<<4)?1:0) << 2) +
+				((Cnt2 & (1<<5)?1:0) << 3) +
+				((Cnt2 & (1<<6)?1:0) << 1) +
+				((Cnt2 & (1<<7)?1:0) << 0) ;
+
+			Cnt4 =
+				((Cnt2 & (1<<0)?1:0) << 6) +
+				((Cnt2 & (1<<1)?1:0) << 5) +
+				((Cnt2 & (1<<2)?1:0) << 7) +
+				((Cnt2 & (1<<3)?1:0) << 3) +
+				((Cnt2 & (1<<4)?1:0) << 4) +
+				((Cnt2 & (1<<5)?1:0) << 0) +
+				((Cnt2 & (1<<6)?1:0) << 2) +
+				((Cnt2 & (1<<7)?1:0) << 1) ;
+
+			SwitchData = pData[Cnt * 512 + 256 + Cnt3];
+			pData[Cnt * 512 + 256 + Cnt3] = pData[Cnt * 512 + Cnt2];
+			pData[Cnt * 512 + Cnt2] = SwitchData;
+			pData[Cnt * 512 + Cnt2] ^= (Cnt4 ^ CustNoHigh);
+			pData[Cnt * 512 + 256 + Cnt3] ^= (Cnt4 ^ CustNoLow);
+		}
+	}
+}
+
+static void fillRandom(unsigned char* buf, unsigned int size)
+{
+	for (unsigned int i = 0; i < size; i++)
+		buf[i] = (unsigned char)(rand() >> 4);
+}
+
+//----------------------------------------------------------------------------//
+// random lengths with tails and every pair of customer numbers on both paths
+static bool checkBlocks(void)
+{
+	unsigned char* src = (unsigned char*)malloc(DECRYPT_BLOCK_SZ * 40);
+	unsigned char* ref = (unsigned char*)malloc(DECRYPT_BLOCK_SZ * 40);
+	unsigned char* out = (unsigned char*)malloc(DECRYPT_BLOCK_SZ * 40);
+	bool ok = true;
+
+	for (int simd = 0; simd < 2 && ok; simd++) {
+		const char* name = ReqDecrypt::setSimd(simd != 0);
+
+		for (int key = 0; key < 0x10000 && ok; key++) {
+			unsigned int len = (key % 3)? DECRYPT_BLOCK_SZ : DECRYPT_BLOCK_SZ + 7;
+			ReqDecrypt dec(key >> 8, key & 0xFF);
+
+			fillRandom(src, len);
+			memcpy(ref, src, len);
+			memcpy(out, src, len);
+			DecDataXRef(ref, len, key >> 8, key & 0xFF);
+			dec.decrypt(out, len);
+			if (memcmp(ref, out, len) != 0) {
+				printf("check %s: key %04X differs\n", name, key);
+				ok = false;
+			}
+		}
+		for (int i = 0; i < BENCH_CHECK_ROUNDS && ok; i++) {
+			unsigned int len = rand() % (DECRYPT_BLOCK_SZ * 40);
+			unsigned char hi = rand(), lo = rand();
+			ReqDecrypt dec(hi, lo);
+
+			fillRandom(src, len);
+			memcpy(ref, src, len);
+			memcpy(out, src, len);
+			DecDataXRef(ref, len, hi, lo);
+			dec.decrypt(out, len);
+			if (memcmp(ref, out, len) != 0) {
+				printf("check %s: length %u differs\n", name, len);
+				ok = false;
+			}
+		}
+		if (ok)
+			printf("check %s: ok\n", name);
+	}
+	free(src);
+	free(ref);
+	free(out);
+	return ok;
+}
+
+//----------------------------------------------------------------------------//
+// reads of random sizes at random offsets against the file decrypted at once
+static bool checkFile(const char* path, const unsigned char* plain, unsigned int size)
+{
+	unsigned char* buf = (unsigned char*)malloc(DECRYPT_READ_SZ * 3);
+	ReqDecryptFile file;
+	unsigned int pos = 0;
+	bool ok = true;
+
+	if (!file.open(path, 0x5A, 0xC3) || file.size() != (long)size) {
+		printf("check file: open failed\n");
+		free(buf);
+		return false;
+	}
+	// front to back first, then anywhere
+	while (ok) {
+		int len = file.read(buf, 1 + rand() % (DECRYPT_READ_SZ * 3));
+		if (len == 0)
+			break;
+		if (len < 0 || memcmp(buf, plain + pos, len) != 0)
+			ok = false;
+		pos += len;
+	}
+	ok = ok && pos == size;
+	for (int i = 0; i < BENCH_CHECK_ROUNDS && ok; i++) {
+		unsigned int off = rand() % (size + 1);
+		int want = rand() % (DECRYPT_READ_SZ * 3);
+		int len;
+
+		file.seek(off);
+		len = file.read(buf, want);
+		if (len != (int)(size - off < (unsigned int)want ? size - off : want)
+			|| memcmp(buf, plain + off, len) != 0)
+			ok = false;
+	}
+	printf("check file: %s\n", ok ? "ok" : "differs");
+	file.close();
+	free(buf);
+	return ok;
+}
+
+//----------------------------------------------------------------------------//
+static void report(const char* title, long long us, unsigned int size)
+{
+	printf("%-10s %8.1f MB/s\n", title, (double)size * BENCH_REPEAT / (us > 0 ? us : 1));
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int size = ((argc > 1)? atoi(argv[1]) : 64) * 1024 * 1024 + 123;
+	const char* path = (argc > 2)? argv[2] : "decrypt_bench.bin";
+	unsigned char* data = (unsigned char*)malloc(size);
+	unsigned char* plain = (unsigned char*)malloc(size);
+	unsigned char* buf = (unsigned char*)malloc(DECRYPT_READ_SZ);
+	ReqDecrypt dec(0x5A, 0xC3);
+	ReqDecryptFile file;
+	FILE* fp;
+	long long t0;
+	int ret = 0;
+
+	srand(1234);
+	if (!checkBlocks())
+		ret = 1;
+
+	fillRandom(data, size);
+	memcpy(plain, data, size);
+	DecDataXRef(plain, size, 0x5A, 0xC3);
+	fp = fopen(path, "wb");
+	if (fp == NULL || fwrite(data, 1, size, fp) != size) {
+		printf("cannot write %s\n", path);
+		return 1;
+	}
+	fclose(fp);
+	if (!checkFile(path, plain, size))
+		ret = 1;
+
+	t0 = benchNowUs();
+	for (int i = 0; i < BENCH_REPEAT; i++)
+		DecDataXRef(data, size, 0x5A, 0xC3);
+	report("original", benchNowUs()-t0, size);
+
+	for (int simd = 0; simd < 2; simd++) {
+		const char* name = ReqDecrypt::setSimd(simd != 0);
+
+		t0 = benchNowUs();
+		for (int i = 0; i < BENCH_REPEAT; i++)
+			dec.decrypt(data, size);
+		report(name, benchNowUs()-t0, size);
+	}
+
+	// page cache warm, this is the decrypt plus the copies
+	t0 = benchNowUs();
+	for (int i = 0; i < BENCH_REPEAT; i++) {
+		file.open(path, 0x5A, 0xC3);
+		while (file.read(buf, DECRYPT_READ_SZ) > 0)
+			;
+		file.close();
+	}
+	report("file", benchNowUs()-t0, size);
+
+	remove(path);
+	free(data);
+	free(plain);
+	free(buf);
+	return ret;
+}
+
+#endif
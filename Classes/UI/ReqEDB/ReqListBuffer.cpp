@@ -15,10 +15,16 @@
 #include <string>
 #ifndef WIN32
 #include <unistd.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #else
 #include <windows.h>
 #endif
 #include <fstream>
+#include <vector>
+#include <algorithm>
 
 #include "krkplayer/MCodeConvert.h"
 
@@ -62,6 +68,10 @@
 //徲̬bufferָ
 static SongBufInfo_t BufferSong[BUFFER_SONG_TYPE_COUNT];
 static SingerBufInfo_t BufferSinger[BUFFER_SINGER_TYPE_COUNT];
+///ͷʱд, ѯʱӶ; ÿͷź汾ż1, ɵα֮ʧЧ
+static pthread_rwlock_t BufferLock = PTHREAD_RWLOCK_INITIALIZER;
+static unsigned int SongBufferGeneration = 0;				//͸Ǹһ汾, ͷһ಻Ӱһα
+static unsigned int SingerBufferGeneration = 0;
 
 //----------------------------------------------------------------//
 static const char* SqlSongString[BUFFER_SONG_TYPE_COUNT] = 
@@ -128,7 +138,6 @@ static bool ThreadBufferIsUsed = false;
 
 //һЩʱ
 #define VERSION_STR_LEN 12
-static char CodeBufferVer[VERSION_STR_LEN];
 static char TmpSongFilePath[MAX_PATH_LEN];
 static char TmpSingerFilePath[MAX_PATH_LEN];
 
@@ -157,6 +166,73 @@ inline int bundingNeedSingerInfo(sqlite3_stmt** pstmt, NeedSingerInfo_t* pinfo,
 	return 2;
 }
 
+//--------------------same FirstWord: names in ChineseGBSort order----------------------//
+class BufNameLess
+{
+public:
+	BufNameLess(const unsigned char* keys, const int* offsets) : d_keys(keys), d_offsets(offsets) {}
+	bool operator()(int a, int b) const
+	{
+		return MCodeCompareSortKey(d_keys + d_offsets[a], d_offsets[a+1] - d_offsets[a],
+			d_keys + d_offsets[b], d_offsets[b+1] - d_offsets[b]) < 0;
+	}
+
+private:
+	const unsigned char* d_keys;
+	const int* d_offsets;
+};
+
+static const char* songBufName(const NeedSongInfo_t& info) {return info.SongName;}
+static const char* singerBufName(const NeedSingerInfo_t& info) {return info.SingerName;}
+
+// sql orders by FirstWord only, the names of a FirstWord are sorted here with the batch sort keys
+template <typename Info>
+static void sortBufferByName(Info* info, const RefStruct_2_t* ref, int refCount, const char* (*getName)(const Info&))
+{
+	std::vector<char> nameBuf;
+	std::vector<const char*> names;
+	std::vector<unsigned char> keys;
+	std::vector<int> offsets, order;
+	std::vector<Info> tmp;
+
+	try
+	{
+		for(int r = 0; r < refCount; r++)
+		{
+			int start = ref[r].start;
+			int count = ref[r].count;
+			if(count < 2)
+				continue;
+
+			// names may fill their field without '\0'
+			nameBuf.assign(count * (MAX_NAME_LEN + 1), 0);
+			names.resize(count);
+			for(int i = 0; i < count; i++)
+			{
+				names[i] = &nameBuf[i * (MAX_NAME_LEN + 1)];
+				strncpy(&nameBuf[i * (MAX_NAME_LEN + 1)], getName(info[start + i]), MAX_NAME_LEN);
+			}
+			// a utf-8 byte takes at most 2 gb bytes, each gb byte at most 2 key bytes
+			keys.resize(count * MAX_NAME_LEN * 4);
+			offsets.resize(count + 1);
+			if(MCodeUTF8SortKeys(&names[0], count, &keys[0], keys.size(), &offsets[0], NULL, 0) < count)
+				continue;
+
+			order.resize(count);
+			for(int i = 0; i < count; i++)
+				order[i] = i;
+			std::stable_sort(order.begin(), order.end(), BufNameLess(&keys[0], &offsets[0]));
+			tmp.assign(info + start, info + start + count);
+			for(int i = 0; i < count; i++)
+				info[start + i] = tmp[order[i]];
+		}
+	}
+	catch(const std::bad_alloc& )
+	{
+		M3D_DebugPrint("<sortBufferByName> no memory, names keep the db order\n");
+	}
+}
+
 inline int FirstWordToAlphaIndex(const char* pstr)
 {
 	int itemp;
@@ -175,334 +251,383 @@ inline int FirstWordToAlphaIndex(const char* pstr)
 }
 
 //-----------------------------------------------------------------------------//
-static bool checkDbVersion(FILE* pfBuf, int dbver)
+//ļʽ(ֱmmapʹ):
+//	[0, BUF_MAP_ALIGN)		BufMapHead_t ļͷ, ƫƺALPHA INDEX
+//	֮ÿ, BUF_MAP_ALIGN:
+//		¼(NeedSongInfo_t / NeedSingerInfo_t, ֱӴڼ¼)
+//		FIRST WORDǰ׺(RefStruct_2_t)
+//	headChecksum/indexChecksum are checked on every load, they cover the head and the FIRST WORD
+//	indexes only, a load does not touch the record pages. dataChecksum covers all data after the
+//	head and is checked once, by reading the file back after it is written
+#define BUF_MAP_MAGIC			"MKLBUF3"
+#define BUF_MAP_ALIGN			4096
+#define BUF_MAP_MAX_SECTION		24
+
+typedef struct
 {
-	//汾
-	int versize = sizeof(CodeBufferVer);
-	if(_fread(CodeBufferVer, versize, pfBuf) != versize)
-		return false;
-	if(sqlite3_strnicmp(CodeBufferVer, CODE_BUFFER_VER, sizeof(CODE_BUFFER_VER)) != 0)
-		return false;
+	int count;
+	int listOffset;
+	int firstWrdCount;
+	int firstWordOffset;
+	int alphaIdxOffset[ALPHA_INDEX_COUNT];
+} BufMapSection_t;
 
-	// db汾
-	int filedbver;
-	if(_fread(&filedbver, sizeof(int), pfBuf) != sizeof(int))
-		return false;
-	if(filedbver != dbver)
-		return false;
-	return true;
-}
+typedef struct
+{
+	char magic[8];
+	char codeVer[VERSION_STR_LEN];
+	int dbver;
+	int recordSize;
+	int refSize;
+	int sectionCount;
+	unsigned int fileSize;
+	unsigned int dataChecksum;
+	unsigned int indexChecksum;
+	unsigned int headChecksum;			// of the head with this field 0
+	BufMapSection_t section[BUF_MAP_MAX_SECTION];
+} BufMapHead_t;
+
+typedef struct
+{
+	void* base;
+	unsigned int size;
+} BufMap_t;
+
+static BufMap_t SongBufMap = {NULL, 0};
+static BufMap_t SingerBufMap = {NULL, 0};
+
+static_assert(sizeof(BufMapHead_t) <= BUF_MAP_ALIGN, "BufMapHead_t must fit in the first page");
+static_assert(BUFFER_SONG_TYPE_COUNT <= BUF_MAP_MAX_SECTION, "too many song buffer types");
 
 //-----------------------------------------------------------------------------//
-static bool writeDbVersion(FILE* pfBuf, int dbver)
+static unsigned int bufMapChecksum(const unsigned char* data, unsigned int size, unsigned int sum)
 {
-	//汾
-	int versize = sizeof(CodeBufferVer);
-	strncpy(CodeBufferVer, CODE_BUFFER_VER, versize);
-	if(_fwrite(CodeBufferVer, versize, pfBuf) != versize)
-		return false;
+	//FNV-1a, 4ֽڴ(ݾѶ)
+	const unsigned int* pword = (const unsigned int*)data;
+	unsigned int words = size / sizeof(unsigned int);
+	for(unsigned int i=0; i<words; i++)
+	{
+		sum ^= pword[i];
+		sum *= 16777619U;
+	}
+	return sum;
+}
 
-	// db汾
-	if(_fwrite(&dbver, sizeof(int), pfBuf) != sizeof(int))
+//-----------------------------------------------------------------------------//
+static bool bufMapWrite(FILE* pfBuf, const void* data, unsigned int size, unsigned int* sum, unsigned int* offset)
+{
+	if(size == 0)
+		return true;
+	if(_fwrite(data, size, pfBuf) != size)
 		return false;
+	*sum = bufMapChecksum((const unsigned char*)data, size, *sum);
+	*offset += size;
 	return true;
 }
 
 //-----------------------------------------------------------------------------//
-static bool initSongBufInfo(FILE* pfBuf, int index)
+static bool bufMapPad(FILE* pfBuf, unsigned int* sum, unsigned int* offset)
 {
-	//ȡ
-	SongBufInfo_t* bufinfo = &BufferSong[index];
-	int itemp;
-	NeedSongInfo_t* tmpinf;
-	RefStruct_2_t* tmpalpha;
-	int num, infosize;
-
-	//ʼڳͷԴ
-	bufinfo->count = 0;
-	bufinfo->firstWrdCount = 0;
+	static const char zero[BUF_MAP_ALIGN] = {0};
+	unsigned int pad = (BUF_MAP_ALIGN - (*offset % BUF_MAP_ALIGN)) % BUF_MAP_ALIGN;
+	return bufMapWrite(pfBuf, zero, pad, sum, offset);
+}
 
-	//ȡϢ
-	if(_fread(&itemp, sizeof(int), pfBuf) != sizeof(int))
-		return false;
-	if(itemp > 0)
-	{
-		try
-		{
-			bufinfo->pListBuffer = new NeedSongInfo_t[itemp];
-		}
-		catch(const std::bad_alloc& )
-		{
-			return false;
-		}
-		bufinfo->count = itemp;
+//-----------------------------------------------------------------------------//
+static unsigned int bufMapHeadChecksum(const BufMapHead_t* head)
+{
+	BufMapHead_t temp;
 
-		//
-		num = 0;
-		infosize = sizeof(NeedSongInfo_t);
-		while(num < itemp)
-		{
-			tmpinf = bufinfo->pListBuffer + num;
-			if(_fread(tmpinf, infosize, pfBuf) != infosize)
-				goto To_error_end0_;
-			num++;
-		}
-	}
+	memcpy(&temp, head, sizeof(temp));
+	temp.headChecksum = 0;
+	return bufMapChecksum((const unsigned char*)&temp, sizeof(temp), 2166136261U);
+}
 
-	//ȡALPHA INDEXϢ
-	itemp = sizeof(bufinfo->alphaIdxOffset);
-	if(_fread(bufinfo->alphaIdxOffset, itemp, pfBuf) != itemp)
-		goto To_error_end0_;
+//-----------------------------------------------------------------------------//
+//read the written file back once and check all data after the head
+static bool bufMapVerifyFile(const char* path, const BufMapHead_t* head)
+{
+	unsigned char* buf;
+	unsigned int sum = 2166136261U;
+	unsigned int left = head->fileSize - BUF_MAP_ALIGN;
+	FILE* pfBuf;
+	bool ret = false;
 
-	//ȡFIRST WORDϢ
-	if(_fread(&itemp, sizeof(int), pfBuf) != sizeof(int))
-		goto To_error_end0_;
-	if(itemp > 0)
+	pfBuf = _fopen(path, "rb");
+	if(pfBuf == NULL)
 	{
-		try
-		{
-			bufinfo->firstWord = new RefStruct_2_t[itemp];
-		}
-		catch(const std::bad_alloc& )
-		{
-			goto To_error_end0_;
-		}
-		bufinfo->firstWrdCount = itemp;
-
-		//FIRST WORD
-		num = 0;
-		infosize = sizeof(RefStruct_2_t);
-		while(num < itemp)
+		return false;
+	}
+	buf = new unsigned char[BUF_MAP_ALIGN * 16];
+	if(fseek(pfBuf, BUF_MAP_ALIGN, SEEK_SET) == 0)
+	{
+		while(left > 0)
 		{
-			tmpalpha = bufinfo->firstWord + num;
-			if(_fread(tmpalpha, infosize, pfBuf) != infosize)
-				goto To_error_end1_;
-			num++;
+			unsigned int size = (left < BUF_MAP_ALIGN * 16) ? left : BUF_MAP_ALIGN * 16;
+			if(_fread(buf, size, pfBuf) != size)
+				break;
+			sum = bufMapChecksum(buf, size, sum);
+			left -= size;
 		}
+		ret = (left == 0 && sum == head->dataChecksum);
 	}
-	return true;
-
-To_error_end0_:
-
-	delete [] bufinfo->pListBuffer;
-	return false;
-
-To_error_end1_:
-
-	delete [] bufinfo->pListBuffer;
-	delete [] bufinfo->firstWord;
-	return false;
+	_fclose(pfBuf);
+	delete [] buf;
+	return ret;
 }
 
 //-----------------------------------------------------------------------------//
-static bool initSingerBufInfo(FILE* pfBuf, int index)
+//Ѹдʱļ, ɹrename, ;ϵ粻°ļ
+static bool writeBufferMapFile(const char* path, int dbver, int recordSize, int sectionCount,
+							   const void* const* lists, const int* counts,
+							   RefStruct_2_t* const* firstWords, const int* firstWrdCounts,
+							   const int (*alphaIdxOffsets)[ALPHA_INDEX_COUNT])
 {
-	//ȡ
-	SingerBufInfo_t* bufinfo = &BufferSinger[index];
-	int itemp;
-	NeedSingerInfo_t* tmpinf;
-	RefStruct_2_t* tmpalpha;
-	int num, infosize;
-	
-	//ʼڳͷԴ
-	bufinfo->count = 0;
-	bufinfo->firstWrdCount = 0;
+	char tmppath[MAX_PATH_LEN];
+	BufMapHead_t head;
+	unsigned int sum = 2166136261U;
+	unsigned int indexSum = 2166136261U;
+	unsigned int offset = BUF_MAP_ALIGN;
+	FILE* pfBuf;
 
-	//ȡϢ
-	if(_fread(&itemp, sizeof(int), pfBuf) != sizeof(int))
+	snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+	pfBuf = _fopen(tmppath, "wb");
+	if(!pfBuf)
 		return false;
-	if(itemp > 0)
+
+	memset(&head, 0, sizeof(head));
+	strncpy(head.magic, BUF_MAP_MAGIC, sizeof(head.magic));
+	strncpy(head.codeVer, CODE_BUFFER_VER, sizeof(head.codeVer));
+	head.dbver = dbver;
+	head.recordSize = recordSize;
+	head.refSize = sizeof(RefStruct_2_t);
+	head.sectionCount = sectionCount;
+
+	//ռסļͷ, д
+	if(fseek(pfBuf, BUF_MAP_ALIGN, SEEK_SET) != 0)
+		goto To_write_failed_;
+
+	for(int i=0; i<sectionCount; i++)
 	{
-		try
-		{
-			bufinfo->pListBuffer = new NeedSingerInfo_t[itemp];
-		}
-		catch(const std::bad_alloc& )
-		{
-			return false;
-		}
-		bufinfo->count = itemp;
+		BufMapSection_t* sec = &head.section[i];
 
-		//
-		num = 0;
-		infosize = sizeof(NeedSingerInfo_t);
-		while(num < itemp)
-		{
-			tmpinf = bufinfo->pListBuffer + num;
-			if(_fread(tmpinf, infosize, pfBuf) != infosize)
-				goto To_error_end0_;
-			num++;
-		}
+		sec->count = counts[i];
+		sec->listOffset = offset;
+		if(!bufMapWrite(pfBuf, lists[i], counts[i] * recordSize, &sum, &offset))
+			goto To_write_failed_;
+		if(!bufMapPad(pfBuf, &sum, &offset))
+			goto To_write_failed_;
+
+		sec->firstWrdCount = firstWrdCounts[i];
+		sec->firstWordOffset = offset;
+		if(!bufMapWrite(pfBuf, firstWords[i], firstWrdCounts[i] * sizeof(RefStruct_2_t), &sum, &offset))
+			goto To_write_failed_;
+		indexSum = bufMapChecksum((const unsigned char*)firstWords[i], firstWrdCounts[i] * sizeof(RefStruct_2_t), indexSum);
+		if(!bufMapPad(pfBuf, &sum, &offset))
+			goto To_write_failed_;
+
+		memcpy(sec->alphaIdxOffset, alphaIdxOffsets[i], sizeof(sec->alphaIdxOffset));
 	}
+	head.fileSize = offset;
+	head.dataChecksum = sum;
+	head.indexChecksum = indexSum;
+	head.headChecksum = bufMapHeadChecksum(&head);
 
-	//ȡALPHA INDEXϢ
-	itemp = sizeof(bufinfo->alphaIdxOffset);
-	if(_fread(bufinfo->alphaIdxOffset, itemp, pfBuf) != itemp)
-		goto To_error_end0_;
+	if(fseek(pfBuf, 0, SEEK_SET) != 0)
+		goto To_write_failed_;
+	if(_fwrite(&head, sizeof(head), pfBuf) != sizeof(head))
+		goto To_write_failed_;
+	if(fflush(pfBuf) != 0)
+		goto To_write_failed_;
+#ifndef WIN32
+	fsync(fileno(pfBuf));
+#endif
+	_fclose(pfBuf);
 
-	//ȡFIRST WORDϢ
-	if(_fread(&itemp, sizeof(int), pfBuf) != sizeof(int))
-		goto To_error_end0_;
-	if(itemp > 0)
+	if(!bufMapVerifyFile(tmppath, &head))
 	{
-		try
-		{
-			bufinfo->firstWord = new RefStruct_2_t[itemp];
-		}
-		catch(const std::bad_alloc& )
-		{
-			goto To_error_end0_;
-		}
-		bufinfo->firstWrdCount = itemp;
+		M3D_DebugPrint("<writeBufferMapFile> [%s] verify error.\n", tmppath);
+		_fremove(tmppath);
+		return false;
+	}
 
-		//FIRST WORD
-		num = 0;
-		infosize = sizeof(RefStruct_2_t);
-		while(num < itemp)
-		{
-			tmpalpha = bufinfo->firstWord + num;
-			if(_fread(tmpalpha, infosize, pfBuf) != infosize)
-				goto To_error_end1_;
-			num++;
-		}
+	_fremove(path);
+	if(rename(tmppath, path) != 0)
+	{
+		_fremove(tmppath);
+		return false;
 	}
 	return true;
 
-To_error_end0_:
+To_write_failed_:
 
-	delete [] bufinfo->pListBuffer;
+	_fclose(pfBuf);
+	_fremove(tmppath);
 	return false;
+}
 
-To_error_end1_:
-
-	delete [] bufinfo->pListBuffer;
-	delete [] bufinfo->firstWord;
-	return false;
+//-----------------------------------------------------------------------------//
+static void unmapBufferFile(BufMap_t* map)
+{
+	if(map->base == NULL)
+		return;
+#ifndef WIN32
+	munmap(map->base, map->size);
+#else
+	delete [] (char*)map->base;
+#endif
+	map->base = NULL;
+	map->size = 0;
 }
 
-//--------------------------------дļ--------------------------------//
-static bool writeSongBufInfo(FILE* pfBuf, int index)
+//-----------------------------------------------------------------------------//
+//ֻӳ仺ļУ, ļͷ(ָӳ)
+static const BufMapHead_t* mapBufferFile(const char* path, int dbver, int recordSize, int sectionCount, BufMap_t* map)
 {
-	SongBufInfo_t* bufinfo = &BufferSong[index];
-	int itemp;
+	const BufMapHead_t* head;
+	unsigned int size;
+	unsigned int indexSum = 2166136261U;
 
-	//жBUFFERǷΪֵ
-	if(bufinfo->state != BUFFER_LOAD_STATE_END)
+	//the buffers may point into the mapping, it goes only with releaseXxxBufInfo()
+	if(map->base != NULL)
+		return NULL;
+
+#ifndef WIN32
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+		return NULL;
+	if(fstat(fd, &st) != 0 || st.st_size < BUF_MAP_ALIGN)
+	{
+		close(fd);
+		return NULL;
+	}
+	size = (unsigned int)st.st_size;
+	void* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(base == MAP_FAILED)
+		return NULL;
+#else
+	FILE* pfBuf = _fopen(path, "rb");
+	if(!pfBuf)
+		return NULL;
+	fseek(pfBuf, 0, SEEK_END);
+	size = (unsigned int)ftell(pfBuf);
+	fseek(pfBuf, 0, SEEK_SET);
+	if(size < BUF_MAP_ALIGN)
 	{
-		return false;
+		_fclose(pfBuf);
+		return NULL;
 	}
-
-	//Ϣдļ
-	NeedSongInfo_t* ptmpinfo;
-	int infosize = sizeof(NeedSongInfo_t);
-	itemp = bufinfo->count;
-	if(_fwrite(&itemp, sizeof(int), pfBuf) != sizeof(int))
-		return false;
-	for(int i=0; i<itemp; i++)
+	char* base = new char[size];
+	if(_fread(base, size, pfBuf) != size)
 	{
-		ptmpinfo = bufinfo->pListBuffer + i;
-		if(_fwrite(ptmpinfo, infosize, pfBuf) != infosize)
-			return false;
+		delete [] base;
+		_fclose(pfBuf);
+		return NULL;
 	}
+	_fclose(pfBuf);
+#endif
+	map->base = base;
+	map->size = size;
 
-	//ȡALPHA INDEXϢ
-	itemp = sizeof(bufinfo->alphaIdxOffset);
-	if(_fwrite(bufinfo->alphaIdxOffset, itemp, pfBuf) != itemp)
-		return false;
-
-	//FIRST WORDдļ
-	RefStruct_2_t* ptmpref;
-	int refsize = sizeof(RefStruct_2_t);
-	itemp = bufinfo->firstWrdCount;
-	if(_fwrite(&itemp, sizeof(int), pfBuf) != sizeof(int))
-		return false;
-	for(int i=0; i<itemp; i++)
+	//汾ݸʽ
+	head = (const BufMapHead_t*)base;
+	if(memcmp(head->magic, BUF_MAP_MAGIC, sizeof(BUF_MAP_MAGIC)) != 0
+		|| sqlite3_strnicmp(head->codeVer, CODE_BUFFER_VER, sizeof(CODE_BUFFER_VER)) != 0
+		|| head->dbver != dbver
+		|| head->recordSize != recordSize
+		|| head->refSize != (int)sizeof(RefStruct_2_t)
+		|| head->sectionCount != sectionCount
+		|| head->fileSize != size)
+		goto To_map_failed_;
+	if(bufMapHeadChecksum(head) != head->headChecksum)
 	{
-		ptmpref = bufinfo->firstWord + i;
-		if(_fwrite(ptmpref, refsize, pfBuf) != refsize)
-			return false;
+		M3D_DebugPrint("<mapBufferFile> [%s] head checksum error.\n", path);
+		goto To_map_failed_;
 	}
-	return true;
-}
-
-//--------------------------------дļ--------------------------------//
-static bool writeSingerBufInfo(FILE* pfBuf, int index)
-{
-	SingerBufInfo_t* bufinfo = &BufferSinger[index];
-	int itemp;
 
-	//жBUFFERǷΪֵ
-	if(bufinfo->state != BUFFER_LOAD_STATE_END)
+	for(int i=0; i<sectionCount; i++)
 	{
-		return false;
+		const BufMapSection_t* sec = &head->section[i];
+		if(sec->count < 0 || sec->firstWrdCount < 0
+			|| sec->listOffset < BUF_MAP_ALIGN || sec->firstWordOffset < BUF_MAP_ALIGN
+			|| (unsigned int)sec->listOffset + (unsigned int)sec->count * recordSize > size
+			|| sec->listOffset % BUF_MAP_ALIGN != 0 || sec->firstWordOffset % BUF_MAP_ALIGN != 0
+			|| (unsigned int)sec->listOffset + (unsigned int)sec->count * recordSize > (unsigned int)sec->firstWordOffset
+			|| (unsigned int)sec->firstWordOffset + (unsigned int)sec->firstWrdCount * sizeof(RefStruct_2_t) > size)
+			goto To_map_failed_;
+		indexSum = bufMapChecksum((const unsigned char*)base + sec->firstWordOffset, sec->firstWrdCount * sizeof(RefStruct_2_t), indexSum);
 	}
 
-	//Ϣдļ
-	NeedSingerInfo_t* ptmpinfo;
-	int infosize = sizeof(NeedSingerInfo_t);
-	itemp = bufinfo->count;
-	if(_fwrite(&itemp, sizeof(int), pfBuf) != sizeof(int))
-		return false;
-	for(int i=0; i<itemp; i++)
+	if(indexSum != head->indexChecksum)
 	{
-		ptmpinfo = bufinfo->pListBuffer + i;
-		if(_fwrite(ptmpinfo, infosize, pfBuf) != infosize)
-			return false;
+		M3D_DebugPrint("<mapBufferFile> [%s] index checksum error.\n", path);
+		goto To_map_failed_;
 	}
+	return head;
 
-	//ȡALPHA INDEXϢ
-	itemp = sizeof(bufinfo->alphaIdxOffset);
-	if(_fwrite(bufinfo->alphaIdxOffset, itemp, pfBuf) != itemp)
-		return false;
+To_map_failed_:
 
-	//FIRST WORDдļ
-	RefStruct_2_t* ptmpref;
-	int refsize = sizeof(RefStruct_2_t);
-	itemp = bufinfo->firstWrdCount;
-	if(_fwrite(&itemp, sizeof(int), pfBuf) != sizeof(int))
-		return false;
-	for(int i=0; i<itemp; i++)
-	{
-		ptmpref = bufinfo->firstWord + i;
-		if(_fwrite(ptmpref, refsize, pfBuf) != refsize)
-			return false;
-	}
-	return true;
+	unmapBufferFile(map);
+	return NULL;
 }
 
 //--------------------------------ͷŸ--------------------------------//
 static bool releaseSongBufInfo(void)
 {
+	pthread_rwlock_wrlock(&BufferLock);
 	//ͷŸԴ
 	for(int i=0; i<BUFFER_SONG_TYPE_COUNT; i++)
 	{
 		if(BufferSong[i].state == BUFFER_LOAD_STATE_END)
 		{
-			delete [] BufferSong[i].pListBuffer;
-			delete [] BufferSong[i].firstWord;
+			if(!BufferSong[i].mapped)
+			{
+				delete [] BufferSong[i].pListBuffer;
+				delete [] BufferSong[i].firstWord;
+			}
+			BufferSong[i].mapped = false;
 			BufferSong[i].state = BUFFER_LOAD_STATE_NONE;
 		}
 		else if(BufferSong[i].state != BUFFER_LOAD_STATE_NONE)
+		{
+			pthread_rwlock_unlock(&BufferLock);
 			return false;
+		}
 	}
+	unmapBufferFile(&SongBufMap);
+	SongBufferGeneration++;
+	pthread_rwlock_unlock(&BufferLock);
 	return true;
 }
 
 //---------------------------ͷŸǻ---------------------------//
 static bool releaseSingerBufInfo(void)
 {
+	pthread_rwlock_wrlock(&BufferLock);
 	//ͷŸԴ
 	for(int i=0; i<BUFFER_SINGER_TYPE_COUNT; i++)
 	{
 		if(BufferSinger[i].state == BUFFER_LOAD_STATE_END)
 		{
-			delete [] BufferSinger[i].pListBuffer;
-			delete [] BufferSinger[i].firstWord;
+			if(!BufferSinger[i].mapped)
+			{
+				delete [] BufferSinger[i].pListBuffer;
+				delete [] BufferSinger[i].firstWord;
+			}
+			BufferSinger[i].mapped = false;
 			BufferSinger[i].state = BUFFER_LOAD_STATE_NONE;
 		}
 		else if(BufferSinger[i].state != BUFFER_LOAD_STATE_NONE)
+		{
+			pthread_rwlock_unlock(&BufferLock);
 			return false;
+		}
 	}
+	unmapBufferFile(&SingerBufMap);
+	SingerBufferGeneration++;
+	pthread_rwlock_unlock(&BufferLock);
 	return true;
 }
 
@@ -511,146 +636,129 @@ static bool releaseSingerBufInfo(void)
 //-------------------------ȡϢ(By File)------------------------------//
 bool loadSongBufferByFile(const char* path, int dbver)
 {
-	FILE* pfBuf;
+	const BufMapHead_t* head;
+	const char* base;
 
-	pfBuf = _fopen(path, "rb");
-	if(!pfBuf)
+	if(SongBufMap.base != NULL)
+	{
+		M3D_DebugPrint("<loadSongBufferByFile> [%s] is mapped already.\n", path);
 		return false;
+	}
+	head = mapBufferFile(path, dbver, sizeof(NeedSongInfo_t), BUFFER_SONG_TYPE_COUNT, &SongBufMap);
+	if(head == NULL)
+	{
+		_fremove(path);
+		return false;
+	}
+	base = (const char*)SongBufMap.base;
 
-	//汾
-	if(!checkDbVersion(pfBuf, dbver))
-		goto To_song_end0_;
-
-	//ȡб
+	//ֱָӳ, ٸ
 	for(int i=0; i<BUFFER_SONG_TYPE_COUNT; i++)
 	{
+		const BufMapSection_t* sec = &head->section[i];
 		if(BufferSong[i].state != BUFFER_LOAD_STATE_NONE)
 			continue;
 		BufferSong[i].state = BUFFER_LOAD_STATE_START;
-		if(!initSongBufInfo(pfBuf,i))
-		{
-			BufferSong[i].state = BUFFER_LOAD_STATE_NONE;
-			goto To_song_end0_;
-		}
-		else
-			BufferSong[i].state = BUFFER_LOAD_STATE_END;
+		BufferSong[i].count = sec->count;
+		BufferSong[i].pListBuffer = (NeedSongInfo_t*)(base + sec->listOffset);
+		BufferSong[i].firstWrdCount = sec->firstWrdCount;
+		BufferSong[i].firstWord = (RefStruct_2_t*)(base + sec->firstWordOffset);
+		memcpy(BufferSong[i].alphaIdxOffset, sec->alphaIdxOffset, sizeof(BufferSong[i].alphaIdxOffset));
+		BufferSong[i].mapped = true;
+		pthread_rwlock_wrlock(&BufferLock);
+		BufferSong[i].state = BUFFER_LOAD_STATE_END;
+		pthread_rwlock_unlock(&BufferLock);
 	}
-
-	_fclose(pfBuf);
 	return true;
-
-To_song_end0_:
-
-	_fclose(pfBuf);
-	_fremove(path);
-	return false;
 }
 
 //-----------------------ȡϢ(By File)----------------------------------//
 bool loadSingerBufferByFile(const char* path, int dbver)
 {
-	FILE* pfBuf;
+	const BufMapHead_t* head;
+	const char* base;
 
-	pfBuf = _fopen(path, "rb");
-	if(!pfBuf)
+	if(SingerBufMap.base != NULL)
+	{
+		M3D_DebugPrint("<loadSingerBufferByFile> [%s] is mapped already.\n", path);
 		return false;
+	}
+	head = mapBufferFile(path, dbver, sizeof(NeedSingerInfo_t), BUFFER_SINGER_TYPE_COUNT, &SingerBufMap);
+	if(head == NULL)
+	{
+		_fremove(path);
+		return false;
+	}
+	base = (const char*)SingerBufMap.base;
 
-	//汾
-	if(!checkDbVersion(pfBuf, dbver))
-		goto To_singer_end0_;
-
-	//ȡб
+	//ֱָӳ, ٸ
 	for(int j=0; j<BUFFER_SINGER_TYPE_COUNT; j++)
 	{
+		const BufMapSection_t* sec = &head->section[j];
 		if(BufferSinger[j].state != BUFFER_LOAD_STATE_NONE)
 			continue;
 		BufferSinger[j].state = BUFFER_LOAD_STATE_START;
-		if(!initSingerBufInfo(pfBuf,j))
-		{
-			BufferSinger[j].state = BUFFER_LOAD_STATE_NONE;
-			goto To_singer_end0_;
-		}
-		else
-			BufferSinger[j].state = BUFFER_LOAD_STATE_END;
+		BufferSinger[j].count = sec->count;
+		BufferSinger[j].pListBuffer = (NeedSingerInfo_t*)(base + sec->listOffset);
+		BufferSinger[j].firstWrdCount = sec->firstWrdCount;
+		BufferSinger[j].firstWord = (RefStruct_2_t*)(base + sec->firstWordOffset);
+		memcpy(BufferSinger[j].alphaIdxOffset, sec->alphaIdxOffset, sizeof(BufferSinger[j].alphaIdxOffset));
+		BufferSinger[j].mapped = true;
+		pthread_rwlock_wrlock(&BufferLock);
+		BufferSinger[j].state = BUFFER_LOAD_STATE_END;
+		pthread_rwlock_unlock(&BufferLock);
 	}
-
-	_fclose(pfBuf);
 	return true;
-
-To_singer_end0_:
-
-	_fclose(pfBuf);
-	_fremove(path);
-	return false;
 }
 
 //-------------------------дϢ(To File)------------------------------//
 static bool writeSongBufferToFile(const char* path, int dbver)
 {
-	FILE* pfBuf;
-	int i=0;
-
-	pfBuf = _fopen(path, "wb");
-	if(!pfBuf)
-		return false;
-
-	//д汾
-	if(!writeDbVersion(pfBuf, dbver))
-		goto To_write_failed_;
+	const void* lists[BUFFER_SONG_TYPE_COUNT];
+	int counts[BUFFER_SONG_TYPE_COUNT];
+	RefStruct_2_t* firstWords[BUFFER_SONG_TYPE_COUNT];
+	int firstWrdCounts[BUFFER_SONG_TYPE_COUNT];
+	int alphaIdxOffsets[BUFFER_SONG_TYPE_COUNT][ALPHA_INDEX_COUNT];
 
-	//ȡб
-	for(i=0; i<BUFFER_SONG_TYPE_COUNT; i++)
+	for(int i=0; i<BUFFER_SONG_TYPE_COUNT; i++)
 	{
-		if(!writeSongBufInfo(pfBuf, i))
-		{
-			goto To_write_failed_;
-		}
-	}
-
-	_fclose(pfBuf);
-	return true;
-
-To_write_failed_:
-
-	_fclose(pfBuf);
-	_fremove(path);
-	return false;
+		//жBUFFERǷΪֵ
+		if(BufferSong[i].state != BUFFER_LOAD_STATE_END)
+			return false;
+		lists[i] = BufferSong[i].pListBuffer;
+		counts[i] = BufferSong[i].count;
+		firstWords[i] = BufferSong[i].firstWord;
+		firstWrdCounts[i] = BufferSong[i].firstWrdCount;
+		memcpy(alphaIdxOffsets[i], BufferSong[i].alphaIdxOffset, sizeof(alphaIdxOffsets[i]));
+	}
+	return writeBufferMapFile(path, dbver, sizeof(NeedSongInfo_t), BUFFER_SONG_TYPE_COUNT,
+		lists, counts, firstWords, firstWrdCounts, alphaIdxOffsets);
 }
 
 //-------------------------дϢ(To File)------------------------------//
 static bool writeSingerBufferToFile(const char* path, int dbver)
 {
-	FILE* pfBuf;
-	int i=0;
-
-	pfBuf = _fopen(path, "wb");
-	if(!pfBuf)
-		return false;
-
-	//д汾
-	if(!writeDbVersion(pfBuf, dbver))
-		goto To_write_failed_;
+	const void* lists[BUFFER_SINGER_TYPE_COUNT];
+	int counts[BUFFER_SINGER_TYPE_COUNT];
+	RefStruct_2_t* firstWords[BUFFER_SINGER_TYPE_COUNT];
+	int firstWrdCounts[BUFFER_SINGER_TYPE_COUNT];
+	int alphaIdxOffsets[BUFFER_SINGER_TYPE_COUNT][ALPHA_INDEX_COUNT];
 
-	//ȡб
-	for(i=0; i<BUFFER_SINGER_TYPE_COUNT; i++)
+	for(int i=0; i<BUFFER_SINGER_TYPE_COUNT; i++)
 	{
-		if(!writeSingerBufInfo(pfBuf, i))
-		{
-			goto To_write_failed_;
-		}
-	}
-
-	_fclose(pfBuf);
-	return true;
-
-To_write_failed_:
-
-	_fclose(pfBuf);
-	_fremove(path);
-	return false;
+		//жBUFFERǷΪֵ
+		if(BufferSinger[i].state != BUFFER_LOAD_STATE_END)
+			return false;
+		lists[i] = BufferSinger[i].pListBuffer;
+		counts[i] = BufferSinger[i].count;
+		firstWords[i] = BufferSinger[i].firstWord;
+		firstWrdCounts[i] = BufferSinger[i].firstWrdCount;
+		memcpy(alphaIdxOffsets[i], BufferSinger[i].alphaIdxOffset, sizeof(alphaIdxOffsets[i]));
+	}
+	return writeBufferMapFile(path, dbver, sizeof(NeedSingerInfo_t), BUFFER_SINGER_TYPE_COUNT,
+		lists, counts, firstWords, firstWrdCounts, alphaIdxOffsets);
 }
 
-
 //--------------------DBлȡҪϢ-----------------------------//
 static bool reqSongBufInfo(sqlite3* dbhandle, int index, int totalCount)
 {
@@ -764,6 +872,7 @@ static bool reqSongBufInfo(sqlite3* dbhandle, int index, int totalCount)
 	}
 	if(tmpInfoIdx > 0)
 		tmpRefIdx++;		//תΪĿ
+	sortBufferByName(ptmpInfo, ptmpRef, tmpRefIdx, songBufName);
 
 	//ӻнݴ洢(СBUFFER)
 	bufinfo->count = tmpInfoIdx;
@@ -921,6 +1030,7 @@ static bool reqSingerBufInfo(sqlite3* dbhandle, int index, int totalCount)
 	}
 	if(tmpInfoIdx > 0)
 		tmpRefIdx++;		//תΪĿ
+	sortBufferByName(ptmpInfo, ptmpRef, tmpRefIdx, singerBufName);
 
 	//ӻнݴ洢(СBUFFER)
 	bufinfo->count = tmpInfoIdx;
@@ -1000,13 +1110,18 @@ bool loadSongBufferByDB(sqlite3* dbhandle, int total)
 	{
 		if(BufferSong[i].state != BUFFER_LOAD_STATE_NONE)
 			continue;
+		BufferSong[i].mapped = false;
 		BufferSong[i].state = BUFFER_LOAD_STATE_START;
 		if(!reqSongBufInfo(dbhandle, i, songtotal))
 		{
 			BufferSong[i].state = BUFFER_LOAD_STATE_NONE;
 		}
 		else
+		{
+			pthread_rwlock_wrlock(&BufferLock);
 			BufferSong[i].state = BUFFER_LOAD_STATE_END;
+			pthread_rwlock_unlock(&BufferLock);
+		}
 	}
 	return true;
 }
@@ -1045,13 +1160,18 @@ bool loadSingerBufferByDB(sqlite3* dbhandle, int total)
 	{
 		if(BufferSinger[i].state != BUFFER_LOAD_STATE_NONE)
 			continue;
+		BufferSinger[i].mapped = false;
 		BufferSinger[i].state = BUFFER_LOAD_STATE_START;
 		if(!reqSingerBufInfo(dbhandle, i, singertotal))
 		{
 			BufferSinger[i].state = BUFFER_LOAD_STATE_NONE;
 		}
 		else
+		{
+			pthread_rwlock_wrlock(&BufferLock);
 			BufferSinger[i].state = BUFFER_LOAD_STATE_END;
+			pthread_rwlock_unlock(&BufferLock);
+		}
 	}
 	return true;
 }
@@ -1450,181 +1570,115 @@ void closeDBDataBuffer(void)
 }
 
 /*
-*	б
-*	:
-*	index ----- BufferSongType_m
-*	start ----- reqStart(ʼ)
-*	count ----- reqCount()
-*	para ----- ƴ
-*	result ----- ݻṹҽʼλ
-*	ز:
-*	(count == -1) ----- 
-*	(count != -1) ----- βĿ
+*	ƴҸ
+*	bufferֻڼɺͷʱ޸, ѯֻ, αͬʱѯ
 */
-int reqBufferSongList(int index, int start, int count, const char* para, NeedSongInfo_t** result)
+int reqBufferSongQuery(ReqBufCursor_t* cursor, int index, const char* para)
 {
-	if(!ThreadBufferIsUsed)
-		return -1;
-
 	SongBufInfo_t* bufinfo;
-	static int reqnum;
-	static int begin = 0;
-	int end;
-	int retcount;
-	int paralen = strlen(para);
+	int reqnum = -1;
 
-	bufinfo = &BufferSong[index];
-
-	if(bufinfo->state != BUFFER_LOAD_STATE_END)			//ݶȡΪ
+	if(!ThreadBufferIsUsed || index < 0 || index >= BUFFER_SONG_TYPE_COUNT)
 		return -1;
 
-	if(count == -1)
+	pthread_rwlock_rdlock(&BufferLock);
+	bufinfo = &BufferSong[index];
+	if(bufinfo->state == BUFFER_LOAD_STATE_END)
 	{
-		//±
+		cursor->index = index;
+		cursor->begin = 0;
+		cursor->generation = SongBufferGeneration;
 		reqnum = bufinfo->count;
-		begin = 0;
-		//Ƚҳƴʱƫ
-		if(paralen > 0)
-		{
-			//ʹһALPHA INDEX
-			int itemp = FirstWordToAlphaIndex(para);
-			begin = bufinfo->alphaIdxOffset[itemp];
-			if(begin >= bufinfo->firstWrdCount)
-			{
-				reqnum = 0;
-				return reqnum;
-			}
-
-			while(sqlite3_strnicmp(bufinfo->firstWord[begin].alphaData, para, paralen) != 0)
-			{
-				begin++;
-				if(begin >= bufinfo->firstWrdCount)
-				{
-					reqnum = 0;
-					return reqnum;
-				}
-			}
-			end = begin;
-			while(sqlite3_strnicmp(bufinfo->firstWord[end].alphaData, para, paralen) == 0)
-			{
-				end++;
-				if(end >= bufinfo->firstWrdCount)
-				{
-					end = bufinfo->firstWrdCount - 1;
-					reqnum = bufinfo->firstWord[end].start - bufinfo->firstWord[begin].start;
-					reqnum += bufinfo->firstWord[end].count;
-					return reqnum;
-				}
-			}
-			reqnum = bufinfo->firstWord[end].start - bufinfo->firstWord[begin].start;
-		}
-		return reqnum;
+		if(strlen(para) > 0)
+			reqnum = findBufferPrefixRange(bufinfo->firstWord, bufinfo->firstWrdCount, para, &cursor->begin);
+		cursor->reqnum = reqnum;
 	}
-	else
+	pthread_rwlock_unlock(&BufferLock);
+	return reqnum;
+}
+
+/*
+*	
+*	ڶڿ, غbufferʹͷҲӰ
+*/
+int reqBufferSongFetch(const ReqBufCursor_t* cursor, int start, int count, NeedSongInfo_t* result)
+{
+	SongBufInfo_t* bufinfo;
+	int retcount = -1;
+
+	if(!ThreadBufferIsUsed || start < 0 || count < 0)
+		return -1;
+
+	pthread_rwlock_rdlock(&BufferLock);
+	bufinfo = &BufferSong[cursor->index];
+	if(bufinfo->state == BUFFER_LOAD_STATE_END && cursor->generation == SongBufferGeneration)
 	{
-		if(start < reqnum)
+		retcount = 0;
+		if(start < cursor->reqnum)
 		{
-			*result = &bufinfo->pListBuffer[start + bufinfo->firstWord[begin].start];
-			retcount = reqnum - start;
+			retcount = cursor->reqnum - start;
 			if(retcount > count)
 				retcount = count;
-			return retcount;
-		}
-		else
-		{
-			return 0;
+			memcpy(result, &bufinfo->pListBuffer[start + bufinfo->firstWord[cursor->begin].start], retcount * sizeof(NeedSongInfo_t));
 		}
 	}
-	return -1;
+	pthread_rwlock_unlock(&BufferLock);
+	return retcount;
 }
 
 /*
-*	б
-*	:
-*	index ----- BufferSingerType_m
-*	start ----- reqStart(ʼ)
-*	count ----- reqCount()
-*	para ----- ƴ
-*	result ----- ݻṹҽʼλ
-*	ز:
-*	(count == -1) ----- 
-*	(count != -1) ----- βĿ
+*	ƴҸ
 */
-int reqBufferSingerList(int index, int start, int count, const char* para, NeedSingerInfo_t** result)
+int reqBufferSingerQuery(ReqBufCursor_t* cursor, int index, const char* para)
 {
-	if(!ThreadBufferIsUsed)
-		return -1;
-
 	SingerBufInfo_t* bufinfo;
-	static int reqnum;
-	static int begin = 0;
-	int end;
-	int retcount;
-	int paralen = strlen(para);
+	int reqnum = -1;
 
-	bufinfo = &BufferSinger[index];
-
-	if(bufinfo->state != BUFFER_LOAD_STATE_END)			//ݶȡΪ
+	if(!ThreadBufferIsUsed || index < 0 || index >= BUFFER_SINGER_TYPE_COUNT)
 		return -1;
 
-	if(count == -1)
+	pthread_rwlock_rdlock(&BufferLock);
+	bufinfo = &BufferSinger[index];
+	if(bufinfo->state == BUFFER_LOAD_STATE_END)
 	{
-		//±
+		cursor->index = index;
+		cursor->begin = 0;
+		cursor->generation = SingerBufferGeneration;
 		reqnum = bufinfo->count;
-		begin = 0;
-		//Ƚҳƴʱƫ
-		if(paralen > 0)
-		{
-			//ʹһALPHA INDEX
-			int itemp = FirstWordToAlphaIndex(para);
-			begin = bufinfo->alphaIdxOffset[itemp];
-			if(begin >= bufinfo->firstWrdCount)
-			{
-				reqnum = 0;
-				return reqnum;
-			}
-
-			while(sqlite3_strnicmp(bufinfo->firstWord[begin].alphaData, para, paralen) != 0)
-			{
-				begin++;
-				if(begin >= bufinfo->firstWrdCount)
-				{
-					reqnum = 0;
-					return reqnum;
-				}
-			}
-			end = begin;
-			while(sqlite3_strnicmp(bufinfo->firstWord[end].alphaData, para, paralen) == 0)
-			{
-				end++;
-				if(end >= bufinfo->firstWrdCount)
-				{
-					end = bufinfo->firstWrdCount - 1;
-					reqnum = bufinfo->firstWord[end].start - bufinfo->firstWord[begin].start;
-					reqnum += bufinfo->firstWord[end].count;
-					return reqnum;
-				}
-			}
-			reqnum = bufinfo->firstWord[end].start - bufinfo->firstWord[begin].start;
-		}
-		return reqnum;
+		if(strlen(para) > 0)
+			reqnum = findBufferPrefixRange(bufinfo->firstWord, bufinfo->firstWrdCount, para, &cursor->begin);
+		cursor->reqnum = reqnum;
 	}
-	else
+	pthread_rwlock_unlock(&BufferLock);
+	return reqnum;
+}
+
+/*
+*	
+*/
+int reqBufferSingerFetch(const ReqBufCursor_t* cursor, int start, int count, NeedSingerInfo_t* result)
+{
+	SingerBufInfo_t* bufinfo;
+	int retcount = -1;
+
+	if(!ThreadBufferIsUsed || start < 0 || count < 0)
+		return -1;
+
+	pthread_rwlock_rdlock(&BufferLock);
+	bufinfo = &BufferSinger[cursor->index];
+	if(bufinfo->state == BUFFER_LOAD_STATE_END && cursor->generation == SingerBufferGeneration)
 	{
-		if(start < reqnum)
+		retcount = 0;
+		if(start < cursor->reqnum)
 		{
-			*result = &bufinfo->pListBuffer[start + bufinfo->firstWord[begin].start];
-			retcount = reqnum - start;
+			retcount = cursor->reqnum - start;
 			if(retcount > count)
 				retcount = count;
-			return retcount;
-		}
-		else
-		{
-			return 0;
+			memcpy(result, &bufinfo->pListBuffer[start + bufinfo->firstWord[cursor->begin].start], retcount * sizeof(NeedSingerInfo_t));
 		}
 	}
-	return -1;
+	pthread_rwlock_unlock(&BufferLock);
+	return retcount;
 }
 
 void updateDBDataBuffer()
@@ -1644,4 +1698,3 @@ void updateDBDataBuffer()
 #endif
 	}	
 }
-
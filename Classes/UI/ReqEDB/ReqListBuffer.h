@@ -9,9 +9,10 @@
 #ifndef _REQ_LIST_BUFFER_
 #define _REQ_LIST_BUFFER_
 
-#define CODE_BUFFER_VER		"Ver 0.07"
+#define CODE_BUFFER_VER		"Ver 0.08"
 #include <sqlite3.h>
 #include <pthread.h>
+#include <string.h>
 
 #define MAX_NAME_LEN		128
 #define MAX_ALPHA_INDEX		32
@@ -111,6 +112,7 @@ typedef struct
 	int alphaIdxOffset[ALPHA_INDEX_COUNT];			//һALPHA INDEX
 	int firstWrdCount;
 	RefStruct_2_t* firstWord;
+	bool mapped;									//ָ򻺴ļӳ, delete
 
 } SongBufInfo_t;
 
@@ -123,9 +125,20 @@ typedef struct
 	int alphaIdxOffset[ALPHA_INDEX_COUNT];			//һALPHA INDEX
 	int firstWrdCount;
 	RefStruct_2_t* firstWord;
+	bool mapped;
 
 } SingerBufInfo_t;
 
+//ѯα, ÿ(/ֻ)Աһ, Ӱ췭ҳ״̬
+typedef struct
+{
+	int index;										//BufferSongType_m / BufferSingerType_m
+	int begin;										//ƴҽFIRST WORDеʼ
+	int reqnum;										//ҽ
+	unsigned int generation;						//ʱbufferİ汾, buffer¼غαʧЧ
+
+} ReqBufCursor_t;
+
 
 //--------------------------------------ʵ------------------------------------//
 /*
@@ -145,32 +158,80 @@ void openDBDataBuffer(const char* path, const char* dbPath, int total);
 void closeDBDataBuffer(void);
 
 /*
-*	б
-*	:
+*	ƴҸ, cursor()
+*	:
+*	cursor ----- ԼĲѯα
 *	index ----- BufferSongType_m
-*	start ----- reqStart(ʼ)
-*	count ----- reqCount()
-*	para ----- ƴ
-*	result ----- ݻṹҽʼ?
-*	ز:
-*	(count == -1) ----- 
-*	(count != -1) ----- βĿ
+*	para ----- ƴ
+*	ز:
+*	, -1ʾbufferδ
 */
-int reqBufferSongList(int index, int start, int count, const char* para, NeedSongInfo_t** result);
+int reqBufferSongQuery(ReqBufCursor_t* cursor, int index, const char* para);
 
 /*
-*	б
-*	:
+*	cursorĲҽп()
+*	:
+*	cursor ----- reqBufferSongQueryõα
+*	start ----- reqStart(ʼ)
+*	count ----- reqCount()
+*	result ----- ṩĻ, count
+*	ز:
+*	οĿ, -1ʾbufferδαʧЧ(²)
+*/
+int reqBufferSongFetch(const ReqBufCursor_t* cursor, int start, int count, NeedSongInfo_t* result);
+
+/*
+*	ƴҸ, ͬreqBufferSongQuery
 *	index ----- BufferSingerType_m
-*	start ----- reqStart(ʼ)
-*	count ----- reqCount()
-*	para ----- ƴ
-*	result ----- ݻṹҽʼ?
-*	ز:
-*	(count == -1) ----- 
-*	(count != -1) ----- βĿ
 */
-int reqBufferSingerList(int index, int start, int count, const char* para, NeedSingerInfo_t** result);
+int reqBufferSingerQuery(ReqBufCursor_t* cursor, int index, const char* para);
+
+/*
+*	cursorĲҽп, ͬreqBufferSongFetch
+*/
+int reqBufferSingerFetch(const ReqBufCursor_t* cursor, int start, int count, NeedSingerInfo_t* result);
+
+
+//-----------------------------------------------------------------------------//
+//FIRST WORDǰCOLLATE NOCASEź, ǰ׺ͬȻ,
+//ֲһε±߽, ضڸ(), *pbeginΪ׵FIRST WORD±
+inline int findBufferPrefixRange(const RefStruct_2_t* firstWord, int firstWrdCount, const char* para, int* pbegin)
+{
+	int paralen = strlen(para);
+	int lo, hi, mid, begin;
+
+	if(paralen > (int)sizeof(firstWord[0].alphaData))
+		paralen = sizeof(firstWord[0].alphaData);
+
+	//һ >= para λ
+	lo = 0;
+	hi = firstWrdCount;
+	while(lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if(sqlite3_strnicmp(firstWord[mid].alphaData, para, paralen) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	begin = lo;
+
+	//һ > para λ
+	hi = firstWrdCount;
+	while(lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if(sqlite3_strnicmp(firstWord[mid].alphaData, para, paralen) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if(begin >= lo)
+		return 0;
+	*pbegin = begin;
+	return firstWord[lo-1].start + firstWord[lo-1].count - firstWord[begin].start;
+}
 
 
 //add for test
@@ -53,6 +53,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <unistd.h>
 //#include <MProfile.h>
 #include <pthread.h>
 #endif
@@ -208,11 +209,13 @@ void *updateRecordSongInfo(void *param)
 //----------------------------------------------------------------------------//
 ReqPhoneDB::ReqPhoneDB(void* dbFile, int para) : ReqDB(dbFile, para),d_maxRecTotalIdx(0)
     ,d_BroadResFlag(false),d_noCoinTimeFlag(NO_COIN_MODE_NONE)
+    ,d_resJournal(NULL),d_resJournalCount(0)
 {
     d_lockReqSonginf = (pthread_mutex_t *)(new pthread_mutex_t);
     pthread_mutex_init((pthread_mutex_t *)d_lockReqSonginf, NULL);
     d_RecThreadLock = new pthread_mutex_t;
     pthread_mutex_init(d_RecThreadLock, NULL);
+    pthread_mutex_init(&d_extraLock, NULL);
 
     int ret;
     orderplayflag = 0;
@@ -296,6 +299,9 @@ ReqPhoneDB::ReqPhoneDB(void* dbFile, int para) : ReqDB(dbFile, para),d_maxRecTot
 
     reqSyncLocalDB(NULL);
 
+    //full text index for the pinyin search, built off the UI thread
+    reqSearchIndexStart(d_dbPath.c_str());
+
     //read each SID to d_SIDMap
     //ReqLoadSID();
 
@@ -334,7 +340,15 @@ ReqPhoneDB::ReqPhoneDB(void* dbFile, int para) : ReqDB(dbFile, para),d_maxRecTot
 //----------------------------------------------------------------------------//
 ReqPhoneDB::~ReqPhoneDB(void)
 {
+    //the worker calls back into this class, it must be gone before any member is
+    reqPrefetchStop();
+
     _saveReservedID(false);
+    if(d_resJournal != NULL)
+    {
+        fclose(d_resJournal);
+        d_resJournal = NULL;
+    }
 
     M3D_DebugPrint("~ReqPhoneDB\n");
 
@@ -357,6 +371,7 @@ ReqPhoneDB::~ReqPhoneDB(void)
 
     pthread_mutex_destroy(d_RecThreadLock);
     delete d_RecThreadLock;
+    pthread_mutex_destroy(&d_extraLock);
     pthread_mutex_destroy((pthread_mutex_t *)d_lockReqSonginf);
     delete (pthread_mutex_t *)d_lockReqSonginf;
 
@@ -1176,127 +1191,388 @@ int ReqPhoneDB::_loadSIDToMap(char *dbFile, std::map<int, int>*map, int deviceId
 
 
 //----------------------------------------------------------------------------//
-void ReqPhoneDB::_loadReservedID(void)
+// reserved song queue
+//	ProgIdEx.bin is a snapshot of d_reservedSong, each change after it is appended
+//	to ProgIdEx.jnl as one record and synced, no full rewrite per change.
+//	the journal head keeps size/sum of the snapshot it follows, so a journal left
+//	from an older snapshot is dropped. a torn record ends the replay.
+//	the journal is folded into a new snapshot on load, on exit and every
+//	RESERVED_JNL_COMPACT records.
+//----------------------------------------------------------------------------//
+#define RESERVED_REC_SIZE		(sizeof(unsigned int)*2 + sizeof(int)*3 + USE_NAME_LEN + USE_ID_LEN + BINDING_SONGNAME_LEN*2)
+#define RESERVED_JNL_MAGIC		0x314A5352		//"RSJ1"
+#define RESERVED_JNL_COMPACT	256
+#define RESERVED_SUM_INIT		2166136261u
+
+enum
+{
+    RESERVED_OP_ADD = 1,	//arg0: 1 - insert at front, followed by the song record
+    RESERVED_OP_DEL,		//arg0: index
+    RESERVED_OP_MOVE,		//arg0: from, arg1: to
+    RESERVED_OP_CLEAR,
+};
+
+typedef struct
+{
+    unsigned int magic;
+    unsigned int snapSize;
+    unsigned int snapSum;
+} ReservJnlHead_t;
+
+typedef struct
+{
+    unsigned int op;
+    int arg0;
+    int arg1;
+    unsigned int sum;		//op/args and the song record
+} ReservJnlRec_t;
+
+//fnv-1a
+static unsigned int reserved_sum(unsigned int sum, const void *data, int size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for(int i = 0; i < size; i++)
+        sum = (sum ^ p[i]) * 16777619u;
+    return sum;
+}
+
+static unsigned long long reserved_key(unsigned int SongNo, unsigned int randomnum)
+{
+    return ((unsigned long long)SongNo << 32) | randomnum;
+}
+
+static void reserved_sync(FILE *fp)
+{
+    fflush(fp);
+#ifndef WIN32
+    fdatasync(fileno(fp));
+#endif
+}
+
+//make a rename durable
+static void reserved_syncdir(const std::string& path)
+{
+#ifndef WIN32
+    std::string::size_type pos = path.rfind('/');
+    int fd;
+
+    if(pos == std::string::npos)
+        return;
+    fd = open(path.substr(0, pos + 1).c_str(), O_RDONLY);
+    if(fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+#endif
+}
+
+//same layout as the old field by field ProgIdEx.bin
+static void reserved_pack(const ReqPhoneDB::ReservInfo_st& info, unsigned char *rec)
 {
-    FILE *fp;
     unsigned int uitemp;
     int itemp;
-    char username[USE_NAME_LEN];
-    char userid[USE_ID_LEN];
-    char songname[BINDING_SONGNAME_LEN];
-    ReservInfo_st songinfo;
-    int ret = 1;
 
+    memset(rec, 0, RESERVED_REC_SIZE);
+    uitemp = info.SongIndex;
+    memcpy(rec, &uitemp, sizeof(unsigned int));
+    rec += sizeof(unsigned int);
+    strncpy((char *)rec, info.username.c_str(), USE_NAME_LEN);
+    rec += USE_NAME_LEN;
+    strncpy((char *)rec, info.userid.c_str(), USE_ID_LEN);
+    rec += USE_ID_LEN;
+    uitemp = info.randomNum;
+    memcpy(rec, &uitemp, sizeof(unsigned int));
+    rec += sizeof(unsigned int);
+    itemp = info.FileType;
+    memcpy(rec, &itemp, sizeof(int));
+    rec += sizeof(int);
+    itemp = info.SubFileType;
+    memcpy(rec, &itemp, sizeof(int));
+    rec += sizeof(int);
+    itemp = info.OrderIndex;
+    memcpy(rec, &itemp, sizeof(int));
+    rec += sizeof(int);
+    strncpy((char *)rec, info.SongName, BINDING_SONGNAME_LEN);
+    rec += BINDING_SONGNAME_LEN;
+    strncpy((char *)rec, info.FirstWord, BINDING_SONGNAME_LEN);
+}
+
+static std::string reserved_string(const unsigned char *p, int size)
+{
+    const unsigned char *end = (const unsigned char *)memchr(p, 0, size);
+    return std::string((const char *)p, end ? (end - p) : size);
+}
+
+static void reserved_unpack(const unsigned char *rec, ReqPhoneDB::ReservInfo_st *info)
+{
+    memcpy(&info->SongIndex, rec, sizeof(unsigned int));
+    rec += sizeof(unsigned int);
+    info->username = reserved_string(rec, USE_NAME_LEN);
+    rec += USE_NAME_LEN;
+    info->userid = reserved_string(rec, USE_ID_LEN);
+    rec += USE_ID_LEN;
+    memcpy(&info->randomNum, rec, sizeof(unsigned int));
+    rec += sizeof(unsigned int);
+    memcpy(&info->FileType, rec, sizeof(int));
+    rec += sizeof(int);
+    memcpy(&info->SubFileType, rec, sizeof(int));
+    rec += sizeof(int);
+    memcpy(&info->OrderIndex, rec, sizeof(int));
+    rec += sizeof(int);
+    memcpy(info->SongName, rec, BINDING_SONGNAME_LEN);
+    info->SongName[BINDING_SONGNAME_LEN - 1] = 0;
+    rec += BINDING_SONGNAME_LEN;
+    memcpy(info->FirstWord, rec, BINDING_SONGNAME_LEN);
+    info->FirstWord[BINDING_SONGNAME_LEN - 1] = 0;
+}
+
+//----------------------------------------------------------------------------//
+bool ReqPhoneDB::_getReservedPath(std::string *path, const char *fileName)
+{
 #ifndef OUT_FILE_SET_SDA3
-    CPVRTString path = CPVRTResourceFile::GetReadPath();
+    *path = CPVRTResourceFile::GetReadPath().c_str();
 #else
-    std::string path;
-    if(!_getSDA2Path(&path))
-        return;
-    path += M3D_CONFIG_PATH;
+    if(!_getSDA2Path(path))
+        return false;
+    *path += M3D_CONFIG_PATH;
 #endif
-    path += M3D_CONFIG_PROG_ID_FILE;
+    *path += fileName;
+    return true;
+}
 
-    fp = fopen(path.c_str(), "rb");
-    if(fp != NULL)
+//----------------------------------------------------------------------------//
+bool ReqPhoneDB::_pushReserved(const ReservInfo_st& info, bool front)
+{
+    if(!d_reservedKeys.insert(reserved_key(info.SongIndex, info.randomNum)).second)
+        return false;
+    pthread_mutex_lock(&d_extraLock);
+    d_reservedCount[info.SongIndex]++;
+    pthread_mutex_unlock(&d_extraLock);
+    if(front)
+        d_reservedSong.push_front(info);
+    else
+        d_reservedSong.push_back(info);
+    return true;
+}
+
+//----------------------------------------------------------------------------//
+void ReqPhoneDB::_eraseReserved(int index)
+{
+    ReservQueue_t::iterator iReservedSong = d_reservedSong.begin() + index;
+    std::unordered_map<unsigned int, int>::iterator iCount = d_reservedCount.find(iReservedSong->SongIndex);
+
+    d_reservedKeys.erase(reserved_key(iReservedSong->SongIndex, iReservedSong->randomNum));
+    pthread_mutex_lock(&d_extraLock);
+    if(iCount != d_reservedCount.end() && --iCount->second <= 0)
+        d_reservedCount.erase(iCount);
+    pthread_mutex_unlock(&d_extraLock);
+    d_reservedSong.erase(iReservedSong);
+}
+
+//----------------------------------------------------------------------------//
+void ReqPhoneDB::_moveReserved(int from, int to)
+{
+    ReservInfo_st ReservedSongTmp = d_reservedSong[from];
+    d_reservedSong.erase(d_reservedSong.begin() + from);
+    d_reservedSong.insert(d_reservedSong.begin() + to, ReservedSongTmp);
+}
+
+//----------------------------------------------------------------------------//
+void ReqPhoneDB::_clearReserved(void)
+{
+    d_reservedSong.clear();
+    d_reservedKeys.clear();
+    pthread_mutex_lock(&d_extraLock);
+    d_reservedCount.clear();
+    pthread_mutex_unlock(&d_extraLock);
+}
+
+//----------------------------------------------------------------------------//
+int ReqPhoneDB::_findReserved(unsigned int SongNo, unsigned int randomnum)
+{
+    if(d_reservedKeys.find(reserved_key(SongNo, randomnum)) == d_reservedKeys.end())
+        return -1;
+    for(int i = 0; i < (int)d_reservedSong.size(); i++)
     {
-        while(fread(&uitemp, 1, sizeof(unsigned int), fp) ==  sizeof(unsigned int))
+        if(d_reservedSong[i].SongIndex == SongNo && d_reservedSong[i].randomNum == randomnum)
+            return i;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------------//
+//append a change to the journal, op is already applied to d_reservedSong
+void ReqPhoneDB::_logReserved(unsigned int op, int arg0, int arg1)
+{
+    ReservJnlRec_t jrec;
+    unsigned char rec[RESERVED_REC_SIZE];
+
+    if(d_resJournal == NULL || d_resJournalCount >= RESERVED_JNL_COMPACT)
+    {
+        _saveReservedID();
+        return;
+    }
+
+    jrec.op = op;
+    jrec.arg0 = arg0;
+    jrec.arg1 = arg1;
+    jrec.sum = reserved_sum(RESERVED_SUM_INIT, &jrec, sizeof(jrec) - sizeof(jrec.sum));
+    if(op == RESERVED_OP_ADD)
+    {
+        reserved_pack((arg0 == 1) ? d_reservedSong.front() : d_reservedSong.back(), rec);
+        jrec.sum = reserved_sum(jrec.sum, rec, RESERVED_REC_SIZE);
+    }
+
+    fwrite(&jrec, 1, sizeof(jrec), d_resJournal);
+    if(op == RESERVED_OP_ADD)
+        fwrite(rec, 1, RESERVED_REC_SIZE, d_resJournal);
+    reserved_sync(d_resJournal);
+    d_resJournalCount++;
+    d_BroadResFlag = true;
+}
+
+//----------------------------------------------------------------------------//
+int ReqPhoneDB::_replayReserved(FILE *fp)
+{
+    ReservJnlRec_t jrec;
+    unsigned char rec[RESERVED_REC_SIZE];
+    ReservInfo_st songinfo;
+    unsigned int sum;
+    int size;
+    int count = 0;
+
+    while(fread(&jrec, 1, sizeof(jrec), fp) == sizeof(jrec))
+    {
+        sum = reserved_sum(RESERVED_SUM_INIT, &jrec, sizeof(jrec) - sizeof(jrec.sum));
+        if(jrec.op == RESERVED_OP_ADD)
         {
-            memset(songinfo.SongName, 0, sizeof(songinfo.SongName));
-            memset(songinfo.FirstWord, 0, sizeof(songinfo.FirstWord));
-            M3D_DebugPrint("progId = %d\n",uitemp);
-
-            songinfo.SongIndex = uitemp;
-            memset(username, 0, USE_NAME_LEN);
-            fread(username, sizeof(char), USE_NAME_LEN, fp);
-            songinfo.username = username;
-            memset(userid, 0, USE_ID_LEN);
-            fread(userid, sizeof(char), USE_ID_LEN, fp);
-            songinfo.userid = userid;
-            fread(&uitemp, 1, sizeof(unsigned int), fp);
-            songinfo.randomNum = uitemp;
-
-            fread(&itemp, 1, sizeof(int), fp);
-            songinfo.FileType = itemp;
-            fread(&itemp, 1, sizeof(int), fp);
-            songinfo.SubFileType = itemp;
-            fread(&itemp, 1, sizeof(int), fp);
-            songinfo.OrderIndex = itemp;
-            memset(songname, 0, BINDING_SONGNAME_LEN);
-            fread(songname, BINDING_SONGNAME_LEN, sizeof(char), fp);
-            strncpy(songinfo.SongName, songname, BINDING_SONGNAME_LEN);
-            memset(songname, 0, BINDING_SONGNAME_LEN);
-            if(fread(songname, 1, BINDING_SONGNAME_LEN, fp) != BINDING_SONGNAME_LEN)
-            {
-                ret = 0;
+            if(fread(rec, 1, RESERVED_REC_SIZE, fp) != RESERVED_REC_SIZE)
                 break;
-            }
-            strncpy(songinfo.FirstWord, songname, BINDING_SONGNAME_LEN);
+            sum = reserved_sum(sum, rec, RESERVED_REC_SIZE);
+        }
+        if(sum != jrec.sum)
+        {
+            M3D_DebugPrint("_replayReserved bad record %d\n", count);
+            break;
+        }
 
-            //push_back
-            d_reservedSong.push_back(songinfo);
+        size = d_reservedSong.size();
+        switch(jrec.op)
+        {
+        case RESERVED_OP_ADD:
+            reserved_unpack(rec, &songinfo);
+            _pushReserved(songinfo, jrec.arg0 == 1);
+            break;
+        case RESERVED_OP_DEL:
+            if(jrec.arg0 >= 0 && jrec.arg0 < size)
+                _eraseReserved(jrec.arg0);
+            break;
+        case RESERVED_OP_MOVE:
+            if(jrec.arg0 >= 0 && jrec.arg0 < size && jrec.arg1 >= 0 && jrec.arg1 < size)
+                _moveReserved(jrec.arg0, jrec.arg1);
+            break;
+        case RESERVED_OP_CLEAR:
+            _clearReserved();
+            break;
         }
-        fclose(fp);
-        if(ret == 0)
-            M3D_fremove(path.c_str());
+        count++;
     }
+    return count;
 }
 
 //----------------------------------------------------------------------------//
-void ReqPhoneDB::_saveReservedID(bool flag)
+void ReqPhoneDB::_loadReservedID(void)
 {
     FILE *fp;
-    unsigned int uitemp;
-    int itemp;
-    char username[USE_NAME_LEN];
-    char userid[USE_ID_LEN];
-    char songName[BINDING_SONGNAME_LEN];
-
-#ifndef OUT_FILE_SET_SDA3
-    CPVRTString path = CPVRTResourceFile::GetReadPath();
-#else
     std::string path;
-    if(!_getSDA2Path(&path))
+    unsigned char rec[RESERVED_REC_SIZE];
+    ReservInfo_st songinfo;
+    ReservJnlHead_t head;
+    unsigned int snapSize = 0;
+    unsigned int snapSum = RESERVED_SUM_INIT;
+    int count = 0;
+
+    if(!_getReservedPath(&path, M3D_CONFIG_PROG_ID_FILE))
         return;
-    path += M3D_CONFIG_PATH;
-#endif
-    path += M3D_CONFIG_PROG_ID_FILE;
 
-    M3D_DebugPrint("_saveReservedID size %d \n", d_reservedSong.size());
-    fp = fopen(path.c_str(), "wb");
+    fp = fopen(path.c_str(), "rb");
     if(fp != NULL)
     {
-        for(int i=0; i < d_reservedSong.size(); i++)
+        while(fread(rec, 1, RESERVED_REC_SIZE, fp) == RESERVED_REC_SIZE)
         {
-            uitemp = d_reservedSong.at(i).SongIndex;
-            fwrite(&uitemp, 1, sizeof(unsigned int), fp);
-            memset(username, 0, USE_NAME_LEN);
-            strncpy(username, (char *)d_reservedSong.at(i).username.c_str(), USE_NAME_LEN);
-            fwrite(username, USE_NAME_LEN, sizeof(char), fp);
-            memset(userid, 0, USE_NAME_LEN);
-            strncpy(userid, (char *)d_reservedSong.at(i).userid.c_str(), USE_ID_LEN);
-            fwrite(userid, USE_ID_LEN, sizeof(char), fp);
-            uitemp = d_reservedSong.at(i).randomNum;
-            fwrite(&uitemp, 1, sizeof(unsigned int), fp);
-
-            itemp = d_reservedSong.at(i).FileType;
-            fwrite(&itemp, 1, sizeof(int), fp);
-            itemp = d_reservedSong.at(i).SubFileType;
-            fwrite(&itemp, 1, sizeof(int), fp);
-            itemp = d_reservedSong.at(i).OrderIndex;
-            fwrite(&itemp, 1, sizeof(int), fp);
-            memset(songName, 0, BINDING_SONGNAME_LEN);
-            strncpy(songName, d_reservedSong.at(i).SongName, BINDING_SONGNAME_LEN);
-            fwrite(songName, BINDING_SONGNAME_LEN, sizeof(char), fp);
-            memset(songName, 0, BINDING_SONGNAME_LEN);
-            strncpy(songName, d_reservedSong.at(i).FirstWord, BINDING_SONGNAME_LEN);
-            fwrite(songName, BINDING_SONGNAME_LEN, sizeof(char), fp);
+            snapSize += RESERVED_REC_SIZE;
+            snapSum = reserved_sum(snapSum, rec, RESERVED_REC_SIZE);
+            reserved_unpack(rec, &songinfo);
+            M3D_DebugPrint("progId = %d\n",songinfo.SongIndex);
+            _pushReserved(songinfo, false);
         }
         fclose(fp);
-#ifndef WIN32
-        system("sync");
+    }
+
+    if(_getReservedPath(&path, M3D_CONFIG_PROG_JNL_FILE) && (fp = fopen(path.c_str(), "rb")) != NULL)
+    {
+        if(fread(&head, 1, sizeof(head), fp) == sizeof(head) && head.magic == RESERVED_JNL_MAGIC
+            && head.snapSize == snapSize && head.snapSum == snapSum)
+            count = _replayReserved(fp);
+        fclose(fp);
+    }
+    M3D_DebugPrint("_loadReservedID %d songs, %d journal records\n", d_reservedSong.size(), count);
+
+    //fold the journal into a new snapshot, journal starts empty
+    _saveReservedID(false);
+}
+
+//----------------------------------------------------------------------------//
+//write a snapshot of d_reservedSong and start a new journal after it
+void ReqPhoneDB::_saveReservedID(bool flag)
+{
+    FILE *fp;
+    std::string path;
+    std::string tmpPath;
+    std::string jnlPath;
+    std::vector<unsigned char> snap(d_reservedSong.size() * RESERVED_REC_SIZE);
+    ReservJnlHead_t head;
+
+    if(!_getReservedPath(&path, M3D_CONFIG_PROG_ID_FILE) || !_getReservedPath(&jnlPath, M3D_CONFIG_PROG_JNL_FILE))
+        return;
+    tmpPath = path + ".tmp";
+
+    M3D_DebugPrint("_saveReservedID size %d \n", d_reservedSong.size());
+    for(size_t i = 0; i < d_reservedSong.size(); i++)
+        reserved_pack(d_reservedSong[i], &snap[i * RESERVED_REC_SIZE]);
+
+    //a crash before rename keeps the old snapshot and its journal
+    fp = fopen(tmpPath.c_str(), "wb");
+    if(fp == NULL)
+        return;
+    if(snap.size())
+        fwrite(&snap[0], 1, snap.size(), fp);
+    reserved_sync(fp);
+    fclose(fp);
+#ifdef WIN32
+    M3D_fremove(path.c_str());
 #endif
+    if(rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        M3D_DebugPrint("_saveReservedID rename fail\n");
+        return;
+    }
+    reserved_syncdir(path);
+
+    head.magic = RESERVED_JNL_MAGIC;
+    head.snapSize = snap.size();
+    head.snapSum = reserved_sum(RESERVED_SUM_INIT, snap.size() ? &snap[0] : NULL, snap.size());
+    if(d_resJournal != NULL)
+        fclose(d_resJournal);
+    d_resJournal = fopen(jnlPath.c_str(), "wb");
+    if(d_resJournal != NULL)
+    {
+        fwrite(&head, 1, sizeof(head), d_resJournal);
+        reserved_sync(d_resJournal);
     }
+    d_resJournalCount = 0;
+
     if(flag)
         d_BroadResFlag = true;
 }
@@ -1727,21 +2003,14 @@ bool ReqPhoneDB::_addReservedSong(unsigned int SongNo, int insertFlag, const std
 
     //M3D_DebugPrint("ReqPhoneDB::_addReservedSong SongNo = %d: insert[%d] ",SongNo, insertFlag);
 
-    if(d_reservedSong.size() > 0)
-    {
-        std::vector<ReservInfo_st>::iterator iReservedSong;
-        for (iReservedSong = d_reservedSong.begin(); iReservedSong != d_reservedSong.end(); ++iReservedSong)
-        {
 #ifndef CAN_RESERVED_SAME_SONG
-            if(iReservedSong->SongIndex == SongNo)
+    if(d_reservedKeys.find(reserved_key(SongNo, 0)) != d_reservedKeys.end())
 #else
-            if(iReservedSong->SongIndex == SongNo && iReservedSong->randomNum == randomnum)
+    if(d_reservedKeys.find(reserved_key(SongNo, randomnum)) != d_reservedKeys.end())
 #endif
-            {
-                M3D_DebugPrint("the same reserved song.\n");
-                return false;
-            }
-        }
+    {
+        M3D_DebugPrint("the same reserved song.\n");
+        return false;
     }
 
     temp.SongIndex = SongNo;
@@ -1796,17 +2065,9 @@ bool ReqPhoneDB::_addReservedSong(unsigned int SongNo, int insertFlag, const std
         }
     }
 
-    if(insertFlag == 1)
-    {
-        if (d_reservedSong.size())
-            d_reservedSong.insert(d_reservedSong.begin(), 1, temp);
-        else
-            d_reservedSong.push_back(temp);
-    }
-    else
-        d_reservedSong.push_back(temp);
+    _pushReserved(temp, insertFlag == 1);
     if(!isload)
-        _saveReservedID(); //save reserved id
+        _logReserved(RESERVED_OP_ADD, insertFlag == 1); //save reserved id
 
     //M3D_DebugPrint("reserved song success.\n");
     return true;
@@ -1824,21 +2085,14 @@ bool ReqPhoneDB::_addReservedSongEx(const SongListBindingStruct_t* songinfo, int
 
     //M3D_DebugPrint("ReqPhoneDB::_addReservedSongEx SongNo = %d: insert[%d] ",SongNo, insertFlag);
 
-    if(d_reservedSong.size() > 0)
-    {
-        std::vector<ReservInfo_st>::iterator iReservedSong;
-        for (iReservedSong = d_reservedSong.begin(); iReservedSong != d_reservedSong.end(); ++iReservedSong)
-        {
 #ifndef CAN_RESERVED_SAME_SONG
-            if(iReservedSong->SongIndex == SongNo)
+    if(d_reservedKeys.find(reserved_key(SongNo, 0)) != d_reservedKeys.end())
 #else
-            if(iReservedSong->SongIndex == SongNo && iReservedSong->randomNum == randomnum)
+    if(d_reservedKeys.find(reserved_key(SongNo, randomnum)) != d_reservedKeys.end())
 #endif
-            {
-                M3D_DebugPrint("the same reserved song.\n");
-                return false;
-            }
-        }
+    {
+        M3D_DebugPrint("the same reserved song.\n");
+        return false;
     }
 
     temp.SongIndex = songinfo->SongIndex;
@@ -1892,17 +2146,9 @@ bool ReqPhoneDB::_addReservedSongEx(const SongListBindingStruct_t* songinfo, int
         }
     }
 
-    if(insertFlag == 1)
-    {
-        if (d_reservedSong.size())
-            d_reservedSong.insert(d_reservedSong.begin(), 1, temp);
-        else
-            d_reservedSong.push_back(temp);
-    }
-    else
-        d_reservedSong.push_back(temp);
+    _pushReserved(temp, insertFlag == 1);
     if(!isload)
-        _saveReservedID(); //save reserved id
+        _logReserved(RESERVED_OP_ADD, insertFlag == 1); //save reserved id
 
     //M3D_DebugPrint("reserved song EX success.\n");
     return true;
@@ -2371,7 +2617,9 @@ bool ReqPhoneDB::ReqRecordSongGetInfo(int& songIndex,int& recIndex,int& deviceIn
 //----------------------------------------------------------------------------//
 bool ReqPhoneDB::ReqFavoSongLoad(void)
 {
+    pthread_mutex_lock(&d_extraLock);
     d_vFavoID.clear();
+    pthread_mutex_unlock(&d_extraLock);
 #ifndef OUT_FILE_SET_SDA3
     CPVRTString path = CPVRTResourceFile::GetReadPath();
 #else
@@ -2416,7 +2664,9 @@ bool ReqPhoneDB::ReqFavoSongLoad(void)
         M3D_fread(tmpFavo.SongName, name_size, fp);
         M3D_fread(tmpFavo.FirstWord, firstword_size, fp);
 
+        pthread_mutex_lock(&d_extraLock);
         d_vFavoID.push_back(tmpFavo);
+        pthread_mutex_unlock(&d_extraLock);
     }
 
     M3D_fclose(fp);
@@ -2485,7 +2735,9 @@ bool ReqPhoneDB::ReqFavoSongAdd(unsigned int SongNo)
     strncpy(temp.SongName, song.SongName, sizeof(temp.SongName));
     strncpy(temp.FirstWord, song.firstWord, sizeof(temp.FirstWord));
 
+    pthread_mutex_lock(&d_extraLock);
     d_vFavoID.push_back(temp);
+    pthread_mutex_unlock(&d_extraLock);
 
     //save favo
     ReqFavoSongSave();
@@ -2504,7 +2756,9 @@ bool ReqPhoneDB::ReqFavoSongDelete(unsigned int SongNo)
     if(iter == d_vFavoID.end())
         return false;
 
+    pthread_mutex_lock(&d_extraLock);
     d_vFavoID.erase(iter);
+    pthread_mutex_unlock(&d_extraLock);
     //save favo
     ReqFavoSongSave();
     return true;
@@ -2518,6 +2772,18 @@ int ReqPhoneDB::ReqFavoSongCount(void)
 
 //----------------------------------------------------------------------------//
 bool ReqPhoneDB::ReqIsFavoSong(unsigned int SongNo)
+{
+    bool ret;
+
+    pthread_mutex_lock(&d_extraLock);
+    ret = _isFavoSong(SongNo);
+    pthread_mutex_unlock(&d_extraLock);
+    return ret;
+}
+
+//----------------------------------------------------------------------------//
+//called with d_extraLock held
+bool ReqPhoneDB::_isFavoSong(unsigned int SongNo)
 {
     std::vector<Favo_t>::iterator iter = d_vFavoID.begin();
     for(; iter != d_vFavoID.end(); iter++)
@@ -2910,34 +3176,22 @@ bool ReqPhoneDB::ReqReservedSongTop(unsigned int SongNo,std::string username,std
 bool ReqPhoneDB::ReqReservedSongTopEx(unsigned int SongNo,unsigned int randomnum)
 #endif
 {
-    if(d_reservedSong.size() == 0)
+    int index = _findReserved(SongNo, randomnum);
+    if(index < 0)
         return false;
-    std::vector<ReservInfo_st>::iterator iReservedSong;
-    for (iReservedSong = d_reservedSong.begin(); iReservedSong != d_reservedSong.end(); ++iReservedSong)
-    {
-        if(iReservedSong->SongIndex == SongNo && iReservedSong->randomNum == randomnum)
-        {
-            ReservInfo_st ReservedSongTmp = *iReservedSong;
-            d_reservedSong.erase(iReservedSong);
-            d_reservedSong.insert(d_reservedSong.begin(),1,ReservedSongTmp);
-            _saveReservedID(); //save reserved id
-            M3D_DebugPrint("ReqPhoneDB::ReqReservedSongTop ok---[%d, %d]\n",SongNo,randomnum);
-            return true;
-        }
-    }
-    return false;
+    _moveReserved(index, 0);
+    _logReserved(RESERVED_OP_MOVE, index, 0); //save reserved id
+    M3D_DebugPrint("ReqPhoneDB::ReqReservedSongTop ok---[%d, %d]\n",SongNo,randomnum);
+    return true;
 }
 
 //----------------------------------------------------------------------------//
 bool ReqPhoneDB::ReqReservedSongTopByIndex(int index)
 {
-    if(d_reservedSong.size() <= index)
+    if(index < 0 || d_reservedSong.size() <= index)
         return false;
-    std::vector<ReservInfo_st>::iterator iReservedSong = d_reservedSong.begin() + index;
-    ReservInfo_st ReservedSongTmp = *iReservedSong;
-    d_reservedSong.erase(iReservedSong);
-    d_reservedSong.insert(d_reservedSong.begin(),1,ReservedSongTmp);
-    _saveReservedID(); //save reserved id
+    _moveReserved(index, 0);
+    _logReserved(RESERVED_OP_MOVE, index, 0); //save reserved id
     M3D_DebugPrint("ReqPhoneDB::ReqReservedSongTopByIndex ok---[%d]\n",index);
     return true;
 }
@@ -2951,19 +3205,13 @@ bool ReqPhoneDB::ReqReservedSongDelete(unsigned int SongNo,unsigned int randomnu
 {
     M3D_DebugPrint("ReqPhoneDB::ReqReservedSongDelete SongNo = %d\n",SongNo);
 
-    if(d_reservedSong.size() > 0)
-    {
-        std::vector<ReservInfo_st>::iterator iReservedSong;
-        for (iReservedSong = d_reservedSong.begin(); iReservedSong != d_reservedSong.end(); ++iReservedSong)
-            if(iReservedSong->SongIndex == SongNo && iReservedSong->randomNum == randomnum)
-            {
-                d_reservedSong.erase(iReservedSong);
-                _saveReservedID(); //save reserved id
-                M3D_DebugPrint("ReqPhoneDB::ReqReservedSongDelete tok\n");
-                return true;
-            }
-    }
-    return false;
+    int index = _findReserved(SongNo, randomnum);
+    if(index < 0)
+        return false;
+    _eraseReserved(index);
+    _logReserved(RESERVED_OP_DEL, index); //save reserved id
+    M3D_DebugPrint("ReqPhoneDB::ReqReservedSongDelete tok\n");
+    return true;
 }
 
 //----------------------------------------------------------------------------//
@@ -2973,9 +3221,8 @@ bool ReqPhoneDB::ReqReservedSongDeleteByIndex(unsigned int index)
 
     if(index < d_reservedSong.size())
     {
-        std::vector<ReservInfo_st>::iterator iReservedSong = d_reservedSong.begin() + index;
-        d_reservedSong.erase(iReservedSong);
-        _saveReservedID(); //save reserved id
+        _eraseReserved(index);
+        _logReserved(RESERVED_OP_DEL, index); //save reserved id
         return true;
     }
     return false;
@@ -2990,7 +3237,7 @@ bool ReqPhoneDB::ReqReservedSongGetFirst(int *songIndex)
 
     if(d_reservedSong.size() > 0)
     {
-        std::vector<ReservInfo_st>::iterator iReservedSong = d_reservedSong.begin() ;
+        ReservQueue_t::iterator iReservedSong = d_reservedSong.begin() ;
         *songIndex = iReservedSong->SongIndex;
         ret = true;
         d_cur_reservedSong.SongIndex = iReservedSong->SongIndex;
@@ -3015,7 +3262,7 @@ bool ReqPhoneDB::ReqReservedSongGetFirstEx(SongListBindingStruct_t* songResInfo)
 
     if(d_reservedSong.size() > 0)
     {
-        std::vector<ReservInfo_st>::iterator iReservedSong = d_reservedSong.begin() ;
+        ReservQueue_t::iterator iReservedSong = d_reservedSong.begin() ;
         songResInfo->SongIndex = iReservedSong->SongIndex;
         songResInfo->OrderIndex = iReservedSong->OrderIndex;
         songResInfo->FileType = iReservedSong->FileType;
@@ -3053,7 +3300,7 @@ bool ReqPhoneDB::ReqReservedSongGet(int *songIndex,int index,std::string *userna
     }
     else if(d_reservedSong.size() > 0)
     {
-        std::vector<ReservInfo_st>::iterator iReservedSong = d_reservedSong.begin() + index;
+        ReservQueue_t::iterator iReservedSong = d_reservedSong.begin() + index;
         *songIndex = iReservedSong->SongIndex;
         *username = iReservedSong->username;
         *userid = iReservedSong->userid;
@@ -3075,62 +3322,33 @@ int ReqPhoneDB::ReqReservedSongCount(void)
 //----------------------------------------------------------------------------//
 bool ReqPhoneDB::ReqReservedSongUp(const int songid, const int randomnum)
 {
-    ReservInfo_st tmpRes;
-    if(d_reservedSong.size() > 0)
-    {
-        std::vector<ReservInfo_st>::iterator iReservedSong;
-        std::vector<ReservInfo_st>::iterator iResTmp;
-        for (iReservedSong = d_reservedSong.begin(); iReservedSong != d_reservedSong.end(); ++iReservedSong)
-        {
-            if(iReservedSong->SongIndex == songid && iReservedSong->randomNum == randomnum)
-            {
-                if(iReservedSong == d_reservedSong.begin())
-                    return false;
-                iResTmp = iReservedSong - 1;
-                tmpRes = *iReservedSong;
-                d_reservedSong.erase(iReservedSong);
-                d_reservedSong.insert(iResTmp,1,tmpRes);
-                _saveReservedID(); //save reserved id
-                M3D_DebugPrint("ReqPhoneDB::ReqReservedSongUp tok\n");
-                return true;
-            }
-        }
-    }
-    return false;
+    int index = _findReserved(songid, randomnum);
+    if(index <= 0)
+        return false;
+    _moveReserved(index, index - 1);
+    _logReserved(RESERVED_OP_MOVE, index, index - 1); //save reserved id
+    M3D_DebugPrint("ReqPhoneDB::ReqReservedSongUp tok\n");
+    return true;
 }
 
 //----------------------------------------------------------------------------//
 bool ReqPhoneDB::ReqReservedSongDown(const int songid, const int randomnum)
 {
-    ReservInfo_st tmpRes;
-    if(d_reservedSong.size() > 0)
-    {
-        std::vector<ReservInfo_st>::iterator iReservedSong;
-        std::vector<ReservInfo_st>::iterator iResTmp;
-        for (iReservedSong = d_reservedSong.begin(); iReservedSong != d_reservedSong.end(); ++iReservedSong)
-        {
-            if(iReservedSong->SongIndex == songid && iReservedSong->randomNum == randomnum)
-            {
-                if(iReservedSong == d_reservedSong.end() - 1)
-                    return false;
-                iResTmp = iReservedSong + 1;
-                tmpRes = *iReservedSong;
-                d_reservedSong.erase(iReservedSong);
-                d_reservedSong.insert(iResTmp,1,tmpRes);
-                _saveReservedID(); //save reserved id
-                M3D_DebugPrint("ReqPhoneDB::ReqReservedSongUp tok\n");
-                return true;
-            }
-        }
-    }
-    return false;
+    int index = _findReserved(songid, randomnum);
+    if(index < 0 || index >= (int)d_reservedSong.size() - 1)
+        return false;
+    _moveReserved(index, index + 1);
+    _logReserved(RESERVED_OP_MOVE, index, index + 1); //save reserved id
+    M3D_DebugPrint("ReqPhoneDB::ReqReservedSongUp tok\n");
+    return true;
 }
 
 //----------------------------------------------------------------------------//
 bool ReqPhoneDB::ReqReservedSongDeleteAll(void)
 {
     M3D_DebugPrint("ReqPhoneDB::ReqReservedSongDeleteAll\n");
-    d_reservedSong.clear();
+    _clearReserved();
+    _logReserved(RESERVED_OP_CLEAR, 0);
     return true;
 }
 
@@ -3568,8 +3786,9 @@ int ReqPhoneDB::ReqReservedSongAddAll(void)
         //temp.username = "";
         //temp.userid = "";
         temp.randomNum = 0;
-        d_reservedSong.push_back(temp);
+        _pushReserved(temp, false);
     }
+    _saveReservedID();
 
     return true;
 }
@@ -3585,31 +3804,26 @@ void ReqPhoneDB::reqSongExtraInf(SongListBindingStruct_t& song,bool isreserved)
 
     sprintf(song.OrderChar, "%05d", song.OrderIndex);
 
+    pthread_mutex_lock(&d_extraLock);
 #if 0
     std::set<int>::iterator iFavoSong = d_FavoIDSet.find(SongNo);
     if(iFavoSong != d_FavoIDSet.end())
         song.Favo = 1;
 #else
-    if (ReqIsFavoSong(song.SongIndex))
+    if (_isFavoSong(song.SongIndex))
         song.Favo = 1;
 #endif
 
     if(isreserved == false)
     {
-        std::vector<ReservInfo_st>::iterator iReservedSong;
-        for (iReservedSong = d_reservedSong.begin(); iReservedSong != d_reservedSong.end(); ++iReservedSong)
-        {
-            if(iReservedSong->SongIndex == SongNo)
-            {
-                song.Resv = 1;
-                break;
-            }
-        }
+        if(d_reservedCount.find(SongNo) != d_reservedCount.end())
+            song.Resv = 1;
     }
     else
     {
         song.Resv = 1;
     }
+    pthread_mutex_unlock(&d_extraLock);
 
     //file type: 1.MP3 2.MTV 3.MOVIE 0.OTHER
     if (song.FileType == SONG_FILETYPE_MTV)
@@ -3685,7 +3899,7 @@ int ReqPhoneDB::reqReservedSong(int reqStart, int reqCount)
     int bcount = 0;
     int i;
     //SongListBindingStruct_t tmpsong;
-    std::vector<ReservInfo_st>::iterator iReservedSong;
+    ReservQueue_t::iterator iReservedSong;
 
     if (reqCount == -1)
     {
@@ -3696,7 +3910,7 @@ int ReqPhoneDB::reqReservedSong(int reqStart, int reqCount)
 #ifdef REQ_TEST
         for (i = 0; i < MAX_BINDREC_COUNT; i ++)
         {
-            bindingRec.items[i].song = SongListRecDummy;
+            recItems()[i].song = SongListRecDummy;
         }
 #endif
 
@@ -3724,7 +3938,7 @@ int ReqPhoneDB::reqReservedSong(int reqStart, int reqCount)
     {
         for (i = 0; i<reqCount; i++)
         {
-            bindingRec.items[i].song = SongListRecDummy;
+            recItems()[i].song = SongListRecDummy;
         }
         return 0;
     }
@@ -3745,16 +3959,16 @@ int ReqPhoneDB::reqReservedSong(int reqStart, int reqCount)
             {
                 break;
             }
-            bindingRec.items[ret].song.dataIndex = i;
-            bindingRec.items[ret].song.SongIndex = iReservedSong->SongIndex;
-            bindingRec.items[ret].song.OrderIndex = iReservedSong->OrderIndex;
-            bindingRec.items[ret].song.FileType = iReservedSong->FileType;
-            bindingRec.items[ret].song.MediaType = iReservedSong->SubFileType;
+            recItems()[ret].song.dataIndex = i;
+            recItems()[ret].song.SongIndex = iReservedSong->SongIndex;
+            recItems()[ret].song.OrderIndex = iReservedSong->OrderIndex;
+            recItems()[ret].song.FileType = iReservedSong->FileType;
+            recItems()[ret].song.MediaType = iReservedSong->SubFileType;
 
-            strncpy(bindingRec.items[ret].song.SongName,iReservedSong->SongName,BINDING_SONGNAME_LEN);
-            //M3D_DebugPrint("&&&&&&&nxl[%d,%s]",ret+handle.reqCmd.itemIndex,bindingRec.items[ret+handle.reqCmd.itemIndex].song.SongName);
+            strncpy(recItems()[ret].song.SongName,iReservedSong->SongName,BINDING_SONGNAME_LEN);
+            //M3D_DebugPrint("&&&&&&&nxl[%d,%s]",ret+handle.reqCmd.itemIndex,recItems()[ret+handle.reqCmd.itemIndex].song.SongName);
 
-            reqSongExtraInf(bindingRec.items[ret].song, true);
+            reqSongExtraInf(recItems()[ret].song, true);
 
             ret++;
         }
@@ -3763,7 +3977,7 @@ int ReqPhoneDB::reqReservedSong(int reqStart, int reqCount)
 
     for (i = ret; i<reqCount; i++)
     {
-        bindingRec.items[i].song = SongListRecDummy;
+        recItems()[i].song = SongListRecDummy;
     }
 
     if((ret + reqStart) > PROGSONG_MAX_NUM)
@@ -3790,20 +4004,20 @@ int ReqPhoneDB::reqMyHotSong(int reqStart, int reqCount)
         int i, j, ret2;
         for(i=reqStart, j=0; i<ret && j<reqCount; i++, j++)
         {
-            memset(&bindingRec.items[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.dataIndex = j;
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.SongIndex = d_vMyHot.at(i).SongIndex;
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.OrderIndex = d_vMyHot.at(i).OrderIndex;
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.FileType = d_vMyHot.at(i).FileType;
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.MediaType = d_vMyHot.at(i).SubFileType;
-            strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName, d_vMyHot.at(i).SongName, sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName)-1);
-
-            reqSongExtraInf(bindingRec.items[j+handle.reqCmd.itemIndex].song);
+            memset(&recItems()[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
+            recItems()[j+handle.reqCmd.itemIndex].song.dataIndex = j;
+            recItems()[j+handle.reqCmd.itemIndex].song.SongIndex = d_vMyHot.at(i).SongIndex;
+            recItems()[j+handle.reqCmd.itemIndex].song.OrderIndex = d_vMyHot.at(i).OrderIndex;
+            recItems()[j+handle.reqCmd.itemIndex].song.FileType = d_vMyHot.at(i).FileType;
+            recItems()[j+handle.reqCmd.itemIndex].song.MediaType = d_vMyHot.at(i).SubFileType;
+            strncpy(recItems()[j+handle.reqCmd.itemIndex].song.SongName, d_vMyHot.at(i).SongName, sizeof(recItems()[j+handle.reqCmd.itemIndex].song.SongName)-1);
+
+            reqSongExtraInf(recItems()[j+handle.reqCmd.itemIndex].song);
         }
         ret2 = j;
         for(; j<reqCount; j++)
         {
-            bindingRec.items[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
+            recItems()[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
         }
         return ret2;
     }
@@ -3848,15 +4062,15 @@ int ReqPhoneDB::reqFavorSong(int reqStart, int reqCount)
         {
             for(i=reqStart, j=0; i<ret && j<reqCount; i++, j++)
             {
-                memset(&bindingRec.items[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.dataIndex = j;
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.SongIndex = d_vFavoID.at(i).SongIndex;
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.OrderIndex = d_vFavoID.at(i).OrderIndex;
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.FileType = d_vFavoID.at(i).FileType;
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.MediaType = d_vFavoID.at(i).SubFileType;
-                strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName, d_vFavoID.at(i).SongName, sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName)-1);
-
-                reqSongExtraInf(bindingRec.items[j+handle.reqCmd.itemIndex].song);
+                memset(&recItems()[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
+                recItems()[j+handle.reqCmd.itemIndex].song.dataIndex = j;
+                recItems()[j+handle.reqCmd.itemIndex].song.SongIndex = d_vFavoID.at(i).SongIndex;
+                recItems()[j+handle.reqCmd.itemIndex].song.OrderIndex = d_vFavoID.at(i).OrderIndex;
+                recItems()[j+handle.reqCmd.itemIndex].song.FileType = d_vFavoID.at(i).FileType;
+                recItems()[j+handle.reqCmd.itemIndex].song.MediaType = d_vFavoID.at(i).SubFileType;
+                strncpy(recItems()[j+handle.reqCmd.itemIndex].song.SongName, d_vFavoID.at(i).SongName, sizeof(recItems()[j+handle.reqCmd.itemIndex].song.SongName)-1);
+
+                reqSongExtraInf(recItems()[j+handle.reqCmd.itemIndex].song);
             }
         }
         else
@@ -3864,21 +4078,21 @@ int ReqPhoneDB::reqFavorSong(int reqStart, int reqCount)
             ret = s_ShowFavo.size();
             for(i=reqStart, j=0; i<ret && j<reqCount; i++, j++)
             {
-                memset(&bindingRec.items[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.dataIndex = j;
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.SongIndex = s_ShowFavo.at(i).SongIndex;
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.OrderIndex = s_ShowFavo.at(i).OrderIndex;
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.FileType = s_ShowFavo.at(i).FileType;
-                bindingRec.items[j+handle.reqCmd.itemIndex].song.MediaType = s_ShowFavo.at(i).SubFileType;
-                strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName, s_ShowFavo.at(i).SongName, sizeof(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName)-1);
-
-                reqSongExtraInf(bindingRec.items[j+handle.reqCmd.itemIndex].song);
+                memset(&recItems()[j+handle.reqCmd.itemIndex], 0, sizeof(DBBindingStruct_t));
+                recItems()[j+handle.reqCmd.itemIndex].song.dataIndex = j;
+                recItems()[j+handle.reqCmd.itemIndex].song.SongIndex = s_ShowFavo.at(i).SongIndex;
+                recItems()[j+handle.reqCmd.itemIndex].song.OrderIndex = s_ShowFavo.at(i).OrderIndex;
+                recItems()[j+handle.reqCmd.itemIndex].song.FileType = s_ShowFavo.at(i).FileType;
+                recItems()[j+handle.reqCmd.itemIndex].song.MediaType = s_ShowFavo.at(i).SubFileType;
+                strncpy(recItems()[j+handle.reqCmd.itemIndex].song.SongName, s_ShowFavo.at(i).SongName, sizeof(recItems()[j+handle.reqCmd.itemIndex].song.SongName)-1);
+
+                reqSongExtraInf(recItems()[j+handle.reqCmd.itemIndex].song);
             }
         }
         ret2 = j;
         for(; j<reqCount; j++)
         {
-            bindingRec.items[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
+            recItems()[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
         }
         return ret2;
     }
@@ -3908,7 +4122,7 @@ int ReqPhoneDB::reqRecordSong(int reqStart, int reqCount)
 #ifdef REQ_TEST
         for (i = 0; i < MAX_BINDREC_COUNT; i ++)
         {
-            bindingRec.items[i].song = SongListRecDummy;
+            recItems()[i].song = SongListRecDummy;
         }
 #endif
         return recCount;
@@ -3921,7 +4135,7 @@ int ReqPhoneDB::reqRecordSong(int reqStart, int reqCount)
     {
         for (i = 0; i<reqCount; i++)
         {
-            bindingRec.items[i].song = SongListRecDummy;
+            recItems()[i].song = SongListRecDummy;
         }
         return 0;
     }
@@ -3938,29 +4152,29 @@ int ReqPhoneDB::reqRecordSong(int reqStart, int reqCount)
 #ifdef REQ_TEST
             //M3D_DebugPrint("dataIndex = %d, %d, %d", i, d_recordSong[reqStart+ret].SongIndex, d_recordSong[reqStart+ret].RecIndex);
 
-            bindingRec.items[ret+handle.reqCmd.itemIndex].song.dataIndex = i;
-            bindingRec.items[ret+handle.reqCmd.itemIndex].song.SongIndex = iRecordSong->SongIndex;
-            bindingRec.items[ret+handle.reqCmd.itemIndex].song.RecIdx = iRecordSong->RecIndex;
-            _reqSongInf(bindingRec.items[ret+handle.reqCmd.itemIndex].song);
-            //bindingRec.items[ret+handle.reqCmd.itemIndex].song.LocalDevice = iRecordSong->DeviceId;
+            recItems()[ret+handle.reqCmd.itemIndex].song.dataIndex = i;
+            recItems()[ret+handle.reqCmd.itemIndex].song.SongIndex = iRecordSong->SongIndex;
+            recItems()[ret+handle.reqCmd.itemIndex].song.RecIdx = iRecordSong->RecIndex;
+            _reqSongInf(recItems()[ret+handle.reqCmd.itemIndex].song);
+            //recItems()[ret+handle.reqCmd.itemIndex].song.LocalDevice = iRecordSong->DeviceId;
 #else
-            bindingRec.items[ret].song.SongIndex = iRecordSong->SongIndex;
-            bindingRec.items[ret].song.RecIdx = iRecordSong->RecIndex;
-            _reqSongInf(bindingRec.items[ret].song);
-            //bindingRec.items[ret].song.LocalDevice = iRecordSong->DeviceId;
+            recItems()[ret].song.SongIndex = iRecordSong->SongIndex;
+            recItems()[ret].song.RecIdx = iRecordSong->RecIndex;
+            _reqSongInf(recItems()[ret].song);
+            //recItems()[ret].song.LocalDevice = iRecordSong->DeviceId;
 #endif
 #else
             //M3D_DebugPrint("dataIndex = %d, %d, %d", i, d_recordSong[reqStart+ret].SongIndex, d_recordSong[reqStart+ret].RecIndex);
 
-            bindingRec.items[ret+handle.reqCmd.itemIndex].song.dataIndex = i;
-            bindingRec.items[ret+handle.reqCmd.itemIndex].song.SongIndex = iRecordSong->SongIndex;
-            bindingRec.items[ret+handle.reqCmd.itemIndex].song.RecIdx = iRecordSong->RecIndex;
+            recItems()[ret+handle.reqCmd.itemIndex].song.dataIndex = i;
+            recItems()[ret+handle.reqCmd.itemIndex].song.SongIndex = iRecordSong->SongIndex;
+            recItems()[ret+handle.reqCmd.itemIndex].song.RecIdx = iRecordSong->RecIndex;
 
-            bindingRec.items[ret+handle.reqCmd.itemIndex].song.OrderIndex = iRecordSong->OrderIndex;
-            bindingRec.items[ret+handle.reqCmd.itemIndex].song.FileType = iRecordSong->FileType;
-            bindingRec.items[ret+handle.reqCmd.itemIndex].song.MediaType = iRecordSong->SubFileType;
-            strncpy(bindingRec.items[ret+handle.reqCmd.itemIndex].song.SongName, iRecordSong->SongName, sizeof(bindingRec.items[ret+handle.reqCmd.itemIndex].song.SongName));
-            reqSongExtraInf(bindingRec.items[ret+handle.reqCmd.itemIndex].song);
+            recItems()[ret+handle.reqCmd.itemIndex].song.OrderIndex = iRecordSong->OrderIndex;
+            recItems()[ret+handle.reqCmd.itemIndex].song.FileType = iRecordSong->FileType;
+            recItems()[ret+handle.reqCmd.itemIndex].song.MediaType = iRecordSong->SubFileType;
+            strncpy(recItems()[ret+handle.reqCmd.itemIndex].song.SongName, iRecordSong->SongName, sizeof(recItems()[ret+handle.reqCmd.itemIndex].song.SongName));
+            reqSongExtraInf(recItems()[ret+handle.reqCmd.itemIndex].song);
 #endif
             ret++;
         }
@@ -3973,22 +4187,22 @@ int ReqPhoneDB::reqRecordSong(int reqStart, int reqCount)
     {
         for(i=reqStart; i < recCount && j < reqCount; i++,j++,ret++)
         {
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.dataIndex = i;
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.SongIndex = d_recordSong.at(i).SongIndex;
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.RecIdx = d_recordSong.at(i).RecIndex;
-
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.OrderIndex = d_recordSong.at(i).OrderIndex;
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.FileType = d_recordSong.at(i).FileType;
-            bindingRec.items[j+handle.reqCmd.itemIndex].song.MediaType = d_recordSong.at(i).SubFileType;
-            strncpy(bindingRec.items[j+handle.reqCmd.itemIndex].song.SongName, d_recordSong.at(i).SongName, sizeof(bindingRec.items[ret+handle.reqCmd.itemIndex].song.SongName));
-            reqSongExtraInf(bindingRec.items[j+handle.reqCmd.itemIndex].song);
+            recItems()[j+handle.reqCmd.itemIndex].song.dataIndex = i;
+            recItems()[j+handle.reqCmd.itemIndex].song.SongIndex = d_recordSong.at(i).SongIndex;
+            recItems()[j+handle.reqCmd.itemIndex].song.RecIdx = d_recordSong.at(i).RecIndex;
+
+            recItems()[j+handle.reqCmd.itemIndex].song.OrderIndex = d_recordSong.at(i).OrderIndex;
+            recItems()[j+handle.reqCmd.itemIndex].song.FileType = d_recordSong.at(i).FileType;
+            recItems()[j+handle.reqCmd.itemIndex].song.MediaType = d_recordSong.at(i).SubFileType;
+            strncpy(recItems()[j+handle.reqCmd.itemIndex].song.SongName, d_recordSong.at(i).SongName, sizeof(recItems()[ret+handle.reqCmd.itemIndex].song.SongName));
+            reqSongExtraInf(recItems()[j+handle.reqCmd.itemIndex].song);
         }
     }
 #endif
     pthread_mutex_unlock(d_RecThreadLock);
     for (; j<reqCount; j++)
     {
-        bindingRec.items[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
+        recItems()[j+handle.reqCmd.itemIndex].song = SongListRecDummy;
     }
 
     if((ret + reqStart) > RECORDSONG_MAX_NUM)
@@ -4022,15 +4236,15 @@ int ReqPhoneDB::reqSingerType(int reqStart, int reqCount)
                 M3D_DebugPrint("index < 0\n");
             }
             pstr = "";//ReadRes::getSingletonPtr()->GetString(STRING_ID_SINGER_TYPE + index);
-            memset(bindingRec.items[i].singer.SingerName,0,sizeof(bindingRec.items[i].singer.SingerName));
-            strncpy(bindingRec.items[i].singer.SingerName,pstr,sizeof(bindingRec.items[i].singer.SingerName) - 1);
-            bindingRec.items[i].singer.SingerType = reqStart + i;
-            bindingRec.items[i].singer.SongCount =  reqSingerCount(reqStart + i);
+            memset(recItems()[i].singer.SingerName,0,sizeof(recItems()[i].singer.SingerName));
+            strncpy(recItems()[i].singer.SingerName,pstr,sizeof(recItems()[i].singer.SingerName) - 1);
+            recItems()[i].singer.SingerType = reqStart + i;
+            recItems()[i].singer.SongCount =  reqSingerCount(reqStart + i);
             ret++;
         }
         else
         {
-            bindingRec.items[i].singer = SingerRecDummy;
+            recItems()[i].singer = SingerRecDummy;
         }
     }
     return ret;
@@ -4052,15 +4266,15 @@ int ReqPhoneDB::reqLanguage(int reqStart, int reqCount)
         if (reqStart+i < LANGUAGE_COUNT)
         {
             pstr = "";//ReadRes::getSingletonPtr()->GetString(STRING_ID_LANGUAGE + reqStart + i);
-            memset(bindingRec.items[i].singer.SingerName,0,sizeof(bindingRec.items[i].singer.SingerName));
-            strncpy(bindingRec.items[i].singer.SingerName,pstr,sizeof(bindingRec.items[i].singer.SingerName) - 1);
-            bindingRec.items[i].singer.SingerType = reqStart + i;
-            bindingRec.items[i].singer.SongCount =  reqLangugeSongCount(reqStart + i);
+            memset(recItems()[i].singer.SingerName,0,sizeof(recItems()[i].singer.SingerName));
+            strncpy(recItems()[i].singer.SingerName,pstr,sizeof(recItems()[i].singer.SingerName) - 1);
+            recItems()[i].singer.SingerType = reqStart + i;
+            recItems()[i].singer.SongCount =  reqLangugeSongCount(reqStart + i);
             ret++;
         }
         else
         {
-            bindingRec.items[i].singer = SingerRecDummy;
+            recItems()[i].singer = SingerRecDummy;
         }
     }
     return ret;
@@ -4128,7 +4342,7 @@ void ReqPhoneDB::updateReservedSongForUserName(const std::string& newusername, c
 {
     //do this in host render
     //do some thing to change username for reserved list
-    std::vector<ReservInfo_st>::iterator viReserved = d_reservedSong.begin();
+    ReservQueue_t::iterator viReserved = d_reservedSong.begin();
     for(; viReserved != d_reservedSong.end(); viReserved++)
     {
         if(viReserved->userid == userid)
@@ -4188,27 +4402,21 @@ bool ReqPhoneDB::reqNewHotsongList(int* hotcount, int* hotlist)
 bool ReqPhoneDB::reqSingerNameBySongId(int songid, std::string* singername)
 {
     //do this in another thread
-    char sql_cmd[256];
-    int ret = 0;
-    sqlite3_stmt *stmt;
-
-    if(checkSQLExist(REQDB_SQL_SINGER_BY_SONGID))
-        sprintf(sql_cmd, "%s%d",getSQLString(REQDB_SQL_SINGER_BY_SONGID),songid);
-    assert(strlen(sql_cmd) < 256);
+    sqlite3_stmt *stmt = reqStmtBegin(REQDB_SQL_SINGER_BY_SONGID);
 
-    ret = sqlite3_prepare_v2(d_db, sql_cmd, strlen(sql_cmd), &stmt, 0);
-    if(ret != SQLITE_OK)
+    if(stmt == NULL)
     {
         return false;
     }
     else
     {
+        sqlite3_bind_int(stmt, 1, songid);
         if(sqlite3_step(stmt) == SQLITE_ROW)
         {
             if(sqlite3_column_text(stmt, 0) != NULL)
                 *singername = (char*)sqlite3_column_text(stmt, 0);
         }
-        sqlite3_finalize(stmt);
+        reqStmtEnd(stmt);
     }
     return true;
 }
@@ -19,7 +19,10 @@
 #include "ReqDB.h"
 #include <set>
 #include <vector>
+#include <deque>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <pthread.h>
 //#include "netCooKaraLan.h"
 
@@ -112,6 +115,7 @@ public:
 		char SongName[BINDING_SONGNAME_LEN];
 		char FirstWord[BINDING_SONGNAME_LEN];
 	}ReservInfo_st;
+	typedef std::deque<ReservInfo_st> ReservQueue_t;
 
 	typedef struct
 	{
@@ -158,7 +162,10 @@ public:
 	std::map<int, int>					d_SIDMap;		//songid, deviceid
 	std::vector<RecordSongInfo_st>		d_recordSong; 
 	std::vector<Favo_t>					d_vFavoID;
-	std::vector<ReservInfo_st>					d_reservedSong; 
+	ReservQueue_t								d_reservedSong; 
+	std::unordered_set<unsigned long long>		d_reservedKeys;		//SongIndex<<32 | randomNum, same song check
+	std::unordered_map<unsigned int, int>		d_reservedCount;	//SongIndex -> count in d_reservedSong
+	pthread_mutex_t								d_extraLock;		//d_vFavoID/d_reservedCount writes, reqSongExtraInf() reads them on the prefetch worker
 	std::vector<FileInfo_st>					d_picFileList_nand; 
 	std::vector<FileInfo_st>					d_videoFileList_nand;
 #ifdef PLAY_MP3_BGV_BY_BGVMP3
@@ -322,6 +329,8 @@ private:
 	int d_playSongType;
 
 	unsigned int d_reservedTmp[PROGSONG_MAX_NUM+1];
+	FILE*		d_resJournal;		//reserved song changes since last ProgIdEx.bin
+	int			d_resJournalCount;
 	//device		add device
 	//db		update db to new version
 	//			set song localdevice
@@ -365,6 +374,16 @@ private:
 
 	void _loadReservedID(void);
 	void _saveReservedID(bool flag = true);
+	//reserved queue, keep d_reservedKeys/d_reservedCount in step and journal each change
+	bool _getReservedPath(std::string *path, const char *fileName);
+	bool _pushReserved(const ReservInfo_st& info, bool front);
+	void _eraseReserved(int index);
+	void _moveReserved(int from, int to);
+	void _clearReserved(void);
+	int _findReserved(unsigned int SongNo, unsigned int randomnum);
+	void _logReserved(unsigned int op, int arg0, int arg1 = 0);
+	int _replayReserved(FILE *fp);
+	bool _isFavoSong(unsigned int SongNo);
 	//filter folder
 	void _filterRecordSongToList(char *path, std::vector<RecordSongInfo_st>*list, int deviceId);
 	void _filterFileToList(char *path, std::vector<FileInfo_st>*list, int deviceId, DiscType_et deviceType, int fileType);
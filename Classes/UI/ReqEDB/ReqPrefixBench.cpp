@@ -0,0 +1,169 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : ReqPrefixBench.cpp
+//
+// Description: standalone check and benchmark for findBufferPrefixRange, not part
+//				of the app. builds a sorted FIRST WORD table like ReqListBuffer,
+//				compares the binary search with the original alpha index scan
+//				over all one and two letter prefixes and times both.
+//
+//	build:	g++ -O2 -DREQ_PREFIX_BENCH ReqPrefixBench.cpp -lsqlite3 -lpthread
+//	run:	./a.out [songs]		(default 200000)
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#ifdef REQ_PREFIX_BENCH
+
+#include "ReqListBuffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#define BENCH_REPEAT		20
+
+//----------------------------------------------------------------------------//
+static long long benchNowUs(void)
+{
+#ifdef WIN32
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return now.QuadPart * 1000000 / freq.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+static int alphaIndex(char c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c - 'A' + 1;
+	if (c >= 'a' && c <= 'z')
+		return c - 'a' + 1;
+	return 0;
+}
+
+//----------------------------------------------------------------------------//
+// ReqListBuffer before findBufferPrefixRange, the reference:
+// jump to the first letter by the alpha index and compare entry by entry
+static int scanPrefixRange(const RefStruct_2_t* firstWord, int firstWrdCount, const int* alphaIdxOffset, const char* para, int* pbegin)
+{
+	int paralen = strlen(para);
+	int begin = alphaIdxOffset[alphaIndex(para[0])];
+	int end;
+
+	if (begin >= firstWrdCount)
+		return 0;
+	while (sqlite3_strnicmp(firstWord[begin].alphaData, para, paralen) != 0) {
+		begin++;
+		if (begin >= firstWrdCount)
+			return 0;
+	}
+	end = begin;
+	while (end < firstWrdCount && sqlite3_strnicmp(firstWord[end].alphaData, para, paralen) == 0)
+		end++;
+	*pbegin = begin;
+	return firstWord[end-1].start + firstWord[end-1].count - firstWord[begin].start;
+}
+
+static bool lessNoCase(const std::string& a, const std::string& b)
+{
+	return sqlite3_stricmp(a.c_str(), b.c_str()) < 0;
+}
+
+//----------------------------------------------------------------------------//
+// pinyin first words of the songs, sorted COLLATE NOCASE and grouped like the buffer
+static void buildTable(int songs, std::vector<RefStruct_2_t>& table, int* alphaIdxOffset)
+{
+	std::vector<std::string> words(songs);
+
+	for (int i = 0; i < songs; i++) {
+		int len = 1 + rand() % 6;
+		for (int k = 0; k < len; k++) {
+			char c = 'a' + rand() % 26;
+			words[i].push_back((rand() % 8) ? c : c - 'a' + 'A');
+		}
+	}
+	std::sort(words.begin(), words.end(), lessNoCase);
+
+	for (int i = 0; i < songs; i++) {
+		if (table.empty() || sqlite3_stricmp(table.back().alphaData, words[i].c_str()) != 0) {
+			RefStruct_2_t ref;
+			memset(&ref, 0, sizeof(ref));
+			ref.start = i;
+			strncpy(ref.alphaData, words[i].c_str(), sizeof(ref.alphaData)-1);
+			table.push_back(ref);
+		}
+		table.back().count++;
+	}
+
+	// first entry of each letter, letters without songs point to the next one
+	for (int a = ALPHA_INDEX_COUNT-1, i = (int)table.size(); a >= 0; a--) {
+		while (i > 0 && alphaIndex(table[i-1].alphaData[0]) >= a)
+			i--;
+		alphaIdxOffset[a] = i;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int songs = (argc > 1)? atoi(argv[1]) : 200000;
+	std::vector<RefStruct_2_t> table;
+	int alphaIdxOffset[ALPHA_INDEX_COUNT];
+	char para[3];
+	int prefixes = 0, mismatch = 0;
+	long long scanUs = 0, findUs = 0, t0;
+
+	srand(1234);
+	buildTable(songs, table, alphaIdxOffset);
+
+	for (int a = 'a'; a <= 'z'; a++) {
+		for (int b = 'a'-1; b <= 'z'; b++) {
+			int scanBegin = 0, findBegin = 0, scanNum = 0, findNum = 0;
+
+			para[0] = (char)a;
+			para[1] = (b < 'a')? '\0' : (char)b;
+			para[2] = '\0';
+
+			t0 = benchNowUs();
+			for (int i = 0; i < BENCH_REPEAT; i++)
+				scanNum = scanPrefixRange(&table[0], (int)table.size(), alphaIdxOffset, para, &scanBegin);
+			scanUs += benchNowUs() - t0;
+
+			t0 = benchNowUs();
+			for (int i = 0; i < BENCH_REPEAT; i++)
+				findNum = findBufferPrefixRange(&table[0], (int)table.size(), para, &findBegin);
+			findUs += benchNowUs() - t0;
+
+			if (scanNum != findNum || (scanNum > 0 && scanBegin != findBegin)) {
+				printf("prefix [%s] differs: scan %d@%d find %d@%d\n", para, scanNum, scanBegin, findNum, findBegin);
+				mismatch++;
+			}
+			prefixes++;
+		}
+	}
+
+	printf("songs %d firstword %d prefixes %d\n", songs, (int)table.size(), prefixes);
+	printf("scan %10.2f us/query\n", (double)scanUs / (prefixes * BENCH_REPEAT));
+	printf("find %10.2f us/query\n", (double)findUs / (prefixes * BENCH_REPEAT));
+	return mismatch? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,251 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : ReqSearchBench.cpp
+//
+// Description: standalone benchmark for ReqSearchIndex, not part of the app.
+//				generates a song catalog in sqlite, builds the index and times
+//				substring / typo queries against it and against SQL LIKE.
+//
+//	build:	g++ -O2 -DREQ_SEARCH_BENCH -DM3D_DebugPrint=printf ReqSearchBench.cpp ReqSearchIndex.cpp -lsqlite3 -lpthread
+//	run:	./a.out [songs] [db file]		(default 200000, in memory)
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#ifdef REQ_SEARCH_BENCH
+
+#include "ReqSearchIndex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+using namespace CEGUI;
+
+#define BENCH_QUERY_COUNT	2000
+#define BENCH_LIKE_COUNT	20
+#define BENCH_MAX_HITS		100
+
+static const char* Syllable[] =
+{
+	"ai", "bao", "bei", "chang", "chun", "da", "deng", "fei", "feng", "gu",
+	"hai", "hong", "hua", "jia", "jin", "kai", "lan", "li", "liu", "long",
+	"mei", "ming", "nan", "qing", "ren", "shan", "tian", "wang", "xin", "yue",
+	"zhang", "zhou", "love", "night", "heart", "rain", "dream", "star", "fire", "sky"
+};
+#define SYLLABLE_COUNT	(int)(sizeof(Syllable)/sizeof(Syllable[0]))
+
+//----------------------------------------------------------------------------//
+static long long benchNowUs(void)
+{
+#ifdef WIN32
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return now.QuadPart * 1000000 / freq.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+//----------------------------------------------------------------------------//
+static void appendUtf8(std::string& s, unsigned int cp)
+{
+	s += (char)(0xE0 | (cp >> 12));
+	s += (char)(0x80 | ((cp >> 6) & 0x3F));
+	s += (char)(0x80 | (cp & 0x3F));
+}
+
+//----------------------------------------------------------------------------//
+// half of the names are 2~6 cjk characters, the others 2~4 latin words
+static void makeName(std::string& name, std::string& word)
+{
+	name.clear();
+	word.clear();
+	if (rand() & 1) {
+		int n = 2 + rand()%5;
+		for (int i = 0; i < n; i++) {
+			int s = rand()%SYLLABLE_COUNT;
+			appendUtf8(name, 0x4E00 + s*40 + rand()%40);
+			word += Syllable[s][0];
+		}
+	}
+	else {
+		int n = 2 + rand()%3;
+		for (int i = 0; i < n; i++) {
+			const char* s = Syllable[rand()%SYLLABLE_COUNT];
+			if (i)
+				name += ' ';
+			name += s;
+			word += s[0];
+		}
+	}
+}
+
+//----------------------------------------------------------------------------//
+static bool makeCatalog(sqlite3* db, int songs)
+{
+	sqlite3_stmt* stmt;
+	std::string name, word;
+	int singers = songs/10 + 1;
+
+	sqlite3_exec(db, "CREATE TABLE TableSong (SongIndex INTEGER PRIMARY KEY, SongName TEXT, FirstWord TEXT, PrivacyFlag INTEGER);", NULL, NULL, NULL);
+	sqlite3_exec(db, "CREATE TABLE TableSinger (SingerIndex INTEGER PRIMARY KEY, SingerName TEXT, FirstWord TEXT);", NULL, NULL, NULL);
+	sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+
+	if (sqlite3_prepare_v2(db, "INSERT INTO TableSong VALUES (?, ?, ?, 0);", -1, &stmt, NULL) != SQLITE_OK)
+		return false;
+	for (int i = 1; i <= songs; i++) {
+		makeName(name, word);
+		sqlite3_bind_int(stmt, 1, i);
+		sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(stmt, 3, word.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_step(stmt);
+		sqlite3_reset(stmt);
+	}
+	sqlite3_finalize(stmt);
+
+	if (sqlite3_prepare_v2(db, "INSERT INTO TableSinger VALUES (?, ?, ?);", -1, &stmt, NULL) != SQLITE_OK)
+		return false;
+	for (int i = 1; i <= singers; i++) {
+		makeName(name, word);
+		sqlite3_bind_int(stmt, 1, i);
+		sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(stmt, 3, word.c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_step(stmt);
+		sqlite3_reset(stmt);
+	}
+	sqlite3_finalize(stmt);
+
+	sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+	return true;
+}
+
+//----------------------------------------------------------------------------//
+// a substring of an existing name, optionally with one substituted letter
+static void makeQuery(sqlite3_stmt* pick, int songs, bool typo, std::string& query)
+{
+	const char* name;
+
+	query.clear();
+	while (query.empty()) {
+		sqlite3_bind_int(pick, 1, 1 + rand()%songs);
+		if (sqlite3_step(pick) == SQLITE_ROW && (name = (const char*)sqlite3_column_text(pick, 0)) != NULL) {
+			std::string s = name;
+			if (typo) {
+				// latin names only, at least 6 letters so a 1 edit filter is possible
+				if ((unsigned char)s[0] < 0x80 && s.size() >= 8) {
+					int start = rand()%(s.size()-7);
+					query = s.substr(start, 6 + rand()%(s.size()-start-5));
+					size_t pos = rand()%query.size();
+					if (query[pos] != ' ')
+						query[pos] = (query[pos] == 'z')? 'a' : query[pos]+1;
+				}
+			}
+			else if ((unsigned char)s[0] >= 0x80) {
+				int chars = s.size()/3;
+				int len = 1 + rand()%std::min(chars, 3);
+				query = s.substr((rand()%(chars-len+1))*3, len*3);
+			}
+			else {
+				int len = std::min((int)s.size(), 3 + rand()%6);
+				query = s.substr(rand()%(s.size()-len+1), len);
+			}
+		}
+		sqlite3_reset(pick);
+	}
+}
+
+//----------------------------------------------------------------------------//
+static void report(const char* title, std::vector<long long>& us, long long hits)
+{
+	long long total = 0;
+
+	std::sort(us.begin(), us.end());
+	for (size_t i = 0; i < us.size(); i++)
+		total += us[i];
+	printf("%-10s queries[%d] avg[%lldus] p50[%lldus] p99[%lldus] max[%lldus] hits/query[%.1f]\n",
+		title, (int)us.size(), total/(long long)us.size(), us[us.size()/2], us[us.size()*99/100], us.back(),
+		(double)hits/us.size());
+}
+
+//----------------------------------------------------------------------------//
+int main(int argc, char* argv[])
+{
+	int songs = (argc > 1)? atoi(argv[1]) : 200000;
+	const char* path = (argc > 2)? argv[2] : ":memory:";
+	ReqSearchIndex index;
+	SearchHit_t hits[BENCH_MAX_HITS];
+	sqlite3* db;
+	sqlite3_stmt* pick;
+	std::string query;
+	std::vector<long long> us;
+	long long t0, hitTotal;
+
+	srand(1234);
+	if (sqlite3_open(path, &db) != SQLITE_OK)
+		return 1;
+
+	t0 = benchNowUs();
+	if (!makeCatalog(db, songs))
+		return 1;
+	printf("catalog: %d songs in %lldms\n", songs, (benchNowUs()-t0)/1000);
+
+	t0 = benchNowUs();
+	if (!index.build(db))
+		return 1;
+	printf("build: %d docs in %lldms, %uK\n", index.getDocCount(), (benchNowUs()-t0)/1000, index.getMemSize()/1024);
+
+	sqlite3_prepare_v2(db, "SELECT SongName FROM TableSong WHERE SongIndex = ?;", -1, &pick, NULL);
+
+	for (int typo = 0; typo < 2; typo++) {
+		us.clear();
+		hitTotal = 0;
+		for (int i = 0; i < BENCH_QUERY_COUNT; i++) {
+			makeQuery(pick, songs, typo != 0, query);
+			t0 = benchNowUs();
+			hitTotal += index.search(query.c_str(), typo, hits, BENCH_MAX_HITS);
+			us.push_back(benchNowUs()-t0);
+		}
+		report(typo? "typo(k=1)" : "substring", us, hitTotal);
+	}
+
+	// the SQL fallback the index replaces
+	sqlite3_stmt* like;
+	sqlite3_prepare_v2(db, "SELECT SongIndex FROM TableSong WHERE SongName LIKE ? LIMIT 100;", -1, &like, NULL);
+	us.clear();
+	hitTotal = 0;
+	for (int i = 0; i < BENCH_LIKE_COUNT; i++) {
+		makeQuery(pick, songs, false, query);
+		query = "%" + query + "%";
+		t0 = benchNowUs();
+		sqlite3_bind_text(like, 1, query.c_str(), -1, SQLITE_TRANSIENT);
+		while (sqlite3_step(like) == SQLITE_ROW)
+			hitTotal++;
+		sqlite3_reset(like);
+		us.push_back(benchNowUs()-t0);
+	}
+	report("sql like", us, hitTotal);
+
+	sqlite3_finalize(like);
+	sqlite3_finalize(pick);
+	sqlite3_close(db);
+	return 0;
+}
+
+#endif
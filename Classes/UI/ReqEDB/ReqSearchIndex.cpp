@@ -0,0 +1,497 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : ReqSearchIndex.cpp
+//
+// Description: in-memory trigram index for song/singer full text search
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#include "ReqSearchIndex.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#ifndef M3D_DebugPrint
+#ifndef WIN32
+#include <android/log.h>
+#define M3D_DebugPrint(...) __android_log_print(ANDROID_LOG_INFO,"ReqSearchIndex",__VA_ARGS__)
+#else
+#define M3D_DebugPrint printf
+#endif
+#endif
+
+namespace CEGUI
+{
+
+//! code points are 21 bits, these never occur in a text
+#define GRAM_MARK_BIGRAM	0x1FFFFF
+#define GRAM_MARK_SINGLE	0x1FFFFE
+#define GRAM_MARK_START		0x1FFFFD
+
+static const char* SearchSqlStr[] =
+{
+	"SELECT SongIndex, SongName, FirstWord FROM TableSong WHERE PrivacyFlag = 0;",
+	"SELECT SingerIndex, SingerName, FirstWord FROM TableSinger;"
+};
+
+//----------------------------------------------------------------------------//
+static bool compareHitById(const SearchHit_t& a, const SearchHit_t& b)
+{
+	int groupA = (a.field >= SEARCH_FIELD_SINGERNAME);
+	int groupB = (b.field >= SEARCH_FIELD_SINGERNAME);
+
+	if (groupA != groupB)
+		return groupA < groupB;
+	if (a.id != b.id)
+		return a.id < b.id;
+	return a.score < b.score;
+}
+
+//----------------------------------------------------------------------------//
+static bool compareHitByScore(const SearchHit_t& a, const SearchHit_t& b)
+{
+	if (a.score != b.score)
+		return a.score < b.score;
+	if (a.field != b.field)
+		return a.field < b.field;
+	return a.id < b.id;
+}
+
+//----------------------------------------------------------------------------//
+static bool sameHitId(const SearchHit_t& a, const SearchHit_t& b)
+{
+	return a.id == b.id && (a.field >= SEARCH_FIELD_SINGERNAME) == (b.field >= SEARCH_FIELD_SINGERNAME);
+}
+
+//----------------------------------------------------------------------------//
+ReqSearchIndex::ReqSearchIndex(void)
+{
+	pthread_mutex_init(&d_lock, NULL);
+}
+
+//----------------------------------------------------------------------------//
+ReqSearchIndex::~ReqSearchIndex(void)
+{
+	pthread_mutex_destroy(&d_lock);
+}
+
+//----------------------------------------------------------------------------//
+void ReqSearchIndex::clear(void)
+{
+	pthread_mutex_lock(&d_lock);
+	std::vector<SearchDoc_t>().swap(d_docs);
+	std::vector<unsigned int>().swap(d_text);
+	std::vector<GramKey_t>().swap(d_keys);
+	std::vector<unsigned int>().swap(d_offsets);
+	std::vector<unsigned int>().swap(d_postings);
+	std::vector<unsigned short>().swap(d_counts);
+	pthread_mutex_unlock(&d_lock);
+}
+
+//----------------------------------------------------------------------------//
+unsigned int ReqSearchIndex::getMemSize(void) const
+{
+	return d_docs.capacity()*sizeof(SearchDoc_t)
+		+ d_text.capacity()*sizeof(unsigned int)
+		+ d_keys.capacity()*sizeof(GramKey_t)
+		+ d_offsets.capacity()*sizeof(unsigned int)
+		+ d_postings.capacity()*sizeof(unsigned int)
+		+ d_counts.capacity()*sizeof(unsigned short);
+}
+
+//----------------------------------------------------------------------------//
+// utf-8 -> folded code points: ascii lower case, full width ascii to ascii,
+// blanks and ascii punctuation dropped. bytes that are not utf-8 are kept as is.
+int ReqSearchIndex::foldText(const char* utf8, unsigned int* out, int size)
+{
+	const unsigned char* p = (const unsigned char*)utf8;
+	unsigned int cp;
+	int len = 0;
+
+	while (*p && len < size) {
+		if (p[0] < 0x80) {
+			cp = *p++;
+		}
+		else if ((p[0] & 0xE0) == 0xC0 && (p[1] & 0xC0) == 0x80) {
+			cp = ((p[0] & 0x1F) << 6) | (p[1] & 0x3F);
+			p += 2;
+		}
+		else if ((p[0] & 0xF0) == 0xE0 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80) {
+			cp = ((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+			p += 3;
+		}
+		else if ((p[0] & 0xF8) == 0xF0 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80 && (p[3] & 0xC0) == 0x80) {
+			cp = ((p[0] & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+			p += 4;
+		}
+		else {
+			cp = *p++;
+		}
+
+		if (cp >= 0xFF01 && cp <= 0xFF5E)
+			cp -= 0xFEE0;
+		if (cp < 0x80) {
+			if (cp >= 'A' && cp <= 'Z')
+				cp += 'a' - 'A';
+			else if (!((cp >= 'a' && cp <= 'z') || (cp >= '0' && cp <= '9')))
+				continue;
+		}
+		else if (cp == 0x3000) {
+			continue;
+		}
+		out[len++] = cp & 0x1FFFFF;
+	}
+	return len;
+}
+
+//----------------------------------------------------------------------------//
+// edit distance between q and the best matching substring of text (Sellers),
+// -1 if it is more than maxDist. column needs m+1 entries.
+int ReqSearchIndex::matchDist(const unsigned int* q, int m, const unsigned int* text, int n, int maxDist, int* column)
+{
+	int best = m;
+	int diag, left, v;
+
+	for (int i = 0; i <= m; i++)
+		column[i] = i;
+
+	for (int j = 0; j < n && best > 0; j++) {
+		diag = column[0];
+		column[0] = 0;
+		for (int i = 1; i <= m; i++) {
+			left = column[i];
+			v = diag + (q[i-1] != text[j]);
+			if (left+1 < v)
+				v = left+1;
+			if (column[i-1]+1 < v)
+				v = column[i-1]+1;
+			diag = left;
+			column[i] = v;
+		}
+		if (column[m] < best)
+			best = column[m];
+	}
+	return (best <= maxDist)? best : -1;
+}
+
+//----------------------------------------------------------------------------//
+// all index keys of a text, sorted and distinct
+void ReqSearchIndex::textGrams(const unsigned int* text, int len, std::vector<GramKey_t>& grams)
+{
+	grams.clear();
+	if (len <= 0)
+		return;
+
+	grams.push_back(gramKey(GRAM_MARK_START, text[0], GRAM_MARK_START));
+	for (int i = 0; i < len; i++) {
+		if (text[i] >= 0x80)
+			grams.push_back(gramKey(text[i], GRAM_MARK_SINGLE, GRAM_MARK_SINGLE));
+		if (i+2 <= len)
+			grams.push_back(gramKey(text[i], text[i+1], GRAM_MARK_BIGRAM));
+		if (i+3 <= len)
+			grams.push_back(gramKey(text[i], text[i+1], text[i+2]));
+	}
+	std::sort(grams.begin(), grams.end());
+	grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+//----------------------------------------------------------------------------//
+bool ReqSearchIndex::addTable(sqlite3* db, const char* sql, int nameField, int wordField)
+{
+	unsigned int folded[SEARCH_MAX_TEXT_LEN];
+	sqlite3_stmt* stmt;
+	SearchDoc_t doc;
+
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		M3D_DebugPrint("<ReqSearchIndex> prepare failed: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		doc.id = sqlite3_column_int(stmt, 0);
+		for (int col = 1; col <= 2; col++) {
+			const char* value = (const char*)sqlite3_column_text(stmt, col);
+			if (value == NULL)
+				continue;
+			int len = foldText(value, folded, SEARCH_MAX_TEXT_LEN);
+			if (len == 0)
+				continue;
+			doc.field = (col == 1)? nameField : wordField;
+			doc.len = len;
+			doc.offset = d_text.size();
+			d_text.insert(d_text.end(), folded, folded+len);
+			d_docs.push_back(doc);
+		}
+	}
+	sqlite3_finalize(stmt);
+	return true;
+}
+
+//----------------------------------------------------------------------------//
+bool ReqSearchIndex::getPosting(GramKey_t key, const unsigned int** begin, const unsigned int** end) const
+{
+	std::vector<GramKey_t>::const_iterator it = std::lower_bound(d_keys.begin(), d_keys.end(), key);
+
+	if (it == d_keys.end() || *it != key)
+		return false;
+	*begin = &d_postings[0] + d_offsets[it - d_keys.begin()];
+	*end = &d_postings[0] + d_offsets[it - d_keys.begin() + 1];
+	return true;
+}
+
+//----------------------------------------------------------------------------//
+bool ReqSearchIndex::build(sqlite3* db)
+{
+	ReqSearchIndex next;
+	std::vector<GramKey_t> grams;
+	size_t gramTotal = 0;
+
+	if (!next.addTable(db, SearchSqlStr[0], SEARCH_FIELD_SONGNAME, SEARCH_FIELD_SONGWORD))
+		return false;
+	if (!next.addTable(db, SearchSqlStr[1], SEARCH_FIELD_SINGERNAME, SEARCH_FIELD_SINGERWORD))
+		return false;
+
+	// distinct keys, merged every few thousand docs to bound the temporary memory
+	for (size_t d = 0; d < next.d_docs.size(); d++) {
+		textGrams(&next.d_text[next.d_docs[d].offset], next.d_docs[d].len, grams);
+		next.d_keys.insert(next.d_keys.end(), grams.begin(), grams.end());
+		if (next.d_keys.size() > gramTotal+(1<<20) || d+1 == next.d_docs.size()) {
+			std::sort(next.d_keys.begin(), next.d_keys.end());
+			next.d_keys.erase(std::unique(next.d_keys.begin(), next.d_keys.end()), next.d_keys.end());
+			gramTotal = next.d_keys.size();
+		}
+	}
+	std::vector<GramKey_t>(next.d_keys).swap(next.d_keys);
+
+	// posting lists, counted first then filled in doc order so every list is sorted
+	next.d_offsets.assign(next.d_keys.size()+1, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			for (size_t k = 1; k < next.d_offsets.size(); k++)
+				next.d_offsets[k] += next.d_offsets[k-1];
+			next.d_postings.resize(next.d_offsets.back());
+		}
+		for (size_t d = 0; d < next.d_docs.size(); d++) {
+			textGrams(&next.d_text[next.d_docs[d].offset], next.d_docs[d].len, grams);
+			for (size_t g = 0; g < grams.size(); g++) {
+				size_t k = std::lower_bound(next.d_keys.begin(), next.d_keys.end(), grams[g]) - next.d_keys.begin();
+				if (pass == 0)
+					next.d_offsets[k+1]++;
+				else
+					next.d_postings[next.d_offsets[k]++] = d;
+			}
+		}
+	}
+	// the fill pass moved every offset to the end of its list, shift back
+	for (size_t k = next.d_offsets.size()-1; k > 0; k--)
+		next.d_offsets[k] = next.d_offsets[k-1];
+	next.d_offsets[0] = 0;
+
+	pthread_mutex_lock(&d_lock);
+	d_docs.swap(next.d_docs);
+	d_text.swap(next.d_text);
+	d_keys.swap(next.d_keys);
+	d_offsets.swap(next.d_offsets);
+	d_postings.swap(next.d_postings);
+	d_counts.assign(d_docs.size(), 0);
+	pthread_mutex_unlock(&d_lock);
+
+	M3D_DebugPrint("<ReqSearchIndex> docs[%d] grams[%d] postings[%d] mem[%uK]\n",
+		(int)d_docs.size(), (int)d_keys.size(), (int)d_postings.size(), getMemSize()/1024);
+	return true;
+}
+
+//----------------------------------------------------------------------------//
+int ReqSearchIndex::search(const char* query, int maxDist, SearchHit_t* hits, int maxHits, unsigned int fields)
+{
+	unsigned int q[SEARCH_MAX_QUERY_LEN];
+	int column[SEARCH_MAX_QUERY_LEN+1];
+	std::vector<GramKey_t> grams;
+	std::vector<const unsigned int*> listBegin, listEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<SearchHit_t> result;
+	const unsigned int *begin, *end;
+	int m, k, threshold, count;
+
+	if (maxHits <= 0)
+		return 0;
+	m = foldText(query, q, SEARCH_MAX_QUERY_LEN);
+	if (m == 0)
+		return 0;
+
+	// q-gram lemma: a match within k edits keeps at least (grams - 3k) of the query trigrams
+	k = (maxDist < 0)? 0 : (maxDist > SEARCH_MAX_DIST)? SEARCH_MAX_DIST : maxDist;
+	if (k > 0 && m < 3*k+3)
+		k = (m >= 3)? (m-3)/3 : 0;
+	if (m == 1)
+		grams.push_back((q[0] >= 0x80)? gramKey(q[0], GRAM_MARK_SINGLE, GRAM_MARK_SINGLE) : gramKey(GRAM_MARK_START, q[0], GRAM_MARK_START));
+	else if (m == 2)
+		grams.push_back(gramKey(q[0], q[1], GRAM_MARK_BIGRAM));
+	for (int i = 0; i+3 <= m; i++)
+		grams.push_back(gramKey(q[i], q[i+1], q[i+2]));
+	std::sort(grams.begin(), grams.end());
+	grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+	threshold = std::max((int)grams.size() - 3*k, 1);
+
+	pthread_mutex_lock(&d_lock);
+
+	for (size_t g = 0; g < grams.size(); g++) {
+		if (getPosting(grams[g], &begin, &end)) {
+			listBegin.push_back(begin);
+			listEnd.push_back(end);
+		}
+		else if (k == 0) {
+			pthread_mutex_unlock(&d_lock);
+			return 0;
+		}
+		else {
+			listBegin.push_back(NULL);
+			listEnd.push_back(NULL);
+		}
+	}
+
+	if (k == 0) {
+		// intersect, starting from the shortest list
+		size_t shortest = 0;
+		for (size_t l = 1; l < listBegin.size(); l++) {
+			if (listEnd[l]-listBegin[l] < listEnd[shortest]-listBegin[shortest])
+				shortest = l;
+		}
+		for (const unsigned int* p = listBegin[shortest]; p < listEnd[shortest]; p++) {
+			if (fields & SEARCH_FIELD_BIT(d_docs[*p].field))
+				candidates.push_back(*p);
+		}
+		for (size_t l = 0; l < listBegin.size() && !candidates.empty(); l++) {
+			if (l == shortest)
+				continue;
+			size_t n = 0;
+			for (size_t c = 0; c < candidates.size(); c++) {
+				if (std::binary_search(listBegin[l], listEnd[l], candidates[c]))
+					candidates[n++] = candidates[c];
+			}
+			candidates.resize(n);
+		}
+	}
+	else {
+		// a doc with <threshold> of the query trigrams is in at least one of the
+		// (lists - threshold + 1) shortest lists: only those are scanned, the
+		// longer ones are probed for the docs found there
+		std::vector<unsigned int> touched;
+		std::vector<size_t> order(listBegin.size());
+		int scan = (int)listBegin.size() - threshold + 1;
+
+		for (size_t l = 0; l < order.size(); l++)
+			order[l] = l;
+		for (size_t a = 1; a < order.size(); a++) {
+			for (size_t b = a; b > 0 && listEnd[order[b]]-listBegin[order[b]] < listEnd[order[b-1]]-listBegin[order[b-1]]; b--)
+				std::swap(order[b], order[b-1]);
+		}
+		// common trigrams: past SEARCH_MAX_SCAN postings the overlap threshold
+		// is raised, one more shared trigram for each list left out of the scan
+		size_t scanned = 0;
+		for (int l = 0; l < scan; l++) {
+			scanned += listEnd[order[l]]-listBegin[order[l]];
+			if (scanned > SEARCH_MAX_SCAN && l > 0 && threshold < (int)order.size()) {
+				threshold += scan - l;
+				scan = l;
+				break;
+			}
+		}
+		for (int l = 0; l < scan; l++) {
+			for (const unsigned int* p = listBegin[order[l]]; p < listEnd[order[l]]; p++) {
+				if (d_counts[*p]++ == 0 && (fields & SEARCH_FIELD_BIT(d_docs[*p].field)))
+					touched.push_back(*p);
+			}
+		}
+		std::sort(touched.begin(), touched.end());
+		for (size_t l = scan; l < order.size(); l++) {
+			const unsigned int* p = listBegin[order[l]];
+			int left = (int)(order.size() - l);
+			size_t n = 0;
+			for (size_t t = 0; t < touched.size(); t++) {
+				unsigned int doc = touched[t];
+				p = std::lower_bound(p, listEnd[order[l]], doc);
+				if (p < listEnd[order[l]] && *p == doc)
+					d_counts[doc]++;
+				if (d_counts[doc] + left - 1 >= threshold)
+					touched[n++] = doc;
+			}
+			touched.resize(n);
+		}
+
+		// overlap threshold before verification: past SEARCH_MAX_VERIFY candidates
+		// only the ones sharing the most query trigrams are verified
+		std::vector<std::pair<int, unsigned int> > overlap;
+		for (size_t t = 0; t < touched.size(); t++) {
+			if (d_counts[touched[t]] >= threshold)
+				overlap.push_back(std::make_pair(-(int)d_counts[touched[t]], touched[t]));
+		}
+		if (overlap.size() > SEARCH_MAX_VERIFY) {
+			std::nth_element(overlap.begin(), overlap.begin()+SEARCH_MAX_VERIFY, overlap.end());
+			overlap.resize(SEARCH_MAX_VERIFY);
+		}
+		for (size_t c = 0; c < overlap.size(); c++)
+			candidates.push_back(overlap[c].second);
+
+		for (int l = 0; l < scan; l++) {
+			for (const unsigned int* p = listBegin[order[l]]; p < listEnd[order[l]]; p++)
+				d_counts[*p] = 0;
+		}
+	}
+
+	// verify and rank: distance, whole text, prefix, then shorter texts first
+	for (size_t c = 0; c < candidates.size(); c++) {
+		const SearchDoc_t& doc = d_docs[candidates[c]];
+		const unsigned int* text = &d_text[doc.offset];
+		int dist;
+		// up to 3 code points the single key is the whole query, an exact match
+		// needs no distance matrix
+		if (k > 0)
+			dist = matchDist(q, m, text, doc.len, k, column);
+		else if (m <= 3 || std::search(text, text+doc.len, q, q+m) != text+doc.len)
+			dist = 0;
+		else
+			continue;
+		if (dist < 0)
+			continue;
+
+		SearchHit_t hit;
+		hit.id = doc.id;
+		hit.field = doc.field;
+		hit.dist = dist;
+		hit.score = dist*10000;
+		if (doc.len >= m && memcmp(text, q, m*sizeof(unsigned int)) == 0)
+			hit.score += (doc.len == m)? 0 : 1000;
+		else
+			hit.score += 2000;
+		hit.score += std::min(abs(doc.len - m), 999);
+		result.push_back(hit);
+	}
+
+	pthread_mutex_unlock(&d_lock);
+
+	// one hit per song/singer, the best field wins. a song or singer has two fields,
+	// so the best 2*maxHits hits hold the best hit of at least maxHits of them
+	if ((int)result.size() > 2*maxHits) {
+		std::nth_element(result.begin(), result.begin()+2*maxHits, result.end(), compareHitByScore);
+		result.resize(2*maxHits);
+	}
+	std::sort(result.begin(), result.end(), compareHitById);
+	result.erase(std::unique(result.begin(), result.end(), sameHitId), result.end());
+
+	count = std::min((int)result.size(), maxHits);
+	std::partial_sort(result.begin(), result.begin()+count, result.end(), compareHitByScore);
+	if (count > 0)
+		memcpy(hits, &result[0], count*sizeof(SearchHit_t));
+	return count;
+}
+
+}
@@ -0,0 +1,132 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : ReqSearchIndex.h
+//
+// Description: in-memory trigram index for song/singer full text search
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#ifndef REQSEARCHINDEX_H
+#define REQSEARCHINDEX_H
+
+#include <sqlite3.h>
+#include <pthread.h>
+#include <vector>
+
+namespace CEGUI
+{
+
+#define SEARCH_MAX_TEXT_LEN		255			//! code points kept per indexed text
+#define SEARCH_MAX_QUERY_LEN	64			//! code points used from the query
+#define SEARCH_MAX_DIST			2			//! max edit distance accepted by search()
+#define SEARCH_MAX_VERIFY		2048		//! approximate candidates verified per search()
+#define SEARCH_MAX_SCAN			8192		//! approximate search postings scanned before probing
+
+/*!
+\brief
+	indexed fields
+*/
+enum {
+	SEARCH_FIELD_SONGNAME = 0,				//! TableSong.SongName
+	SEARCH_FIELD_SONGWORD,					//! TableSong.FirstWord, pinyin
+	SEARCH_FIELD_SINGERNAME,				//! TableSinger.SingerName
+	SEARCH_FIELD_SINGERWORD,				//! TableSinger.FirstWord, pinyin
+
+	SEARCH_FIELD_COUNT
+};
+
+#define SEARCH_FIELD_BIT(f)		(1u << (f))
+#define SEARCH_FIELD_SONG		(SEARCH_FIELD_BIT(SEARCH_FIELD_SONGNAME) | SEARCH_FIELD_BIT(SEARCH_FIELD_SONGWORD))
+#define SEARCH_FIELD_SINGER		(SEARCH_FIELD_BIT(SEARCH_FIELD_SINGERNAME) | SEARCH_FIELD_BIT(SEARCH_FIELD_SINGERWORD))
+#define SEARCH_FIELD_ALL		(SEARCH_FIELD_SONG | SEARCH_FIELD_SINGER)
+
+/*!
+\brief
+	search result, id is SongIndex for song fields and SingerIndex for singer fields
+*/
+typedef struct {
+	int id;
+	int field;
+	int dist;								//! edit distance of the best match
+	int score;								//! rank, lower is better
+
+} SearchHit_t;
+
+/*!
+\brief
+	trigram inverted index over song names, singer names and their pinyin.
+	texts are folded (ascii lower case, full width ascii, no blanks/punctuation)
+	and split into trigrams of unicode code points. bigrams, single non-ascii
+	characters and the first letter are indexed as well for 1~2 character queries,
+	a single ascii letter only matches at the start of the text.
+	search() returns ranked substring matches within <maxDist> edits:
+	candidates come from the trigram posting lists (q-gram lemma), only the
+	shortest lists are scanned and at most SEARCH_MAX_VERIFY candidates, the
+	ones sharing the most trigrams, are verified with an approximate substring match.
+	build() and search() may run on different threads.
+*/
+class ReqSearchIndex
+{
+public:
+	ReqSearchIndex(void);
+	~ReqSearchIndex(void);
+
+	/*!
+	\brief
+		build the index from TableSong/TableSinger, replaces the old one
+	*/
+	bool build(sqlite3* db);
+	void clear(void);
+
+	/*!
+	\brief
+		query ----- utf-8 text, song name, singer name or pinyin
+		maxDist --- allowed edits, lowered for short queries (a trigram filter
+					needs at least 3*maxDist+3 code points)
+		hits ------ result buffer, sorted by score
+		fields ---- SEARCH_FIELD_BIT() mask of the fields searched
+		return ---- number of hits
+	*/
+	int search(const char* query, int maxDist, SearchHit_t* hits, int maxHits, unsigned int fields = SEARCH_FIELD_ALL);
+
+	int getDocCount(void) const {return (int)d_docs.size();}
+	unsigned int getMemSize(void) const;
+
+private:
+	typedef struct {
+		int id;
+		unsigned short field;
+		unsigned short len;
+		unsigned int offset;				//! into d_text
+	} SearchDoc_t;
+
+	typedef unsigned long long GramKey_t;
+
+	static int foldText(const char* utf8, unsigned int* out, int size);
+	static GramKey_t gramKey(unsigned int a, unsigned int b, unsigned int c) {return ((GramKey_t)a<<42)|((GramKey_t)b<<21)|c;}
+	static void textGrams(const unsigned int* text, int len, std::vector<GramKey_t>& grams);
+	static int matchDist(const unsigned int* q, int m, const unsigned int* text, int n, int maxDist, int* column);
+
+	bool addTable(sqlite3* db, const char* sql, int nameField, int wordField);
+	bool getPosting(GramKey_t key, const unsigned int** begin, const unsigned int** end) const;
+
+	std::vector<SearchDoc_t> d_docs;
+	std::vector<unsigned int> d_text;		//! folded texts, code points
+	std::vector<GramKey_t> d_keys;			//! sorted distinct trigrams
+	std::vector<unsigned int> d_offsets;	//! d_keys[i] -> d_postings[d_offsets[i], d_offsets[i+1])
+	std::vector<unsigned int> d_postings;	//! doc numbers, ascending per trigram
+
+	std::vector<unsigned short> d_counts;	//! per doc trigram hits, scratch for search()
+	pthread_mutex_t d_lock;
+};
+
+}
+
+#endif
@@ -488,6 +488,10 @@ void appKRK::onFirstInit()
 
     M3D_DebugPrint("db_pathFile = %s\n",db_pathFile);
     ReqPhoneDB* reqDb = new ReqPhoneDB(db_pathFile,0);
+    reqDb->reqPrefetchStart(REQDB_PREFETCH_RADIUS);
+
+    //scan the song folders now, not on the first song played
+    appConfig_buildSongPathIndex();
 
     MKPlayer* player = (MKPlayer*)MKPlayer::getSingletonPtr();
     if(player != NULL)	//17.5.5/houhs: 为player设置回调函数
@@ -528,6 +532,15 @@ void appKRK::onRenderUI(float timeElapsed)
     RenderIn[3]++;
     if(MKPlayer::getSingletonPtr())
         MKPlayer::getSingletonPtr()->updateSelf((int)timeElapsed);
+    if(MKRecEncoder::getSingletonPtr())
+    {
+        // encoders wait while a song plays, they would steal its cpu
+        bool live = MKPlayer::getSingletonPtr() && MKPlayer::getSingletonPtr()->getPlayState() == MKPlayer::m_statePlaying;
+        MKRecEncoder::getSingletonPtr()->setLivePlayback(live ? 1 : 0);
+        MKRecEncoder::getSingletonPtr()->updateSelf((int)timeElapsed);
+    }
+    if(MKSystem::getSingletonPtr())
+        MKSystem::getSingletonPtr()->updateSelf((int)timeElapsed);
     RenderOut[3]++;
 	//String playState = MKPlayer::getSingletonPtr()->getPlayState();
 	//M3D_DebugPrint("----------play status = %s\n----------",(char *)playState.c_str());
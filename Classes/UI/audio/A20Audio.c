@@ -133,11 +133,12 @@ typedef struct tagA20_AUDIO_IN_INFO
 {
 	AUDIO_HANDLE		Handle;
 	int					Valid;
+	volatile int		Users;			// in Read/Wait/GetStat, they do not take Mutex
 	pthread_mutex_t		Mutex;
 	FuncAudioCallBack	CallBack;
 	void				*User;
 	int					Size;
-	int					Read;
+	AUDIO_RING			*Ring;			// a whole number of Size in the callback mode
 }A20_AUDIO_IN_INFO;
 
 typedef struct tagA20_AUDIO_SINK_INFO
@@ -149,8 +150,8 @@ typedef struct tagA20_AUDIO_SINK_INFO
 	int					Size;
 	unsigned char		Buf[A20_AUDIO_OUT_BUF_SIZE];
 	unsigned char		TempBuf[A20_AUDIO_OPENSLES_PLAYER_BUF_SIZE];
-	int					Read;
-	int					Write;
+	int					Read;			// callback mode
+	AUDIO_RING			Ring;			// write mode, over Buf
 }A20_AUDIO_OUT_INFO;
 
 typedef struct tagA20_AUDIO_INFO
@@ -185,9 +186,7 @@ typedef struct tagA20_AUDIO_INFO
 	A20_AUDIO_IN_INFO				AudioInInfo[A20_AUDIO_MAX_HANDLE];
 	A20_AUDIO_OUT_INFO				AudioOutInfo[A20_AUDIO_MAX_HANDLE];
 
-	unsigned char					AudioInBuf[A20_AUDIO_IN_BUF_SIZE];
 	unsigned char					AudioInTempBuf[A20_AUDIO_IN_TEMP_BUF_SIZE];
-	unsigned long					AudioInBufWrite;
 
 	unsigned long					Seed;
 }A20_AUDIO_INFO;
@@ -236,49 +235,32 @@ static int ChaosAudio_Finish (A20_AUDIO_INFO *pAudioInfo)
 	return -1;
 }
 
-static void A20AudioIn_Proc (A20_AUDIO_INFO *pAudioInfo)
+// the handle mutex only guards open and close, the device thread never waits
+// on it and skips a handle that is being opened or closed
+static void A20AudioIn_Proc (A20_AUDIO_INFO *pAudioInfo, int Size)
 {
 	A20_AUDIO_IN_INFO *pAudioInInfo;
 	int i;
-	int Delta;
+	void *Addr;
 
 	for (i = 0; i < A20_AUDIO_MAX_HANDLE; i++)
 	{
 		pAudioInInfo = pAudioInfo->AudioInInfo + i;
-		pthread_mutex_lock (&pAudioInInfo->Mutex);
+		if (pthread_mutex_trylock (&pAudioInInfo->Mutex) != 0)
+		{
+			continue;
+		}
 		if (pAudioInInfo->Valid == 1)
 		{
+			// a reader that falls behind loses the newest block
+			AudioRing_WriteBlock (pAudioInInfo->Ring, pAudioInfo->AudioInTempBuf, Size);
+
 			if (pAudioInInfo->CallBack != NULL)
 			{
-				if (pAudioInInfo->Read > pAudioInfo->AudioInBufWrite)
+				while (AudioRing_ReadRegion (pAudioInInfo->Ring, &Addr) >= (unsigned long)pAudioInInfo->Size)
 				{
-					Delta = pAudioInfo->AudioInBufWrite + A20_AUDIO_IN_BUF_SIZE - pAudioInInfo->Read;
-				}
-				else
-				{
-					Delta = pAudioInfo->AudioInBufWrite - pAudioInInfo->Read;
-				}
-				if (Delta >= pAudioInInfo->Size)
-				{
-					if (pAudioInInfo->Read + pAudioInInfo->Size > A20_AUDIO_IN_BUF_SIZE)
-					{
-						memcpy (pAudioInfo->AudioInTempBuf, pAudioInfo->AudioInBuf + pAudioInInfo->Read, A20_AUDIO_IN_BUF_SIZE - pAudioInInfo->Read);
-						memcpy (pAudioInfo->AudioInTempBuf + (A20_AUDIO_IN_BUF_SIZE - pAudioInInfo->Read), pAudioInfo->AudioInBuf, pAudioInInfo->Size - (A20_AUDIO_IN_BUF_SIZE - pAudioInInfo->Read));
-						pAudioInInfo->Read = pAudioInInfo->Read + pAudioInInfo->Size - A20_AUDIO_IN_BUF_SIZE;
-					}
-					else
-					{
-						memcpy (pAudioInfo->AudioInTempBuf, pAudioInfo->AudioInBuf + pAudioInInfo->Read, pAudioInInfo->Size);
-						if (pAudioInInfo->Read + pAudioInInfo->Size == A20_AUDIO_IN_BUF_SIZE)
-						{
-							pAudioInInfo->Read = 0;
-						}
-						else
-						{
-							pAudioInInfo->Read += pAudioInInfo->Size;
-						}
-					}
-					pAudioInInfo->CallBack (pAudioInInfo->User, pAudioInfo->AudioInTempBuf);
+					pAudioInInfo->CallBack (pAudioInInfo->User, Addr);
+					AudioRing_ReadCommit (pAudioInInfo->Ring, pAudioInInfo->Size);
 				}
 			}
 		}
@@ -307,27 +289,11 @@ static void OpenSLES_Src_Callback (SLAndroidSimpleBufferQueueItf bq, void *conte
 	}
 
 	WriteSize = read (pAudioInfo->Handle, pAudioInfo->AudioInTempBuf, A20_AUDIO_IN_TEMP_BUF_SIZE);
-	if (pAudioInfo->AudioInBufWrite + WriteSize > A20_AUDIO_IN_BUF_SIZE)
+	if (WriteSize > 0)
 	{
-		memcpy (pAudioInfo->AudioInBuf + pAudioInfo->AudioInBufWrite, pAudioInfo->AudioInTempBuf, A20_AUDIO_IN_BUF_SIZE - pAudioInfo->AudioInBufWrite);
-		memcpy (pAudioInfo->AudioInBuf, pAudioInfo->AudioInTempBuf + (A20_AUDIO_IN_BUF_SIZE - pAudioInfo->AudioInBufWrite), WriteSize - (A20_AUDIO_IN_BUF_SIZE - pAudioInfo->AudioInBufWrite));
-		pAudioInfo->AudioInBufWrite = pAudioInfo->AudioInBufWrite + WriteSize - A20_AUDIO_IN_BUF_SIZE;
-	}
-	else
-	{
-		memcpy (pAudioInfo->AudioInBuf + pAudioInfo->AudioInBufWrite, pAudioInfo->AudioInTempBuf, WriteSize);
-		if (pAudioInfo->AudioInBufWrite + WriteSize == A20_AUDIO_IN_BUF_SIZE)
-		{
-			pAudioInfo->AudioInBufWrite = 0;
-		}
-		else
-		{
-			pAudioInfo->AudioInBufWrite += WriteSize;
-		}
+		A20AudioIn_Proc (pAudioInfo, WriteSize);
 	}
 
-	A20AudioIn_Proc (pAudioInfo);
-
 	result = (*pAudioInfo->recorderBufferQueue)->Enqueue (pAudioInfo->recorderBufferQueue, pAudioInfo->recorderBuffer,
 		A20_AUDIO_OPENSLES_RECORDER_BUF_SIZE);
 	if (SL_RESULT_SUCCESS != result)
@@ -446,6 +412,8 @@ static int A20AudioIn_Init (A20_AUDIO_INFO *pAudioInfo)
 	for (i = 0; i < A20_AUDIO_MAX_HANDLE; i++)
 	{
 		pAudioInfo->AudioInInfo[i].Valid = 0;
+		pAudioInfo->AudioInInfo[i].Users = 0;
+		pAudioInfo->AudioInInfo[i].Ring = NULL;
 		pthread_mutex_init (&pAudioInfo->AudioInInfo[i].Mutex, NULL);
 	}
 
@@ -483,6 +451,7 @@ static int A20AudioIn_Finish (A20_AUDIO_INFO *pAudioInfo)
 
 	for (i = 0; i < A20_AUDIO_MAX_HANDLE; i++)
 	{
+		AudioRing_Destroy (pAudioInfo->AudioInInfo[i].Ring);
 		pthread_mutex_destroy (&pAudioInfo->AudioInInfo[i].Mutex);
 	}
 
@@ -495,43 +464,44 @@ static void A20AudioOut_Proc (A20_AUDIO_INFO *pAudioInfo)
 	int i, j;
 	int StreamCount;
 	signed short *StreamList[A20_AUDIO_MAX_HANDLE];
+	A20_AUDIO_OUT_INFO *LockList[A20_AUDIO_MAX_HANDLE];
+	AUDIO_RING *RingList[A20_AUDIO_MAX_HANDLE];
+	int LockCount;
+	int RingCount;
 	signed short *DestBuf;
-	int Write;
+	void *Addr;
 	int Delta;
 	int SizeLeft;
 	int SampleCount;
 	signed long Val;
 
+	// the write mode streams are mixed in place in their rings, the handles stay
+	// locked until the chunks are consumed. the mutex only guards open and close,
+	// a handle that is being opened or closed is skipped for a period
 	StreamCount = 0;
+	LockCount = 0;
+	RingCount = 0;
 	for (i = 0; i < A20_AUDIO_MAX_HANDLE; i++)
 	{
 		pAudioOutInfo = pAudioInfo->AudioOutInfo + i;
-		pthread_mutex_lock (&pAudioOutInfo->Mutex);
+		if (pthread_mutex_trylock (&pAudioOutInfo->Mutex) != 0)
+		{
+			continue;
+		}
+		LockList[LockCount++] = pAudioOutInfo;
 		if (pAudioOutInfo->Valid == 1)
 		{
 			if (pAudioOutInfo->CallBack == NULL)
 			{
-				Write = pAudioOutInfo->Write;
-				if (Write < pAudioOutInfo->Read)
+				// Buf is a whole number of chunks, a full chunk never wraps
+				if (AudioRing_ReadRegion (&pAudioOutInfo->Ring, &Addr) >= A20_AUDIO_OPENSLES_PLAYER_BUF_SIZE)
 				{
-					Delta = Write + A20_AUDIO_OUT_BUF_SIZE - pAudioOutInfo->Read;
+					StreamList[StreamCount++] = (signed short *)Addr;
+					RingList[RingCount++] = &pAudioOutInfo->Ring;
 				}
 				else
 				{
-					Delta = Write - pAudioOutInfo->Read;
-				}
-				if (Delta >= A20_AUDIO_OPENSLES_PLAYER_BUF_SIZE)
-				{
-					memcpy (pAudioOutInfo->TempBuf, pAudioOutInfo->Buf + pAudioOutInfo->Read, A20_AUDIO_OPENSLES_PLAYER_BUF_SIZE);
-					if (pAudioOutInfo->Read + A20_AUDIO_OPENSLES_PLAYER_BUF_SIZE == A20_AUDIO_OUT_BUF_SIZE)
-					{
-						pAudioOutInfo->Read = 0;
-					}
-					else
-					{
-						pAudioOutInfo->Read += A20_AUDIO_OPENSLES_PLAYER_BUF_SIZE;
-					}
-					StreamList[StreamCount++] = (signed short *)pAudioOutInfo->TempBuf;
+					AudioRing_NoteUnderrun (&pAudioOutInfo->Ring, A20_AUDIO_OPENSLES_PLAYER_BUF_SIZE);
 				}
 			}
 			else
@@ -564,7 +534,6 @@ static void A20AudioOut_Proc (A20_AUDIO_INFO *pAudioInfo)
 				StreamList[StreamCount++] = (signed short *)pAudioOutInfo->TempBuf;
 			}
 		}
-		pthread_mutex_unlock (&pAudioOutInfo->Mutex);
 	}
 
 	if (StreamCount == 0)
@@ -600,6 +569,15 @@ static void A20AudioOut_Proc (A20_AUDIO_INFO *pAudioInfo)
 		}
 	}
 
+	for (i = 0; i < RingCount; i++)
+	{
+		AudioRing_ReadCommit (RingList[i], A20_AUDIO_OPENSLES_PLAYER_BUF_SIZE);
+	}
+	for (i = 0; i < LockCount; i++)
+	{
+		pthread_mutex_unlock (&LockList[i]->Mutex);
+	}
+
 	return;
 }
 
@@ -1008,7 +986,26 @@ AUDIO_IN_HANDLE A20AudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 			pAudioInInfo->CallBack = Param->CallBack;
 			pAudioInInfo->User = Param->User;
 			pAudioInInfo->Size = Param->FrameCount * Param->Channels * 2;
-			pAudioInInfo->Read = pAudioInfo->AudioInBufWrite;
+			if (Param->CallBack != NULL && pAudioInInfo->Size > 0)
+			{
+				// the callback gets every block in place
+				pAudioInInfo->Ring = AudioRing_Create (A20_AUDIO_IN_BUF_SIZE / pAudioInInfo->Size * pAudioInInfo->Size);
+			}
+			else
+			{
+				pAudioInInfo->Ring = AudioRing_Create (A20_AUDIO_IN_BUF_SIZE);
+			}
+			if (pAudioInInfo->Ring != NULL && Param->CallBack == NULL && AudioRing_EnableWait (pAudioInInfo->Ring, Param->SampleRate * Param->Channels * 2) == -1)
+			{
+				AudioRing_Destroy (pAudioInInfo->Ring);
+				pAudioInInfo->Ring = NULL;
+			}
+			if (pAudioInInfo->Ring == NULL)
+			{
+				pthread_mutex_unlock (&pAudioInInfo->Mutex);
+				i = A20_AUDIO_MAX_HANDLE;
+				break;
+			}
 			pAudioInInfo->Valid = 1;
 			pthread_mutex_unlock (&pAudioInInfo->Mutex);
 			break;
@@ -1030,6 +1027,36 @@ AUDIO_IN_HANDLE A20AudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 	return (AUDIO_IN_HANDLE)pAudioInInfo;
 }
 
+// the readers do not take the handle mutex. a reader counts itself in before it
+// checks Valid, close clears Valid, wakes a waiting reader and waits for the
+// count to drop before the ring goes
+static AUDIO_RING* A20AudioIn_Enter (A20_AUDIO_IN_INFO *pAudioInInfo)
+{
+	__sync_fetch_and_add (&pAudioInInfo->Users, 1);
+	if (pAudioInInfo->Valid == 1)
+	{
+		return pAudioInInfo->Ring;
+	}
+	__sync_fetch_and_sub (&pAudioInInfo->Users, 1);
+	return NULL;
+}
+
+static void A20AudioIn_Leave (A20_AUDIO_IN_INFO *pAudioInInfo)
+{
+	__sync_fetch_and_sub (&pAudioInInfo->Users, 1);
+}
+
+// with Mutex held and Valid cleared
+static void A20AudioIn_Drain (A20_AUDIO_IN_INFO *pAudioInInfo)
+{
+	__sync_synchronize ();
+	AudioRing_Close (pAudioInInfo->Ring);
+	while (pAudioInInfo->Users > 0)
+	{
+		usleep (1000);
+	}
+}
+
 long A20AudioIn_Close (AUDIO_IN_HANDLE Handle)
 {
 	A20_AUDIO_IN_INFO *pAudioInInfo = (A20_AUDIO_IN_INFO *)Handle;
@@ -1039,6 +1066,9 @@ long A20AudioIn_Close (AUDIO_IN_HANDLE Handle)
 	if (pAudioInInfo->Valid == 1)
 	{
 		pAudioInInfo->Valid = 0;
+		A20AudioIn_Drain (pAudioInInfo);
+		AudioRing_Destroy (pAudioInInfo->Ring);
+		pAudioInInfo->Ring = NULL;
 		pthread_mutex_unlock (&pAudioInInfo->Mutex);
 		log_for_pro("exit A20AudioIn_Close success");
 		return 0;
@@ -1054,49 +1084,50 @@ long A20AudioIn_Close (AUDIO_IN_HANDLE Handle)
 long A20AudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size)
 {
 	A20_AUDIO_IN_INFO *pAudioInInfo = (A20_AUDIO_IN_INFO *)Handle;
-	A20_AUDIO_INFO *pAudioInfo;
-	int Write, Delta;
+	AUDIO_RING *pRing = A20AudioIn_Enter (pAudioInInfo);
+	long Ret = -1;
 
-	pAudioInfo = (A20_AUDIO_INFO *)pAudioInInfo->Handle;
-	if (pAudioInInfo->Valid == 1)
+	if (pRing != NULL)
 	{
-		Write = pAudioInfo->AudioInBufWrite;
-		if (pAudioInInfo->Read > Write)
-		{
-			Delta = Write + A20_AUDIO_IN_BUF_SIZE - pAudioInInfo->Read;
-		}
-		else
-		{
-			Delta = Write - pAudioInInfo->Read;
-		}
-		if (Delta > Size)
-		{
-			Delta = Size;
-		}
-		if (pAudioInInfo->Read + Delta > A20_AUDIO_IN_BUF_SIZE)
-		{
-			memcpy (BufAddr, pAudioInfo->AudioInBuf + pAudioInInfo->Read, A20_AUDIO_IN_BUF_SIZE - pAudioInInfo->Read);
-			memcpy ((unsigned char *)BufAddr + (A20_AUDIO_IN_BUF_SIZE - pAudioInInfo->Read), pAudioInfo->AudioInBuf, Delta - (A20_AUDIO_IN_BUF_SIZE - pAudioInInfo->Read));
-			pAudioInInfo->Read = pAudioInInfo->Read + Delta - A20_AUDIO_IN_BUF_SIZE;
-		}
-		else
+		Ret = AudioRing_Read (pRing, BufAddr, Size);
+		A20AudioIn_Leave (pAudioInInfo);
+	}
+
+	return Ret;
+}
+
+// the OpenSL ES recorder callback commits each block and wakes the reader
+long A20AudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat)
+{
+	A20_AUDIO_IN_INFO *pAudioInInfo = (A20_AUDIO_IN_INFO *)Handle;
+	AUDIO_RING *pRing = A20AudioIn_Enter (pAudioInInfo);
+	long Ret = -1;
+
+	if (pRing != NULL)
+	{
+		if (pAudioInInfo->CallBack == NULL)
 		{
-			memcpy (BufAddr, pAudioInfo->AudioInBuf + pAudioInInfo->Read, Delta);
-			if (pAudioInInfo->Read + Delta == A20_AUDIO_IN_BUF_SIZE)
-			{
-				pAudioInInfo->Read = 0;
-			}
-			else
-			{
-				pAudioInInfo->Read += Delta;
-			}
+			Ret = AudioRing_ReadWait (pRing, BufAddr, Size, Timeout, pStat);
 		}
-		return Delta;
+		A20AudioIn_Leave (pAudioInInfo);
 	}
-	else
+
+	return Ret;
+}
+
+long A20AudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	A20_AUDIO_IN_INFO *pAudioInInfo = (A20_AUDIO_IN_INFO *)Handle;
+	AUDIO_RING *pRing = A20AudioIn_Enter (pAudioInInfo);
+
+	if (pRing == NULL)
 	{
 		return -1;
 	}
+	AudioRing_GetStat (pRing, pStat);
+	A20AudioIn_Leave (pAudioInInfo);
+
+	return 0;
 }
 
 AUDIO_OUT_HANDLE A20AudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
@@ -1125,7 +1156,7 @@ AUDIO_OUT_HANDLE A20AudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 				Param->FrameCount = A20_AUDIO_OUT_BUF_SIZE / Param->Channels / 2;
 			}
 			pAudioOutInfo->Read = pAudioOutInfo->Size;
-			pAudioOutInfo->Write = 0;
+			AudioRing_Init (&pAudioOutInfo->Ring, pAudioOutInfo->Buf, A20_AUDIO_OUT_BUF_SIZE);
 			pAudioOutInfo->Valid = 1;
 			pthread_mutex_unlock (&pAudioOutInfo->Mutex);
 			break;
@@ -1171,42 +1202,25 @@ long A20AudioOut_Close (AUDIO_OUT_HANDLE Handle)
 long A20AudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size)
 {
 	A20_AUDIO_OUT_INFO *pAudioOutInfo = (A20_AUDIO_OUT_INFO *)Handle;
-	int Free, Read;
 
 	if (pAudioOutInfo->Valid == 1)
 	{
-		Read = pAudioOutInfo->Read;
-		if (Read > pAudioOutInfo->Write)
-		{
-			Free = Read - pAudioOutInfo->Write;
-		}
-		else
-		{
-			Free = A20_AUDIO_OUT_BUF_SIZE - (pAudioOutInfo->Write - Read);
-		}
-		if (Free > Size)
-		{
-			Free = Size;
-		}
-		if (pAudioOutInfo->Write + Free > A20_AUDIO_OUT_BUF_SIZE)
-		{
-			memcpy (pAudioOutInfo->Buf + pAudioOutInfo->Write, BufAddr, A20_AUDIO_OUT_BUF_SIZE - pAudioOutInfo->Write);
-			memcpy (pAudioOutInfo->Buf, (unsigned char *)BufAddr + (A20_AUDIO_OUT_BUF_SIZE - pAudioOutInfo->Write), Free - (A20_AUDIO_OUT_BUF_SIZE - pAudioOutInfo->Write));
-			pAudioOutInfo->Write = pAudioOutInfo->Write + Free - A20_AUDIO_OUT_BUF_SIZE;
-		}
-		else
-		{
-			memcpy (pAudioOutInfo->Buf + pAudioOutInfo->Write, BufAddr, Free);
-			if (pAudioOutInfo->Write + Free == A20_AUDIO_OUT_BUF_SIZE)
-			{
-				pAudioOutInfo->Write = 0;
-			}
-			else
-			{
-				pAudioOutInfo->Write += Free;
-			}
-		}
-		return Free;
+		return AudioRing_Write (&pAudioOutInfo->Ring, BufAddr, Size);
+	}
+	else
+	{
+		return -1;
+	}
+}
+
+long A20AudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	A20_AUDIO_OUT_INFO *pAudioOutInfo = (A20_AUDIO_OUT_INFO *)Handle;
+
+	if (pAudioOutInfo->Valid == 1 && pAudioOutInfo->CallBack == NULL)
+	{
+		AudioRing_GetStat (&pAudioOutInfo->Ring, pStat);
+		return 0;
 	}
 	else
 	{
@@ -1282,7 +1296,6 @@ AUDIO_HANDLE A20Audio_Init (int samplerate)
 	}
 
 	pAudioInfo->Handle = -1;
-	pAudioInfo->AudioInBufWrite = 0;
 
 #ifdef SUPPORT_EXT_MIDI
 	Ret = A20AudioUart_Init (pAudioInfo);
@@ -2,6 +2,7 @@
 #define _A20_AUDIO_H_
 
 #include "CP_Audio.h"
+#include "AudioRing.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -78,10 +79,13 @@ long A20Audio_Get (AUDIO_HANDLE Handle, int Cmd, int *Data);
 AUDIO_IN_HANDLE A20AudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 long A20AudioIn_Close (AUDIO_IN_HANDLE Handle);
 long A20AudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size);
+long A20AudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat);
+long A20AudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat);
 
 AUDIO_OUT_HANDLE A20AudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 long A20AudioOut_Close (AUDIO_OUT_HANDLE Handle);
 long A20AudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size);
+long A20AudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat);
 
 AUDIO_HANDLE A20Audio_Init (int samplerate);
 long A20Audio_Finish (AUDIO_HANDLE Handle);
@@ -120,11 +120,12 @@ typedef struct tagAW_JAVA_AUDIO_IN_INFO
 {
 	AUDIO_HANDLE		Handle;
 	int					Valid;
+	volatile int		Users;			// in Read/Wait/GetStat, they do not take Mutex
 	pthread_mutex_t		Mutex;
 	FuncAudioCallBack	CallBack;
 	void				*User;
 	int					Size;
-	int					Read;
+	AUDIO_RING			*Ring;			// a whole number of Size in the callback mode
 }AW_JAVA_AUDIO_IN_INFO;
 
 typedef struct tagAW_JAVA_AUDIO_SINK_INFO
@@ -137,8 +138,8 @@ typedef struct tagAW_JAVA_AUDIO_SINK_INFO
 	int					Size;
 	unsigned char		Buf[AW_JAVA_AUDIO_OUT_BUF_SIZE];
 	unsigned char		TempBuf[AW_JAVA_AUDIO_OUT_TEMP_BUF_SIZE];
-	int					Read;
-	int					Write;
+	int					Read;			// callback mode
+	AUDIO_RING			Ring;			// write mode, over Buf
 }AW_JAVA_AUDIO_OUT_INFO;
 
 typedef struct tagAW_JAVA_AUDIO_INFO
@@ -160,9 +161,7 @@ typedef struct tagAW_JAVA_AUDIO_INFO
 
 	unsigned char					InTempBuf[AW_JAVA_AUDIO_IN_TEMP_BUF_SIZE];
 	unsigned long					InTempBufSize;
-	unsigned char					InBuf[AW_JAVA_AUDIO_IN_BUF_SIZE];
 	unsigned long					InBufSize;
-	unsigned long					InBufWrite;
 
 	unsigned long					OutChannels;
 	unsigned long					OutSampleRate;
@@ -245,49 +244,32 @@ static int ChaosAudio_Finish (AW_JAVA_AUDIO_INFO *pAudioInfo)
 	return -1;
 }
 
-static void AWJavaAudioIn_Proc (AW_JAVA_AUDIO_INFO *pAudioInfo)
+// the handle mutex only guards open and close, the device thread never waits
+// on it and skips a handle that is being opened or closed
+static void AWJavaAudioIn_Proc (AW_JAVA_AUDIO_INFO *pAudioInfo, int Size)
 {
 	AW_JAVA_AUDIO_IN_INFO *pAudioInInfo;
 	int i;
-	int Delta;
+	void *Addr;
 
 	for (i = 0; i < AW_JAVA_AUDIO_MAX_HANDLE; i++)
 	{
 		pAudioInInfo = pAudioInfo->AudioInInfo + i;
-		pthread_mutex_lock (&pAudioInInfo->Mutex);
+		if (pthread_mutex_trylock (&pAudioInInfo->Mutex) != 0)
+		{
+			continue;
+		}
 		if (pAudioInInfo->Valid == 1)
 		{
+			// a reader that falls behind loses the newest block
+			AudioRing_WriteBlock (pAudioInInfo->Ring, pAudioInfo->InTempBuf, Size);
+
 			if (pAudioInInfo->CallBack != NULL)
 			{
-				if (pAudioInInfo->Read > pAudioInfo->InBufWrite)
+				while (AudioRing_ReadRegion (pAudioInInfo->Ring, &Addr) >= (unsigned long)pAudioInInfo->Size)
 				{
-					Delta = pAudioInfo->InBufWrite + pAudioInfo->InBufSize - pAudioInInfo->Read;
-				}
-				else
-				{
-					Delta = pAudioInfo->InBufWrite - pAudioInInfo->Read;
-				}
-				if (Delta >= pAudioInInfo->Size)
-				{
-					if (pAudioInInfo->Read + pAudioInInfo->Size > pAudioInfo->InBufSize)
-					{
-						memcpy (pAudioInfo->InTempBuf, pAudioInfo->InBuf + pAudioInInfo->Read, pAudioInfo->InBufSize - pAudioInInfo->Read);
-						memcpy (pAudioInfo->InTempBuf + (pAudioInfo->InBufSize - pAudioInInfo->Read), pAudioInfo->InBuf, pAudioInInfo->Size - (pAudioInfo->InBufSize - pAudioInInfo->Read));
-						pAudioInInfo->Read = pAudioInInfo->Read + pAudioInInfo->Size - pAudioInfo->InBufSize;
-					}
-					else
-					{
-						memcpy (pAudioInfo->InTempBuf, pAudioInfo->InBuf + pAudioInInfo->Read, pAudioInInfo->Size);
-						if (pAudioInInfo->Read + pAudioInInfo->Size == pAudioInfo->InBufSize)
-						{
-							pAudioInInfo->Read = 0;
-						}
-						else
-						{
-							pAudioInInfo->Read += pAudioInInfo->Size;
-						}
-					}
-					pAudioInInfo->CallBack (pAudioInInfo->User, pAudioInfo->InTempBuf);
+					pAudioInInfo->CallBack (pAudioInInfo->User, Addr);
+					AudioRing_ReadCommit (pAudioInInfo->Ring, pAudioInInfo->Size);
 				}
 			}
 		}
@@ -332,27 +314,11 @@ static void *AWJavaAudio_Src_Thread (void *Data)
 		Ret = read (pAudioInfo->Handle, pAudioInfo->InTempBuf, pAudioInfo->InTempBufSize * 2);
 #endif
 
-		if (pAudioInfo->InBufWrite + Ret > pAudioInfo->InBufSize)
-		{
-			memcpy (pAudioInfo->InBuf + pAudioInfo->InBufWrite, pAudioInfo->InTempBuf, pAudioInfo->InBufSize - pAudioInfo->InBufWrite);
-			memcpy (pAudioInfo->InBuf, pAudioInfo->InTempBuf + (pAudioInfo->InBufSize - pAudioInfo->InBufWrite), Ret - (pAudioInfo->InBufSize - pAudioInfo->InBufWrite));
-			pAudioInfo->InBufWrite = pAudioInfo->InBufWrite + Ret - pAudioInfo->InBufSize;
-		}
-		else
+		if (Ret > 0)
 		{
-			memcpy (pAudioInfo->InBuf + pAudioInfo->InBufWrite, pAudioInfo->InTempBuf, Ret);
-			if (pAudioInfo->InBufWrite + Ret == pAudioInfo->InBufSize)
-			{
-				pAudioInfo->InBufWrite = 0;
-			}
-			else
-			{
-				pAudioInfo->InBufWrite += Ret;
-			}
+			AWJavaAudioIn_Proc (pAudioInfo, Ret);
 		}
 
-		AWJavaAudioIn_Proc (pAudioInfo);
-
 		if (Ret != pAudioInfo->InTempBufSize)
 		{
 			usleep (AW_JAVA_AUDIO_SLEEP_TIME);
@@ -409,26 +375,7 @@ static void *AWJavaAudio_Src_Thread (void *Data)
 			read (pAudioInfo->Handle, pAudioInfo->InTempBuf, Ret);
 #endif
 
-			if (pAudioInfo->InBufWrite + Ret > pAudioInfo->InBufSize)
-			{
-				memcpy (pAudioInfo->InBuf + pAudioInfo->InBufWrite, pAudioInfo->InTempBuf, pAudioInfo->InBufSize - pAudioInfo->InBufWrite);
-				memcpy (pAudioInfo->InBuf, pAudioInfo->InTempBuf + (pAudioInfo->InBufSize - pAudioInfo->InBufWrite), Ret - (pAudioInfo->InBufSize - pAudioInfo->InBufWrite));
-				pAudioInfo->InBufWrite = pAudioInfo->InBufWrite + Ret - pAudioInfo->InBufSize;
-			}
-			else
-			{
-				memcpy (pAudioInfo->InBuf + pAudioInfo->InBufWrite, pAudioInfo->InTempBuf, Ret);
-				if (pAudioInfo->InBufWrite + Ret == pAudioInfo->InBufSize)
-				{
-					pAudioInfo->InBufWrite = 0;
-				}
-				else
-				{
-					pAudioInfo->InBufWrite += Ret;
-				}
-			}
-
-			AWJavaAudioIn_Proc (pAudioInfo);
+			AWJavaAudioIn_Proc (pAudioInfo, Ret);
 		}
 
 		if (Ret != pAudioInfo->InTempBufSize)
@@ -464,6 +411,8 @@ static int AWJavaAudioIn_Init (AW_JAVA_AUDIO_INFO *pAudioInfo)
 	for (i = 0; i < AW_JAVA_AUDIO_MAX_HANDLE; i++)
 	{
 		pAudioInfo->AudioInInfo[i].Valid = 0;
+		pAudioInfo->AudioInInfo[i].Users = 0;
+		pAudioInfo->AudioInInfo[i].Ring = NULL;
 		pthread_mutex_init (&pAudioInfo->AudioInInfo[i].Mutex, NULL);
 	}
 
@@ -501,6 +450,7 @@ static int AWJavaAudioIn_Finish (AW_JAVA_AUDIO_INFO *pAudioInfo)
 
 	for (i = 0; i < AW_JAVA_AUDIO_MAX_HANDLE; i++)
 	{
+		AudioRing_Destroy (pAudioInfo->AudioInInfo[i].Ring);
 		pthread_mutex_destroy (&pAudioInfo->AudioInInfo[i].Mutex);
 	}
 
@@ -513,43 +463,44 @@ static void AWJavaAudioOut_Proc (AW_JAVA_AUDIO_INFO *pAudioInfo)
 	int i, j;
 	int StreamCount;
 	signed short *StreamList[AW_JAVA_AUDIO_MAX_HANDLE];
+	AW_JAVA_AUDIO_OUT_INFO *LockList[AW_JAVA_AUDIO_MAX_HANDLE];
+	AUDIO_RING *RingList[AW_JAVA_AUDIO_MAX_HANDLE];
+	int LockCount;
+	int RingCount;
 	signed short *DestBuf;
-	int Write;
+	void *Addr;
 	int Delta;
 	int SizeLeft;
 	int SampleCount;
 	signed long Val;
 
+	// the write mode streams are mixed in place in their rings, the handles stay
+	// locked until the chunks are consumed. the mutex only guards open and close,
+	// a handle that is being opened or closed is skipped for a period
 	StreamCount = 0;
+	LockCount = 0;
+	RingCount = 0;
 	for (i = 0; i < AW_JAVA_AUDIO_MAX_HANDLE; i++)
 	{
 		pAudioOutInfo = pAudioInfo->AudioOutInfo + i;
-		pthread_mutex_lock (&pAudioOutInfo->Mutex);
+		if (pthread_mutex_trylock (&pAudioOutInfo->Mutex) != 0)
+		{
+			continue;
+		}
+		LockList[LockCount++] = pAudioOutInfo;
 		if (pAudioOutInfo->Valid == 1)
 		{
 			if (pAudioOutInfo->CallBack == NULL)
 			{
-				Write = pAudioOutInfo->Write;
-				if (Write < pAudioOutInfo->Read)
+				// the ring is a whole number of chunks, a full chunk never wraps
+				if (AudioRing_ReadRegion (&pAudioOutInfo->Ring, &Addr) >= pAudioInfo->OutTempBufSize)
 				{
-					Delta = Write + pAudioInfo->OutBufSize - pAudioOutInfo->Read;
+					StreamList[StreamCount++] = (signed short *)Addr;
+					RingList[RingCount++] = &pAudioOutInfo->Ring;
 				}
 				else
 				{
-					Delta = Write - pAudioOutInfo->Read;
-				}
-				if (Delta >= pAudioInfo->OutTempBufSize)
-				{
-					memcpy (pAudioOutInfo->TempBuf, pAudioOutInfo->Buf + pAudioOutInfo->Read, pAudioInfo->OutTempBufSize);
-					if (pAudioOutInfo->Read + pAudioInfo->OutTempBufSize == pAudioInfo->OutBufSize)
-					{
-						pAudioOutInfo->Read = 0;
-					}
-					else
-					{
-						pAudioOutInfo->Read += pAudioInfo->OutTempBufSize;
-					}
-					StreamList[StreamCount++] = (signed short *)pAudioOutInfo->TempBuf;
+					AudioRing_NoteUnderrun (&pAudioOutInfo->Ring, pAudioInfo->OutTempBufSize);
 				}
 			}
 			else
@@ -582,7 +533,6 @@ static void AWJavaAudioOut_Proc (AW_JAVA_AUDIO_INFO *pAudioInfo)
 				StreamList[StreamCount++] = (signed short *)pAudioOutInfo->TempBuf;
 			}
 		}
-		pthread_mutex_unlock (&pAudioOutInfo->Mutex);
 	}
 
 	if (StreamCount == 0)
@@ -618,6 +568,15 @@ static void AWJavaAudioOut_Proc (AW_JAVA_AUDIO_INFO *pAudioInfo)
 		}
 	}
 
+	for (i = 0; i < RingCount; i++)
+	{
+		AudioRing_ReadCommit (RingList[i], pAudioInfo->OutTempBufSize);
+	}
+	for (i = 0; i < LockCount; i++)
+	{
+		pthread_mutex_unlock (&LockList[i]->Mutex);
+	}
+
 	return;
 }
 
@@ -935,7 +894,26 @@ AUDIO_IN_HANDLE AWJavaAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 				pAudioInInfo->Size = pAudioInfo->InBufSize;
 				Param->FrameCount = pAudioInfo->InBufSize / Param->Channels / 2;
 			}
-			pAudioInInfo->Read = pAudioInfo->InBufWrite;
+			if (Param->CallBack != NULL && pAudioInInfo->Size > 0)
+			{
+				// the callback gets every block in place
+				pAudioInInfo->Ring = AudioRing_Create (pAudioInfo->InBufSize / pAudioInInfo->Size * pAudioInInfo->Size);
+			}
+			else
+			{
+				pAudioInInfo->Ring = AudioRing_Create (pAudioInfo->InBufSize);
+			}
+			if (pAudioInInfo->Ring != NULL && Param->CallBack == NULL && AudioRing_EnableWait (pAudioInInfo->Ring, Param->SampleRate * Param->Channels * 2) == -1)
+			{
+				AudioRing_Destroy (pAudioInInfo->Ring);
+				pAudioInInfo->Ring = NULL;
+			}
+			if (pAudioInInfo->Ring == NULL)
+			{
+				pthread_mutex_unlock (&pAudioInInfo->Mutex);
+				i = AW_JAVA_AUDIO_MAX_HANDLE;
+				break;
+			}
 			pAudioInInfo->Valid = 1;
 			pthread_mutex_unlock (&pAudioInInfo->Mutex);
 			break;
@@ -955,6 +933,36 @@ AUDIO_IN_HANDLE AWJavaAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 	return (AUDIO_IN_HANDLE)pAudioInInfo;
 }
 
+// the readers do not take the handle mutex. a reader counts itself in before it
+// checks Valid, close clears Valid, wakes a waiting reader and waits for the
+// count to drop before the ring goes
+static AUDIO_RING* AWJavaAudioIn_Enter (AW_JAVA_AUDIO_IN_INFO *pAudioInInfo)
+{
+	__sync_fetch_and_add (&pAudioInInfo->Users, 1);
+	if (pAudioInInfo->Valid == 1)
+	{
+		return pAudioInInfo->Ring;
+	}
+	__sync_fetch_and_sub (&pAudioInInfo->Users, 1);
+	return NULL;
+}
+
+static void AWJavaAudioIn_Leave (AW_JAVA_AUDIO_IN_INFO *pAudioInInfo)
+{
+	__sync_fetch_and_sub (&pAudioInInfo->Users, 1);
+}
+
+// with Mutex held and Valid cleared
+static void AWJavaAudioIn_Drain (AW_JAVA_AUDIO_IN_INFO *pAudioInInfo)
+{
+	__sync_synchronize ();
+	AudioRing_Close (pAudioInInfo->Ring);
+	while (pAudioInInfo->Users > 0)
+	{
+		usleep (1000);
+	}
+}
+
 long AWJavaAudioIn_Close (AUDIO_IN_HANDLE Handle)
 {
 	AW_JAVA_AUDIO_IN_INFO *pAudioInInfo = (AW_JAVA_AUDIO_IN_INFO *)Handle;
@@ -963,6 +971,9 @@ long AWJavaAudioIn_Close (AUDIO_IN_HANDLE Handle)
 	if (pAudioInInfo->Valid == 1)
 	{
 		pAudioInInfo->Valid = 0;
+		AWJavaAudioIn_Drain (pAudioInInfo);
+		AudioRing_Destroy (pAudioInInfo->Ring);
+		pAudioInInfo->Ring = NULL;
 		pthread_mutex_unlock (&pAudioInInfo->Mutex);
 		return 0;
 	}
@@ -976,49 +987,50 @@ long AWJavaAudioIn_Close (AUDIO_IN_HANDLE Handle)
 long AWJavaAudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size)
 {
 	AW_JAVA_AUDIO_IN_INFO *pAudioInInfo = (AW_JAVA_AUDIO_IN_INFO *)Handle;
-	AW_JAVA_AUDIO_INFO *pAudioInfo;
-	int Write, Delta;
+	AUDIO_RING *pRing = AWJavaAudioIn_Enter (pAudioInInfo);
+	long Ret = -1;
 
-	pAudioInfo = (AW_JAVA_AUDIO_INFO *)pAudioInInfo->Handle;
-	if (pAudioInInfo->Valid == 1)
+	if (pRing != NULL)
 	{
-		Write = pAudioInfo->InBufWrite;
-		if (pAudioInInfo->Read > Write)
-		{
-			Delta = Write + pAudioInfo->InBufSize - pAudioInInfo->Read;
-		}
-		else
-		{
-			Delta = Write - pAudioInInfo->Read;
-		}
-		if (Delta > Size)
-		{
-			Delta = Size;
-		}
-		if (pAudioInInfo->Read + Delta > pAudioInfo->InBufSize)
-		{
-			memcpy (BufAddr, pAudioInfo->InBuf + pAudioInInfo->Read, pAudioInfo->InBufSize - pAudioInInfo->Read);
-			memcpy ((unsigned char *)BufAddr + (pAudioInfo->InBufSize - pAudioInInfo->Read), pAudioInfo->InBuf, Delta - (pAudioInfo->InBufSize - pAudioInInfo->Read));
-			pAudioInInfo->Read = pAudioInInfo->Read + Delta - pAudioInfo->InBufSize;
-		}
-		else
+		Ret = AudioRing_Read (pRing, BufAddr, Size);
+		AWJavaAudioIn_Leave (pAudioInInfo);
+	}
+
+	return Ret;
+}
+
+// the java record thread commits each block and wakes the reader
+long AWJavaAudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat)
+{
+	AW_JAVA_AUDIO_IN_INFO *pAudioInInfo = (AW_JAVA_AUDIO_IN_INFO *)Handle;
+	AUDIO_RING *pRing = AWJavaAudioIn_Enter (pAudioInInfo);
+	long Ret = -1;
+
+	if (pRing != NULL)
+	{
+		if (pAudioInInfo->CallBack == NULL)
 		{
-			memcpy (BufAddr, pAudioInfo->InBuf + pAudioInInfo->Read, Delta);
-			if (pAudioInInfo->Read + Delta == pAudioInfo->InBufSize)
-			{
-				pAudioInInfo->Read = 0;
-			}
-			else
-			{
-				pAudioInInfo->Read += Delta;
-			}
+			Ret = AudioRing_ReadWait (pRing, BufAddr, Size, Timeout, pStat);
 		}
-		return Delta;
+		AWJavaAudioIn_Leave (pAudioInInfo);
 	}
-	else
+
+	return Ret;
+}
+
+long AWJavaAudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	AW_JAVA_AUDIO_IN_INFO *pAudioInInfo = (AW_JAVA_AUDIO_IN_INFO *)Handle;
+	AUDIO_RING *pRing = AWJavaAudioIn_Enter (pAudioInInfo);
+
+	if (pRing == NULL)
 	{
 		return -1;
 	}
+	AudioRing_GetStat (pRing, pStat);
+	AWJavaAudioIn_Leave (pAudioInInfo);
+
+	return 0;
 }
 
 AUDIO_OUT_HANDLE AWJavaAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
@@ -1046,7 +1058,7 @@ AUDIO_OUT_HANDLE AWJavaAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 				Param->FrameCount = pAudioInfo->OutBufSize / Param->Channels / 2;
 			}
 			pAudioOutInfo->Read = pAudioOutInfo->Size;
-			pAudioOutInfo->Write = 0;
+			AudioRing_Init (&pAudioOutInfo->Ring, pAudioOutInfo->Buf, pAudioInfo->OutBufSize / pAudioInfo->OutTempBufSize * pAudioInfo->OutTempBufSize);
 			pAudioOutInfo->Valid = 1;
 			pthread_mutex_unlock (&pAudioOutInfo->Mutex);
 			break;
@@ -1087,44 +1099,25 @@ long AWJavaAudioOut_Close (AUDIO_OUT_HANDLE Handle)
 long AWJavaAudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size)
 {
 	AW_JAVA_AUDIO_OUT_INFO *pAudioOutInfo = (AW_JAVA_AUDIO_OUT_INFO *)Handle;
-	AW_JAVA_AUDIO_INFO *pAudioInfo;
-	int Free, Read;
 
-	pAudioInfo = (AW_JAVA_AUDIO_INFO *)pAudioOutInfo->Handle;
 	if (pAudioOutInfo->Valid == 1)
 	{
-		Read = pAudioOutInfo->Read;
-		if (Read > pAudioOutInfo->Write)
-		{
-			Free = Read - pAudioOutInfo->Write;
-		}
-		else
-		{
-			Free = pAudioInfo->OutBufSize - (pAudioOutInfo->Write - Read);
-		}
-		if (Free > Size)
-		{
-			Free = Size;
-		}
-		if (pAudioOutInfo->Write + Free > pAudioInfo->OutBufSize)
-		{
-			memcpy (pAudioOutInfo->Buf + pAudioOutInfo->Write, BufAddr, pAudioInfo->OutBufSize - pAudioOutInfo->Write);
-			memcpy (pAudioOutInfo->Buf, (unsigned char *)BufAddr + (pAudioInfo->OutBufSize - pAudioOutInfo->Write), Free - (pAudioInfo->OutBufSize - pAudioOutInfo->Write));
-			pAudioOutInfo->Write = pAudioOutInfo->Write + Free - pAudioInfo->OutBufSize;
-		}
-		else
-		{
-			memcpy (pAudioOutInfo->Buf + pAudioOutInfo->Write, BufAddr, Free);
-			if (pAudioOutInfo->Write + Free == pAudioInfo->OutBufSize)
-			{
-				pAudioOutInfo->Write = 0;
-			}
-			else
-			{
-				pAudioOutInfo->Write += Free;
-			}
-		}
-		return Free;
+		return AudioRing_Write (&pAudioOutInfo->Ring, BufAddr, Size);
+	}
+	else
+	{
+		return -1;
+	}
+}
+
+long AWJavaAudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	AW_JAVA_AUDIO_OUT_INFO *pAudioOutInfo = (AW_JAVA_AUDIO_OUT_INFO *)Handle;
+
+	if (pAudioOutInfo->Valid == 1 && pAudioOutInfo->CallBack == NULL)
+	{
+		AudioRing_GetStat (&pAudioOutInfo->Ring, pStat);
+		return 0;
 	}
 	else
 	{
@@ -1220,7 +1213,6 @@ AUDIO_HANDLE AWJavaAudio_Init (ANDROID_JAVA_AUDIO_PARAM *Param)
 	pAudioInfo->InExitFlag = 0;
 	pAudioInfo->InEnv = NULL;
 	pAudioInfo->InBufSize = AW_JAVA_AUDIO_IN_BUF_TIME * pAudioInfo->InSampleRate * AW_JAVA_AUDIO_IN_CHANNELS * 2 / 1000;
-	pAudioInfo->InBufWrite = 0;
 	pAudioInfo->InTempBufSize = AW_JAVA_AUDIO_IN_TEMP_BUF_TIME * pAudioInfo->InSampleRate * pAudioInfo->InChannels * 2 / 1000;
 
 	pAudioInfo->OutChannels = pAudioInfo->Param->OutChannels;
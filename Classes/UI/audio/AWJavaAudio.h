@@ -2,6 +2,7 @@
 #define _AW_JAVA_AUDIO_H_
 
 #include "CP_Audio.h"
+#include "AudioRing.h"
 
 
 #include <jni.h>
@@ -73,10 +74,13 @@ extern "C" {
 	AUDIO_IN_HANDLE AWJavaAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 	long AWJavaAudioIn_Close (AUDIO_IN_HANDLE Handle);
 	long AWJavaAudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size);
+	long AWJavaAudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat);
+	long AWJavaAudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat);
 
 	AUDIO_OUT_HANDLE AWJavaAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 	long AWJavaAudioOut_Close (AUDIO_OUT_HANDLE Handle);
 	long AWJavaAudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size);
+	long AWJavaAudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat);
 
 	AUDIO_HANDLE AWJavaAudio_Init (ANDROID_JAVA_AUDIO_PARAM *Param);
 	int AWJavaAudio_Finish (AUDIO_HANDLE Handle);
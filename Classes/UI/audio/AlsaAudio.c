@@ -0,0 +1,715 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <alsa/asoundlib.h>
+
+#include "AlsaAudio.h"
+#include "AudioRing.h"
+
+#ifdef ALSA_AUDIO_LATENCY_TOOL
+#define ALSA_DebugPrint(...)			printf ("[alsa] " __VA_ARGS__)
+#else
+#include <k_global.h>
+#define ALSA_DebugPrint(...)			mus_printf ("[alsa] " __VA_ARGS__)
+#endif
+
+#define ALSA_AUDIO_SAMPLE_BYTES		2			// S16_LE
+#define ALSA_AUDIO_RING_FRAMES		12800		// ring of the read/write mode, 266MS at 48K
+#define ALSA_AUDIO_WAIT_MS			1000
+
+typedef struct tagALSA_AUDIO_INFO
+{
+	ALSA_AUDIO_PARAM		Param;
+
+	pthread_mutex_t			Mutex;				// guards the pcm pointers below against close
+	snd_pcm_t				*InPcm;
+	snd_pcm_t				*OutPcm;
+	unsigned long			InRate;
+	unsigned long			OutRate;
+	volatile unsigned long	Xruns;
+}ALSA_AUDIO_INFO;
+
+typedef struct tagALSA_AUDIO_STREAM_INFO
+{
+	ALSA_AUDIO_INFO			*pAudioInfo;
+	snd_pcm_t				*Pcm;
+	int						Capture;
+	int						Mmap;
+	unsigned long			Channels;
+	unsigned long			SampleRate;
+	unsigned long			FrameBytes;
+	snd_pcm_uframes_t		PeriodFrames;
+	snd_pcm_uframes_t		BufferFrames;
+
+	FuncAudioCallBack		CallBack;
+	void					*User;
+
+	pthread_t				Thread;
+	volatile int			ThreadExitFlag;
+
+	unsigned char			*ProcBuf;			// one transfer to or from the pcm
+	unsigned long			ProcFrames;
+
+	AUDIO_RING				*Ring;				// read/write mode, a whole number of ProcFrames
+}ALSA_AUDIO_STREAM_INFO;
+
+static ALSA_AUDIO_PARAM gAlsaAudioParam =
+{
+	ALSA_AUDIO_DEFAULT_DEVICE,
+	ALSA_AUDIO_DEFAULT_DEVICE,
+	ALSA_AUDIO_DEFAULT_PERIOD_FRAMES,
+	ALSA_AUDIO_DEFAULT_PERIODS,
+	1,
+};
+
+void AlsaAudio_SetParam (ALSA_AUDIO_PARAM *Param)
+{
+	gAlsaAudioParam = *Param;
+}
+
+ALSA_AUDIO_PARAM* AlsaAudio_GetParam (void)
+{
+	return &gAlsaAudioParam;
+}
+
+//----------------------------------------------------------------------------//
+// -EPIPE is an overrun on capture and an underrun on playback, -ESTRPIPE a
+// suspended device. both leave the pcm stopped until it is prepared again
+static int AlsaAudio_Recover (ALSA_AUDIO_STREAM_INFO *pStreamInfo, int Err)
+{
+	if (Err == -EPIPE)
+	{
+		__sync_fetch_and_add (&pStreamInfo->pAudioInfo->Xruns, 1);
+		Err = snd_pcm_prepare (pStreamInfo->Pcm);
+	}
+	else if (Err == -ESTRPIPE)
+	{
+		while ((Err = snd_pcm_resume (pStreamInfo->Pcm)) == -EAGAIN && pStreamInfo->ThreadExitFlag == 0)
+		{
+			usleep (10000);
+		}
+		if (Err == 0)
+		{
+			// resumed in the state it was suspended in, a running capture needs no start
+			return 0;
+		}
+		// -ENOSYS, the driver can not resume, or closing while it was still waking up
+		Err = snd_pcm_prepare (pStreamInfo->Pcm);
+	}
+	else
+	{
+		ALSA_DebugPrint ("%s error: %s\n", pStreamInfo->Capture? "capture" : "playback", snd_strerror (Err));
+		return Err;
+	}
+
+	// playback starts again at the start threshold, capture has to be kicked
+	if (Err == 0 && pStreamInfo->Capture)
+	{
+		Err = snd_pcm_start (pStreamInfo->Pcm);
+	}
+	if (Err < 0)
+	{
+		ALSA_DebugPrint ("%s recover error: %s\n", pStreamInfo->Capture? "capture" : "playback", snd_strerror (Err));
+	}
+
+	return Err;
+}
+
+//----------------------------------------------------------------------------//
+// moves Frames frames between BufAddr and the pcm, blocks until all are done
+static long AlsaAudio_Transfer (ALSA_AUDIO_STREAM_INFO *pStreamInfo, unsigned char *BufAddr, snd_pcm_uframes_t Frames)
+{
+	const snd_pcm_channel_area_t	*Areas;
+	snd_pcm_uframes_t				Offset, Size;
+	snd_pcm_sframes_t				Avail, Done;
+	unsigned char					*Addr;
+	int								Err;
+
+	while (Frames > 0 && pStreamInfo->ThreadExitFlag == 0)
+	{
+		if (pStreamInfo->Mmap == 0)
+		{
+			if (pStreamInfo->Capture)
+			{
+				Done = snd_pcm_readi (pStreamInfo->Pcm, BufAddr, Frames);
+			}
+			else
+			{
+				Done = snd_pcm_writei (pStreamInfo->Pcm, BufAddr, Frames);
+			}
+			if (Done == -EAGAIN)
+			{
+				snd_pcm_wait (pStreamInfo->Pcm, ALSA_AUDIO_WAIT_MS);
+				continue;
+			}
+			if (Done < 0)
+			{
+				if (AlsaAudio_Recover (pStreamInfo, (int)Done) < 0)
+				{
+					return -1;
+				}
+				continue;
+			}
+		}
+		else
+		{
+			Avail = snd_pcm_avail_update (pStreamInfo->Pcm);
+			if (Avail < 0)
+			{
+				if (AlsaAudio_Recover (pStreamInfo, (int)Avail) < 0)
+				{
+					return -1;
+				}
+				continue;
+			}
+			if ((snd_pcm_uframes_t)Avail < Frames && (snd_pcm_uframes_t)Avail < pStreamInfo->PeriodFrames)
+			{
+				// a full playback buffer that never reached the start threshold
+				if (pStreamInfo->Capture == 0 && snd_pcm_state (pStreamInfo->Pcm) == SND_PCM_STATE_PREPARED)
+				{
+					snd_pcm_start (pStreamInfo->Pcm);
+					continue;
+				}
+				Err = snd_pcm_wait (pStreamInfo->Pcm, ALSA_AUDIO_WAIT_MS);
+				if (Err < 0 && AlsaAudio_Recover (pStreamInfo, Err) < 0)
+				{
+					return -1;
+				}
+				continue;
+			}
+
+			Size = Frames;
+			Err = snd_pcm_mmap_begin (pStreamInfo->Pcm, &Areas, &Offset, &Size);
+			if (Err < 0)
+			{
+				if (AlsaAudio_Recover (pStreamInfo, Err) < 0)
+				{
+					return -1;
+				}
+				continue;
+			}
+
+			// interleaved access, one area for all channels, first/step in bits
+			Addr = (unsigned char *)Areas[0].addr + Areas[0].first / 8 + Offset * (Areas[0].step / 8);
+			if (pStreamInfo->Capture)
+			{
+				memcpy (BufAddr, Addr, Size * pStreamInfo->FrameBytes);
+			}
+			else
+			{
+				memcpy (Addr, BufAddr, Size * pStreamInfo->FrameBytes);
+			}
+
+			Done = snd_pcm_mmap_commit (pStreamInfo->Pcm, Offset, Size);
+			if (Done < 0 || (snd_pcm_uframes_t)Done != Size)
+			{
+				if (AlsaAudio_Recover (pStreamInfo, (Done < 0)? (int)Done : -EPIPE) < 0)
+				{
+					return -1;
+				}
+				continue;
+			}
+		}
+
+		BufAddr += Done * pStreamInfo->FrameBytes;
+		Frames -= Done;
+	}
+
+	return (Frames == 0)? 0 : -1;
+}
+
+//----------------------------------------------------------------------------//
+static int AlsaAudio_PcmOpen (ALSA_AUDIO_STREAM_INFO *pStreamInfo, const char *Device, ALSA_AUDIO_PARAM *Param)
+{
+	snd_pcm_hw_params_t	*HwParams;
+	snd_pcm_sw_params_t	*SwParams;
+	unsigned int		Rate = pStreamInfo->SampleRate;
+	snd_pcm_uframes_t	Period = Param->PeriodFrames;
+	snd_pcm_uframes_t	Buffer = Param->PeriodFrames * Param->Periods;
+	int					Err;
+
+	Err = snd_pcm_open (&pStreamInfo->Pcm, Device, pStreamInfo->Capture? SND_PCM_STREAM_CAPTURE : SND_PCM_STREAM_PLAYBACK, 0);
+	if (Err < 0)
+	{
+		ALSA_DebugPrint ("open %s error: %s\n", Device, snd_strerror (Err));
+		pStreamInfo->Pcm = NULL;
+		return -1;
+	}
+
+	snd_pcm_hw_params_alloca (&HwParams);
+	snd_pcm_hw_params_any (pStreamInfo->Pcm, HwParams);
+
+	pStreamInfo->Mmap = Param->Mmap;
+	if (pStreamInfo->Mmap && snd_pcm_hw_params_set_access (pStreamInfo->Pcm, HwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0)
+	{
+		ALSA_DebugPrint ("%s has no mmap access, using read/write\n", Device);
+		pStreamInfo->Mmap = 0;
+	}
+	if (pStreamInfo->Mmap == 0 && (Err = snd_pcm_hw_params_set_access (pStreamInfo->Pcm, HwParams, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0)
+	{
+		goto fail;
+	}
+
+	if ((Err = snd_pcm_hw_params_set_format (pStreamInfo->Pcm, HwParams, SND_PCM_FORMAT_S16_LE)) < 0 ||
+		(Err = snd_pcm_hw_params_set_channels (pStreamInfo->Pcm, HwParams, pStreamInfo->Channels)) < 0 ||
+		(Err = snd_pcm_hw_params_set_rate_resample (pStreamInfo->Pcm, HwParams, 1)) < 0 ||
+		(Err = snd_pcm_hw_params_set_rate_near (pStreamInfo->Pcm, HwParams, &Rate, NULL)) < 0 ||
+		(Err = snd_pcm_hw_params_set_period_size_near (pStreamInfo->Pcm, HwParams, &Period, NULL)) < 0 ||
+		(Err = snd_pcm_hw_params_set_buffer_size_near (pStreamInfo->Pcm, HwParams, &Buffer)) < 0 ||
+		(Err = snd_pcm_hw_params (pStreamInfo->Pcm, HwParams)) < 0)
+	{
+		goto fail;
+	}
+	if (Rate != pStreamInfo->SampleRate)
+	{
+		ALSA_DebugPrint ("%s can not run at %lu, only %u\n", Device, pStreamInfo->SampleRate, Rate);
+		Err = -EINVAL;
+		goto fail;
+	}
+
+	snd_pcm_hw_params_get_period_size (HwParams, &pStreamInfo->PeriodFrames, NULL);
+	snd_pcm_hw_params_get_buffer_size (HwParams, &pStreamInfo->BufferFrames);
+
+	// playback starts once the buffer is full, capture is started below
+	snd_pcm_sw_params_alloca (&SwParams);
+	snd_pcm_sw_params_current (pStreamInfo->Pcm, SwParams);
+	snd_pcm_sw_params_set_start_threshold (pStreamInfo->Pcm, SwParams, pStreamInfo->Capture? 1 : pStreamInfo->BufferFrames);
+	snd_pcm_sw_params_set_avail_min (pStreamInfo->Pcm, SwParams, pStreamInfo->PeriodFrames);
+	if ((Err = snd_pcm_sw_params (pStreamInfo->Pcm, SwParams)) < 0 ||
+		(Err = snd_pcm_prepare (pStreamInfo->Pcm)) < 0)
+	{
+		goto fail;
+	}
+	if (pStreamInfo->Capture && (Err = snd_pcm_start (pStreamInfo->Pcm)) < 0)
+	{
+		goto fail;
+	}
+
+	ALSA_DebugPrint ("%s %s: %lu Hz, %lu ch, period %lu, buffer %lu, %s\n", pStreamInfo->Capture? "capture" : "playback", Device,
+		pStreamInfo->SampleRate, pStreamInfo->Channels, (unsigned long)pStreamInfo->PeriodFrames, (unsigned long)pStreamInfo->BufferFrames,
+		pStreamInfo->Mmap? "mmap" : "read/write");
+
+	return 0;
+
+fail:
+	ALSA_DebugPrint ("setup %s error: %s\n", Device, snd_strerror (Err));
+	snd_pcm_close (pStreamInfo->Pcm);
+	pStreamInfo->Pcm = NULL;
+	return -1;
+}
+
+//----------------------------------------------------------------------------//
+static void* AlsaAudio_Thread (void *Data)
+{
+	ALSA_AUDIO_STREAM_INFO	*pStreamInfo = (ALSA_AUDIO_STREAM_INFO *)Data;
+	unsigned long			ProcSize = pStreamInfo->ProcFrames * pStreamInfo->FrameBytes;
+	unsigned long			Size;
+	void					*Addr;
+	struct sched_param		SchedParam;
+
+	/* try to obtain realtime priority, needs rtprio or root, runs as normal otherwise */
+	SchedParam.sched_priority = sched_get_priority_max (SCHED_FIFO) / 2;
+	pthread_setschedparam (pthread_self (), SCHED_FIFO, &SchedParam);
+
+	while (pStreamInfo->ThreadExitFlag == 0)
+	{
+		if (pStreamInfo->Capture)
+		{
+			// the read mode takes the period straight into the ring. a reader
+			// that falls behind loses the newest data, read into ProcBuf
+			Addr = pStreamInfo->ProcBuf;
+			if (pStreamInfo->CallBack == NULL && AudioRing_WriteRegion (pStreamInfo->Ring, &Addr) < ProcSize)
+			{
+				Addr = pStreamInfo->ProcBuf;
+			}
+
+			if (AlsaAudio_Transfer (pStreamInfo, (unsigned char *)Addr, pStreamInfo->ProcFrames) == -1)
+			{
+				usleep (10000);
+				continue;
+			}
+
+			if (pStreamInfo->CallBack == NULL)
+			{
+				if (Addr != pStreamInfo->ProcBuf)
+				{
+					AudioRing_WriteCommit (pStreamInfo->Ring, ProcSize);
+				}
+				else
+				{
+					AudioRing_NoteOverrun (pStreamInfo->Ring, ProcSize);
+				}
+			}
+			else
+			{
+				pStreamInfo->CallBack (pStreamInfo->User, pStreamInfo->ProcBuf);
+			}
+		}
+		else
+		{
+			Addr = pStreamInfo->ProcBuf;
+			Size = 0;
+			if (pStreamInfo->CallBack == NULL)
+			{
+				// the write mode plays the ring in place, at most a period at a time.
+				// a short or wrapped region is written as it is, the rest goes next
+				Size = AudioRing_ReadRegion (pStreamInfo->Ring, &Addr);
+				if (Size > ProcSize)
+				{
+					Size = ProcSize;
+				}
+				Size -= Size % pStreamInfo->FrameBytes;
+				if (Size == 0)
+				{
+					// dry ring, a period of silence keeps the pcm running
+					AudioRing_NoteUnderrun (pStreamInfo->Ring, ProcSize);
+					Addr = pStreamInfo->ProcBuf;
+					memset (pStreamInfo->ProcBuf, 0, ProcSize);
+				}
+			}
+			else
+			{
+				memset (pStreamInfo->ProcBuf, 0, ProcSize);
+				pStreamInfo->CallBack (pStreamInfo->User, pStreamInfo->ProcBuf);
+			}
+
+			if (AlsaAudio_Transfer (pStreamInfo, (unsigned char *)Addr, (Size > 0)? Size / pStreamInfo->FrameBytes : pStreamInfo->ProcFrames) == -1)
+			{
+				usleep (10000);
+			}
+			if (Size > 0)
+			{
+				AudioRing_ReadCommit (pStreamInfo->Ring, Size);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+//----------------------------------------------------------------------------//
+static ALSA_AUDIO_STREAM_INFO* AlsaAudio_StreamOpen (AUDIO_HANDLE Handle, AUDIO_PARAM *Param, int Capture)
+{
+	ALSA_AUDIO_INFO			*pAudioInfo = (ALSA_AUDIO_INFO *)Handle;
+	ALSA_AUDIO_STREAM_INFO	*pStreamInfo;
+	unsigned long			RingFrames;
+
+	if (pAudioInfo == NULL || Param == NULL || Param->Channels == 0)
+	{
+		return NULL;
+	}
+
+	pStreamInfo = (ALSA_AUDIO_STREAM_INFO *)calloc (1, sizeof(ALSA_AUDIO_STREAM_INFO));
+	if (pStreamInfo == NULL)
+	{
+		return NULL;
+	}
+
+	pStreamInfo->pAudioInfo = pAudioInfo;
+	pStreamInfo->Capture = Capture;
+	pStreamInfo->Channels = Param->Channels;
+	pStreamInfo->SampleRate = Param->SampleRate;
+	pStreamInfo->FrameBytes = Param->Channels * ALSA_AUDIO_SAMPLE_BYTES;
+
+	if (AlsaAudio_PcmOpen (pStreamInfo, Capture? pAudioInfo->Param.InDevice : pAudioInfo->Param.OutDevice, &pAudioInfo->Param) == -1)
+	{
+		free (pStreamInfo);
+		return NULL;
+	}
+
+	// the callback gets FrameCount frames per call, the ring is fed one period at a time
+	pStreamInfo->CallBack = Param->CallBack;
+	pStreamInfo->User = Param->User;
+	pStreamInfo->ProcFrames = (Param->CallBack != NULL && Param->FrameCount != 0)? Param->FrameCount : pStreamInfo->PeriodFrames;
+	RingFrames = (ALSA_AUDIO_RING_FRAMES + pStreamInfo->ProcFrames - 1) / pStreamInfo->ProcFrames * pStreamInfo->ProcFrames;
+
+	pStreamInfo->ProcBuf = (unsigned char *)malloc (pStreamInfo->ProcFrames * pStreamInfo->FrameBytes);
+	if (Param->CallBack == NULL)
+	{
+		pStreamInfo->Ring = AudioRing_Create (RingFrames * pStreamInfo->FrameBytes);
+		if (pStreamInfo->Ring != NULL && Capture && AudioRing_EnableWait (pStreamInfo->Ring, pStreamInfo->SampleRate * pStreamInfo->FrameBytes) == -1)
+		{
+			AudioRing_Destroy (pStreamInfo->Ring);
+			pStreamInfo->Ring = NULL;
+		}
+	}
+	if (pStreamInfo->ProcBuf == NULL || (Param->CallBack == NULL && pStreamInfo->Ring == NULL))
+	{
+		snd_pcm_close (pStreamInfo->Pcm);
+		AudioRing_Destroy (pStreamInfo->Ring);
+		free (pStreamInfo->ProcBuf);
+		free (pStreamInfo);
+		return NULL;
+	}
+
+	pStreamInfo->ThreadExitFlag = 0;
+	if (pthread_create (&pStreamInfo->Thread, NULL, AlsaAudio_Thread, pStreamInfo) != 0)
+	{
+		snd_pcm_close (pStreamInfo->Pcm);
+		AudioRing_Destroy (pStreamInfo->Ring);
+		free (pStreamInfo->ProcBuf);
+		free (pStreamInfo);
+		return NULL;
+	}
+
+	pthread_mutex_lock (&pAudioInfo->Mutex);
+	if (Capture)
+	{
+		pAudioInfo->InPcm = pStreamInfo->Pcm;
+		pAudioInfo->InRate = pStreamInfo->SampleRate;
+	}
+	else
+	{
+		pAudioInfo->OutPcm = pStreamInfo->Pcm;
+		pAudioInfo->OutRate = pStreamInfo->SampleRate;
+	}
+	pthread_mutex_unlock (&pAudioInfo->Mutex);
+
+	return pStreamInfo;
+}
+
+static long AlsaAudio_StreamClose (ALSA_AUDIO_STREAM_INFO *pStreamInfo)
+{
+	ALSA_AUDIO_INFO *pAudioInfo = pStreamInfo->pAudioInfo;
+
+	pStreamInfo->ThreadExitFlag = 1;
+	pthread_join (pStreamInfo->Thread, NULL);
+
+	pthread_mutex_lock (&pAudioInfo->Mutex);
+	if (pAudioInfo->InPcm == pStreamInfo->Pcm)
+	{
+		pAudioInfo->InPcm = NULL;
+	}
+	if (pAudioInfo->OutPcm == pStreamInfo->Pcm)
+	{
+		pAudioInfo->OutPcm = NULL;
+	}
+	pthread_mutex_unlock (&pAudioInfo->Mutex);
+
+	snd_pcm_drop (pStreamInfo->Pcm);
+	snd_pcm_close (pStreamInfo->Pcm);
+
+	AudioRing_Destroy (pStreamInfo->Ring);
+	free (pStreamInfo->ProcBuf);
+	free (pStreamInfo);
+
+	return 0;
+}
+
+static long AlsaAudio_StreamStat (ALSA_AUDIO_STREAM_INFO *pStreamInfo, AUDIO_RING_STAT *pStat)
+{
+	if (pStreamInfo->Ring == NULL)
+	{
+		return -1;
+	}
+
+	AudioRing_GetStat (pStreamInfo->Ring, pStat);
+
+	return 0;
+}
+
+//----------------------------------------------------------------------------//
+AUDIO_IN_HANDLE AlsaAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
+{
+	return (AUDIO_IN_HANDLE)AlsaAudio_StreamOpen (Handle, Param, 1);
+}
+
+long AlsaAudioIn_Close (AUDIO_IN_HANDLE Handle)
+{
+	return AlsaAudio_StreamClose ((ALSA_AUDIO_STREAM_INFO *)Handle);
+}
+
+long AlsaAudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size)
+{
+	ALSA_AUDIO_STREAM_INFO *pStreamInfo = (ALSA_AUDIO_STREAM_INFO *)Handle;
+
+	if (pStreamInfo->CallBack != NULL)
+	{
+		return -1;
+	}
+
+	return AudioRing_Read (pStreamInfo->Ring, BufAddr, Size - Size % pStreamInfo->FrameBytes);
+}
+
+// the stream thread sleeps in poll on the pcm fds, its commit wakes the reader
+long AlsaAudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat)
+{
+	ALSA_AUDIO_STREAM_INFO *pStreamInfo = (ALSA_AUDIO_STREAM_INFO *)Handle;
+
+	if (pStreamInfo->CallBack != NULL)
+	{
+		return -1;
+	}
+
+	return AudioRing_ReadWait (pStreamInfo->Ring, BufAddr, Size - Size % pStreamInfo->FrameBytes, Timeout, pStat);
+}
+
+long AlsaAudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	return AlsaAudio_StreamStat ((ALSA_AUDIO_STREAM_INFO *)Handle, pStat);
+}
+
+AUDIO_OUT_HANDLE AlsaAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
+{
+	return (AUDIO_OUT_HANDLE)AlsaAudio_StreamOpen (Handle, Param, 0);
+}
+
+long AlsaAudioOut_Close (AUDIO_OUT_HANDLE Handle)
+{
+	return AlsaAudio_StreamClose ((ALSA_AUDIO_STREAM_INFO *)Handle);
+}
+
+long AlsaAudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size)
+{
+	ALSA_AUDIO_STREAM_INFO *pStreamInfo = (ALSA_AUDIO_STREAM_INFO *)Handle;
+
+	if (pStreamInfo->CallBack != NULL)
+	{
+		return -1;
+	}
+
+	return AudioRing_Write (pStreamInfo->Ring, BufAddr, Size - Size % pStreamInfo->FrameBytes);
+}
+
+long AlsaAudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	return AlsaAudio_StreamStat ((ALSA_AUDIO_STREAM_INFO *)Handle, pStat);
+}
+
+//----------------------------------------------------------------------------//
+static int AlsaAudio_Delay (snd_pcm_t *Pcm, int *Data)
+{
+	snd_pcm_sframes_t Delay;
+
+	if (Pcm == NULL || snd_pcm_delay (Pcm, &Delay) < 0)
+	{
+		return -1;
+	}
+	*Data = (Delay > 0)? (int)Delay : 0;
+
+	return 0;
+}
+
+int AlsaAudio_Set (AUDIO_HANDLE Handle, int Cmd, int Data)
+{
+	ALSA_AUDIO_INFO *pAudioInfo = (ALSA_AUDIO_INFO *)Handle;
+
+	if (pAudioInfo == NULL)
+	{
+		return -1;
+	}
+
+	switch (Cmd)
+	{
+	case ALSA_AUDIO_CMD_SET_PERIOD_FRAMES:
+		if (Data <= 0)
+		{
+			return -1;
+		}
+		pAudioInfo->Param.PeriodFrames = Data;
+		break;
+
+	case ALSA_AUDIO_CMD_SET_PERIODS:
+		if (Data < 2)
+		{
+			return -1;
+		}
+		pAudioInfo->Param.Periods = Data;
+		break;
+
+	case ALSA_AUDIO_CMD_SET_MMAP:
+		pAudioInfo->Param.Mmap = (Data != 0);
+		break;
+
+	default:
+		// mic/echo volumes belong to the mixer of the card, not handled here
+		return -1;
+	}
+
+	return 0;
+}
+
+int AlsaAudio_Get (AUDIO_HANDLE Handle, int Cmd, int *Data)
+{
+	ALSA_AUDIO_INFO	*pAudioInfo = (ALSA_AUDIO_INFO *)Handle;
+	int				Result = 0;
+	int				InDelay, OutDelay;
+
+	if (pAudioInfo == NULL || Data == NULL)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock (&pAudioInfo->Mutex);
+	switch (Cmd)
+	{
+	case ALSA_AUDIO_CMD_GET_IN_DELAY:
+		Result = AlsaAudio_Delay (pAudioInfo->InPcm, Data);
+		break;
+
+	case ALSA_AUDIO_CMD_GET_OUT_DELAY:
+		Result = AlsaAudio_Delay (pAudioInfo->OutPcm, Data);
+		break;
+
+	case ALSA_AUDIO_CMD_GET_LATENCY:
+		if (AlsaAudio_Delay (pAudioInfo->InPcm, &InDelay) == -1 || AlsaAudio_Delay (pAudioInfo->OutPcm, &OutDelay) == -1)
+		{
+			Result = -1;
+			break;
+		}
+		*Data = (int)(InDelay * 1000 / pAudioInfo->InRate + OutDelay * 1000 / pAudioInfo->OutRate);
+		break;
+
+	case ALSA_AUDIO_CMD_GET_XRUNS:
+		*Data = (int)pAudioInfo->Xruns;
+		break;
+
+	default:
+		Result = -1;
+		break;
+	}
+	pthread_mutex_unlock (&pAudioInfo->Mutex);
+
+	return Result;
+}
+
+//----------------------------------------------------------------------------//
+AUDIO_HANDLE AlsaAudio_Init (int samplerate)
+{
+	ALSA_AUDIO_INFO *pAudioInfo;
+
+	pAudioInfo = (ALSA_AUDIO_INFO *)calloc (1, sizeof(ALSA_AUDIO_INFO));
+	if (pAudioInfo == NULL)
+	{
+		return NULL;
+	}
+
+	pAudioInfo->Param = gAlsaAudioParam;
+	pthread_mutex_init (&pAudioInfo->Mutex, NULL);
+
+	ALSA_DebugPrint ("init, in %s, out %s, period %lu x %lu, %s\n", pAudioInfo->Param.InDevice, pAudioInfo->Param.OutDevice,
+		pAudioInfo->Param.PeriodFrames, pAudioInfo->Param.Periods, pAudioInfo->Param.Mmap? "mmap" : "read/write");
+
+	return (AUDIO_HANDLE)pAudioInfo;
+}
+
+int AlsaAudio_Finish (AUDIO_HANDLE Handle)
+{
+	ALSA_AUDIO_INFO *pAudioInfo = (ALSA_AUDIO_INFO *)Handle;
+
+	if (pAudioInfo == NULL)
+	{
+		return -1;
+	}
+
+	pthread_mutex_destroy (&pAudioInfo->Mutex);
+	free (pAudioInfo);
+
+	return 0;
+}
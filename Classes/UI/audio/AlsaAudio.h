@@ -0,0 +1,61 @@
+#ifndef _ALSA_AUDIO_H_
+#define _ALSA_AUDIO_H_
+
+#include "CP_Audio.h"
+#include "AudioRing.h"
+
+#define ALSA_AUDIO_DEFAULT_DEVICE				"default"
+#define ALSA_AUDIO_DEFAULT_PERIOD_FRAMES		256
+#define ALSA_AUDIO_DEFAULT_PERIODS				3
+
+// rate and channels come with AUDIO_PARAM of each open
+typedef struct tagALSA_AUDIO_PARAM
+{
+	const char		*InDevice;			// capture pcm name, "default", "hw:0,0" ...
+	const char		*OutDevice;			// playback pcm name
+	unsigned long	PeriodFrames;		// frames per period, latency step
+	unsigned long	Periods;			// periods per buffer, buffer = PeriodFrames * Periods
+	int				Mmap;				// 1 - mmap transfer, falls back to read/write if the pcm can not
+}ALSA_AUDIO_PARAM;
+
+// commands of AlsaAudio_Set/AlsaAudio_Get, kept clear of CP_AUDIO_CMD
+typedef enum tagALSA_AUDIO_CMD
+{
+	ALSA_AUDIO_CMD_SET_PERIOD_FRAMES = 0x1000,	// applies to the next open
+	ALSA_AUDIO_CMD_SET_PERIODS,					// applies to the next open
+	ALSA_AUDIO_CMD_SET_MMAP,					// applies to the next open
+	ALSA_AUDIO_CMD_GET_IN_DELAY,				// frames queued in the capture pcm
+	ALSA_AUDIO_CMD_GET_OUT_DELAY,				// frames queued in the playback pcm
+	ALSA_AUDIO_CMD_GET_LATENCY,					// capture + playback buffer latency in ms
+	ALSA_AUDIO_CMD_GET_XRUNS,					// overruns + underruns recovered since init
+}ALSA_AUDIO_CMD;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+void AlsaAudio_SetParam (ALSA_AUDIO_PARAM *Param);
+ALSA_AUDIO_PARAM* AlsaAudio_GetParam (void);
+
+int AlsaAudio_Set (AUDIO_HANDLE Handle, int Cmd, int Data);
+int AlsaAudio_Get (AUDIO_HANDLE Handle, int Cmd, int *Data);
+
+AUDIO_IN_HANDLE AlsaAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
+long AlsaAudioIn_Close (AUDIO_IN_HANDLE Handle);
+long AlsaAudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size);
+long AlsaAudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat);
+long AlsaAudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat);
+
+AUDIO_OUT_HANDLE AlsaAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
+long AlsaAudioOut_Close (AUDIO_OUT_HANDLE Handle);
+long AlsaAudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size);
+long AlsaAudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat);
+
+AUDIO_HANDLE AlsaAudio_Init (int samplerate);
+int AlsaAudio_Finish (AUDIO_HANDLE Handle);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
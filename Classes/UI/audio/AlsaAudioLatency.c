@@ -0,0 +1,272 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : AlsaAudioLatency.c
+//
+// Description: standalone round trip latency tool for the ALSA audio backend,
+//				not part of the app. plays short tone bursts through
+//				AlsaAudioOut and waits for them on AlsaAudioIn, both in the
+//				callback mode the player uses. the delay reported is from the
+//				burst being handed to the sink to it coming back from the
+//				source, i.e. what a singer hears of the mic monitor path on top
+//				of the DSP. loop line out to line in, or hold the mic near the
+//				speaker, and keep the room quiet for the first 300ms.
+//
+//	build:	gcc -O2 -DALSA_AUDIO_LATENCY_TOOL -I../../ThirdParty/ChaosPlayer/include AlsaAudioLatency.c AlsaAudio.c AudioRing.c -lasound -lpthread -lm
+//	run:	./a.out [-i capture pcm] [-o playback pcm] [-r rate] [-p period frames] [-n periods] [-m mmap 0/1] [-c bursts]
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#ifdef ALSA_AUDIO_LATENCY_TOOL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "AlsaAudio.h"
+
+#define LATENCY_NOISE_US			300000		// noise floor window before the first burst
+#define LATENCY_INTERVAL_US			300000		// quiet time between bursts
+#define LATENCY_TIMEOUT_US			1000000		// burst counted as lost after this
+#define LATENCY_BURST_HZ			3000
+#define LATENCY_BURST_US			2000
+#define LATENCY_MIN_THRESHOLD		1000
+
+typedef struct tagLATENCY_INFO
+{
+	pthread_mutex_t		Mutex;
+	unsigned long		Rate;
+	unsigned long		InChannels;
+	unsigned long		OutChannels;
+	unsigned long		FrameCount;
+
+	long long			NoiseEndUs;
+	int					NoisePeak;
+	int					Threshold;
+
+	int					Waiting;
+	long long			EmitUs;
+	long long			NextEmitUs;
+
+	int					Count;
+	int					Sent;
+	int					Got;
+	int					Lost;
+	double				Sum;
+	double				Min;
+	double				Max;
+}LATENCY_INFO;
+
+static long long latencyNowUs (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//----------------------------------------------------------------------------//
+// sink callback, the buffer is zeroed by the backend
+static long latencySinkCallBack (void *User, void *BufAddr)
+{
+	LATENCY_INFO	*pInfo = (LATENCY_INFO *)User;
+	short			*Pcm = (short *)BufAddr;
+	long long		Now = latencyNowUs ();
+	unsigned long	i, c, Frames;
+
+	pthread_mutex_lock (&pInfo->Mutex);
+	if (pInfo->Waiting && Now - pInfo->EmitUs > LATENCY_TIMEOUT_US)
+	{
+		printf ("burst %d lost\n", pInfo->Sent);
+		pInfo->Lost++;
+		pInfo->Waiting = 0;
+		pInfo->NextEmitUs = Now + LATENCY_INTERVAL_US;
+	}
+	if (pInfo->Waiting == 0 && pInfo->Threshold != 0 && pInfo->Sent < pInfo->Count && Now >= pInfo->NextEmitUs)
+	{
+		Frames = pInfo->Rate * LATENCY_BURST_US / 1000000;
+		if (Frames > pInfo->FrameCount)
+		{
+			Frames = pInfo->FrameCount;
+		}
+		for (i = 0; i < Frames; i++)
+		{
+			short Sample = (short)(20000 * sin (2 * M_PI * LATENCY_BURST_HZ * i / pInfo->Rate));
+			for (c = 0; c < pInfo->OutChannels; c++)
+			{
+				Pcm[i * pInfo->OutChannels + c] = Sample;
+			}
+		}
+		pInfo->EmitUs = Now;
+		pInfo->Waiting = 1;
+		pInfo->Sent++;
+	}
+	pthread_mutex_unlock (&pInfo->Mutex);
+
+	return pInfo->FrameCount * pInfo->OutChannels * 2;
+}
+
+//----------------------------------------------------------------------------//
+// source callback, channel 0 is watched. the callback comes right after the
+// last frame of the period was captured, so frame i was taken
+// (FrameCount - i) frames before now
+static long latencySrcCallBack (void *User, void *BufAddr)
+{
+	LATENCY_INFO	*pInfo = (LATENCY_INFO *)User;
+	short			*Pcm = (short *)BufAddr;
+	long long		Now = latencyNowUs ();
+	long long		CapturedUs;
+	unsigned long	i;
+	int				Level;
+	double			Ms;
+
+	pthread_mutex_lock (&pInfo->Mutex);
+	for (i = 0; i < pInfo->FrameCount; i++)
+	{
+		Level = abs (Pcm[i * pInfo->InChannels]);
+
+		if (Now < pInfo->NoiseEndUs)
+		{
+			if (Level > pInfo->NoisePeak)
+			{
+				pInfo->NoisePeak = Level;
+			}
+			continue;
+		}
+		if (pInfo->Threshold == 0)
+		{
+			pInfo->Threshold = (pInfo->NoisePeak * 4 > LATENCY_MIN_THRESHOLD)? pInfo->NoisePeak * 4 : LATENCY_MIN_THRESHOLD;
+			printf ("noise peak %d, threshold %d\n", pInfo->NoisePeak, pInfo->Threshold);
+		}
+		if (pInfo->Waiting && Level > pInfo->Threshold)
+		{
+			CapturedUs = Now - (long long)(pInfo->FrameCount - i) * 1000000 / pInfo->Rate;
+			Ms = (CapturedUs - pInfo->EmitUs) / 1000.0;
+			printf ("burst %d: %.2f ms\n", pInfo->Sent, Ms);
+
+			pInfo->Got++;
+			pInfo->Sum += Ms;
+			if (pInfo->Got == 1 || Ms < pInfo->Min)
+			{
+				pInfo->Min = Ms;
+			}
+			if (pInfo->Got == 1 || Ms > pInfo->Max)
+			{
+				pInfo->Max = Ms;
+			}
+			pInfo->Waiting = 0;
+			pInfo->NextEmitUs = Now + LATENCY_INTERVAL_US;
+			break;
+		}
+	}
+	pthread_mutex_unlock (&pInfo->Mutex);
+
+	return pInfo->FrameCount * pInfo->InChannels * 2;
+}
+
+//----------------------------------------------------------------------------//
+int main (int argc, char *argv[])
+{
+	ALSA_AUDIO_PARAM	AlsaParam = *AlsaAudio_GetParam ();
+	AUDIO_PARAM			InParam, OutParam;
+	LATENCY_INFO		Info;
+	AUDIO_HANDLE		Handle;
+	AUDIO_IN_HANDLE		InHandle;
+	AUDIO_OUT_HANDLE	OutHandle;
+	int					Opt, Done, BufferMs, Xruns;
+
+	memset (&Info, 0, sizeof(Info));
+	pthread_mutex_init (&Info.Mutex, NULL);
+	Info.Rate = 48000;
+	Info.InChannels = 2;
+	Info.OutChannels = 2;
+	Info.Count = 10;
+
+	while ((Opt = getopt (argc, argv, "i:o:r:p:n:m:c:")) != -1)
+	{
+		switch (Opt)
+		{
+		case 'i': AlsaParam.InDevice = optarg; break;
+		case 'o': AlsaParam.OutDevice = optarg; break;
+		case 'r': Info.Rate = atoi (optarg); break;
+		case 'p': AlsaParam.PeriodFrames = atoi (optarg); break;
+		case 'n': AlsaParam.Periods = atoi (optarg); break;
+		case 'm': AlsaParam.Mmap = atoi (optarg); break;
+		case 'c': Info.Count = atoi (optarg); break;
+		default:
+			printf ("usage: %s [-i capture pcm] [-o playback pcm] [-r rate] [-p period frames] [-n periods] [-m mmap 0/1] [-c bursts]\n", argv[0]);
+			return 1;
+		}
+	}
+	Info.FrameCount = AlsaParam.PeriodFrames;
+	AlsaAudio_SetParam (&AlsaParam);
+
+	Handle = AlsaAudio_Init (Info.Rate);
+	if (Handle == NULL)
+	{
+		return 1;
+	}
+
+	memset (&InParam, 0, sizeof(InParam));
+	InParam.Channels = Info.InChannels;
+	InParam.SampleRate = Info.Rate;
+	InParam.CallBack = latencySrcCallBack;
+	InParam.User = &Info;
+	InParam.FrameCount = Info.FrameCount;
+	OutParam = InParam;
+	OutParam.Channels = Info.OutChannels;
+	OutParam.CallBack = latencySinkCallBack;
+
+	Info.NoiseEndUs = latencyNowUs () + LATENCY_NOISE_US;
+	Info.NextEmitUs = Info.NoiseEndUs;
+
+	OutHandle = AlsaAudioOut_Open (Handle, &OutParam);
+	InHandle = AlsaAudioIn_Open (Handle, &InParam);
+	if (OutHandle == NULL || InHandle == NULL)
+	{
+		printf ("can not open %s%s%s\n", (OutHandle == NULL)? "playback" : "", (OutHandle == NULL && InHandle == NULL)? " and " : "", (InHandle == NULL)? "capture" : "");
+		if (OutHandle != NULL) AlsaAudioOut_Close (OutHandle);
+		if (InHandle != NULL) AlsaAudioIn_Close (InHandle);
+		AlsaAudio_Finish (Handle);
+		return 1;
+	}
+
+	do
+	{
+		usleep (100000);
+		pthread_mutex_lock (&Info.Mutex);
+		Done = (Info.Got + Info.Lost >= Info.Count);
+		pthread_mutex_unlock (&Info.Mutex);
+	} while (!Done);
+
+	if (AlsaAudio_Get (Handle, ALSA_AUDIO_CMD_GET_LATENCY, &BufferMs) == -1)
+	{
+		BufferMs = -1;
+	}
+	AlsaAudio_Get (Handle, ALSA_AUDIO_CMD_GET_XRUNS, &Xruns);
+
+	AlsaAudioIn_Close (InHandle);
+	AlsaAudioOut_Close (OutHandle);
+	AlsaAudio_Finish (Handle);
+
+	if (Info.Got == 0)
+	{
+		printf ("no burst came back, check the loop and the capture level\n");
+		return 1;
+	}
+	printf ("round trip: min %.2f ms, avg %.2f ms, max %.2f ms, %d/%d bursts, buffered %d ms, xruns %d\n",
+		Info.Min, Info.Sum / Info.Got, Info.Max, Info.Got, Info.Count, BufferMs, Xruns);
+
+	return 0;
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define _ANDROID_JAVA_AUDIO_H_
 
 #include "CP_Audio.h"
+#include "AudioRing.h"
 
 #include <jni.h>
 typedef struct tagANDROID_JAVA_AUDIO_PARAM
@@ -20,10 +21,13 @@ int AndroidJavaAudio_Set (AUDIO_HANDLE Handle, int Cmd, int Data);
 AUDIO_IN_HANDLE AndroidJavaAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 long AndroidJavaAudioIn_Close (AUDIO_IN_HANDLE Handle);
 long AndroidJavaAudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size);
+long AndroidJavaAudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat);
+long AndroidJavaAudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat);
 
 AUDIO_OUT_HANDLE AndroidJavaAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 long AndroidJavaAudioOut_Close (AUDIO_OUT_HANDLE Handle);
 long AndroidJavaAudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size);
+long AndroidJavaAudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat);
 
 AUDIO_HANDLE AndroidJavaAudio_Init (int samplerate);
 int AndroidJavaAudio_Finish (AUDIO_HANDLE Handle);
@@ -0,0 +1,571 @@
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#include "AudioRing.h"
+
+typedef struct tagAUDIO_RING_WAIT
+{
+#if defined(_MSC_VER)
+	CRITICAL_SECTION		Lock;
+	CONDITION_VARIABLE		Cond;
+#else
+	pthread_mutex_t			Lock;
+	pthread_cond_t			Cond;
+#endif
+}AUDIO_RING_WAIT;
+
+// the producer publishes Pos after the data, the consumer reads Pos before the
+// data, and the other way round for the free space
+#if defined(_MSC_VER)
+static void AudioRing_Fence (void)
+{
+	MemoryBarrier ();
+}
+
+static unsigned long AudioRing_LoadAcquire (volatile unsigned long *Addr)
+{
+	unsigned long Val = *Addr;
+
+	MemoryBarrier ();
+	return Val;
+}
+
+static void AudioRing_StoreRelease (volatile unsigned long *Addr, unsigned long Val)
+{
+	MemoryBarrier ();
+	*Addr = Val;
+}
+#elif defined(__ATOMIC_ACQUIRE)
+static void AudioRing_Fence (void)
+{
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+}
+
+static unsigned long AudioRing_LoadAcquire (volatile unsigned long *Addr)
+{
+	return __atomic_load_n (Addr, __ATOMIC_ACQUIRE);
+}
+
+static void AudioRing_StoreRelease (volatile unsigned long *Addr, unsigned long Val)
+{
+	__atomic_store_n (Addr, Val, __ATOMIC_RELEASE);
+}
+#else
+static void AudioRing_Fence (void)
+{
+	__sync_synchronize ();
+}
+
+static unsigned long AudioRing_LoadAcquire (volatile unsigned long *Addr)
+{
+	unsigned long Val = *Addr;
+
+	__sync_synchronize ();
+	return Val;
+}
+
+static void AudioRing_StoreRelease (volatile unsigned long *Addr, unsigned long Val)
+{
+	__sync_synchronize ();
+	*Addr = Val;
+}
+#endif
+
+static unsigned long AudioRing_Distance (AUDIO_RING *pRing, unsigned long From, unsigned long To)
+{
+	return (To >= From)? To - From : To + 2 * pRing->Size - From;
+}
+
+static unsigned long AudioRing_Index (AUDIO_RING *pRing, unsigned long Pos)
+{
+	return (Pos >= pRing->Size)? Pos - pRing->Size : Pos;
+}
+
+static unsigned long AudioRing_Advance (AUDIO_RING *pRing, unsigned long Pos, unsigned long Size)
+{
+	Pos += Size;
+	return (Pos >= 2 * pRing->Size)? Pos - 2 * pRing->Size : Pos;
+}
+
+//----------------------------------------------------------------------------//
+int AudioRing_Init (AUDIO_RING *pRing, void *BufAddr, unsigned long Size)
+{
+	if (pRing == NULL || BufAddr == NULL || Size == 0)
+	{
+		return -1;
+	}
+
+	memset (pRing, 0, sizeof(AUDIO_RING));
+	pRing->BufAddr = (unsigned char *)BufAddr;
+	pRing->Size = Size;
+
+	return 0;
+}
+
+AUDIO_RING* AudioRing_Create (unsigned long Size)
+{
+	AUDIO_RING		*pRing;
+	unsigned char	*BufAddr;
+
+	// the buffer starts on a cache line of its own after the ring
+	pRing = (AUDIO_RING *)malloc (sizeof(AUDIO_RING) + 2 * AUDIO_RING_CACHE_LINE + Size);
+	if (pRing == NULL)
+	{
+		return NULL;
+	}
+
+	BufAddr = (unsigned char *)pRing + sizeof(AUDIO_RING) + AUDIO_RING_CACHE_LINE;
+	BufAddr += (AUDIO_RING_CACHE_LINE - (unsigned long)((size_t)BufAddr % AUDIO_RING_CACHE_LINE)) % AUDIO_RING_CACHE_LINE;
+
+	if (AudioRing_Init (pRing, BufAddr, Size) == -1)
+	{
+		free (pRing);
+		return NULL;
+	}
+	pRing->Owned = 1;
+
+	return pRing;
+}
+
+void AudioRing_Destroy (AUDIO_RING *pRing)
+{
+	AudioRing_DisableWait (pRing);
+	if (pRing != NULL && pRing->Owned)
+	{
+		free (pRing);
+	}
+}
+
+//----------------------------------------------------------------------------//
+int AudioRing_EnableWait (AUDIO_RING *pRing, unsigned long BytesPerSec)
+{
+	AUDIO_RING_WAIT *pWait;
+
+	if (pRing->Wait != NULL)
+	{
+		return 0;
+	}
+
+	pWait = (AUDIO_RING_WAIT *)malloc (sizeof(AUDIO_RING_WAIT));
+	if (pWait == NULL)
+	{
+		return -1;
+	}
+#if defined(_MSC_VER)
+	InitializeCriticalSection (&pWait->Lock);
+	InitializeConditionVariable (&pWait->Cond);
+#else
+	pthread_mutex_init (&pWait->Lock, NULL);
+	pthread_cond_init (&pWait->Cond, NULL);
+#endif
+
+	pRing->BytesPerSec = BytesPerSec;
+	pRing->Wait = pWait;
+
+	return 0;
+}
+
+void AudioRing_DisableWait (AUDIO_RING *pRing)
+{
+	AUDIO_RING_WAIT *pWait;
+
+	if (pRing == NULL || pRing->Wait == NULL)
+	{
+		return;
+	}
+
+	pWait = (AUDIO_RING_WAIT *)pRing->Wait;
+#if defined(_MSC_VER)
+	DeleteCriticalSection (&pWait->Lock);
+#else
+	pthread_cond_destroy (&pWait->Cond);
+	pthread_mutex_destroy (&pWait->Lock);
+#endif
+	free (pWait);
+	pRing->Wait = NULL;
+}
+
+void AudioRing_Close (AUDIO_RING *pRing)
+{
+	AUDIO_RING_WAIT *pWait;
+
+	if (pRing == NULL)
+	{
+		return;
+	}
+
+	pWait = (AUDIO_RING_WAIT *)pRing->Wait;
+	if (pWait == NULL)
+	{
+		pRing->Closing = 1;
+		return;
+	}
+
+	// under the lock, a reader between its check and its sleep can not miss it
+#if defined(_MSC_VER)
+	EnterCriticalSection (&pWait->Lock);
+	pRing->Closing = 1;
+	WakeAllConditionVariable (&pWait->Cond);
+	LeaveCriticalSection (&pWait->Lock);
+#else
+	pthread_mutex_lock (&pWait->Lock);
+	pRing->Closing = 1;
+	pthread_cond_broadcast (&pWait->Cond);
+	pthread_mutex_unlock (&pWait->Lock);
+#endif
+}
+
+unsigned long long AudioRing_NowUs (void)
+{
+#if defined(_MSC_VER)
+	LARGE_INTEGER Count, Freq;
+
+	QueryPerformanceFrequency (&Freq);
+	QueryPerformanceCounter (&Count);
+	return (unsigned long long)(Count.QuadPart / Freq.QuadPart * 1000000 + Count.QuadPart % Freq.QuadPart * 1000000 / Freq.QuadPart);
+#else
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+// the position and time of a commit, the reader retries while they change
+static void AudioRing_Stamp (AUDIO_RING *pRing, unsigned long Pos)
+{
+	unsigned long long Time = AudioRing_NowUs ();
+
+	pRing->Producer.StampSeq++;
+	AudioRing_Fence ();
+	pRing->Producer.StampPos = Pos;
+	pRing->Producer.StampTime = Time;
+	AudioRing_Fence ();
+	pRing->Producer.StampSeq++;
+}
+
+// capture time of the byte at Pos, the rate fills in from the last commit
+static unsigned long long AudioRing_StampAt (AUDIO_RING *pRing, unsigned long Pos)
+{
+	unsigned long		Seq;
+	unsigned long		StampPos;
+	unsigned long long	StampTime;
+	unsigned long long	Back;
+
+	do
+	{
+		Seq = AudioRing_LoadAcquire (&pRing->Producer.StampSeq);
+		StampPos = pRing->Producer.StampPos;
+		StampTime = pRing->Producer.StampTime;
+		AudioRing_Fence ();
+	} while ((Seq & 1) != 0 || Seq != pRing->Producer.StampSeq);
+
+	if (StampTime == 0 || pRing->BytesPerSec == 0)
+	{
+		return 0;
+	}
+
+	Back = (unsigned long long)AudioRing_Distance (pRing, Pos, StampPos) * 1000000 / pRing->BytesPerSec;
+	return (StampTime > Back)? StampTime - Back : 0;
+}
+
+static void AudioRing_Signal (AUDIO_RING *pRing)
+{
+	AUDIO_RING_WAIT *pWait = (AUDIO_RING_WAIT *)pRing->Wait;
+
+	// pairs with the fence in ReadWait, either the reader sees the new
+	// position or this sees the reader waiting
+	AudioRing_Fence ();
+	if (pRing->Consumer.Waiting)
+	{
+#if defined(_MSC_VER)
+		EnterCriticalSection (&pWait->Lock);
+		WakeConditionVariable (&pWait->Cond);
+		LeaveCriticalSection (&pWait->Lock);
+#else
+		pthread_mutex_lock (&pWait->Lock);
+		pthread_cond_signal (&pWait->Cond);
+		pthread_mutex_unlock (&pWait->Lock);
+#endif
+	}
+}
+
+// 0 - woken or spurious, -1 - the deadline passed, Deadline 0 waits for ever
+static int AudioRing_Sleep (AUDIO_RING_WAIT *pWait, unsigned long long Deadline)
+{
+	unsigned long long	Now;
+#if !defined(_MSC_VER)
+	struct timespec		ts;
+#endif
+
+	if (Deadline == 0)
+	{
+#if defined(_MSC_VER)
+		SleepConditionVariableCS (&pWait->Cond, &pWait->Lock, INFINITE);
+#else
+		pthread_cond_wait (&pWait->Cond, &pWait->Lock);
+#endif
+		return 0;
+	}
+
+	Now = AudioRing_NowUs ();
+	if (Now >= Deadline)
+	{
+		return -1;
+	}
+
+#if defined(_MSC_VER)
+	SleepConditionVariableCS (&pWait->Cond, &pWait->Lock, (DWORD)((Deadline - Now + 999) / 1000));
+#else
+	clock_gettime (CLOCK_REALTIME, &ts);
+	ts.tv_sec += (Deadline - Now) / 1000000;
+	ts.tv_nsec += ((Deadline - Now) % 1000000) * 1000;
+	ts.tv_sec += ts.tv_nsec / 1000000000;
+	ts.tv_nsec %= 1000000000;
+	pthread_cond_timedwait (&pWait->Cond, &pWait->Lock, &ts);
+#endif
+	return 0;
+}
+
+void AudioRing_Reset (AUDIO_RING *pRing)
+{
+	memset (&pRing->Producer, 0, sizeof(AUDIO_RING_END));
+	memset (&pRing->Consumer, 0, sizeof(AUDIO_RING_END));
+}
+
+unsigned long AudioRing_Used (AUDIO_RING *pRing)
+{
+	return AudioRing_Distance (pRing, AudioRing_LoadAcquire (&pRing->Consumer.Pos), AudioRing_LoadAcquire (&pRing->Producer.Pos));
+}
+
+unsigned long AudioRing_Free (AUDIO_RING *pRing)
+{
+	return pRing->Size - AudioRing_Used (pRing);
+}
+
+//----------------------------------------------------------------------------//
+unsigned long AudioRing_WriteRegion (AUDIO_RING *pRing, void **Addr)
+{
+	unsigned long Write = pRing->Producer.Pos;
+	unsigned long Free = pRing->Size - AudioRing_Distance (pRing, AudioRing_LoadAcquire (&pRing->Consumer.Pos), Write);
+	unsigned long Index = AudioRing_Index (pRing, Write);
+
+	*Addr = pRing->BufAddr + Index;
+
+	return (Free < pRing->Size - Index)? Free : pRing->Size - Index;
+}
+
+void AudioRing_WriteCommit (AUDIO_RING *pRing, unsigned long Size)
+{
+	unsigned long Pos = AudioRing_Advance (pRing, pRing->Producer.Pos, Size);
+
+	if (pRing->Wait != NULL)
+	{
+		AudioRing_Stamp (pRing, Pos);
+	}
+	AudioRing_StoreRelease (&pRing->Producer.Pos, Pos);
+	if (pRing->Wait != NULL)
+	{
+		AudioRing_Signal (pRing);
+	}
+}
+
+unsigned long AudioRing_Write (AUDIO_RING *pRing, const void *BufAddr, unsigned long Size)
+{
+	unsigned long	Done = 0;
+	unsigned long	Region;
+	void			*Addr;
+
+	// at most two regions, the second one starts at the buffer
+	while (Done < Size && (Region = AudioRing_WriteRegion (pRing, &Addr)) > 0)
+	{
+		if (Region > Size - Done)
+		{
+			Region = Size - Done;
+		}
+		memcpy (Addr, (const unsigned char *)BufAddr + Done, Region);
+		AudioRing_WriteCommit (pRing, Region);
+		Done += Region;
+	}
+
+	return Done;
+}
+
+int AudioRing_WriteBlock (AUDIO_RING *pRing, const void *BufAddr, unsigned long Size)
+{
+	if (pRing->Size - AudioRing_Distance (pRing, AudioRing_LoadAcquire (&pRing->Consumer.Pos), pRing->Producer.Pos) < Size)
+	{
+		AudioRing_NoteOverrun (pRing, Size);
+		return -1;
+	}
+
+	AudioRing_Write (pRing, BufAddr, Size);
+
+	return 0;
+}
+
+void AudioRing_NoteOverrun (AUDIO_RING *pRing, unsigned long Size)
+{
+	pRing->Producer.Runs++;
+	pRing->Producer.RunBytes += Size;
+}
+
+//----------------------------------------------------------------------------//
+unsigned long AudioRing_ReadRegion (AUDIO_RING *pRing, void **Addr)
+{
+	unsigned long Read = pRing->Consumer.Pos;
+	unsigned long Used = AudioRing_Distance (pRing, Read, AudioRing_LoadAcquire (&pRing->Producer.Pos));
+	unsigned long Index = AudioRing_Index (pRing, Read);
+
+	*Addr = pRing->BufAddr + Index;
+
+	return (Used < pRing->Size - Index)? Used : pRing->Size - Index;
+}
+
+void AudioRing_ReadCommit (AUDIO_RING *pRing, unsigned long Size)
+{
+	AudioRing_StoreRelease (&pRing->Consumer.Pos, AudioRing_Advance (pRing, pRing->Consumer.Pos, Size));
+}
+
+unsigned long AudioRing_Read (AUDIO_RING *pRing, void *BufAddr, unsigned long Size)
+{
+	unsigned long	Done = 0;
+	unsigned long	Region;
+	void			*Addr;
+
+	while (Done < Size && (Region = AudioRing_ReadRegion (pRing, &Addr)) > 0)
+	{
+		if (Region > Size - Done)
+		{
+			Region = Size - Done;
+		}
+		memcpy ((unsigned char *)BufAddr + Done, Addr, Region);
+		AudioRing_ReadCommit (pRing, Region);
+		Done += Region;
+	}
+
+	return Done;
+}
+
+int AudioRing_ReadBlock (AUDIO_RING *pRing, void *BufAddr, unsigned long Size)
+{
+	if (AudioRing_Distance (pRing, pRing->Consumer.Pos, AudioRing_LoadAcquire (&pRing->Producer.Pos)) < Size)
+	{
+		AudioRing_NoteUnderrun (pRing, Size);
+		return -1;
+	}
+
+	AudioRing_Read (pRing, BufAddr, Size);
+
+	return 0;
+}
+
+// a reader asking for more than the ring holds waits for a full ring
+long AudioRing_WaitData (AUDIO_RING *pRing, unsigned long Size, long TimeoutMs)
+{
+	AUDIO_RING_WAIT		*pWait = (AUDIO_RING_WAIT *)pRing->Wait;
+	unsigned long long	Deadline = 0;
+	unsigned long		Want = (Size < pRing->Size)? Size : pRing->Size;
+	long				Used;
+
+	if (pWait == NULL || pRing->Closing)
+	{
+		return -1;
+	}
+
+	Used = AudioRing_Used (pRing);
+	if ((unsigned long)Used < Want && TimeoutMs != 0)
+	{
+		if (TimeoutMs > 0)
+		{
+			Deadline = AudioRing_NowUs () + (unsigned long long)TimeoutMs * 1000;
+		}
+
+#if defined(_MSC_VER)
+		EnterCriticalSection (&pWait->Lock);
+#else
+		pthread_mutex_lock (&pWait->Lock);
+#endif
+		for (;;)
+		{
+			pRing->Consumer.Waiting = 1;
+			AudioRing_Fence ();
+			if (pRing->Closing)
+			{
+				Used = -1;
+				break;
+			}
+			Used = AudioRing_Used (pRing);
+			if ((unsigned long)Used >= Want || AudioRing_Sleep (pWait, Deadline) == -1)
+			{
+				break;
+			}
+		}
+		pRing->Consumer.Waiting = 0;
+#if defined(_MSC_VER)
+		LeaveCriticalSection (&pWait->Lock);
+#else
+		pthread_mutex_unlock (&pWait->Lock);
+#endif
+	}
+
+	return Used;
+}
+
+long AudioRing_ReadWait (AUDIO_RING *pRing, void *BufAddr, unsigned long Size, long TimeoutMs, AUDIO_IN_STAT *pStat)
+{
+	unsigned long		Done;
+
+	if (AudioRing_WaitData (pRing, Size, TimeoutMs) == -1)
+	{
+		return -1;
+	}
+
+	if (pStat != NULL)
+	{
+		pStat->Time = AudioRing_StampAt (pRing, pRing->Consumer.Pos);
+	}
+
+	Done = AudioRing_Read (pRing, BufAddr, Size);
+
+	if (pStat != NULL)
+	{
+		pStat->Queued = AudioRing_Used (pRing);
+		pStat->Overruns = pRing->Producer.Runs;
+		pStat->OverrunBytes = pRing->Producer.RunBytes;
+	}
+
+	return Done;
+}
+
+// a ring that was never fed, or stays dry, counts once and not every period
+void AudioRing_NoteUnderrun (AUDIO_RING *pRing, unsigned long Size)
+{
+	unsigned long Write = AudioRing_LoadAcquire (&pRing->Producer.Pos);
+
+	if (!pRing->Consumer.Stalled || Write != pRing->Consumer.StallPos)
+	{
+		pRing->Consumer.StallPos = Write;
+		pRing->Consumer.Stalled = 1;
+		pRing->Consumer.Runs++;
+	}
+	pRing->Consumer.RunBytes += Size;
+}
+
+void AudioRing_GetStat (AUDIO_RING *pRing, AUDIO_RING_STAT *pStat)
+{
+	pStat->Size = pRing->Size;
+	pStat->Used = AudioRing_Used (pRing);
+	pStat->Overruns = pRing->Producer.Runs;
+	pStat->OverrunBytes = pRing->Producer.RunBytes;
+	pStat->Underruns = pRing->Consumer.Runs;
+	pStat->UnderrunBytes = pRing->Consumer.RunBytes;
+}
@@ -0,0 +1,110 @@
+#ifndef _AUDIO_RING_H_
+#define _AUDIO_RING_H_
+
+// lock-free pcm ring of one producer and one consumer thread, shared by the
+// audio backends. positions run over twice the size, so a full ring and an
+// empty one differ and every byte of the buffer can be used. the two ends sit
+// on their own cache lines, each end only writes its own line.
+//
+// a stream is moved without an extra copy through regions: WriteRegion/ReadRegion
+// give the contiguous part at the position, the device or the caller fills or
+// drains it in place and Commit hands it to the other end.
+//
+// a capture ring with EnableWait lets the reader sleep in ReadWait until the
+// device thread commits enough, and stamps every commit with the time. WaitData
+// is the same sleep for a reader that drains the regions in place. Close wakes
+// that reader for good, the backend still has to keep the ring until its
+// readers are out before it destroys it.
+
+#include "CP_Audio.h"
+
+#define AUDIO_RING_CACHE_LINE		64
+
+typedef struct tagAUDIO_RING_END
+{
+	volatile unsigned long	Pos;				// 0 .. 2 * Size - 1, written by this end only
+	unsigned long			Runs;				// overruns on the producer end, underruns on the consumer end
+	unsigned long			RunBytes;			// bytes dropped by overruns, missed by underruns
+	unsigned long			StallPos;			// producer position at the last underrun
+	int						Stalled;			// StallPos is set
+
+	// producer end of a wait ring, the position and time of the last commit
+	// under a sequence count, odd while they change
+	volatile unsigned long	StampSeq;
+	volatile unsigned long	StampPos;
+	volatile unsigned long long	StampTime;
+
+	volatile unsigned long	Waiting;			// consumer end of a wait ring, asleep in ReadWait
+}AUDIO_RING_END;
+
+typedef struct tagAUDIO_RING
+{
+	unsigned char			*BufAddr;
+	unsigned long			Size;
+	int						Owned;				// BufAddr is part of the AudioRing_Create block
+	void					*Wait;				// EnableWait, the reader's sleep
+	unsigned long			BytesPerSec;
+	volatile int			Closing;			// set by Close, WaitData returns -1
+
+	char					Pad0[AUDIO_RING_CACHE_LINE];
+	AUDIO_RING_END			Producer;
+	char					Pad1[AUDIO_RING_CACHE_LINE];
+	AUDIO_RING_END			Consumer;
+	char					Pad2[AUDIO_RING_CACHE_LINE];
+}AUDIO_RING;
+
+typedef struct tagAUDIO_RING_STAT
+{
+	unsigned long			Size;
+	unsigned long			Used;
+	unsigned long			Overruns;			// blocks the producer could not put, dropped
+	unsigned long			OverrunBytes;
+	unsigned long			Underruns;			// times the consumer found the ring dry
+	unsigned long			UnderrunBytes;
+}AUDIO_RING_STAT;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// BufAddr is kept by the caller, Create allocates ring and buffer in one block
+int AudioRing_Init (AUDIO_RING *pRing, void *BufAddr, unsigned long Size);
+AUDIO_RING* AudioRing_Create (unsigned long Size);
+void AudioRing_Destroy (AUDIO_RING *pRing);
+
+// before either end runs. Destroy disables it, an Init ring has to itself
+int AudioRing_EnableWait (AUDIO_RING *pRing, unsigned long BytesPerSec);
+void AudioRing_DisableWait (AUDIO_RING *pRing);
+// wakes a reader asleep in WaitData/ReadWait, later waits return -1 at once
+void AudioRing_Close (AUDIO_RING *pRing);
+unsigned long long AudioRing_NowUs (void);
+
+// only while neither end runs
+void AudioRing_Reset (AUDIO_RING *pRing);
+
+unsigned long AudioRing_Used (AUDIO_RING *pRing);
+unsigned long AudioRing_Free (AUDIO_RING *pRing);
+
+// producer end
+unsigned long AudioRing_WriteRegion (AUDIO_RING *pRing, void **Addr);
+void AudioRing_WriteCommit (AUDIO_RING *pRing, unsigned long Size);
+unsigned long AudioRing_Write (AUDIO_RING *pRing, const void *BufAddr, unsigned long Size);
+int AudioRing_WriteBlock (AUDIO_RING *pRing, const void *BufAddr, unsigned long Size);
+void AudioRing_NoteOverrun (AUDIO_RING *pRing, unsigned long Size);
+
+// consumer end
+unsigned long AudioRing_ReadRegion (AUDIO_RING *pRing, void **Addr);
+void AudioRing_ReadCommit (AUDIO_RING *pRing, unsigned long Size);
+unsigned long AudioRing_Read (AUDIO_RING *pRing, void *BufAddr, unsigned long Size);
+int AudioRing_ReadBlock (AUDIO_RING *pRing, void *BufAddr, unsigned long Size);
+long AudioRing_WaitData (AUDIO_RING *pRing, unsigned long Size, long TimeoutMs);
+long AudioRing_ReadWait (AUDIO_RING *pRing, void *BufAddr, unsigned long Size, long TimeoutMs, AUDIO_IN_STAT *pStat);
+void AudioRing_NoteUnderrun (AUDIO_RING *pRing, unsigned long Size);
+
+void AudioRing_GetStat (AUDIO_RING *pRing, AUDIO_RING_STAT *pStat);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,750 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <k_global.h>
+#include "FileAudio.h"
+
+#define FILE_DebugPrint(...)			mus_printf ("[fileaudio] " __VA_ARGS__)
+
+#define FILE_AUDIO_SAMPLE_BYTES		2			// S16_LE
+#define FILE_AUDIO_PERIOD_FRAMES		1024		// push mode may run this far ahead of the clock
+#define FILE_AUDIO_WAV_HEADER_SIZE	44
+#define FILE_AUDIO_WAIT_MS			100
+
+typedef struct tagFILE_AUDIO_INFO
+{
+	FILE_AUDIO_PARAM		Param;
+
+	// the playback side is the clock of the capture side in free run mode
+	pthread_mutex_t			Mutex;
+	pthread_cond_t			Cond;
+	long long				OutFrames;
+	long long				InFrames;
+	unsigned long			OutRate;
+	int						OutOpened;
+
+	long long				InitUs;
+}FILE_AUDIO_INFO;
+
+typedef struct tagFILE_AUDIO_STREAM_INFO
+{
+	FILE_AUDIO_INFO			*pAudioInfo;
+	int						Capture;
+	unsigned long			Channels;
+	unsigned long			SampleRate;
+	unsigned long			FrameBytes;
+
+	FILE					*File;
+	int						Wav;
+	unsigned long			FileChannels;		// capture file may be mono for a stereo open and so on
+	long					DataStart;
+	unsigned long			DataBytes;
+	unsigned long			DataRead;			// bytes of the wav data chunk read since the last rewind
+
+	FuncAudioCallBack		CallBack;
+	void					*User;
+	unsigned char			*ProcBuf;
+	unsigned long			ProcFrames;
+	unsigned char			*FileBuf;			// capture file frames before channel mapping
+
+	pthread_t				Thread;
+	volatile int			ThreadExitFlag;
+
+	long long				StartUs;
+	long long				Frames;				// frames moved since open
+}FILE_AUDIO_STREAM_INFO;
+
+static FILE_AUDIO_PARAM gFileAudioParam =
+{
+	NULL,
+	NULL,
+	0,
+	0,
+};
+
+void FileAudio_SetParam (FILE_AUDIO_PARAM *Param)
+{
+	gFileAudioParam = *Param;
+}
+
+FILE_AUDIO_PARAM* FileAudio_GetParam (void)
+{
+	return &gFileAudioParam;
+}
+
+//----------------------------------------------------------------------------//
+static long long FileAudio_NowUs (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void FileAudio_SleepUntil (long long Us)
+{
+	struct timespec ts;
+	long long Wait = Us - FileAudio_NowUs ();
+
+	if (Wait <= 0)
+	{
+		return;
+	}
+	ts.tv_sec = Wait / 1000000;
+	ts.tv_nsec = (Wait % 1000000) * 1000;
+	while (nanosleep (&ts, &ts) == -1 && errno == EINTR)
+		;
+}
+
+static long long FileAudio_ClockFrames (FILE_AUDIO_STREAM_INFO *pStreamInfo)
+{
+	return (FileAudio_NowUs () - pStreamInfo->StartUs) * pStreamInfo->SampleRate / 1000000;
+}
+
+// playback frames so far, in capture frames
+static long long FileAudio_OutFramesAt (FILE_AUDIO_INFO *pAudioInfo, unsigned long Rate)
+{
+	return (pAudioInfo->OutRate != 0)? pAudioInfo->OutFrames * Rate / pAudioInfo->OutRate : 0;
+}
+
+//----------------------------------------------------------------------------//
+static void FileAudio_PutLE (unsigned char *Addr, unsigned long Value, int Bytes)
+{
+	int i;
+
+	for (i = 0; i < Bytes; i++)
+	{
+		Addr[i] = (unsigned char)(Value >> (i * 8));
+	}
+}
+
+static unsigned long FileAudio_GetLE (const unsigned char *Addr, int Bytes)
+{
+	unsigned long Value = 0;
+	int i;
+
+	for (i = Bytes - 1; i >= 0; i--)
+	{
+		Value = (Value << 8) | Addr[i];
+	}
+	return Value;
+}
+
+static void FileAudio_WavHeader (FILE_AUDIO_STREAM_INFO *pStreamInfo)
+{
+	unsigned char Header[FILE_AUDIO_WAV_HEADER_SIZE];
+
+	memcpy (Header, "RIFF", 4);
+	FileAudio_PutLE (Header + 4, 36 + pStreamInfo->DataBytes, 4);
+	memcpy (Header + 8, "WAVEfmt ", 8);
+	FileAudio_PutLE (Header + 16, 16, 4);
+	FileAudio_PutLE (Header + 20, 1, 2);
+	FileAudio_PutLE (Header + 22, pStreamInfo->Channels, 2);
+	FileAudio_PutLE (Header + 24, pStreamInfo->SampleRate, 4);
+	FileAudio_PutLE (Header + 28, pStreamInfo->SampleRate * pStreamInfo->FrameBytes, 4);
+	FileAudio_PutLE (Header + 32, pStreamInfo->FrameBytes, 2);
+	FileAudio_PutLE (Header + 34, FILE_AUDIO_SAMPLE_BYTES * 8, 2);
+	memcpy (Header + 36, "data", 4);
+	FileAudio_PutLE (Header + 40, pStreamInfo->DataBytes, 4);
+
+	fseek (pStreamInfo->File, 0, SEEK_SET);
+	fwrite (Header, 1, sizeof(Header), pStreamInfo->File);
+}
+
+// finds the data chunk of a 16 bit pcm wav, anything else is read as raw
+static void FileAudio_WavParse (FILE_AUDIO_STREAM_INFO *pStreamInfo)
+{
+	unsigned char	Chunk[16];
+	unsigned long	Size;
+	long			Pos = 12;
+
+	pStreamInfo->Wav = 0;
+	pStreamInfo->FileChannels = pStreamInfo->Channels;
+	pStreamInfo->DataStart = 0;
+
+	if (fread (Chunk, 1, 12, pStreamInfo->File) != 12 || memcmp (Chunk, "RIFF", 4) != 0 || memcmp (Chunk + 8, "WAVE", 4) != 0)
+	{
+		fseek (pStreamInfo->File, 0, SEEK_SET);
+		return;
+	}
+
+	while (fseek (pStreamInfo->File, Pos, SEEK_SET) == 0 && fread (Chunk, 1, 8, pStreamInfo->File) == 8)
+	{
+		Size = FileAudio_GetLE (Chunk + 4, 4);
+		if (memcmp (Chunk, "fmt ", 4) == 0 && Size >= 16 && fread (Chunk, 1, 16, pStreamInfo->File) == 16)
+		{
+			if (FileAudio_GetLE (Chunk + 14, 2) != FILE_AUDIO_SAMPLE_BYTES * 8)
+			{
+				FILE_DebugPrint ("only 16 bit wav input is supported\n");
+				break;
+			}
+			pStreamInfo->FileChannels = FileAudio_GetLE (Chunk + 2, 2);
+			if (pStreamInfo->FileChannels == 0)
+			{
+				break;
+			}
+			if (FileAudio_GetLE (Chunk + 4, 4) != pStreamInfo->SampleRate)
+			{
+				FILE_DebugPrint ("input is %lu Hz, read as %lu Hz\n", FileAudio_GetLE (Chunk + 4, 4), pStreamInfo->SampleRate);
+			}
+		}
+		else if (memcmp (Chunk, "data", 4) == 0)
+		{
+			pStreamInfo->Wav = 1;
+			pStreamInfo->DataStart = Pos + 8;
+			pStreamInfo->DataBytes = Size;
+			return;
+		}
+		Pos += 8 + Size + (Size & 1);
+	}
+
+	pStreamInfo->FileChannels = pStreamInfo->Channels;
+	fseek (pStreamInfo->File, 0, SEEK_SET);
+}
+
+//----------------------------------------------------------------------------//
+static void FileAudio_WritePcm (FILE_AUDIO_STREAM_INFO *pStreamInfo, const unsigned char *BufAddr, unsigned long Frames)
+{
+	if (pStreamInfo->File != NULL)
+	{
+		pStreamInfo->DataBytes += fwrite (BufAddr, pStreamInfo->FrameBytes, Frames, pStreamInfo->File) * pStreamInfo->FrameBytes;
+	}
+}
+
+static void FileAudio_ReadPcm (FILE_AUDIO_STREAM_INFO *pStreamInfo, unsigned char *BufAddr, unsigned long Frames)
+{
+	unsigned long	FileFrameBytes = pStreamInfo->FileChannels * FILE_AUDIO_SAMPLE_BYTES;
+	unsigned long	Done = 0, Got, i, c;
+	short			*In, *Out;
+	int				Rewound = 0;
+
+	// the file buffer holds one period, a wav stops at the end of its data
+	// chunk so trailing chunks are not played as audio
+	while (pStreamInfo->File != NULL && Done < Frames)
+	{
+		Got = (Frames - Done > FILE_AUDIO_PERIOD_FRAMES)? FILE_AUDIO_PERIOD_FRAMES : Frames - Done;
+		if (pStreamInfo->Wav && Got > (pStreamInfo->DataBytes - pStreamInfo->DataRead) / FileFrameBytes)
+		{
+			Got = (pStreamInfo->DataBytes - pStreamInfo->DataRead) / FileFrameBytes;
+		}
+		if (Got != 0)
+		{
+			Got = fread (pStreamInfo->FileBuf, FileFrameBytes, Got, pStreamInfo->File);
+		}
+		if (Got == 0)
+		{
+			if (pStreamInfo->pAudioInfo->Param.Loop == 0 || Rewound || fseek (pStreamInfo->File, pStreamInfo->DataStart, SEEK_SET) != 0)
+			{
+				break;
+			}
+			pStreamInfo->DataRead = 0;
+			Rewound = 1;
+			continue;
+		}
+		pStreamInfo->DataRead += Got * FileFrameBytes;
+		Rewound = 0;
+
+		if (pStreamInfo->FileChannels == pStreamInfo->Channels)
+		{
+			memcpy (BufAddr + Done * pStreamInfo->FrameBytes, pStreamInfo->FileBuf, Got * FileFrameBytes);
+		}
+		else
+		{
+			// extra output channels repeat the last file channel, extra file channels are dropped
+			In = (short *)pStreamInfo->FileBuf;
+			Out = (short *)(BufAddr + Done * pStreamInfo->FrameBytes);
+			for (i = 0; i < Got; i++)
+			{
+				for (c = 0; c < pStreamInfo->Channels; c++)
+				{
+					Out[i * pStreamInfo->Channels + c] = In[i * pStreamInfo->FileChannels + ((c < pStreamInfo->FileChannels)? c : pStreamInfo->FileChannels - 1)];
+				}
+			}
+		}
+		Done += Got;
+	}
+
+	memset (BufAddr + Done * pStreamInfo->FrameBytes, 0, (Frames - Done) * pStreamInfo->FrameBytes);
+}
+
+//----------------------------------------------------------------------------//
+static void FileAudio_AddFrames (FILE_AUDIO_STREAM_INFO *pStreamInfo, unsigned long Frames)
+{
+	FILE_AUDIO_INFO *pAudioInfo = pStreamInfo->pAudioInfo;
+
+	pthread_mutex_lock (&pAudioInfo->Mutex);
+	pStreamInfo->Frames += Frames;
+	if (pStreamInfo->Capture)
+	{
+		pAudioInfo->InFrames += Frames;
+	}
+	else
+	{
+		pAudioInfo->OutFrames += Frames;
+		pthread_cond_broadcast (&pAudioInfo->Cond);
+	}
+	pthread_mutex_unlock (&pAudioInfo->Mutex);
+}
+
+// frames the stream may move now. real time follows the wall clock, free run
+// playback is never held, free run capture keeps behind the playback side
+static long long FileAudio_Budget (FILE_AUDIO_STREAM_INFO *pStreamInfo, unsigned long Ahead)
+{
+	FILE_AUDIO_INFO *pAudioInfo = pStreamInfo->pAudioInfo;
+	long long Budget;
+
+	if (pAudioInfo->Param.FreeRun == 0)
+	{
+		Budget = FileAudio_ClockFrames (pStreamInfo) + Ahead;
+	}
+	else if (pStreamInfo->Capture && pAudioInfo->OutOpened)
+	{
+		Budget = FileAudio_OutFramesAt (pAudioInfo, pStreamInfo->SampleRate);
+	}
+	else
+	{
+		return 0x7fffffff;
+	}
+
+	Budget -= pStreamInfo->Frames;
+	return (Budget > 0)? Budget : 0;
+}
+
+// waits until the stream may move Frames frames, 0 - go, -1 - closing or
+// DeadlineUs passed, 0 waits for ever
+static int FileAudio_Wait (FILE_AUDIO_STREAM_INFO *pStreamInfo, unsigned long Frames, unsigned long Ahead, long long DeadlineUs)
+{
+	FILE_AUDIO_INFO	*pAudioInfo = pStreamInfo->pAudioInfo;
+	struct timespec	ts;
+	long long		Budget;
+	long long		Due;
+	long long		WaitUs;
+
+	while (pStreamInfo->ThreadExitFlag == 0)
+	{
+		pthread_mutex_lock (&pAudioInfo->Mutex);
+		Budget = FileAudio_Budget (pStreamInfo, Ahead);
+		pthread_mutex_unlock (&pAudioInfo->Mutex);
+		if (Budget >= (long long)Frames)
+		{
+			return 0;
+		}
+
+		if (DeadlineUs != 0 && FileAudio_NowUs () >= DeadlineUs)
+		{
+			return -1;
+		}
+
+		if (pAudioInfo->Param.FreeRun == 0)
+		{
+			Due = pStreamInfo->StartUs + (pStreamInfo->Frames + Frames - Ahead) * 1000000 / pStreamInfo->SampleRate;
+			FileAudio_SleepUntil ((DeadlineUs != 0 && DeadlineUs < Due)? DeadlineUs : Due);
+			continue;
+		}
+
+		// free run capture, wait for the playback side to move on
+		WaitUs = FILE_AUDIO_WAIT_MS * 1000;
+		if (DeadlineUs != 0 && DeadlineUs - FileAudio_NowUs () < WaitUs)
+		{
+			WaitUs = DeadlineUs - FileAudio_NowUs ();
+		}
+		clock_gettime (CLOCK_REALTIME, &ts);
+		ts.tv_nsec += (WaitUs > 0)? WaitUs * 1000 : 0;
+		ts.tv_sec += ts.tv_nsec / 1000000000;
+		ts.tv_nsec %= 1000000000;
+		pthread_mutex_lock (&pAudioInfo->Mutex);
+		if (FileAudio_Budget (pStreamInfo, Ahead) < (long long)Frames)
+		{
+			pthread_cond_timedwait (&pAudioInfo->Cond, &pAudioInfo->Mutex, &ts);
+		}
+		pthread_mutex_unlock (&pAudioInfo->Mutex);
+	}
+
+	return -1;
+}
+
+//----------------------------------------------------------------------------//
+static void* FileAudio_Thread (void *Data)
+{
+	FILE_AUDIO_STREAM_INFO	*pStreamInfo = (FILE_AUDIO_STREAM_INFO *)Data;
+	unsigned long			ProcSize = pStreamInfo->ProcFrames * pStreamInfo->FrameBytes;
+
+	// playback hands out a period when the previous one is due, capture when
+	// the period has been "recorded"
+	while (FileAudio_Wait (pStreamInfo, pStreamInfo->ProcFrames, pStreamInfo->Capture? 0 : pStreamInfo->ProcFrames, 0) == 0)
+	{
+		if (pStreamInfo->Capture)
+		{
+			FileAudio_ReadPcm (pStreamInfo, pStreamInfo->ProcBuf, pStreamInfo->ProcFrames);
+			pStreamInfo->CallBack (pStreamInfo->User, pStreamInfo->ProcBuf);
+		}
+		else
+		{
+			memset (pStreamInfo->ProcBuf, 0, ProcSize);
+			pStreamInfo->CallBack (pStreamInfo->User, pStreamInfo->ProcBuf);
+			FileAudio_WritePcm (pStreamInfo, pStreamInfo->ProcBuf, pStreamInfo->ProcFrames);
+		}
+		FileAudio_AddFrames (pStreamInfo, pStreamInfo->ProcFrames);
+	}
+
+	return NULL;
+}
+
+//----------------------------------------------------------------------------//
+static FILE_AUDIO_STREAM_INFO* FileAudio_StreamOpen (AUDIO_HANDLE Handle, AUDIO_PARAM *Param, int Capture)
+{
+	FILE_AUDIO_INFO			*pAudioInfo = (FILE_AUDIO_INFO *)Handle;
+	FILE_AUDIO_STREAM_INFO	*pStreamInfo;
+	const char				*Name;
+	unsigned long			Len;
+
+	if (pAudioInfo == NULL || Param == NULL || Param->Channels == 0 || Param->SampleRate == 0)
+	{
+		return NULL;
+	}
+
+	pStreamInfo = (FILE_AUDIO_STREAM_INFO *)calloc (1, sizeof(FILE_AUDIO_STREAM_INFO));
+	if (pStreamInfo == NULL)
+	{
+		return NULL;
+	}
+
+	pStreamInfo->pAudioInfo = pAudioInfo;
+	pStreamInfo->Capture = Capture;
+	pStreamInfo->Channels = Param->Channels;
+	pStreamInfo->SampleRate = Param->SampleRate;
+	pStreamInfo->FrameBytes = Param->Channels * FILE_AUDIO_SAMPLE_BYTES;
+	pStreamInfo->FileChannels = Param->Channels;
+	pStreamInfo->CallBack = Param->CallBack;
+	pStreamInfo->User = Param->User;
+	pStreamInfo->ProcFrames = (Param->CallBack != NULL && Param->FrameCount != 0)? Param->FrameCount : FILE_AUDIO_PERIOD_FRAMES;
+
+	Name = Capture? pAudioInfo->Param.InFile : pAudioInfo->Param.OutFile;
+	if (Name != NULL)
+	{
+		pStreamInfo->File = fopen (Name, Capture? "rb" : "wb");
+		if (pStreamInfo->File == NULL)
+		{
+			FILE_DebugPrint ("can not open %s: %s\n", Name, strerror (errno));
+			free (pStreamInfo);
+			return NULL;
+		}
+		if (Capture)
+		{
+			FileAudio_WavParse (pStreamInfo);
+		}
+		else
+		{
+			Len = strlen (Name);
+			pStreamInfo->Wav = (Len > 4 && strcasecmp (Name + Len - 4, ".wav") == 0);
+			if (pStreamInfo->Wav)
+			{
+				FileAudio_WavHeader (pStreamInfo);
+			}
+		}
+	}
+
+	pStreamInfo->ProcBuf = (unsigned char *)malloc (pStreamInfo->ProcFrames * pStreamInfo->FrameBytes +
+		FILE_AUDIO_PERIOD_FRAMES * pStreamInfo->FileChannels * FILE_AUDIO_SAMPLE_BYTES);
+	if (pStreamInfo->ProcBuf == NULL)
+	{
+		if (pStreamInfo->File != NULL) fclose (pStreamInfo->File);
+		free (pStreamInfo);
+		return NULL;
+	}
+	pStreamInfo->FileBuf = pStreamInfo->ProcBuf + pStreamInfo->ProcFrames * pStreamInfo->FrameBytes;
+
+	if (Capture == 0)
+	{
+		pthread_mutex_lock (&pAudioInfo->Mutex);
+		pAudioInfo->OutRate = pStreamInfo->SampleRate;
+		pAudioInfo->OutOpened = 1;
+		pthread_mutex_unlock (&pAudioInfo->Mutex);
+	}
+
+	pStreamInfo->StartUs = FileAudio_NowUs ();
+	if (Param->CallBack != NULL && pthread_create (&pStreamInfo->Thread, NULL, FileAudio_Thread, pStreamInfo) != 0)
+	{
+		if (pStreamInfo->File != NULL) fclose (pStreamInfo->File);
+		free (pStreamInfo->ProcBuf);
+		free (pStreamInfo);
+		return NULL;
+	}
+
+	return pStreamInfo;
+}
+
+static long FileAudio_StreamClose (FILE_AUDIO_STREAM_INFO *pStreamInfo)
+{
+	FILE_AUDIO_INFO *pAudioInfo = pStreamInfo->pAudioInfo;
+
+	if (pStreamInfo->CallBack != NULL)
+	{
+		pStreamInfo->ThreadExitFlag = 1;
+		pthread_mutex_lock (&pAudioInfo->Mutex);
+		pthread_cond_broadcast (&pAudioInfo->Cond);
+		pthread_mutex_unlock (&pAudioInfo->Mutex);
+		pthread_join (pStreamInfo->Thread, NULL);
+	}
+
+	if (pStreamInfo->Capture == 0)
+	{
+		pthread_mutex_lock (&pAudioInfo->Mutex);
+		pAudioInfo->OutOpened = 0;
+		pthread_cond_broadcast (&pAudioInfo->Cond);
+		pthread_mutex_unlock (&pAudioInfo->Mutex);
+	}
+
+	if (pStreamInfo->File != NULL)
+	{
+		if (pStreamInfo->Capture == 0 && pStreamInfo->Wav)
+		{
+			FileAudio_WavHeader (pStreamInfo);
+		}
+		fclose (pStreamInfo->File);
+	}
+
+	free (pStreamInfo->ProcBuf);
+	free (pStreamInfo);
+
+	return 0;
+}
+
+//----------------------------------------------------------------------------//
+AUDIO_IN_HANDLE FileAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
+{
+	return (AUDIO_IN_HANDLE)FileAudio_StreamOpen (Handle, Param, 1);
+}
+
+long FileAudioIn_Close (AUDIO_IN_HANDLE Handle)
+{
+	return FileAudio_StreamClose ((FILE_AUDIO_STREAM_INFO *)Handle);
+}
+
+long FileAudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size)
+{
+	FILE_AUDIO_STREAM_INFO	*pStreamInfo = (FILE_AUDIO_STREAM_INFO *)Handle;
+	long long				Frames = Size / pStreamInfo->FrameBytes;
+	long long				Budget;
+
+	if (pStreamInfo->CallBack != NULL)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock (&pStreamInfo->pAudioInfo->Mutex);
+	Budget = FileAudio_Budget (pStreamInfo, 0);
+	pthread_mutex_unlock (&pStreamInfo->pAudioInfo->Mutex);
+	if (Frames > Budget)
+	{
+		Frames = Budget;
+	}
+
+	FileAudio_ReadPcm (pStreamInfo, (unsigned char *)BufAddr, Frames);
+	FileAudio_AddFrames (pStreamInfo, Frames);
+
+	return Frames * pStreamInfo->FrameBytes;
+}
+
+// sleeps on the device clock instead of being polled, the time of a frame is
+// when the clock reached it
+long FileAudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat)
+{
+	FILE_AUDIO_STREAM_INFO	*pStreamInfo = (FILE_AUDIO_STREAM_INFO *)Handle;
+	long long				Frames = Size / pStreamInfo->FrameBytes;
+	long long				Budget;
+
+	if (pStreamInfo->CallBack != NULL)
+	{
+		return -1;
+	}
+
+	if (Timeout != 0)
+	{
+		FileAudio_Wait (pStreamInfo, (unsigned long)Frames, 0, (Timeout > 0)? FileAudio_NowUs () + (long long)Timeout * 1000 : 0);
+	}
+
+	pthread_mutex_lock (&pStreamInfo->pAudioInfo->Mutex);
+	Budget = FileAudio_Budget (pStreamInfo, 0);
+	pthread_mutex_unlock (&pStreamInfo->pAudioInfo->Mutex);
+	if (Frames > Budget)
+	{
+		Frames = Budget;
+	}
+
+	if (pStat != NULL)
+	{
+		pStat->Time = pStreamInfo->StartUs + pStreamInfo->Frames * 1000000 / pStreamInfo->SampleRate;
+		pStat->Queued = (unsigned long)(((Budget - Frames) * pStreamInfo->FrameBytes < 0x7fffffff)? (Budget - Frames) * pStreamInfo->FrameBytes : 0x7fffffff);
+		pStat->Overruns = 0;
+		pStat->OverrunBytes = 0;
+	}
+
+	FileAudio_ReadPcm (pStreamInfo, (unsigned char *)BufAddr, Frames);
+	FileAudio_AddFrames (pStreamInfo, Frames);
+
+	return Frames * pStreamInfo->FrameBytes;
+}
+
+AUDIO_OUT_HANDLE FileAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
+{
+	return (AUDIO_OUT_HANDLE)FileAudio_StreamOpen (Handle, Param, 0);
+}
+
+long FileAudioOut_Close (AUDIO_OUT_HANDLE Handle)
+{
+	return FileAudio_StreamClose ((FILE_AUDIO_STREAM_INFO *)Handle);
+}
+
+long FileAudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size)
+{
+	FILE_AUDIO_STREAM_INFO	*pStreamInfo = (FILE_AUDIO_STREAM_INFO *)Handle;
+	long long				Frames = Size / pStreamInfo->FrameBytes;
+	long long				Budget;
+
+	if (pStreamInfo->CallBack != NULL)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock (&pStreamInfo->pAudioInfo->Mutex);
+	Budget = FileAudio_Budget (pStreamInfo, FILE_AUDIO_PERIOD_FRAMES);
+	pthread_mutex_unlock (&pStreamInfo->pAudioInfo->Mutex);
+	if (Frames > Budget)
+	{
+		Frames = Budget;
+	}
+
+	FileAudio_WritePcm (pStreamInfo, (const unsigned char *)BufAddr, Frames);
+	FileAudio_AddFrames (pStreamInfo, Frames);
+
+	return Frames * pStreamInfo->FrameBytes;
+}
+
+//----------------------------------------------------------------------------//
+int FileAudio_Set (AUDIO_HANDLE Handle, int Cmd, int Data)
+{
+	FILE_AUDIO_INFO *pAudioInfo = (FILE_AUDIO_INFO *)Handle;
+
+	if (pAudioInfo == NULL)
+	{
+		return -1;
+	}
+
+	switch (Cmd)
+	{
+	case FILE_AUDIO_CMD_SET_FREE_RUN:
+		pthread_mutex_lock (&pAudioInfo->Mutex);
+		pAudioInfo->Param.FreeRun = (Data != 0);
+		pthread_cond_broadcast (&pAudioInfo->Cond);
+		pthread_mutex_unlock (&pAudioInfo->Mutex);
+		break;
+
+	default:
+		// no mixer behind these devices, volumes are accepted and ignored
+		break;
+	}
+
+	return 0;
+}
+
+int FileAudio_Get (AUDIO_HANDLE Handle, int Cmd, int *Data)
+{
+	FILE_AUDIO_INFO	*pAudioInfo = (FILE_AUDIO_INFO *)Handle;
+	int				Result = 0;
+
+	if (pAudioInfo == NULL || Data == NULL)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock (&pAudioInfo->Mutex);
+	switch (Cmd)
+	{
+	case FILE_AUDIO_CMD_GET_OUT_FRAMES:
+		*Data = (int)pAudioInfo->OutFrames;
+		break;
+
+	case FILE_AUDIO_CMD_GET_IN_FRAMES:
+		*Data = (int)pAudioInfo->InFrames;
+		break;
+
+	case FILE_AUDIO_CMD_GET_OUT_MS:
+		*Data = (pAudioInfo->OutRate != 0)? (int)(pAudioInfo->OutFrames * 1000 / pAudioInfo->OutRate) : 0;
+		break;
+
+	default:
+		Result = -1;
+		break;
+	}
+	pthread_mutex_unlock (&pAudioInfo->Mutex);
+
+	return Result;
+}
+
+//----------------------------------------------------------------------------//
+static AUDIO_HANDLE FileAudio_Create (FILE_AUDIO_PARAM *Param)
+{
+	FILE_AUDIO_INFO *pAudioInfo;
+
+	pAudioInfo = (FILE_AUDIO_INFO *)calloc (1, sizeof(FILE_AUDIO_INFO));
+	if (pAudioInfo == NULL)
+	{
+		return NULL;
+	}
+
+	pAudioInfo->Param = *Param;
+	pthread_mutex_init (&pAudioInfo->Mutex, NULL);
+	pthread_cond_init (&pAudioInfo->Cond, NULL);
+	pAudioInfo->InitUs = FileAudio_NowUs ();
+
+	FILE_DebugPrint ("init, in %s, out %s, %s\n", (Param->InFile != NULL)? Param->InFile : "silence",
+		(Param->OutFile != NULL)? Param->OutFile : "discard", Param->FreeRun? "free run" : "real time");
+
+	return (AUDIO_HANDLE)pAudioInfo;
+}
+
+AUDIO_HANDLE NullAudio_Init (int samplerate)
+{
+	FILE_AUDIO_PARAM Param = gFileAudioParam;
+
+	Param.InFile = NULL;
+	Param.OutFile = NULL;
+	return FileAudio_Create (&Param);
+}
+
+AUDIO_HANDLE FileAudio_Init (int samplerate)
+{
+	return FileAudio_Create (&gFileAudioParam);
+}
+
+int FileAudio_Finish (AUDIO_HANDLE Handle)
+{
+	FILE_AUDIO_INFO	*pAudioInfo = (FILE_AUDIO_INFO *)Handle;
+	long long		Us;
+
+	if (pAudioInfo == NULL)
+	{
+		return -1;
+	}
+
+	// the regression timing line
+	Us = FileAudio_NowUs () - pAudioInfo->InitUs;
+	if (pAudioInfo->OutRate != 0)
+	{
+		FILE_DebugPrint ("played %lld ms of audio in %lld ms, x%.1f real time\n", pAudioInfo->OutFrames * 1000 / pAudioInfo->OutRate,
+			Us / 1000, (Us > 0)? pAudioInfo->OutFrames * 1000000.0 / pAudioInfo->OutRate / Us : 0.0);
+	}
+
+	pthread_cond_destroy (&pAudioInfo->Cond);
+	pthread_mutex_destroy (&pAudioInfo->Mutex);
+	free (pAudioInfo);
+
+	return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef _FILE_AUDIO_H_
+#define _FILE_AUDIO_H_
+
+#include "CP_Audio.h"
+
+// headless audio devices. the null device discards output and reads silence,
+// the file device writes output to a wav/raw file and reads the mic from one.
+// in free run mode nothing waits for the wall clock, so a song renders as fast
+// as the player can decode, mix and score it
+typedef struct tagFILE_AUDIO_PARAM
+{
+	const char		*InFile;			// mic input, wav or raw S16_LE, NULL reads silence
+	const char		*OutFile;			// output, wav header if the name ends in .wav, raw otherwise, NULL discards
+	int				FreeRun;			// 1 - run faster than real time, the capture side follows the playback side
+	int				Loop;				// 1 - mic input starts over at the end of the file, silence otherwise
+}FILE_AUDIO_PARAM;
+
+// commands of FileAudio_Set/FileAudio_Get, kept clear of CP_AUDIO_CMD
+typedef enum tagFILE_AUDIO_CMD
+{
+	FILE_AUDIO_CMD_SET_FREE_RUN = 0x1100,
+	FILE_AUDIO_CMD_GET_OUT_FRAMES,				// frames played since init
+	FILE_AUDIO_CMD_GET_IN_FRAMES,				// frames captured since init
+	FILE_AUDIO_CMD_GET_OUT_MS,					// audio time played since init
+}FILE_AUDIO_CMD;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+void FileAudio_SetParam (FILE_AUDIO_PARAM *Param);
+FILE_AUDIO_PARAM* FileAudio_GetParam (void);
+
+int FileAudio_Set (AUDIO_HANDLE Handle, int Cmd, int Data);
+int FileAudio_Get (AUDIO_HANDLE Handle, int Cmd, int *Data);
+
+AUDIO_IN_HANDLE FileAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
+long FileAudioIn_Close (AUDIO_IN_HANDLE Handle);
+long FileAudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size);
+long FileAudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat);
+
+AUDIO_OUT_HANDLE FileAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
+long FileAudioOut_Close (AUDIO_OUT_HANDLE Handle);
+long FileAudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size);
+
+AUDIO_HANDLE NullAudio_Init (int samplerate);
+AUDIO_HANDLE FileAudio_Init (int samplerate);
+int FileAudio_Finish (AUDIO_HANDLE Handle);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
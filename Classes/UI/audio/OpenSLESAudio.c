@@ -8,6 +8,7 @@
 #include <SLES/OpenSLES_Android.h>
 
 #include "OpenSLESAudio.h"
+#include "AudioRing.h"
 
 #include <android/log.h>
 #define  LOG_TAG    "AUDIOP"
@@ -32,9 +33,8 @@ typedef struct tagOPENSLES_AUDIO_SRC_INFO
 	FuncAudioCallBack				CallBack;
 	void							*User;
 
-	unsigned char					*BufAddr;
-	unsigned long					Read;
-	unsigned long					Write;
+	AUDIO_RING						Ring;				// read mode, recorded in place
+	int								RingQueued;			// the enqueued buffer is the ring, not recorderBuffer
 }OPENSLES_AUDIO_SRC_INFO;
 
 typedef struct tagOPENSLES_AUDIO_SINK_INFO
@@ -55,9 +55,8 @@ typedef struct tagOPENSLES_AUDIO_SINK_INFO
 	FuncAudioCallBack				CallBack;
 	void							*User;
 
-	unsigned char					*BufAddr;
-	unsigned long					Read;
-	unsigned long					Write;
+	AUDIO_RING						Ring;				// write mode, played in place
+	unsigned long					RingQueued;			// ring bytes enqueued, handed back once played
 }OPENSLES_AUDIO_SINK_INFO;
 
 typedef struct tagOPENSLES_AUDIO_INFO
@@ -74,9 +73,26 @@ typedef struct tagOPENSLES_AUDIO_INFO
 // aux effect on the output mix, used by the buffer queue player
 static const SLEnvironmentalReverbSettings reverbSettings = SL_I3DL2_ENVIRONMENT_PRESET_STONECORRIDOR;
 
+// read mode records straight into the ring, recorderBuffer only takes a block
+// that does not fit and is dropped
+static unsigned char* OpenSLESAudioSrc_NextBuffer (OPENSLES_AUDIO_SRC_INFO *pAudioSrcInfo)
+{
+	void *Addr;
+
+	if (pAudioSrcInfo->CallBack == NULL && AudioRing_WriteRegion (&pAudioSrcInfo->Ring, &Addr) >= pAudioSrcInfo->recorderBufferSize)
+	{
+		pAudioSrcInfo->RingQueued = 1;
+		return (unsigned char *)Addr;
+	}
+
+	pAudioSrcInfo->RingQueued = 0;
+	return pAudioSrcInfo->recorderBuffer;
+}
+
 void OpenSLESAudioSrc_Callback (SLAndroidSimpleBufferQueueItf bq, void *context)
 {
 	OPENSLES_AUDIO_SRC_INFO *pAudioSrcInfo = (OPENSLES_AUDIO_SRC_INFO *)context;
+	unsigned char *QueueBuffer;
 	SLresult result;
 
 	if (NULL == pAudioSrcInfo)
@@ -93,14 +109,13 @@ void OpenSLESAudioSrc_Callback (SLAndroidSimpleBufferQueueItf bq, void *context)
 
 	if (pAudioSrcInfo->CallBack == NULL)
 	{
-		memcpy (pAudioSrcInfo->BufAddr + pAudioSrcInfo->Write, pAudioSrcInfo->recorderBuffer, pAudioSrcInfo->recorderBufferSize);
-		if (pAudioSrcInfo->Write + pAudioSrcInfo->recorderBufferSize == OPENSLES_AUDIO_BUF_SIZE)
+		if (pAudioSrcInfo->RingQueued)
 		{
-			pAudioSrcInfo->Write = 0;
+			AudioRing_WriteCommit (&pAudioSrcInfo->Ring, pAudioSrcInfo->recorderBufferSize);
 		}
 		else
 		{
-			pAudioSrcInfo->Write += pAudioSrcInfo->recorderBufferSize;
+			AudioRing_NoteOverrun (&pAudioSrcInfo->Ring, pAudioSrcInfo->recorderBufferSize);
 		}
 	}
 	else
@@ -108,7 +123,8 @@ void OpenSLESAudioSrc_Callback (SLAndroidSimpleBufferQueueItf bq, void *context)
 		pAudioSrcInfo->CallBack (pAudioSrcInfo->User, pAudioSrcInfo->recorderBuffer);
 	}
 
-    result = (*pAudioSrcInfo->recorderBufferQueue)->Enqueue (pAudioSrcInfo->recorderBufferQueue, pAudioSrcInfo->recorderBuffer,
+	QueueBuffer = OpenSLESAudioSrc_NextBuffer (pAudioSrcInfo);
+    result = (*pAudioSrcInfo->recorderBufferQueue)->Enqueue (pAudioSrcInfo->recorderBufferQueue, QueueBuffer,
             pAudioSrcInfo->recorderBufferSize);
 	if (SL_RESULT_SUCCESS != result)
 	{
@@ -198,7 +214,7 @@ static long OpenSLESAudioSrc_Open (OPENSLES_AUDIO_INFO *pAudioInfo, OPENSLES_AUD
 
     // enqueue an empty buffer to be filled by the recorder
     // (for streaming recording, we would enqueue at least 2 empty buffers to start things off)
-    result = (*pAudioSrcInfo->recorderBufferQueue)->Enqueue(pAudioSrcInfo->recorderBufferQueue, pAudioSrcInfo->recorderBuffer,
+    result = (*pAudioSrcInfo->recorderBufferQueue)->Enqueue(pAudioSrcInfo->recorderBufferQueue, OpenSLESAudioSrc_NextBuffer (pAudioSrcInfo),
             pAudioSrcInfo->recorderBufferSize);
     // the most likely other result is SL_RESULT_BUFFER_INSUFFICIENT,
     // which for this code example would indicate a programming error
@@ -275,9 +291,12 @@ AUDIO_IN_HANDLE OpenSLESAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 		pAudioSrcInfo->CallBack = NULL;
 		pAudioSrcInfo->recorderBuffer = (unsigned char *)pAudioSrcInfo + sizeof(OPENSLES_AUDIO_SRC_INFO);
 		pAudioSrcInfo->recorderBufferSize = OPENSLES_AUDIO_PROC_SIZE;
-		pAudioSrcInfo->BufAddr = pAudioSrcInfo->recorderBuffer + OPENSLES_AUDIO_PROC_SIZE;
-		pAudioSrcInfo->Read = 0;
-		pAudioSrcInfo->Write = 0;
+		AudioRing_Init (&pAudioSrcInfo->Ring, pAudioSrcInfo->recorderBuffer + OPENSLES_AUDIO_PROC_SIZE, OPENSLES_AUDIO_BUF_SIZE);
+		if (AudioRing_EnableWait (&pAudioSrcInfo->Ring, Param->SampleRate * Param->Channels * 2) == -1)
+		{
+			free (pAudioSrcInfo);
+			return NULL;
+		}
 	}
 	else
 	{
@@ -290,6 +309,10 @@ AUDIO_IN_HANDLE OpenSLESAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 	Ret = OpenSLESAudioSrc_Open (pAudioInfo, pAudioSrcInfo);
 	if (Ret != 0)
 	{
+		if (pAudioSrcInfo->CallBack == NULL)
+		{
+			AudioRing_DisableWait (&pAudioSrcInfo->Ring);
+		}
 		free (pAudioSrcInfo);
 		pAudioSrcInfo = NULL;
 	}
@@ -308,6 +331,10 @@ long OpenSLESAudioIn_Close (AUDIO_IN_HANDLE Handle)
 		return -1;
 	}
 
+	if (pAudioSrcInfo->CallBack == NULL)
+	{
+		AudioRing_DisableWait (&pAudioSrcInfo->Ring);
+	}
 	free (pAudioSrcInfo);
 
 	return 0;
@@ -316,36 +343,66 @@ long OpenSLESAudioIn_Close (AUDIO_IN_HANDLE Handle)
 long OpenSLESAudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size)
 {
 	OPENSLES_AUDIO_SRC_INFO *pOpenSLESAudioSrcInfo = (OPENSLES_AUDIO_SRC_INFO *)Handle;
-	unsigned long Write, Free;
 
-	Write = pOpenSLESAudioSrcInfo->Write;
-	if (Write < pOpenSLESAudioSrcInfo->Read)
+	return AudioRing_Read (&pOpenSLESAudioSrcInfo->Ring, BufAddr, Size);
+}
+
+// the buffer queue callback commits each recorded block and wakes the reader
+long OpenSLESAudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat)
+{
+	OPENSLES_AUDIO_SRC_INFO *pOpenSLESAudioSrcInfo = (OPENSLES_AUDIO_SRC_INFO *)Handle;
+
+	if (pOpenSLESAudioSrcInfo->CallBack != NULL)
 	{
-		Free = Write + OPENSLES_AUDIO_BUF_SIZE - pOpenSLESAudioSrcInfo->Read;
+		return -1;
 	}
-	else
+
+	return AudioRing_ReadWait (&pOpenSLESAudioSrcInfo->Ring, BufAddr, Size, Timeout, pStat);
+}
+
+long OpenSLESAudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	OPENSLES_AUDIO_SRC_INFO *pOpenSLESAudioSrcInfo = (OPENSLES_AUDIO_SRC_INFO *)Handle;
+
+	if (pOpenSLESAudioSrcInfo->CallBack != NULL)
 	{
-		Free = Write - pOpenSLESAudioSrcInfo->Read;
+		return -1;
 	}
 
-	if (Free < Size)
+	AudioRing_GetStat (&pOpenSLESAudioSrcInfo->Ring, pStat);
+
+	return 0;
+}
+
+// write mode plays the ring in place, the block is handed back to the writer
+// when the next one is asked for. a dry ring plays silence from playerBuffer
+static unsigned char* OpenSLESAudioSink_NextBuffer (OPENSLES_AUDIO_SINK_INFO *pAudioSinkInfo)
+{
+	void *Addr;
+
+	if (pAudioSinkInfo->CallBack != NULL)
 	{
-		Size = Free;
+		memset (pAudioSinkInfo->playerBuffer, 0, pAudioSinkInfo->playerBufferSize);
+		pAudioSinkInfo->CallBack (pAudioSinkInfo->User, pAudioSinkInfo->playerBuffer);
+		return pAudioSinkInfo->playerBuffer;
 	}
 
-	if (pOpenSLESAudioSrcInfo->Read + Size > OPENSLES_AUDIO_BUF_SIZE)
+	if (pAudioSinkInfo->RingQueued)
 	{
-		memcpy (BufAddr, pOpenSLESAudioSrcInfo->BufAddr + pOpenSLESAudioSrcInfo->Read, OPENSLES_AUDIO_BUF_SIZE - pOpenSLESAudioSrcInfo->Read);
-		memcpy ((unsigned char *)BufAddr + (OPENSLES_AUDIO_BUF_SIZE - pOpenSLESAudioSrcInfo->Read), pOpenSLESAudioSrcInfo->BufAddr, Size - (OPENSLES_AUDIO_BUF_SIZE - pOpenSLESAudioSrcInfo->Read));
-		pOpenSLESAudioSrcInfo->Read = pOpenSLESAudioSrcInfo->Read + Size - OPENSLES_AUDIO_BUF_SIZE;
+		AudioRing_ReadCommit (&pAudioSinkInfo->Ring, pAudioSinkInfo->RingQueued);
+		pAudioSinkInfo->RingQueued = 0;
 	}
-	else
+
+	// the ring is a whole number of blocks, so a block never wraps
+	if (AudioRing_ReadRegion (&pAudioSinkInfo->Ring, &Addr) >= pAudioSinkInfo->playerBufferSize)
 	{
-		memcpy (BufAddr, pOpenSLESAudioSrcInfo->BufAddr + pOpenSLESAudioSrcInfo->Read, Size);
-		pOpenSLESAudioSrcInfo->Read += Size;
+		pAudioSinkInfo->RingQueued = pAudioSinkInfo->playerBufferSize;
+		return (unsigned char *)Addr;
 	}
 
-	return Size;
+	AudioRing_NoteUnderrun (&pAudioSinkInfo->Ring, pAudioSinkInfo->playerBufferSize);
+	memset (pAudioSinkInfo->playerBuffer, 0, pAudioSinkInfo->playerBufferSize);
+	return pAudioSinkInfo->playerBuffer;
 }
 
 // this callback handler is called every time a buffer finishes playing
@@ -353,8 +410,6 @@ void OpenSLESAudioSink_Callback (SLAndroidSimpleBufferQueueItf bq, void *context
 {
 	OPENSLES_AUDIO_SINK_INFO	*pAudioSinkInfo = (OPENSLES_AUDIO_SINK_INFO *)context;
 	SLresult					result;
-	unsigned long				Available;
-	unsigned long				Write;
 
 	if (NULL == pAudioSinkInfo)
 	{
@@ -368,42 +423,8 @@ void OpenSLESAudioSink_Callback (SLAndroidSimpleBufferQueueItf bq, void *context
 		return;
 	}
 	
-	if (pAudioSinkInfo->CallBack == NULL)
-	{
-		Write = pAudioSinkInfo->Write;
-		if (Write < pAudioSinkInfo->Read)
-		{
-			Available = Write + OPENSLES_AUDIO_BUF_SIZE - pAudioSinkInfo->Read;
-		}
-		else
-		{
-			Available = Write - pAudioSinkInfo->Read;
-		}
-		if (Available >= pAudioSinkInfo->playerBufferSize)
-		{
-			memcpy (pAudioSinkInfo->playerBuffer, pAudioSinkInfo->BufAddr + pAudioSinkInfo->Read, pAudioSinkInfo->playerBufferSize);
-			if (pAudioSinkInfo->Read + pAudioSinkInfo->playerBufferSize == OPENSLES_AUDIO_BUF_SIZE)
-			{
-				pAudioSinkInfo->Read = 0;
-			}
-			else
-			{
-				pAudioSinkInfo->Read += pAudioSinkInfo->playerBufferSize;
-			}
-		}
-		else
-		{
-			memset (pAudioSinkInfo->playerBuffer, 0, pAudioSinkInfo->playerBufferSize);
-		}
-	}
-	else
-	{
-		memset (pAudioSinkInfo->playerBuffer, 0, pAudioSinkInfo->playerBufferSize);
-		pAudioSinkInfo->CallBack (pAudioSinkInfo->User, pAudioSinkInfo->playerBuffer);
-	}
-
 	// enqueue another buffer
-	result = (*pAudioSinkInfo->bqPlayerBufferQueue)->Enqueue (pAudioSinkInfo->bqPlayerBufferQueue, pAudioSinkInfo->playerBuffer, pAudioSinkInfo->playerBufferSize);
+	result = (*pAudioSinkInfo->bqPlayerBufferQueue)->Enqueue (pAudioSinkInfo->bqPlayerBufferQueue, OpenSLESAudioSink_NextBuffer (pAudioSinkInfo), pAudioSinkInfo->playerBufferSize);
 	// the most likely other result is SL_RESULT_BUFFER_INSUFFICIENT,
 	// which for this code example would indicate a programming error
     if (SL_RESULT_SUCCESS != result)
@@ -422,7 +443,6 @@ static long OpenSLESAudioSink_Open (OPENSLES_AUDIO_INFO *pAudioInfo, OPENSLES_AU
 	const SLboolean req[3] = {SL_BOOLEAN_TRUE, SL_BOOLEAN_TRUE,
 			/*SL_BOOLEAN_TRUE,*/ SL_BOOLEAN_TRUE};
 	SLresult result;
-	unsigned long Write, Available;
 
 	// configure audio source
 	SLDataLocator_AndroidSimpleBufferQueue loc_bufq = {SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, 2};
@@ -508,42 +528,8 @@ static long OpenSLESAudioSink_Open (OPENSLES_AUDIO_INFO *pAudioInfo, OPENSLES_AU
 		return -1;
 	}
 
-	if (pAudioSinkInfo->CallBack == NULL)
-	{
-		Write = pAudioSinkInfo->Write;
-		if (Write < pAudioSinkInfo->Read)
-		{
-			Available = Write + OPENSLES_AUDIO_BUF_SIZE - pAudioSinkInfo->Read;
-		}
-		else
-		{
-			Available = Write - pAudioSinkInfo->Read;
-		}
-		if (Available >= pAudioSinkInfo->playerBufferSize)
-		{
-			memcpy (pAudioSinkInfo->playerBuffer, pAudioSinkInfo->BufAddr + pAudioSinkInfo->Read, pAudioSinkInfo->playerBufferSize);
-			if (pAudioSinkInfo->Read + pAudioSinkInfo->playerBufferSize == OPENSLES_AUDIO_BUF_SIZE)
-			{
-				pAudioSinkInfo->Read = 0;
-			}
-			else
-			{
-				pAudioSinkInfo->Read += pAudioSinkInfo->playerBufferSize;
-			}
-		}
-		else
-		{
-			memset (pAudioSinkInfo->playerBuffer, 0, pAudioSinkInfo->playerBufferSize);
-		}
-	}
-	else
-	{
-		memset (pAudioSinkInfo->playerBuffer, 0, pAudioSinkInfo->playerBufferSize);
-		pAudioSinkInfo->CallBack (pAudioSinkInfo->User, pAudioSinkInfo->playerBuffer);
-	}
-
 	// enqueue another buffer
-	result = (*pAudioSinkInfo->bqPlayerBufferQueue)->Enqueue(pAudioSinkInfo->bqPlayerBufferQueue, pAudioSinkInfo->playerBuffer, pAudioSinkInfo->playerBufferSize);
+	result = (*pAudioSinkInfo->bqPlayerBufferQueue)->Enqueue(pAudioSinkInfo->bqPlayerBufferQueue, OpenSLESAudioSink_NextBuffer (pAudioSinkInfo), pAudioSinkInfo->playerBufferSize);
 	// the most likely other result is SL_RESULT_BUFFER_INSUFFICIENT,
 	// which for this code example would indicate a programming error
     if (SL_RESULT_SUCCESS != result)
@@ -615,9 +601,8 @@ AUDIO_OUT_HANDLE OpenSLESAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 		pAudioSinkInfo->CallBack = NULL;
 		pAudioSinkInfo->playerBuffer = (unsigned char *)pAudioSinkInfo + sizeof(OPENSLES_AUDIO_SINK_INFO);
 		pAudioSinkInfo->playerBufferSize = OPENSLES_AUDIO_PROC_SIZE;
-		pAudioSinkInfo->BufAddr = pAudioSinkInfo->playerBuffer + OPENSLES_AUDIO_PROC_SIZE;
-		pAudioSinkInfo->Read = 0;
-		pAudioSinkInfo->Write = 0;
+		AudioRing_Init (&pAudioSinkInfo->Ring, pAudioSinkInfo->playerBuffer + OPENSLES_AUDIO_PROC_SIZE, OPENSLES_AUDIO_BUF_SIZE);
+		pAudioSinkInfo->RingQueued = 0;
 	}
 	else
 	{
@@ -656,37 +641,23 @@ long OpenSLESAudioOut_Close (AUDIO_OUT_HANDLE Handle)
 long OpenSLESAudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size)
 {
 	OPENSLES_AUDIO_SINK_INFO *pOpenSLESAudioSinkInfo = (OPENSLES_AUDIO_SINK_INFO *)Handle;
-	unsigned long Read, Free;
 
-	Read = pOpenSLESAudioSinkInfo->Read;
-	if (pOpenSLESAudioSinkInfo->Write < Read)
-	{
-		Free = Read - pOpenSLESAudioSinkInfo->Write;
-	}
-	else
-	{
-		Free = OPENSLES_AUDIO_BUF_SIZE - (pOpenSLESAudioSinkInfo->Write - Read); 
-	}
-	if (Free < Size)
-	{
-		Size = Free;
-	}
+	return AudioRing_Write (&pOpenSLESAudioSinkInfo->Ring, BufAddr, Size);
+}
 
-	if (pOpenSLESAudioSinkInfo->Write + Size > OPENSLES_AUDIO_BUF_SIZE)
-	{
-		memcpy (pOpenSLESAudioSinkInfo->BufAddr + pOpenSLESAudioSinkInfo->Write, BufAddr, OPENSLES_AUDIO_BUF_SIZE - pOpenSLESAudioSinkInfo->Write);
-		memcpy (pOpenSLESAudioSinkInfo->BufAddr, (unsigned char *)BufAddr + (OPENSLES_AUDIO_BUF_SIZE - pOpenSLESAudioSinkInfo->Write), Size - (OPENSLES_AUDIO_BUF_SIZE - pOpenSLESAudioSinkInfo->Write));
-		pOpenSLESAudioSinkInfo->Write = pOpenSLESAudioSinkInfo->Write + Size - OPENSLES_AUDIO_BUF_SIZE;
-	}
-	else
+long OpenSLESAudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	OPENSLES_AUDIO_SINK_INFO *pOpenSLESAudioSinkInfo = (OPENSLES_AUDIO_SINK_INFO *)Handle;
+
+	if (pOpenSLESAudioSinkInfo->CallBack != NULL)
 	{
-		memcpy (pOpenSLESAudioSinkInfo->BufAddr + pOpenSLESAudioSinkInfo->Write, BufAddr, Size);
-		pOpenSLESAudioSinkInfo->Write += Size;
+		return -1;
 	}
 
-	return Size;
-}
+	AudioRing_GetStat (&pOpenSLESAudioSinkInfo->Ring, pStat);
 
+	return 0;
+}
 
 static long OpenSLESAudio_Engine_Init (OPENSLES_AUDIO_INFO *pAudioInfo)
 {
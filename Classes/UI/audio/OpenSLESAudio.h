@@ -2,6 +2,7 @@
 #define _OPENSLES_AUDIO_H_
 
 #include "CP_Audio.h"
+#include "AudioRing.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -10,10 +11,13 @@ extern "C" {
 	AUDIO_IN_HANDLE OpenSLESAudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 	long OpenSLESAudioIn_Close (AUDIO_IN_HANDLE Handle);
 	long OpenSLESAudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size);
+	long OpenSLESAudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat);
+	long OpenSLESAudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat);
 
 	AUDIO_OUT_HANDLE OpenSLESAudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param);
 	long OpenSLESAudioOut_Close (AUDIO_OUT_HANDLE Handle);
 	long OpenSLESAudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size);
+	long OpenSLESAudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat);
 
 	AUDIO_HANDLE OpenSLESAudio_Init (int samplerate);
 	long OpenSLESAudio_Finish (AUDIO_HANDLE Handle);
@@ -2,6 +2,7 @@
 #include <process.h>
 
 #include "Win32Audio.h"
+#include "Win32AudioStat.h"
 
 #define WIN32_AUDIO_NUMBER_OF_BUFFERS	2
 #define WIN32_AUDIO_PROC_SIZE				6400
@@ -32,9 +33,7 @@ typedef struct tagWIN32_AUDIO_SRC_INFO
 	HWAVEIN					WaveHandle;
 	WIN32_AUDIO_BUFFER		Buffer[WIN32_AUDIO_NUMBER_OF_BUFFERS];
 
-	unsigned char			*BufAddr;
-	unsigned long			Write;
-	unsigned long			Read;
+	AUDIO_RING				Ring;				// read mode, device thread to Win32AudioIn_Read
 }WIN32_AUDIO_SRC_INFO;
 
 typedef struct tagWIN32_AUDIO_SINK_INFO
@@ -52,10 +51,8 @@ typedef struct tagWIN32_AUDIO_SINK_INFO
 	int						Paused;
 	HWAVEOUT				WaveHandle;
 	WIN32_AUDIO_BUFFER		Buffer[WIN32_AUDIO_NUMBER_OF_BUFFERS];
-	
-	unsigned char			*BufAddr;
-	unsigned long			Write;
-	unsigned long			Read;
+
+	AUDIO_RING				Ring;				// write mode, Win32AudioOut_Write to device thread
 }WIN32_AUDIO_SINK_INFO;
 
 static int Win32AudioSrc_PlayerInit (WIN32_AUDIO_SRC_INFO *pWin32AudioSrcInfo)
@@ -328,15 +325,8 @@ static void Win32AudioSrc_Thread (void *Data)
 
 		if (pWin32AudioSrcInfo->CallBack == NULL)
 		{
-			memcpy (pWin32AudioSrcInfo->BufAddr + pWin32AudioSrcInfo->Write, InBuffer->PcmData, InBuffer->PcmDataSize);
-			if (pWin32AudioSrcInfo->Write + InBuffer->PcmDataSize == WIN32_AUDIO_BUF_SIZE)
-			{
-				pWin32AudioSrcInfo->Write = 0;
-			}
-			else
-			{
-				pWin32AudioSrcInfo->Write += InBuffer->PcmDataSize;
-			}
+			/* a reader that falls behind loses the newest block */
+			AudioRing_WriteBlock (&pWin32AudioSrcInfo->Ring, InBuffer->PcmData, InBuffer->PcmDataSize);
 		}
 		else
 		{
@@ -377,9 +367,12 @@ AUDIO_IN_HANDLE Win32AudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 		pWin32AudioSrcInfo->Buffer[1].PcmDataSize = WIN32_AUDIO_PROC_SIZE;
 		pWin32AudioSrcInfo->Buffer[0].PcmData = (unsigned char *)pWin32AudioSrcInfo + sizeof(WIN32_AUDIO_SRC_INFO);
 		pWin32AudioSrcInfo->Buffer[1].PcmData = pWin32AudioSrcInfo->Buffer[0].PcmData + WIN32_AUDIO_PROC_SIZE;
-		pWin32AudioSrcInfo->BufAddr = pWin32AudioSrcInfo->Buffer[1].PcmData + WIN32_AUDIO_PROC_SIZE;
-		pWin32AudioSrcInfo->Read = 0;
-		pWin32AudioSrcInfo->Write = 0;
+		AudioRing_Init (&pWin32AudioSrcInfo->Ring, pWin32AudioSrcInfo->Buffer[1].PcmData + WIN32_AUDIO_PROC_SIZE, WIN32_AUDIO_BUF_SIZE);
+		if (AudioRing_EnableWait (&pWin32AudioSrcInfo->Ring, Param->SampleRate * Param->Channels * 2) == -1)
+		{
+			free (pWin32AudioSrcInfo);
+			return NULL;
+		}
 	}
 	else
 	{
@@ -398,6 +391,10 @@ AUDIO_IN_HANDLE Win32AudioIn_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 	pWin32AudioSrcInfo->Handle = (HANDLE)_beginthread (Win32AudioSrc_Thread, 0, pWin32AudioSrcInfo);
 	if (pWin32AudioSrcInfo->Handle == (HANDLE)(-1))
 	{
+		if (pWin32AudioSrcInfo->CallBack == NULL)
+		{
+			AudioRing_DisableWait (&pWin32AudioSrcInfo->Ring);
+		}
 		free (pWin32AudioSrcInfo);
 		return NULL;
 	}
@@ -412,6 +409,10 @@ long Win32AudioIn_Close (AUDIO_IN_HANDLE Handle)
 	pWin32AudioSrcInfo->ThreadExitFlag = 1;
 	WaitForSingleObject(pWin32AudioSrcInfo->Handle, INFINITE);
 
+	if (pWin32AudioSrcInfo->CallBack == NULL)
+	{
+		AudioRing_DisableWait (&pWin32AudioSrcInfo->Ring);
+	}
 	free (pWin32AudioSrcInfo);
 
 	return 0;
@@ -420,36 +421,35 @@ long Win32AudioIn_Close (AUDIO_IN_HANDLE Handle)
 long Win32AudioIn_Read (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size)
 {
 	WIN32_AUDIO_SRC_INFO *pWin32AudioSrcInfo = (WIN32_AUDIO_SRC_INFO *)Handle;
-	unsigned long Write, Free;
 
-	Write = pWin32AudioSrcInfo->Write;
-	if (Write < pWin32AudioSrcInfo->Read)
-	{
-		Free = Write + WIN32_AUDIO_BUF_SIZE - pWin32AudioSrcInfo->Read;
-	}
-	else
-	{
-		Free = Write - pWin32AudioSrcInfo->Read;
-	}
+	return AudioRing_Read (&pWin32AudioSrcInfo->Ring, BufAddr, Size);
+}
 
-	if (Free < Size)
-	{
-		Size = Free;
-	}
+// the device thread sleeps on the waveIn block event, its commit wakes the reader
+long Win32AudioIn_Wait (AUDIO_IN_HANDLE Handle, void *BufAddr, unsigned long Size, long Timeout, AUDIO_IN_STAT *pStat)
+{
+	WIN32_AUDIO_SRC_INFO *pWin32AudioSrcInfo = (WIN32_AUDIO_SRC_INFO *)Handle;
 
-	if (pWin32AudioSrcInfo->Read + Size > WIN32_AUDIO_BUF_SIZE)
+	if (pWin32AudioSrcInfo->CallBack != NULL)
 	{
-		memcpy (BufAddr, pWin32AudioSrcInfo->BufAddr + pWin32AudioSrcInfo->Read, WIN32_AUDIO_BUF_SIZE - pWin32AudioSrcInfo->Read);
-		memcpy ((unsigned char *)BufAddr + (WIN32_AUDIO_BUF_SIZE - pWin32AudioSrcInfo->Read), pWin32AudioSrcInfo->BufAddr, Size - (WIN32_AUDIO_BUF_SIZE - pWin32AudioSrcInfo->Read));
-		pWin32AudioSrcInfo->Read = pWin32AudioSrcInfo->Read + Size - WIN32_AUDIO_BUF_SIZE;
+		return -1;
 	}
-	else
+
+	return AudioRing_ReadWait (&pWin32AudioSrcInfo->Ring, BufAddr, Size, Timeout, pStat);
+}
+
+long Win32AudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	WIN32_AUDIO_SRC_INFO *pWin32AudioSrcInfo = (WIN32_AUDIO_SRC_INFO *)Handle;
+
+	if (pWin32AudioSrcInfo->CallBack != NULL)
 	{
-		memcpy (BufAddr, pWin32AudioSrcInfo->BufAddr + pWin32AudioSrcInfo->Read, Size);
-		pWin32AudioSrcInfo->Read += Size;
+		return -1;
 	}
 
-	return Size;
+	AudioRing_GetStat (&pWin32AudioSrcInfo->Ring, pStat);
+
+	return 0;
 }
 
 static int Win32AudioSink_PlayerInit (WIN32_AUDIO_SINK_INFO *pWin32AudioSinkInfo)
@@ -735,8 +735,6 @@ static void Win32AudioSink_Thread (void *Data)
 {
 	WIN32_AUDIO_SINK_INFO	*pWin32AudioSinkInfo = (WIN32_AUDIO_SINK_INFO *)Data;
 	WIN32_AUDIO_BUFFER *OutBuffer;
-	unsigned long			Available;
-	unsigned long			Write;
 
 	while (1)
 	{
@@ -765,28 +763,7 @@ static void Win32AudioSink_Thread (void *Data)
 
 		if (pWin32AudioSinkInfo->CallBack == NULL)
 		{
-			Write = pWin32AudioSinkInfo->Write;
-			if (Write < pWin32AudioSinkInfo->Read)
-			{
-				Available = Write + WIN32_AUDIO_BUF_SIZE - pWin32AudioSinkInfo->Read;
-			}
-			else
-			{
-				Available = Write - pWin32AudioSinkInfo->Read;
-			}
-			if (Available >= OutBuffer->PcmDataSize)
-			{
-				memcpy (OutBuffer->PcmData, pWin32AudioSinkInfo->BufAddr + pWin32AudioSinkInfo->Read, OutBuffer->PcmDataSize);
-				if (pWin32AudioSinkInfo->Read + OutBuffer->PcmDataSize == WIN32_AUDIO_BUF_SIZE)
-				{
-					pWin32AudioSinkInfo->Read = 0;
-				}
-				else
-				{
-					pWin32AudioSinkInfo->Read += OutBuffer->PcmDataSize;
-				}
-			}
-			else
+			if (AudioRing_ReadBlock (&pWin32AudioSinkInfo->Ring, OutBuffer->PcmData, OutBuffer->PcmDataSize) == -1)
 			{
 				memset (OutBuffer->PcmData, 0, OutBuffer->PcmDataSize);
 			}
@@ -839,9 +816,7 @@ AUDIO_OUT_HANDLE Win32AudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 		pWin32AudioSinkInfo->Buffer[1].PcmDataSize = WIN32_AUDIO_PROC_SIZE;
 		pWin32AudioSinkInfo->Buffer[0].PcmData = (unsigned char *)pWin32AudioSinkInfo + sizeof(WIN32_AUDIO_SINK_INFO);
 		pWin32AudioSinkInfo->Buffer[1].PcmData = pWin32AudioSinkInfo->Buffer[0].PcmData + WIN32_AUDIO_PROC_SIZE;
-		pWin32AudioSinkInfo->BufAddr = pWin32AudioSinkInfo->Buffer[1].PcmData + WIN32_AUDIO_PROC_SIZE;
-		pWin32AudioSinkInfo->Read = 0;
-		pWin32AudioSinkInfo->Write = 0;
+		AudioRing_Init (&pWin32AudioSinkInfo->Ring, pWin32AudioSinkInfo->Buffer[1].PcmData + WIN32_AUDIO_PROC_SIZE, WIN32_AUDIO_BUF_SIZE);
 	}
 	else
 	{
@@ -856,8 +831,6 @@ AUDIO_OUT_HANDLE Win32AudioOut_Open (AUDIO_HANDLE Handle, AUDIO_PARAM *Param)
 	pWin32AudioSinkInfo->Opened = 0;
 	pWin32AudioSinkInfo->bIndex = 0;
 	pWin32AudioSinkInfo->Paused = 0;
-	pWin32AudioSinkInfo->Read = 0;
-	pWin32AudioSinkInfo->Write = 0;
 
 	pWin32AudioSinkInfo->ThreadExitFlag = 0;
 	pWin32AudioSinkInfo->Handle = (HANDLE)_beginthread (Win32AudioSink_Thread, 0, pWin32AudioSinkInfo);
@@ -885,35 +858,22 @@ long Win32AudioOut_Close (AUDIO_OUT_HANDLE Handle)
 long Win32AudioOut_Write (AUDIO_OUT_HANDLE Handle, void *BufAddr, unsigned long Size)
 {
 	WIN32_AUDIO_SINK_INFO *pWin32AudioSinkInfo = (WIN32_AUDIO_SINK_INFO *)Handle;
-	unsigned long Read, Free;
 
-	Read = pWin32AudioSinkInfo->Read;
-	if (pWin32AudioSinkInfo->Write < Read)
-	{
-		Free = Read - pWin32AudioSinkInfo->Write;
-	}
-	else
-	{
-		Free = WIN32_AUDIO_BUF_SIZE - (pWin32AudioSinkInfo->Write - Read); 
-	}
-	if (Free < Size)
-	{
-		Size = Free;
-	}
+	return AudioRing_Write (&pWin32AudioSinkInfo->Ring, BufAddr, Size);
+}
 
-	if (pWin32AudioSinkInfo->Write + Size > WIN32_AUDIO_BUF_SIZE)
-	{
-		memcpy (pWin32AudioSinkInfo->BufAddr + pWin32AudioSinkInfo->Write, BufAddr, WIN32_AUDIO_BUF_SIZE - pWin32AudioSinkInfo->Write);
-		memcpy (pWin32AudioSinkInfo->BufAddr, (unsigned char *)BufAddr + (WIN32_AUDIO_BUF_SIZE - pWin32AudioSinkInfo->Write), Size - (WIN32_AUDIO_BUF_SIZE - pWin32AudioSinkInfo->Write));
-		pWin32AudioSinkInfo->Write = pWin32AudioSinkInfo->Write + Size - WIN32_AUDIO_BUF_SIZE;
-	}
-	else
+long Win32AudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat)
+{
+	WIN32_AUDIO_SINK_INFO *pWin32AudioSinkInfo = (WIN32_AUDIO_SINK_INFO *)Handle;
+
+	if (pWin32AudioSinkInfo->CallBack != NULL)
 	{
-		memcpy (pWin32AudioSinkInfo->BufAddr + pWin32AudioSinkInfo->Write, BufAddr, Size);
-		pWin32AudioSinkInfo->Write += Size;
+		return -1;
 	}
 
-	return Size;
+	AudioRing_GetStat (&pWin32AudioSinkInfo->Ring, pStat);
+
+	return 0;
 }
 
 AUDIO_HANDLE Win32Audio_Init ()
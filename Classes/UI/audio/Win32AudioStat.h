@@ -0,0 +1,20 @@
+#ifndef _WIN32_AUDIO_STAT_H_
+#define _WIN32_AUDIO_STAT_H_
+
+// ring statistics of the Win32 backend. Win32Audio.h belongs to the ChaosPlayer
+// interface, which does not know the UI audio ring
+#include "CP_Audio.h"
+#include "AudioRing.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+long Win32AudioIn_GetStat (AUDIO_IN_HANDLE Handle, AUDIO_RING_STAT *pStat);
+long Win32AudioOut_GetStat (AUDIO_OUT_HANDLE Handle, AUDIO_RING_STAT *pStat);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
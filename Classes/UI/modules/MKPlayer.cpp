@@ -492,6 +492,10 @@ int MKPlayer::setSPSoundEffect(int setting)
 //----------------------------------------------------------------------------//
 int MKPlayer::setVol(const std::string& type, int value)
 {
+	int volType = player_service_voltype(type.c_str());
+	if (m_typed != NULL && volType >= 0)
+		return execTyped(PLY_TCMD_SETVOL, volType, value);
+
 	setCmdPara(m_cmdSetVol, type, MKString::valueOf(value));
 	return exec(m_cmdSetVol, m_nullstr);
 }
@@ -582,7 +586,9 @@ int MKPlayer::enableLyric(int enabled)
 //----------------------------------------------------------------------------//
 int MKPlayer::renderView(void)
 {
-	return exec(m_cmdViewUpdate, m_nullstr);
+	if (m_typed == NULL)
+		return exec(m_cmdViewUpdate, m_nullstr);
+	return execTyped(PLY_TCMD_UPDATEVIEW);
 }
 
 //----------------------------------------------------------------------------//
@@ -594,9 +600,17 @@ int MKPlayer::updateSelf(int timeElapsed)
 //----------------------------------------------------------------------------//
 std::string MKPlayer::getPlayState(void)
 {
-	if (exec(m_cmdGetState, m_nullstr) == 0)
+	if (m_typed == NULL)
+	{
+		if (exec(m_cmdGetState, m_nullstr) == 0)
+			return getEventParaValue(m_cmdGetState, m_paraState);
+		return "";
+	}
+
+	ezServiceTypedPara_t para;
+	if (execTyped(PLY_TCMD_GETSTATE, &para) == 0)
 	{
-		return getEventParaValue(m_cmdGetState, m_paraState);
+		return std::string(para.ostr);
 	}
 	return "";
 }
@@ -604,13 +618,17 @@ std::string MKPlayer::getPlayState(void)
 //----------------------------------------------------------------------------//
 int MKPlayer::getTotalTime(void)
 {
-	return exec(m_cmdGetTotalTime, m_nullstr);
+	if (m_typed == NULL)
+		return exec(m_cmdGetTotalTime, m_nullstr);
+	return execTyped(PLY_TCMD_GETTOTALTIME);
 }
 
 //----------------------------------------------------------------------------//
 int MKPlayer::getPlayTime(void)
 {
-	return exec(m_cmdGetPlayTime, m_nullstr);
+	if (m_typed == NULL)
+		return exec(m_cmdGetPlayTime, m_nullstr);
+	return execTyped(PLY_TCMD_GETPLAYTIME);
 }
 
 //----------------------------------------------------------------------------//
@@ -638,7 +656,9 @@ int MKPlayer::getLyric(int lineNo, MKLyricInfo& inf)
 //----------------------------------------------------------------------------//
 int MKPlayer::getScore(void)
 {
-	return exec(m_cmdGetScore, m_nullstr);
+	if (m_typed == NULL)
+		return exec(m_cmdGetScore, m_nullstr);
+	return execTyped(PLY_TCMD_GETSCORE);
 }
 
 //----------------------------------------------------------------------------//
@@ -652,7 +672,9 @@ int MKPlayer::getStoppedScore(void)
 //----------------------------------------------------------------------------//
 int MKPlayer::getBufferingFlag(void)
 {
-	return exec(m_cmdGetBufferingFlag, m_nullstr);
+	if (m_typed == NULL)
+		return exec(m_cmdGetBufferingFlag, m_nullstr);
+	return execTyped(PLY_TCMD_GETBUFFERINGFLAG);
 }
 
 //----------------------------------------------------------------------------//
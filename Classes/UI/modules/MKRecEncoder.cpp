@@ -36,6 +36,8 @@ const std::string MKRecEncoder::m_cmdStop = "stop";
 const std::string MKRecEncoder::m_cmdPause = "pause";
 const std::string MKRecEncoder::m_cmdResume = "resume";
 const std::string MKRecEncoder::m_cmdGetPercent = "getpercent";
+const std::string MKRecEncoder::m_cmdCancel = "cancel";
+const std::string MKRecEncoder::m_cmdSetLive = "setlive";
 
 // - parameters
 const std::string MKRecEncoder::m_paraSongName = "songname";
@@ -62,6 +64,7 @@ const std::string MKRecEncoder::m_paraLatency = "latency";
 const std::string MKRecEncoder::m_paraOutLatency = "outlatency";	
 const std::string MKRecEncoder::m_paraMixFlag = "mixflag";	
 const std::string MKRecEncoder::m_paraSpSound = "spsound"; 
+const std::string MKRecEncoder::m_paraMaxJobs = "maxjobs";
 
 // parameter values
 const std::string MKRecEncoder::m_encSongTypePCM = "pcm";
@@ -77,9 +80,14 @@ const std::string MKRecEncoder::m_encEventPlay = "play";
 const std::string MKRecEncoder::m_encEventStopped = "stopped";
 const std::string MKRecEncoder::m_encEventPaused = "paused";
 const std::string MKRecEncoder::m_encEventResumed = "resumed";
+const std::string MKRecEncoder::m_encEventProgress = "progress";
+const std::string MKRecEncoder::m_encEventCancelled = "cancelled";
 const std::string MKRecEncoder::m_encEventValueID = "id";
+const std::string MKRecEncoder::m_encEventValuePercent = "percent";
+const std::string MKRecEncoder::m_encEventValueEta = "eta";
+const std::string MKRecEncoder::m_encEventValueState = "state";
 
-MKRecEncoder::MKRecEncoder(void* owner) : MKService(m_name, owner)
+MKRecEncoder::MKRecEncoder(void* owner) : MKService(m_name, owner), m_live(-1)
 {
 }
 
@@ -88,7 +96,7 @@ MKRecEncoder::~MKRecEncoder(void)
 }
 
 //----------------------------------------------------------------------------//
-int MKRecEncoder::init(int bitrate, int latency, int outlatency)
+int MKRecEncoder::init(int bitrate, int latency, int outlatency, int maxJobs)
 {	
 	setCmdPara(m_cmdInit, m_paraCidKey, "12345678");
 	setCmdPara(m_cmdInit, m_paraPrivateKey, "in");
@@ -98,6 +106,7 @@ int MKRecEncoder::init(int bitrate, int latency, int outlatency)
 	setCmdPara(m_cmdInit, m_paraBitrate, MKString::valueOf(bitrate));
 	setCmdPara(m_cmdInit, m_paraLatency, MKString::valueOf(latency));
 	setCmdPara(m_cmdInit, m_paraOutLatency, MKString::valueOf(outlatency));	
+	setCmdPara(m_cmdInit, m_paraMaxJobs, MKString::valueOf(maxJobs));
 	return exec(m_cmdInit, m_nullstr);
 }
 
@@ -179,4 +188,26 @@ int MKRecEncoder::getPercent(int id)
 	return exec(m_cmdGetPercent, MKString::valueOf(id));
 }
 
+//----------------------------------------------------------------------------//
+int MKRecEncoder::cancel(int id)
+{			
+	return exec(m_cmdCancel, MKString::valueOf(id));
+}
+
+//----------------------------------------------------------------------------//
+int MKRecEncoder::setLivePlayback(int live)
+{
+	// called every frame, only tell the service about changes
+	if (live == m_live)
+		return 0;
+	m_live = live;
+	return exec(m_cmdSetLive, MKString::valueOf(live));
+}
+
+//----------------------------------------------------------------------------//
+int MKRecEncoder::updateSelf(int timeElapsed)
+{
+	return update(timeElapsed);
+}
+
 }
\ No newline at end of file
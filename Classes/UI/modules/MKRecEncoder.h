@@ -43,6 +43,8 @@ public:
 	static const std::string m_cmdPause;
 	static const std::string m_cmdResume;
 	static const std::string m_cmdGetPercent;
+	static const std::string m_cmdCancel;
+	static const std::string m_cmdSetLive;
 
 	// - parameters
 	static const std::string m_paraSongName;
@@ -69,6 +71,7 @@ public:
 	static const std::string m_paraOutLatency;
 	static const std::string m_paraMixFlag;
 	static const std::string m_paraSpSound; 	
+	static const std::string m_paraMaxJobs;
 	// parameter values
 	static const std::string m_encSongTypePCM;
 	static const std::string m_encSongTypeWAV;
@@ -83,14 +86,21 @@ public:
 	static const std::string m_encEventStopped;
 	static const std::string m_encEventPaused;
 	static const std::string m_encEventResumed;
+	static const std::string m_encEventProgress;
+	static const std::string m_encEventCancelled;
 	static const std::string m_encEventValueID;
+	static const std::string m_encEventValuePercent;
+	static const std::string m_encEventValueEta;
+	static const std::string m_encEventValueState;
 
 	MKRecEncoder(void* owner);
 
 	virtual ~MKRecEncoder(void);
 	
 	//----------------------------------------------------------------------------//
-	int init(int bitrate, int latency, int outlatency);
+	//- maxJobs, encoders running at the same time, the others wait in the queue
+	//----------------------------------------------------------------------------//
+	int init(int bitrate, int latency, int outlatency, int maxJobs = 1);
 	
 	//----------------------------------------------------------------------------//
 	int deinit();
@@ -132,6 +142,23 @@ public:
 	//----------------------------------------------------------------------------//
 	int getPercent(int id);
 	
+	//----------------------------------------------------------------------------//
+	//- stop the encoder and delete its out file
+	//----------------------------------------------------------------------------//
+	int cancel(int id);
+	
+	//----------------------------------------------------------------------------//
+	//- encoders are held while live playback runs
+	//----------------------------------------------------------------------------//
+	int setLivePlayback(int live);
+	
+	//----------------------------------------------------------------------------//
+	int updateSelf(int timeElapsed);
+
+private:
+
+	int m_live;
+	
 };
 }
 #endif
@@ -29,6 +29,7 @@ const std::string MKService::m_nullstr = "";
 MKService::MKService(const std::string& name, void* owner)
 {
 	m_hdle = serviceMgr_create(name.c_str(), owner);
+	m_typed = serviceMgr_getTyped(name.c_str(), &m_typedCount);
 }
 
 MKService::~MKService(void)
@@ -182,6 +183,28 @@ int MKService::clearEventPara(const std::string& event)
 	return m_hdle->clearEventPara(m_hdle,event.c_str());
 }
 	
+//----------------------------------------------------------------------------//
+int MKService::internCmd(const std::string& cmd)
+{
+	return serviceMgr_internCmd(m_typed, cmd.c_str());
+}
+	
+//----------------------------------------------------------------------------//
+int MKService::execTyped(int cmd, ezServiceTypedPara_t* para)
+{
+	return serviceMgr_execTyped(m_hdle, m_typed, m_typedCount, cmd, para);
+}
+	
+//----------------------------------------------------------------------------//
+int MKService::execTyped(int cmd, int val0, int val1)
+{
+	ezServiceTypedPara_t para;
+
+	para.ival[0] = val0;
+	para.ival[1] = val1;
+	return serviceMgr_execTyped(m_hdle, m_typed, m_typedCount, cmd, &para);
+}
+	
 //----------------------------------------------------------------------------//
 int MKService::setThread(int onoff)
 {
@@ -24,6 +24,7 @@
 
 #include <string>
 #include <lib/ezbase/ez_service.h>
+#include <serviceTyped.h>
 #include "MKSingleton.h"
 
 namespace CEGUI
@@ -35,6 +36,8 @@ public:
 
 	static const std::string m_nullstr;
 	ezServiceHandle_t* m_hdle;
+	ezServiceTypedRegistry_t* m_typed;		// typed commands of the service, NULL if none
+	int m_typedCount;
 
 	MKService(const std::string& name, void* owner);
 
@@ -103,6 +106,17 @@ public:
 	//----------------------------------------------------------------------------//
 	int clearEventPara(const std::string& event);
 		
+	//----------------------------------------------------------------------------//
+	//- typed command channel, see serviceTyped.h
+	//----------------------------------------------------------------------------//
+	int internCmd(const std::string& cmd);
+	
+	//----------------------------------------------------------------------------//
+	int execTyped(int cmd, ezServiceTypedPara_t* para);
+	
+	//----------------------------------------------------------------------------//
+	int execTyped(int cmd, int val0 = 0, int val1 = 0);
+	
 	//----------------------------------------------------------------------------//
 	int setThread(int onoff);
 	
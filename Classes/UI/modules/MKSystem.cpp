@@ -40,6 +40,7 @@ const std::string MKSystem::m_cmdHideScreenBg = "hidescreenbg";
 const std::string MKSystem::m_cmdRenderScreenBg = "renderscreenbg";
 const std::string MKSystem::m_cmdXCopy = "xcopy";
 const std::string MKSystem::m_cmdXRemove = "xremove";
+const std::string MKSystem::m_cmdXCopyCancel = "xcopycancel";
 
 // - command parameters
 const std::string MKSystem::m_paraResPath = "respath";
@@ -50,6 +51,10 @@ const std::string MKSystem::m_paraResHeight = "resheight";
 const std::string MKSystem::m_paraScreenX = "screenx";
 const std::string MKSystem::m_paraScreenY = "screeny";
 
+// - events
+const std::string MKSystem::m_eventXCopyProgress = "xcopyprogress";
+const std::string MKSystem::m_eventXCopyDone = "xcopydone";
+
 MKSystem::MKSystem(void* owner) : MKService(m_name, owner)
 {
 }
@@ -139,6 +144,27 @@ int MKSystem::xcopy(const std::string& dst, const std::string& src)
 	return exec(m_cmdXCopy, m_nullstr);
 }
 
+//----------------------------------------------------------------------------//
+int MKSystem::xcopyAsync(const std::string& dst, const std::string& src)
+{
+	setCmdPara(m_cmdXCopy, "dst", dst);
+	setCmdPara(m_cmdXCopy, "src", src);
+	setCmdPara(m_cmdXCopy, "async", "1");
+	return exec(m_cmdXCopy, m_nullstr);
+}
+
+//----------------------------------------------------------------------------//
+int MKSystem::xcopyCancel()
+{
+	return exec(m_cmdXCopyCancel, m_nullstr);
+}
+
+//----------------------------------------------------------------------------//
+int MKSystem::updateSelf(int timeElapsed)
+{
+	return update(timeElapsed);
+}
+
 //----------------------------------------------------------------------------//
 int MKSystem::xremove(const std::string& path)
 {
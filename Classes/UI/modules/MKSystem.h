@@ -49,6 +49,7 @@ public:
 	static const std::string m_cmdRenderScreenBg;
 	static const std::string m_cmdXCopy;
 	static const std::string m_cmdXRemove;
+	static const std::string m_cmdXCopyCancel;
 	
 	// - command parameters
 	static const std::string m_paraResPath;
@@ -58,6 +59,10 @@ public:
 	static const std::string m_paraResHeight;
 	static const std::string m_paraScreenX;
 	static const std::string m_paraScreenY;
+	
+	// - events
+	static const std::string m_eventXCopyProgress;
+	static const std::string m_eventXCopyDone;
 
 	MKSystem(void* owner);
 
@@ -96,6 +101,17 @@ public:
 	//----------------------------------------------------------------------------//
 	int xcopy(const std::string& dst, const std::string& src);
 	
+	//----------------------------------------------------------------------------//
+	//- copy on a thread, xcopyprogress and xcopydone come from updateSelf
+	//----------------------------------------------------------------------------//
+	int xcopyAsync(const std::string& dst, const std::string& src);
+	
+	//----------------------------------------------------------------------------//
+	int xcopyCancel();
+	
+	//----------------------------------------------------------------------------//
+	int updateSelf(int timeElapsed);
+	
 	//----------------------------------------------------------------------------//
 	int xremove(const std::string& path);
 };
@@ -146,6 +146,7 @@ CP_AudioIFs gAWJavaAudioIFs =
 	AWJavaAudio_Init_ex,
 	AWJavaAudio_Finish,
 	AWJavaAudio_Set,
+	AWJavaAudioIn_Wait,
 };
 
 //----------------------------------------------------------------------------//
@@ -248,6 +249,69 @@ AudioIFMap_t gAudioIFMap[] =
 };
 */
 
+#elif defined(__linux__) && !defined(__ANDROID__)
+
+#define AUDIO_IF_DEFAULT				AUDIO_IF_ALSA
+
+#include "AlsaAudio.h"
+
+CP_AudioIFs gAlsaAudioIFs = 
+{
+	AlsaAudioIn_Open,
+	AlsaAudioIn_Close,
+	AlsaAudioIn_Read,
+	AlsaAudioOut_Open,
+	AlsaAudioOut_Close,
+	AlsaAudioOut_Write,
+	AlsaAudio_Init,
+	AlsaAudio_Finish,
+	AlsaAudio_Set,
+	AlsaAudioIn_Wait,
+};
+
+//----------------------------------------------------------------------------//
+
+#include "FileAudio.h"
+
+// headless devices for build servers, see FileAudio_SetParam
+CP_AudioIFs gNullAudioIFs = 
+{
+	FileAudioIn_Open,
+	FileAudioIn_Close,
+	FileAudioIn_Read,
+	FileAudioOut_Open,
+	FileAudioOut_Close,
+	FileAudioOut_Write,
+	NullAudio_Init,
+	FileAudio_Finish,
+	FileAudio_Set,
+	FileAudioIn_Wait,
+};
+
+CP_AudioIFs gFileAudioIFs = 
+{
+	FileAudioIn_Open,
+	FileAudioIn_Close,
+	FileAudioIn_Read,
+	FileAudioOut_Open,
+	FileAudioOut_Close,
+	FileAudioOut_Write,
+	FileAudio_Init,
+	FileAudio_Finish,
+	FileAudio_Set,
+	FileAudioIn_Wait,
+};
+
+//----------------------------------------------------------------------------//
+//- MAP
+//----------------------------------------------------------------------------//
+AudioIFMap_t gAudioIFMap[] = 
+{
+	{AUDIO_IF_ALSA, &gAlsaAudioIFs, 48000, 48000, 2, 2, 20},
+	{AUDIO_IF_NULL, &gNullAudioIFs, 48000, 48000, 2, 2, 0},
+	{AUDIO_IF_FILE, &gFileAudioIFs, 48000, 48000, 2, 2, 0},
+};
+
 #else
 
 #define AUDIO_IF_DEFAULT				AUDIO_IF_WIN32
@@ -269,6 +333,7 @@ CP_AudioIFs gWin32AudioIFs =
 	_Win32Audio_Init,
 	Win32Audio_Finish,
 	NULL,
+	Win32AudioIn_Wait,
 };
 
 CP_AudioIFs gKKBoxAudioIFs = 
@@ -30,6 +30,9 @@
 #define AUDIO_IF_KKEMINI			"KKEMINI"
 #define AUDIO_IF_JAVA				"JAVA"
 #define AUDIO_IF_AWJAVA				"AWJAVA"
+#define AUDIO_IF_ALSA				"ALSA"
+#define AUDIO_IF_NULL				"NULLAUDIO"
+#define AUDIO_IF_FILE				"FILEAUDIO"
 
 #ifdef __cplusplus
 extern "C" {
@@ -2125,6 +2125,7 @@ static int player_service_voicerecord(ezServiceHandle_t* hdle, const char* cmdna
 	if (playerHdle != NULL)
 	{
 		voiceRecordParam_t param;
+		char format[16];
 
 		param.format = VOICE_REC_WAV;
 		param.audioIf = player_audio_get_cur_if();
@@ -2138,6 +2139,14 @@ static int player_service_voicerecord(ezServiceHandle_t* hdle, const char* cmdna
 		hdle->getCmdParaValueInt(hdle, cmdname, PLY_CMD_VOICERECORD_MUTETIME, &param.mutetime);
 		hdle->getCmdParaValueInt(hdle, cmdname, PLY_CMD_VOICERECORD_THRESHOLD, &param.threshold);
 		hdle->getCmdParaValueStr(hdle, cmdname, PLY_CMD_VOICERECORD_RECFILE, param.outfile, sizeof(param.outfile));
+		if (hdle->getCmdParaValueInt(hdle, cmdname, PLY_CMD_VOICERECORD_GAIN, &param.gain) != 0)
+			param.gain = VOICE_REC_GAIN_UNITY;
+		if (hdle->getCmdParaValueStr(hdle, cmdname, PLY_CMD_VOICERECORD_FORMAT, format, sizeof(format)) == 0) {
+			if (strcmp(format, PLY_CMD_VOICERECORD_FORMAT_ADPCM) == 0)
+				param.format = VOICE_REC_ADPCM;
+			else if (strcmp(format, PLY_CMD_VOICERECORD_FORMAT_PCM) == 0)
+				param.format = VOICE_REC_PCM;
+		}
 		ret = (int)voice_record_start(&param);
 		if (ret != 0)
 			result = ezServiceEvent_Succ;
@@ -2191,6 +2200,228 @@ int player_service_getplayertime(ezServiceHandle_t* hdle)
 	}
 	return ret;
 }
+//----------------------------------------------------------------------------//
+int player_service_voltype(const char* name)
+{
+	int i;
+
+	for (i=0; i<EZPLAYER_VOL_COUNT; i++)
+	{
+		if (gSetVolTypeNames[i] != NULL && stricmp(gSetVolTypeNames[i], name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+//----------------------------------------------------------------------------//
+//- typed commands, same work and same events as the string commands above
+//- without the parameter maps. the state of the player is read on the caller
+//- thread.
+//----------------------------------------------------------------------------//
+static int player_service_tgettime(ezServiceHandle_t* hdle, const char* evtname, int total)
+{
+	playerServiceHandle_t* playerHdle = (playerServiceHandle_t*)hdle->doer;
+	int time = 0;
+	if (playerHdle != NULL)
+	{
+		BatchPlayer_t* bp = playerHdle->bp;
+		if (bp->getPlayerType(bp) == PLAYER_TYPE_MUS)
+		{
+			MusPlayer_t* player = (MusPlayer_t *)(bp->getPlayer(bp));
+			if (total)
+				player->getTotalTime((ezPlayer_t*)player, &time);
+			else
+				player->getplaytime((ezPlayer_t*)player, &time);
+		}
+		else if (bp->getPlayerType(bp) == PLAYER_TYPE_VIDEO)
+		{
+			MediaPlayer_t* player = (MediaPlayer_t *)(bp->getPlayer(bp));
+			if (total)
+				player->getTotalTime((ezPlayer_t*)player, &time);
+			else
+				player->getplaytime((ezPlayer_t*)player, &time);
+		}
+		hdle->pushEvent(hdle, evtname, ezServiceEvent_Succ);
+		return time;
+	}
+	hdle->pushEvent(hdle, evtname, ezServiceEvent_Fail);
+	return 0;
+}
+
+//----------------------------------------------------------------------------//
+static int player_service_tgetplaytime(ezServiceHandle_t* hdle, ezServiceTypedPara_t* para)
+{
+	(void)para;
+	return player_service_tgettime(hdle, PLY_EVENT_GETPLAYTIME, 0);
+}
+
+//----------------------------------------------------------------------------//
+static int player_service_tgettotaltime(ezServiceHandle_t* hdle, ezServiceTypedPara_t* para)
+{
+	(void)para;
+	return player_service_tgettime(hdle, PLY_EVENT_GETTOTALTIME, 1);
+}
+
+//----------------------------------------------------------------------------//
+static int player_service_tgetscore(ezServiceHandle_t* hdle, ezServiceTypedPara_t* para)
+{
+	playerServiceHandle_t* playerHdle = (playerServiceHandle_t*)hdle->doer;
+	(void)para;
+	if (playerHdle != NULL)
+	{
+		BatchPlayer_t* bp = playerHdle->bp;
+		if (bp->getPlayerType(bp) == PLAYER_TYPE_MUS) {
+			MusPlayer_t* musPlayer = (MusPlayer_t*)bp->getPlayer(bp);
+			if (musPlayer != NULL) {
+				int ret = musPlayer->getScore(ezPlayer(musPlayer), 0);
+				hdle->pushEvent(hdle, PLY_EVENT_GETSCORE, ezServiceEvent_Succ);
+				return ret;
+			}
+		} else if (bp->getPlayerType(bp) == PLAYER_TYPE_VIDEO) {
+			MediaPlayer_t* mmPlayer = (MediaPlayer_t*)bp->getPlayer(bp);
+			if (mmPlayer != NULL) {
+				int ret = mmPlayer->getScore(ezPlayer(mmPlayer), 0);
+				hdle->pushEvent(hdle, PLY_EVENT_GETSCORE, ezServiceEvent_Succ);
+				return ret;
+			}
+		}
+		else
+		{
+			_WARN_NO_PLAYER(hdle->name);
+		}
+	}
+	else
+	{
+		_WARN_NO_INIT(hdle->name);
+	}
+	hdle->pushEvent(hdle, PLY_EVENT_GETSCORE, ezServiceEvent_Fail);
+	return 0;
+}
+
+//----------------------------------------------------------------------------//
+static int player_service_tgetbufferingflag(ezServiceHandle_t* hdle, ezServiceTypedPara_t* para)
+{
+	playerServiceHandle_t* playerHdle = (playerServiceHandle_t*)hdle->doer;
+	(void)para;
+	if (playerHdle != NULL)
+	{
+		BatchPlayer_t* bp = playerHdle->bp;
+		ezPlayer_t* 	player = bp->getPlayerByType(bp, PLAYER_TYPE_MUS);
+		if (player != NULL)
+		{
+			int ret = ((MusPlayer_t*)player)->getBufferingFlag(player, 0);
+			hdle->pushEvent(hdle, PLY_EVENT_GETBUFFERINGFLAG, ezServiceEvent_Succ);
+			return ret;
+		}
+		else
+		{
+			_WARN_NO_PLAYER(hdle->name);
+		}
+	}
+	else
+	{
+		_WARN_NO_INIT(hdle->name);
+	}
+	hdle->pushEvent(hdle, PLY_EVENT_GETBUFFERINGFLAG, ezServiceEvent_Fail);
+	return 0;
+}
+
+//----------------------------------------------------------------------------//
+static int player_service_tgetstate(ezServiceHandle_t* hdle, ezServiceTypedPara_t* para)
+{
+	playerServiceHandle_t* playerHdle = (playerServiceHandle_t*)hdle->doer;
+	const char* state = PLY_EVENT_GETSTATE_STATE_DUMMY;
+	para->oval[0] = EZPLAYER_STATE_DUMMY;
+	para->ostr[0] = '\0';
+	if (playerHdle == NULL)
+	{
+		_WARN_NO_INIT(hdle->name);
+		hdle->pushEvent(hdle, PLY_EVENT_GETSTATE, ezServiceEvent_Fail);
+		return ezService_Err;
+	}
+	ezPlayer_t* player = playerHdle->bp->getPlayer(playerHdle->bp);
+	if (player == NULL)
+	{
+		_WARN_NO_PLAYER(hdle->name);
+		hdle->pushEvent(hdle, PLY_EVENT_GETSTATE, ezServiceEvent_Fail);
+		return ezService_Succ;
+	}
+	switch (player->playInf.state)
+	{
+		case EZPLAYER_STATE_STOPPING:	state = PLY_EVENT_GETSTATE_STATE_STOPPING;	break;
+		case EZPLAYER_STATE_STOPPED:		state = PLY_EVENT_GETSTATE_STATE_STOPPED;	break;
+		case EZPLAYER_STATE_PARSING:		state = PLY_EVENT_GETSTATE_STATE_PARSING;	break;
+		case EZPLAYER_STATE_PLAYING:		state = PLY_EVENT_GETSTATE_STATE_PLAYING;	break;
+		case EZPLAYER_STATE_PAUSING:		state = PLY_EVENT_GETSTATE_STATE_PAUSING;	break;
+		case EZPLAYER_STATE_PAUSED:		state = PLY_EVENT_GETSTATE_STATE_PAUSED;		break;
+		default:									break;
+	}
+	para->oval[0] = player->playInf.state;
+	strcpy(para->ostr, state);
+	hdle->setEventPara(hdle, PLY_EVENT_GETSTATE, PLY_EVENT_GETSTATE_STATE, state);
+	hdle->pushEvent(hdle, PLY_EVENT_GETSTATE, ezServiceEvent_Succ);
+	return ezService_Succ;
+}
+
+//----------------------------------------------------------------------------//
+static int player_service_tsetvol(ezServiceHandle_t* hdle, ezServiceTypedPara_t* para)
+{
+	playerServiceHandle_t* playerHdle = (playerServiceHandle_t*)hdle->doer;
+	if (playerHdle != NULL && para->ival[0] >= 0 && para->ival[0] < EZPLAYER_VOL_COUNT)
+	{
+		BatchPlayer_t* bp = playerHdle->bp;
+		ezSetVolPara_t volPara;
+		int np;
+
+		volPara.volType = para->ival[0];
+		volPara.volValue = para->ival[1];
+		for (np=PLAYER_TYPE_VIDEO; np<PLAYER_TYPE_COUNT; np++)
+		{
+			ezPlayer_t* player = bp->getPlayerByType(bp, np);
+			if (player != NULL)
+				player->setVol(player, &volPara);
+		}
+		return ezService_Succ;
+	}
+	else if (playerHdle == NULL)
+	{
+		_WARN_NO_INIT(hdle->name);
+	}
+	hdle->pushEvent(hdle, PLY_EVENT_SETVOL, ezServiceEvent_Fail);
+	return ezService_Err;
+}
+
+//----------------------------------------------------------------------------//
+static int player_service_tupdateview(ezServiceHandle_t* hdle, ezServiceTypedPara_t* para)
+{
+	playerServiceHandle_t* playerHdle = (playerServiceHandle_t*)hdle->doer;
+	(void)para;
+	if (playerHdle != NULL)
+	{
+		BatchPlayer_t* bp = playerHdle->bp;
+		ezPlayer_t* player = bp->getPlayer(bp);
+		if (player != NULL)
+		{
+			if (bp->getPlayerType(bp) == PLAYER_TYPE_MUS)
+				((MusPlayer_t*)player)->updateView(player, NULL);
+			else if (bp->getPlayerType(bp) == PLAYER_TYPE_VIDEO)
+				((MediaPlayer_t*)player)->updateView(player, NULL);
+			hdle->pushEvent(hdle, PLY_EVENT_UPDATEVIEW, ezServiceEvent_Succ);
+			return ezService_Succ;
+		}
+		else
+		{
+			_WARN_NO_PLAYER(hdle->name);
+		}
+	}
+	else
+	{
+		_WARN_NO_INIT(hdle->name);
+	}
+	hdle->pushEvent(hdle, PLY_EVENT_UPDATEVIEW, ezServiceEvent_Fail);
+	return ezService_Err;
+}
+
 //----------------------------------------------------------------------------//
 EZ_SERVICE_BEGIN_CMD_EXEC_MAP(playerService) 
 	EZ_SERVICE_ADD_CMD_EXEC(PLY_CMD_INIT,										player_service_init)
@@ -2251,3 +2482,14 @@ EZ_SERVICE_BEGIN_CMD_EXEC_MAP(playerService)
 EZ_SERVICE_END_CMD_EXEC_MAP()
 //----------------------------------------------------------------------------//
 
+//----------------------------------------------------------------------------//
+EZ_SERVICE_BEGIN_TYPED_EXEC_MAP(playerTypedService)
+	EZ_SERVICE_ADD_TYPED_EXEC(PLY_TCMD_GETPLAYTIME,			PLY_CMD_GETPLAYTIME,			player_service_tgetplaytime)
+	EZ_SERVICE_ADD_TYPED_EXEC(PLY_TCMD_GETTOTALTIME,			PLY_CMD_GETTOTALTIME,		player_service_tgettotaltime)
+	EZ_SERVICE_ADD_TYPED_EXEC(PLY_TCMD_GETSCORE,				PLY_CMD_GETSCORE,				player_service_tgetscore)
+	EZ_SERVICE_ADD_TYPED_EXEC(PLY_TCMD_GETBUFFERINGFLAG,	PLY_CMD_GETBUFFERINGFLAG,	player_service_tgetbufferingflag)
+	EZ_SERVICE_ADD_TYPED_EXEC(PLY_TCMD_GETSTATE,				PLY_CMD_GETSTATE,				player_service_tgetstate)
+	EZ_SERVICE_ADD_TYPED_EXEC(PLY_TCMD_SETVOL,					PLY_CMD_SETVOL,					player_service_tsetvol)
+	EZ_SERVICE_ADD_TYPED_EXEC(PLY_TCMD_UPDATEVIEW,			PLY_CMD_UPDATEVIEW,			player_service_tupdateview)
+EZ_SERVICE_END_TYPED_EXEC_MAP()
+//----------------------------------------------------------------------------//
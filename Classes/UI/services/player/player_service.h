@@ -232,6 +232,7 @@
 #define _PLAYER_SERVICE_H_
 
 #include <lib/ezbase/ez_service.h>
+#include <serviceTyped.h>
 
 /*
 *========================================
@@ -520,6 +521,11 @@
 #define PLY_CMD_VOICERECORD_MUTETIME				"mutetime"
 #define PLY_CMD_VOICERECORD_THRESHOLD			"threshold"
 #define PLY_CMD_VOICERECORD_RECFILE					"recfile"
+#define PLY_CMD_VOICERECORD_GAIN				"gain"		// x/256, optional
+#define PLY_CMD_VOICERECORD_FORMAT				"format"	// wav, adpcm or pcm, optional
+#define PLY_CMD_VOICERECORD_FORMAT_WAV			"wav"
+#define PLY_CMD_VOICERECORD_FORMAT_ADPCM		"adpcm"
+#define PLY_CMD_VOICERECORD_FORMAT_PCM			"pcm"
 
 /*
 * setspsoundeffect command parameter
@@ -689,14 +695,34 @@
 #define PLY_EVENT_GETLYRIC_STARTTIME								"starttime"
 #define PLY_EVENT_GETLYRIC_ENDTIME									"endtime"
 
+/*
+*========================================
+*	player service typed commands, see serviceTyped.h
+*========================================
+*/
+typedef enum
+{
+	PLY_TCMD_GETPLAYTIME = 0,				// return play time, ms
+	PLY_TCMD_GETTOTALTIME,					// return total time, ms
+	PLY_TCMD_GETSCORE,							// return score
+	PLY_TCMD_GETBUFFERINGFLAG,			// return 1 - buffering, 0 - not buffering
+	PLY_TCMD_GETSTATE,							// oval[0] - EZPLAYER_STATE_XXX, ostr - PLY_EVENT_GETSTATE_STATE_XXX
+	PLY_TCMD_SETVOL,								// ival[0] - ezPlayerVolType_et, ival[1] - value
+	PLY_TCMD_UPDATEVIEW,						// render lyric and staff
+
+	PLY_TCMD_COUNT
+} playerTypedCmd_et;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /* TODO: DECLARE SERVICE REGISTRY */
 EZ_SERVICE_REGISTRY_DECLARE(playerService);
+EZ_SERVICE_TYPED_REGISTRY_DECLARE(playerTypedService);
 /* TODO END */
 int player_service_getplayertime(ezServiceHandle_t* hdle);
+int player_service_voltype(const char* name);	// PLY_CMD_SETVOL_XXX -> ezPlayerVolType_et, -1 if unknown
 
 #ifdef __cplusplus
 }
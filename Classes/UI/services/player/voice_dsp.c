@@ -0,0 +1,702 @@
+/*
+** Copyright (C) 2011 Multak,Inc. All rights reserved
+**
+** Filename : voice_dsp.c
+** Revision : 1.00
+**
+** Description: voice record pcm kernels
+**
+**************************************************************
+**
+** History
+**
+** 1.00
+**       first release
+**
+************************ HOWTO *******************************
+**
+** the SIMD kernels do the bulk of a buffer and return how far they got, the
+** C kernels finish the rest. all sums are integer and never overflow, so the
+** order the lanes add up in does not change a sample.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "voice_dsp.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VOICE_DSP_NEON
+#include <arm_neon.h>
+#if defined(__linux__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VOICE_DSP_SSE2
+#include <emmintrin.h>
+#endif
+
+#define VOICE_DSP_TAPS			16		// taps per phase, more when decimating
+#define VOICE_DSP_MAX_TAPS		64
+#define VOICE_DSP_CUTOFF		0.9		// of the lower nyquist
+#define VOICE_DSP_CNT_FLUSH		4096	// 16 bit lane counters, 8 samples a step
+
+#define VOICE_DSP_PI			3.14159265358979323846
+
+#define voice_dsp_clip(val)		((val) < -32768 ? -32768 : ((val) > 32767 ? 32767 : (val)))
+
+typedef struct {
+	const char* name;
+	int (*gain)(short* buf, int count, int gain);
+	int (*downmix)(short* buf, int frames, int in_chn, int out_chn);
+	int (*silence)(const short* buf, int count, int threshold, voiceDspStat_t* stat);
+	int (*dot)(const short* x, const short* h, int taps);
+
+} voiceDspOps_t;
+
+struct voiceDspResampler {
+	int channels;
+	int up;				// out_rate / gcd
+	int down;			// in_rate / gcd
+	int phases;
+	int taps;
+	short* coef;		// phases * taps, coef[p][j] weighs the j-th oldest sample of the window
+	int pos;			// window start of the next output, frames past the history
+	int frac;			// 0 .. up-1, fraction of the next output past its window end
+	int cap;			// frames per channel past the history
+	short* work;		// channels * (taps - 1 + cap), one deinterleaved line per channel
+};
+
+//----------------------------------------------------------------------------//
+//- C kernels
+//----------------------------------------------------------------------------//
+static int voice_dsp_gain_c(short* buf, int count, int gain)
+{
+	int i;
+	int val;
+
+	for (i=0; i<count; i++) {
+		val = buf[i]*gain/VOICE_DSP_GAIN_UNITY;
+		buf[i] = voice_dsp_clip(val);
+	}
+	return count;
+}
+
+static void voice_dsp_downmix_from(short* buf, int start, int frames, int in_chn, int out_chn)
+{
+	int i;
+	int j;
+	int val;
+	const short* in;
+	short* out;
+
+	// the output never passes the input, a frame is read before it is written
+	for (i=start; i<frames; i++) {
+		in = buf + i*in_chn;
+		out = buf + i*out_chn;
+		val = in[0];
+		for (j=out_chn; j<in_chn; j++)
+			val += in[j];
+		for (j=1; j<out_chn; j++)
+			out[j] = in[j];
+		out[0] = voice_dsp_clip(val);
+	}
+}
+
+static int voice_dsp_downmix_c(short* buf, int frames, int in_chn, int out_chn)
+{
+	voice_dsp_downmix_from(buf, 0, frames, in_chn, out_chn);
+	return frames;
+}
+
+// continues stat over more samples
+static void voice_dsp_silence_from(const short* buf, int start, int count, int threshold, voiceDspStat_t* stat)
+{
+	int i;
+	int val;
+	short sample;
+
+	for (i=start; i<count; i++) {
+		sample = buf[i];
+		val = (sample < 0)? -sample : sample;
+		if (val > 32767)
+			val = 32767;
+		if (val > stat->peak)
+			stat->peak = val;
+
+		// wraps like the old per sample loop, -32768 stays negative
+		if (sample < 0)
+			sample = (short)(0-sample);
+		if (sample > threshold) {
+			stat->loud++;
+			stat->tail = 0;
+		} else {
+			stat->tail++;
+		}
+	}
+}
+
+static int voice_dsp_silence_c(const short* buf, int count, int threshold, voiceDspStat_t* stat)
+{
+	voice_dsp_silence_from(buf, 0, count, threshold, stat);
+	return count;
+}
+
+static int voice_dsp_dot_c(const short* x, const short* h, int taps)
+{
+	int k;
+	int acc = 0;
+
+	for (k=0; k<taps; k++)
+		acc += x[k]*h[k];
+	return acc;
+}
+
+static const voiceDspOps_t voice_dsp_ops_c = {
+	"c",
+	voice_dsp_gain_c,
+	voice_dsp_downmix_c,
+	voice_dsp_silence_c,
+	voice_dsp_dot_c,
+};
+
+//----------------------------------------------------------------------------//
+//- SSE2 kernels
+//----------------------------------------------------------------------------//
+#ifdef VOICE_DSP_SSE2
+static int voice_dsp_gain_sse2(short* buf, int count, int gain)
+{
+	int i;
+	__m128i g = _mm_set1_epi16((short)gain);
+	__m128i x, lo, hi, p0, p1;
+
+	for (i=0; i+8<=count; i+=8) {
+		x = _mm_loadu_si128((const __m128i*)(buf+i));
+		lo = _mm_mullo_epi16(x, g);
+		hi = _mm_mulhi_epi16(x, g);
+		p0 = _mm_unpacklo_epi16(lo, hi);
+		p1 = _mm_unpackhi_epi16(lo, hi);
+		// divide by 256 toward zero, negative products get 255 added first
+		p0 = _mm_srai_epi32(_mm_add_epi32(p0, _mm_srli_epi32(_mm_srai_epi32(p0, 31), 24)), 8);
+		p1 = _mm_srai_epi32(_mm_add_epi32(p1, _mm_srli_epi32(_mm_srai_epi32(p1, 31), 24)), 8);
+		_mm_storeu_si128((__m128i*)(buf+i), _mm_packs_epi32(p0, p1));
+	}
+	return i;
+}
+
+static __m128i voice_dsp_pair_sum_sse2(__m128i a, __m128i b)
+{
+	__m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+	__m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1)));
+
+	return _mm_add_epi32(even, odd);
+}
+
+static int voice_dsp_downmix_sse2(short* buf, int frames, int in_chn, int out_chn)
+{
+	int i = 0;
+	__m128i x0, x1, x2, x3, m0, m1, c;
+
+	if (in_chn == 2 && out_chn == 1) {
+		m0 = _mm_set1_epi16(1);
+		for (; i+8<=frames; i+=8) {
+			x0 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(buf+i*2)), m0);
+			x1 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(buf+i*2+8)), m0);
+			_mm_storeu_si128((__m128i*)(buf+i), _mm_packs_epi32(x0, x1));
+		}
+	} else if (in_chn == 4 && out_chn == 1) {
+		m0 = _mm_set1_epi16(1);
+		for (; i+8<=frames; i+=8) {
+			x0 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(buf+i*4)), m0);
+			x1 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(buf+i*4+8)), m0);
+			x2 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(buf+i*4+16)), m0);
+			x3 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(buf+i*4+24)), m0);
+			_mm_storeu_si128((__m128i*)(buf+i), _mm_packs_epi32(voice_dsp_pair_sum_sse2(x0, x1), voice_dsp_pair_sum_sse2(x2, x3)));
+		}
+	} else if (in_chn == 4 && out_chn == 2) {
+		// channel 0 takes 2 and 3, channel 1 passes
+		m0 = _mm_setr_epi16(1, 0, 1, 1, 1, 0, 1, 1);
+		m1 = _mm_setr_epi16(0, 1, 0, 0, 0, 1, 0, 0);
+		for (; i+4<=frames; i+=4) {
+			x0 = _mm_loadu_si128((const __m128i*)(buf+i*4));
+			x1 = _mm_loadu_si128((const __m128i*)(buf+i*4+8));
+			x2 = voice_dsp_pair_sum_sse2(_mm_madd_epi16(x0, m0), _mm_madd_epi16(x1, m0));
+			c = voice_dsp_pair_sum_sse2(_mm_madd_epi16(x0, m1), _mm_madd_epi16(x1, m1));
+			_mm_storeu_si128((__m128i*)(buf+i*2), _mm_packs_epi32(_mm_unpacklo_epi32(x2, c), _mm_unpackhi_epi32(x2, c)));
+		}
+	}
+	return i;
+}
+
+static int voice_dsp_silence_sse2(const short* buf, int count, int threshold, voiceDspStat_t* stat)
+{
+	int i;
+	int k;
+	int step = 0;
+	int last = -1;
+	int bits = 0;
+	int lane[4];
+	short peak[8];
+	__m128i zero = _mm_setzero_si128();
+	__m128i ones = _mm_set1_epi16(1);
+	__m128i thr = _mm_set1_epi16((short)threshold);
+	__m128i cnt = zero, cnt32 = zero, top = zero;
+	__m128i x, m;
+
+	for (i=0; i+8<=count; i+=8) {
+		x = _mm_loadu_si128((const __m128i*)(buf+i));
+		top = _mm_max_epi16(top, _mm_max_epi16(x, _mm_subs_epi16(zero, x)));
+		m = _mm_cmpgt_epi16(_mm_max_epi16(x, _mm_sub_epi16(zero, x)), thr);
+		cnt = _mm_sub_epi16(cnt, m);
+		k = _mm_movemask_epi8(m);
+		if (k != 0) {
+			last = i;
+			bits = k;
+		}
+		if (++step == VOICE_DSP_CNT_FLUSH) {
+			cnt32 = _mm_add_epi32(cnt32, _mm_madd_epi16(cnt, ones));
+			cnt = zero;
+			step = 0;
+		}
+	}
+	cnt32 = _mm_add_epi32(cnt32, _mm_madd_epi16(cnt, ones));
+
+	_mm_storeu_si128((__m128i*)lane, cnt32);
+	_mm_storeu_si128((__m128i*)peak, top);
+	stat->loud += lane[0] + lane[1] + lane[2] + lane[3];
+	for (k=0; k<8; k++) {
+		if (peak[k] > stat->peak)
+			stat->peak = peak[k];
+	}
+	if (last < 0) {
+		stat->tail += i;
+	} else {
+		// movemask has two bits a lane
+		for (k=7; (bits & (1 << (k*2))) == 0; k--)
+			;
+		stat->tail = i - (last + k) - 1;
+	}
+	return i;
+}
+
+static int voice_dsp_dot_sse2(const short* x, const short* h, int taps)
+{
+	int k;
+	int lane[4];
+	__m128i acc = _mm_setzero_si128();
+
+	for (k=0; k<taps; k+=8)
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(x+k)), _mm_loadu_si128((const __m128i*)(h+k))));
+	_mm_storeu_si128((__m128i*)lane, acc);
+	return lane[0] + lane[1] + lane[2] + lane[3];
+}
+
+static const voiceDspOps_t voice_dsp_ops_simd = {
+	"sse2",
+	voice_dsp_gain_sse2,
+	voice_dsp_downmix_sse2,
+	voice_dsp_silence_sse2,
+	voice_dsp_dot_sse2,
+};
+#endif
+
+//----------------------------------------------------------------------------//
+//- NEON kernels
+//----------------------------------------------------------------------------//
+#ifdef VOICE_DSP_NEON
+static int32x4_t voice_dsp_div256_neon(int32x4_t p)
+{
+	// divide by 256 toward zero, negative products get 255 added first
+	p = vaddq_s32(p, vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(vshrq_n_s32(p, 31)), 24)));
+	return vshrq_n_s32(p, 8);
+}
+
+static int voice_dsp_gain_neon(short* buf, int count, int gain)
+{
+	int i;
+	int16x4_t g = vdup_n_s16((short)gain);
+	int16x8_t x;
+	int32x4_t p0, p1;
+
+	for (i=0; i+8<=count; i+=8) {
+		x = vld1q_s16(buf+i);
+		p0 = voice_dsp_div256_neon(vmull_s16(vget_low_s16(x), g));
+		p1 = voice_dsp_div256_neon(vmull_s16(vget_high_s16(x), g));
+		vst1q_s16(buf+i, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)));
+	}
+	return i;
+}
+
+static int voice_dsp_downmix_neon(short* buf, int frames, int in_chn, int out_chn)
+{
+	int i = 0;
+	int16x8x2_t s;
+	int16x8x4_t q;
+	int32x4_t lo, hi;
+
+	if (in_chn == 2 && out_chn == 1) {
+		for (; i+8<=frames; i+=8) {
+			s = vld2q_s16(buf+i*2);
+			vst1q_s16(buf+i, vqaddq_s16(s.val[0], s.val[1]));
+		}
+	} else if (in_chn == 4 && out_chn == 1) {
+		for (; i+8<=frames; i+=8) {
+			q = vld4q_s16(buf+i*4);
+			lo = vaddw_s16(vaddw_s16(vaddl_s16(vget_low_s16(q.val[0]), vget_low_s16(q.val[1])), vget_low_s16(q.val[2])), vget_low_s16(q.val[3]));
+			hi = vaddw_s16(vaddw_s16(vaddl_s16(vget_high_s16(q.val[0]), vget_high_s16(q.val[1])), vget_high_s16(q.val[2])), vget_high_s16(q.val[3]));
+			vst1q_s16(buf+i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+		}
+	} else if (in_chn == 4 && out_chn == 2) {
+		// channel 0 takes 2 and 3, channel 1 passes
+		for (; i+8<=frames; i+=8) {
+			q = vld4q_s16(buf+i*4);
+			lo = vaddw_s16(vaddl_s16(vget_low_s16(q.val[0]), vget_low_s16(q.val[2])), vget_low_s16(q.val[3]));
+			hi = vaddw_s16(vaddl_s16(vget_high_s16(q.val[0]), vget_high_s16(q.val[2])), vget_high_s16(q.val[3]));
+			s.val[0] = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+			s.val[1] = q.val[1];
+			vst2q_s16(buf+i*2, s);
+		}
+	}
+	return i;
+}
+
+static int voice_dsp_any_neon(uint16x8_t m)
+{
+	uint16x4_t t = vorr_u16(vget_low_u16(m), vget_high_u16(m));
+
+	t = vpmax_u16(t, t);
+	t = vpmax_u16(t, t);
+	return vget_lane_u16(t, 0) != 0;
+}
+
+static int voice_dsp_silence_neon(const short* buf, int count, int threshold, voiceDspStat_t* stat)
+{
+	int i;
+	int k;
+	int step = 0;
+	int last = -1;
+	int lane[4];
+	short peak[8];
+	unsigned short mask[8];
+	int16x8_t thr = vdupq_n_s16((short)threshold);
+	int16x8_t cnt = vdupq_n_s16(0), top = vdupq_n_s16(0);
+	int32x4_t cnt32 = vdupq_n_s32(0);
+	int16x8_t x;
+	uint16x8_t m, lastm = vdupq_n_u16(0);
+
+	for (i=0; i+8<=count; i+=8) {
+		x = vld1q_s16(buf+i);
+		top = vmaxq_s16(top, vqabsq_s16(x));
+		m = vcgtq_s16(vabsq_s16(x), thr);
+		cnt = vsubq_s16(cnt, vreinterpretq_s16_u16(m));
+		if (voice_dsp_any_neon(m)) {
+			last = i;
+			lastm = m;
+		}
+		if (++step == VOICE_DSP_CNT_FLUSH) {
+			cnt32 = vpadalq_s16(cnt32, cnt);
+			cnt = vdupq_n_s16(0);
+			step = 0;
+		}
+	}
+	cnt32 = vpadalq_s16(cnt32, cnt);
+
+	vst1q_s32(lane, cnt32);
+	vst1q_s16(peak, top);
+	stat->loud += lane[0] + lane[1] + lane[2] + lane[3];
+	for (k=0; k<8; k++) {
+		if (peak[k] > stat->peak)
+			stat->peak = peak[k];
+	}
+	if (last < 0) {
+		stat->tail += i;
+	} else {
+		vst1q_u16(mask, lastm);
+		for (k=7; mask[k] == 0; k--)
+			;
+		stat->tail = i - (last + k) - 1;
+	}
+	return i;
+}
+
+static int voice_dsp_dot_neon(const short* x, const short* h, int taps)
+{
+	int k;
+	int lane[4];
+	int16x8_t a, b;
+	int32x4_t acc = vdupq_n_s32(0);
+
+	for (k=0; k<taps; k+=8) {
+		a = vld1q_s16(x+k);
+		b = vld1q_s16(h+k);
+		acc = vmlal_s16(acc, vget_low_s16(a), vget_low_s16(b));
+		acc = vmlal_s16(acc, vget_high_s16(a), vget_high_s16(b));
+	}
+	vst1q_s32(lane, acc);
+	return lane[0] + lane[1] + lane[2] + lane[3];
+}
+
+static const voiceDspOps_t voice_dsp_ops_simd = {
+	"neon",
+	voice_dsp_gain_neon,
+	voice_dsp_downmix_neon,
+	voice_dsp_silence_neon,
+	voice_dsp_dot_neon,
+};
+#endif
+
+//----------------------------------------------------------------------------//
+//- dispatch
+//----------------------------------------------------------------------------//
+static const voiceDspOps_t* voice_dsp_ops_cur = NULL;
+
+static int voice_dsp_cpu_has_simd(void)
+{
+#if defined(VOICE_DSP_NEON) && defined(__linux__) && !defined(__aarch64__) && defined(AT_HWCAP)
+	// armv7 builds with -mfpu=neon may still land on a core without it
+	return (getauxval(AT_HWCAP) & (1 << 12)) != 0;		// HWCAP_NEON
+#elif defined(VOICE_DSP_NEON) || defined(VOICE_DSP_SSE2)
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+const char* voice_dsp_set_simd(int enable)
+{
+	voice_dsp_ops_cur = &voice_dsp_ops_c;
+#if defined(VOICE_DSP_NEON) || defined(VOICE_DSP_SSE2)
+	if (enable && voice_dsp_cpu_has_simd())
+		voice_dsp_ops_cur = &voice_dsp_ops_simd;
+#endif
+	return voice_dsp_ops_cur->name;
+}
+
+// the first caller picks, racing callers pick the same
+static const voiceDspOps_t* voice_dsp_ops(void)
+{
+	if (voice_dsp_ops_cur == NULL)
+		voice_dsp_set_simd(1);
+	return voice_dsp_ops_cur;
+}
+
+//----------------------------------------------------------------------------//
+//- kernels
+//----------------------------------------------------------------------------//
+void voice_dsp_gain(short* buf, int count, int gain)
+{
+	int done;
+
+	if (gain == VOICE_DSP_GAIN_UNITY)
+		return;
+	gain = voice_dsp_clip(gain);
+	done = voice_dsp_ops()->gain(buf, count, gain);
+	voice_dsp_gain_c(buf+done, count-done, gain);
+}
+
+void voice_dsp_downmix(short* buf, int frames, int in_chn, int out_chn)
+{
+	int done;
+
+	if (out_chn <= 0 || out_chn >= in_chn)
+		return;
+	done = voice_dsp_ops()->downmix(buf, frames, in_chn, out_chn);
+	voice_dsp_downmix_from(buf, done, frames, in_chn, out_chn);
+}
+
+void voice_dsp_silence(const short* buf, int count, int threshold, voiceDspStat_t* stat)
+{
+	int done = 0;
+
+	memset(stat, 0, sizeof(voiceDspStat_t));
+
+	// no 16 bit threshold above every sample when it is lower
+	if (threshold >= -32768) {
+		if (threshold > 32767)
+			threshold = 32767;
+		done = voice_dsp_ops()->silence(buf, count, threshold, stat);
+	}
+	voice_dsp_silence_from(buf, done, count, threshold, stat);
+}
+
+//----------------------------------------------------------------------------//
+//- resampler
+//----------------------------------------------------------------------------//
+static int voice_dsp_gcd(int a, int b)
+{
+	int t;
+
+	while (b != 0) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// windowed sinc, each phase quantized to a DC gain of exactly 1.0
+static void voice_dsp_resampler_design(voiceDspResampler_t* rs)
+{
+	int p;
+	int j;
+	int val;
+	int sum;
+	int peak;
+	double fc;
+	double d;
+	double u;
+	double total;
+	double tap[VOICE_DSP_MAX_TAPS];
+	short* coef;
+
+	fc = 0.5*VOICE_DSP_CUTOFF;
+	if (rs->up < rs->down)
+		fc = fc*rs->up/rs->down;
+
+	for (p=0; p<rs->phases; p++) {
+		coef = rs->coef + p*rs->taps;
+		total = 0;
+		for (j=0; j<rs->taps; j++) {
+			// distance of the j-th oldest sample from the output, the peak sits at taps/2
+			d = (rs->taps - 1 - j) + (double)p/rs->phases;
+			u = d - rs->taps/2;
+			tap[j] = (u == 0)? 2*fc : sin(2*VOICE_DSP_PI*fc*u)/(VOICE_DSP_PI*u);
+			tap[j] *= 0.42 - 0.5*cos(2*VOICE_DSP_PI*d/rs->taps) + 0.08*cos(4*VOICE_DSP_PI*d/rs->taps);
+			total += tap[j];
+		}
+
+		sum = 0;
+		peak = 0;
+		for (j=0; j<rs->taps; j++) {
+			val = (int)floor(tap[j]/total*32768 + 0.5);
+			coef[j] = voice_dsp_clip(val);
+			sum += coef[j];
+			if (coef[j] > coef[peak])
+				peak = j;
+		}
+		val = coef[peak] + 32768 - sum;
+		coef[peak] = voice_dsp_clip(val);
+	}
+}
+
+voiceDspResampler_t* voice_dsp_resampler_create(int in_rate, int out_rate, int channels)
+{
+	voiceDspResampler_t* rs;
+	int g;
+
+	if (in_rate <= 0 || out_rate <= 0 || channels <= 0 || channels > VOICE_DSP_MAX_CHANNELS)
+		return NULL;
+
+	rs = calloc(1, sizeof(voiceDspResampler_t));
+	if (rs == NULL)
+		return NULL;
+
+	g = voice_dsp_gcd(in_rate, out_rate);
+	rs->channels = channels;
+	rs->up = out_rate/g;
+	rs->down = in_rate/g;
+	rs->phases = (rs->up < VOICE_DSP_MAX_PHASES)? rs->up : VOICE_DSP_MAX_PHASES;
+
+	// the kernels take taps in eights
+	rs->taps = VOICE_DSP_TAPS;
+	if (rs->down > rs->up)
+		rs->taps = (int)(((long long)VOICE_DSP_TAPS*rs->down + rs->up - 1)/rs->up);
+	rs->taps = (rs->taps + 7) & ~7;
+	if (rs->taps > VOICE_DSP_MAX_TAPS)
+		rs->taps = VOICE_DSP_MAX_TAPS;
+
+	rs->coef = malloc(rs->phases*rs->taps*sizeof(short));
+	if (rs->coef == NULL) {
+		free(rs);
+		return NULL;
+	}
+	voice_dsp_resampler_design(rs);
+
+	return rs;
+}
+
+void voice_dsp_resampler_destroy(voiceDspResampler_t* rs)
+{
+	if (rs != NULL) {
+		free(rs->coef);
+		free(rs->work);
+		free(rs);
+	}
+}
+
+int voice_dsp_resampler_max_out(voiceDspResampler_t* rs, int in_frames)
+{
+	return (int)((long long)in_frames*rs->up/rs->down) + 2;
+}
+
+// lines keep taps - 1 frames of history in front
+static int voice_dsp_resampler_reserve(voiceDspResampler_t* rs, int in_frames)
+{
+	int hist = rs->taps - 1;
+	int cap;
+	int ch;
+	short* work;
+
+	if (in_frames <= rs->cap)
+		return 0;
+
+	cap = (in_frames + 255) & ~255;
+	work = calloc(rs->channels*(hist + cap), sizeof(short));
+	if (work == NULL)
+		return -1;
+	if (rs->work != NULL) {
+		for (ch=0; ch<rs->channels; ch++)
+			memcpy(work + ch*(hist + cap), rs->work + ch*(hist + rs->cap), hist*sizeof(short));
+		free(rs->work);
+	}
+	rs->work = work;
+	rs->cap = cap;
+	return 0;
+}
+
+int voice_dsp_resampler_run(voiceDspResampler_t* rs, const short* in, int in_frames, short* out)
+{
+	const voiceDspOps_t* ops = voice_dsp_ops();
+	int hist = rs->taps - 1;
+	int line;
+	int ch;
+	int i;
+	int n = 0;
+	int val;
+	const short* coef;
+	short* x;
+
+	if (in_frames <= 0)
+		return 0;
+	if (voice_dsp_resampler_reserve(rs, in_frames) != 0)
+		return -1;
+
+	line = hist + rs->cap;
+	for (ch=0; ch<rs->channels; ch++) {
+		x = rs->work + ch*line + hist;
+		for (i=0; i<in_frames; i++)
+			x[i] = in[i*rs->channels + ch];
+	}
+
+	while (rs->pos < in_frames) {
+		coef = rs->coef + (int)((long long)rs->frac*rs->phases/rs->up)*rs->taps;
+		for (ch=0; ch<rs->channels; ch++) {
+			val = (ops->dot(rs->work + ch*line + rs->pos, coef, rs->taps) + 16384) >> 15;
+			out[n*rs->channels + ch] = voice_dsp_clip(val);
+		}
+		n++;
+
+		rs->frac += rs->down;
+		rs->pos += rs->frac/rs->up;
+		rs->frac %= rs->up;
+	}
+	rs->pos -= in_frames;
+
+	for (ch=0; ch<rs->channels; ch++) {
+		x = rs->work + ch*line;
+		memmove(x, x + in_frames, hist*sizeof(short));
+	}
+	return n;
+}
+
@@ -0,0 +1,129 @@
+/*
+** Copyright (C) 2011 Multak,Inc. All rights reserved
+**
+** Filename : voice_dsp.h
+** Revision : 1.00
+**
+** Description: voice record pcm kernels, gain, channel mixing, silence
+**				detection and polyphase resampling of 16 bit interleaved pcm.
+**
+**************************************************************
+**
+** History
+**
+** 1.00
+**       first release
+**
+************************ HOWTO *******************************
+**
+** the kernels pick NEON or SSE2 at the first call when the cpu has it and
+** fall back to plain C. every path gives the same samples, voice_dsp_set_simd
+** forces the C one. see voice_dsp_bench.c for the check and the timings.
+*/
+
+#ifndef _VOICE_DSP_H_
+#define _VOICE_DSP_H_
+
+#define VOICE_DSP_GAIN_UNITY		256		// gain is x/256 like the backends' input volume
+#define VOICE_DSP_MAX_CHANNELS		8
+#define VOICE_DSP_MAX_PHASES		256		// finer fractions use the nearest lower phase
+
+/*
+* silence detection result of one buffer
+*/
+typedef struct {
+	int peak;			// largest saturated magnitude
+	int loud;			// samples above the threshold
+	int tail;			// quiet samples after the last loud one, the whole buffer when loud is 0
+
+} voiceDspStat_t;
+
+/*
+* polyphase resampler of one stream
+*/
+typedef struct voiceDspResampler voiceDspResampler_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Function name  	: voice_dsp_set_simd
+ * Arguments      	: enable - 0 forces the C kernels, 1 uses the cpu's best
+ * Return         	: name of the kernels now in use, "neon", "sse2" or "c"
+ * Description    	: select the kernels, for tests and benchmarks
+ *
+*/
+extern const char* voice_dsp_set_simd(int enable);
+
+/*
+ * Function name  	: voice_dsp_gain
+ * Arguments      	: buf - samples, changed in place
+ *					  count - samples, all channels
+ *					  gain - x/256, VOICE_DSP_GAIN_UNITY keeps the level
+ * Description    	: scale and saturate, rounding toward zero
+ *
+*/
+extern void voice_dsp_gain(short* buf, int count, int gain);
+
+/*
+ * Function name  	: voice_dsp_downmix
+ * Arguments      	: buf - interleaved frames, changed in place
+ *					  frames - frame count
+ *					  in_chn / out_chn - channels, out_chn < in_chn
+ * Description    	: keep the first out_chn channels and add the dropped
+ *					  ones into the first, saturated
+ *
+*/
+extern void voice_dsp_downmix(short* buf, int frames, int in_chn, int out_chn);
+
+/*
+ * Function name  	: voice_dsp_silence
+ * Arguments      	: buf - samples
+ *					  count - samples, all channels
+ *					  threshold - a sample is loud when its magnitude is above it
+ *					  stat - result
+ * Description    	: -32768 counts as quiet, as it always did in voice_record
+ *
+*/
+extern void voice_dsp_silence(const short* buf, int count, int threshold, voiceDspStat_t* stat);
+
+/*
+ * Function name  	: voice_dsp_resampler_create
+ * Arguments      	: in_rate / out_rate - sample rates
+ *					  channels - interleaved channels, 1 .. VOICE_DSP_MAX_CHANNELS
+ * Return         	: resampler, NULL on bad arguments or no memory
+ * Description    	: windowed sinc low pass cut below the lower nyquist,
+ *					  16 taps per phase and more when decimating
+ *
+*/
+extern voiceDspResampler_t* voice_dsp_resampler_create(int in_rate, int out_rate, int channels);
+
+extern void voice_dsp_resampler_destroy(voiceDspResampler_t* rs);
+
+/*
+ * Function name  	: voice_dsp_resampler_max_out
+ * Arguments      	: rs - resampler
+ *					  in_frames - frames of the next run
+ * Return         	: most frames that run can give
+ *
+*/
+extern int voice_dsp_resampler_max_out(voiceDspResampler_t* rs, int in_frames);
+
+/*
+ * Function name  	: voice_dsp_resampler_run
+ * Arguments      	: rs - resampler
+ *					  in / in_frames - interleaved input
+ *					  out - room for voice_dsp_resampler_max_out frames
+ * Return         	: frames written, -1 when out of memory
+ * Description    	: streams, the filter history carries over between calls
+ *
+*/
+extern int voice_dsp_resampler_run(voiceDspResampler_t* rs, const short* in, int in_frames, short* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,281 @@
+//----------------------------------------------------------------------------//
+// Multak 3D GUI Project
+//
+// Filename : voice_dsp_bench.c
+//
+// Description: standalone check and benchmark of the voice_dsp kernels, not
+//				part of the app. runs every kernel on the SIMD path and on the
+//				C path over random, full scale and odd length pcm and fails on
+//				the first sample that differs, then times both paths.
+//
+//	build:	gcc -O2 -DVOICE_DSP_BENCH voice_dsp_bench.c voice_dsp.c -lm
+//	run:	./a.out [-s seconds of pcm to time, 48k stereo]
+//
+//----------------------------------------------------------------------------//
+// History:
+//
+// v1.00 : first release
+//
+//----------------------------------------------------------------------------//
+//
+
+#ifdef VOICE_DSP_BENCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "voice_dsp.h"
+
+#define BENCH_MAX_FRAMES			4100		// odd on purpose, leaves a tail for the C kernels
+#define BENCH_ROUNDS				200
+
+static short BenchIn[BENCH_MAX_FRAMES*VOICE_DSP_MAX_CHANNELS];
+static short BenchC[BENCH_MAX_FRAMES*VOICE_DSP_MAX_CHANNELS*8];
+static short BenchSimd[BENCH_MAX_FRAMES*VOICE_DSP_MAX_CHANNELS*8];
+static int BenchFail = 0;
+
+static unsigned int BenchSeed = 1;
+
+static int Bench_Rand (void)
+{
+	BenchSeed = BenchSeed * 1103515245 + 12345;
+	return (BenchSeed >> 8) & 0xffff;
+}
+
+// kind 0 random, 1 only the extremes, 2 quiet with sparse bursts
+static void Bench_Fill (short *Buf, int Count, int Kind)
+{
+	int		i;
+	int		Val;
+
+	for (i = 0; i < Count; i++)
+	{
+		Val = Bench_Rand ();
+		if (Kind == 1)
+		{
+			Val = (Val & 3) == 0 ? -32768 : ((Val & 3) == 1 ? 32767 : ((Val & 3) == 2 ? -32767 : 0));
+		}
+		else if (Kind == 2)
+		{
+			Val = ((Val & 0x3ff) == 0) ? (short)Bench_Rand () : (Val & 0x3f) - 32;
+		}
+		Buf[i] = (short)Val;
+	}
+}
+
+static double Bench_Now (void)
+{
+	struct timespec		Ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &Ts);
+	return Ts.tv_sec + Ts.tv_nsec / 1e9;
+}
+
+static void Bench_Check (const char *What, const short *A, const short *B, int Count, int Arg0, int Arg1)
+{
+	int		i;
+
+	for (i = 0; i < Count; i++)
+	{
+		if (A[i] != B[i])
+		{
+			printf ("FAIL %s (%d, %d) at %d of %d: c %d simd %d\n", What, Arg0, Arg1, i, Count, A[i], B[i]);
+			BenchFail++;
+			return;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------//
+static void Bench_Exact (void)
+{
+	static const int	Gains[] = { 0, 1, 77, 255, 257, 512, 4000, 32767, 40000, -300, -40000 };
+	static const int	Thresholds[] = { -40000, -32768, -1, 0, 1, 300, 5000, 32766, 32767, 40000 };
+	static const int	Mixes[][2] = { {2, 1}, {4, 1}, {4, 2}, {3, 1}, {6, 2}, {8, 1} };
+	static const int	Rates[][2] = { {48000, 44100}, {44100, 48000}, {48000, 16000}, {8000, 48000}, {32000, 44100}, {44100, 8000}, {11025, 22050}, {48000, 48000} };
+	int					Kind;
+	int					Count;
+	int					n;
+	int					i;
+	int					j;
+	int					Frames;
+	int					OutC;
+	int					OutSimd;
+	voiceDspStat_t		StatC;
+	voiceDspStat_t		StatSimd;
+	voiceDspResampler_t	*RsC;
+	voiceDspResampler_t	*RsSimd;
+
+	for (Kind = 0; Kind < 3; Kind++)
+	{
+		for (Count = 0; Count < 300; Count += 1 + Count / 8)
+		{
+			Bench_Fill (BenchIn, Count * 8, Kind);
+
+			for (n = 0; n < (int)(sizeof(Gains) / sizeof(Gains[0])); n++)
+			{
+				memcpy (BenchC, BenchIn, Count * sizeof(short));
+				memcpy (BenchSimd, BenchIn, Count * sizeof(short));
+				voice_dsp_set_simd (0);
+				voice_dsp_gain (BenchC, Count, Gains[n]);
+				voice_dsp_set_simd (1);
+				voice_dsp_gain (BenchSimd, Count, Gains[n]);
+				Bench_Check ("gain", BenchC, BenchSimd, Count, Gains[n], Count);
+			}
+
+			for (n = 0; n < (int)(sizeof(Mixes) / sizeof(Mixes[0])); n++)
+			{
+				memcpy (BenchC, BenchIn, Count * Mixes[n][0] * sizeof(short));
+				memcpy (BenchSimd, BenchIn, Count * Mixes[n][0] * sizeof(short));
+				voice_dsp_set_simd (0);
+				voice_dsp_downmix (BenchC, Count, Mixes[n][0], Mixes[n][1]);
+				voice_dsp_set_simd (1);
+				voice_dsp_downmix (BenchSimd, Count, Mixes[n][0], Mixes[n][1]);
+				Bench_Check ("downmix", BenchC, BenchSimd, Count * Mixes[n][1], Mixes[n][0], Mixes[n][1]);
+			}
+
+			for (n = 0; n < (int)(sizeof(Thresholds) / sizeof(Thresholds[0])); n++)
+			{
+				voice_dsp_set_simd (0);
+				voice_dsp_silence (BenchIn, Count, Thresholds[n], &StatC);
+				voice_dsp_set_simd (1);
+				voice_dsp_silence (BenchIn, Count, Thresholds[n], &StatSimd);
+				if (memcmp (&StatC, &StatSimd, sizeof(voiceDspStat_t)) != 0)
+				{
+					printf ("FAIL silence (%d, %d): c %d/%d/%d simd %d/%d/%d\n", Thresholds[n], Count,
+						StatC.peak, StatC.loud, StatC.tail, StatSimd.peak, StatSimd.loud, StatSimd.tail);
+					BenchFail++;
+				}
+			}
+		}
+	}
+
+	// long buffers run the lane counters past their flush
+	Bench_Fill (BenchIn, BENCH_MAX_FRAMES * VOICE_DSP_MAX_CHANNELS, 1);
+	voice_dsp_set_simd (0);
+	voice_dsp_silence (BenchIn, BENCH_MAX_FRAMES * VOICE_DSP_MAX_CHANNELS, 0, &StatC);
+	voice_dsp_set_simd (1);
+	voice_dsp_silence (BenchIn, BENCH_MAX_FRAMES * VOICE_DSP_MAX_CHANNELS, 0, &StatSimd);
+	if (memcmp (&StatC, &StatSimd, sizeof(voiceDspStat_t)) != 0)
+	{
+		printf ("FAIL silence long: c %d/%d/%d simd %d/%d/%d\n",
+			StatC.peak, StatC.loud, StatC.tail, StatSimd.peak, StatSimd.loud, StatSimd.tail);
+		BenchFail++;
+	}
+
+	// streams in uneven blocks, the history has to carry over the same way
+	for (Kind = 0; Kind < 3; Kind++)
+	{
+		for (n = 0; n < (int)(sizeof(Rates) / sizeof(Rates[0])); n++)
+		{
+			for (j = 1; j <= 2; j++)
+			{
+				RsC = voice_dsp_resampler_create (Rates[n][0], Rates[n][1], j);
+				RsSimd = voice_dsp_resampler_create (Rates[n][0], Rates[n][1], j);
+				for (i = 0; i < 12; i++)
+				{
+					Frames = 1 + Bench_Rand () % (BENCH_MAX_FRAMES / 2);
+					Bench_Fill (BenchIn, Frames * j, Kind);
+					voice_dsp_set_simd (0);
+					OutC = voice_dsp_resampler_run (RsC, BenchIn, Frames, BenchC);
+					voice_dsp_set_simd (1);
+					OutSimd = voice_dsp_resampler_run (RsSimd, BenchIn, Frames, BenchSimd);
+					if (OutC != OutSimd || OutC > voice_dsp_resampler_max_out (RsC, Frames))
+					{
+						printf ("FAIL resample frames (%d, %d): c %d simd %d\n", Rates[n][0], Rates[n][1], OutC, OutSimd);
+						BenchFail++;
+						break;
+					}
+					Bench_Check ("resample", BenchC, BenchSimd, OutC * j, Rates[n][0], Rates[n][1]);
+				}
+				voice_dsp_resampler_destroy (RsC);
+				voice_dsp_resampler_destroy (RsSimd);
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------//
+static void Bench_Time (const char *Name, int Simd, int Seconds)
+{
+	int					Frames = 1024;			// one 4k stereo read of voice_record
+	int					Blocks = Seconds * 48000 / Frames;
+	int					i;
+	double				t0;
+	double				Gain;
+	double				Mix;
+	double				Silence;
+	double				Resample;
+	voiceDspStat_t		Stat;
+	voiceDspResampler_t	*Rs;
+
+	voice_dsp_set_simd (Simd);
+	Bench_Fill (BenchIn, Frames * 2, 0);
+
+	t0 = Bench_Now ();
+	for (i = 0; i < Blocks; i++)
+	{
+		memcpy (BenchC, BenchIn, Frames * 2 * sizeof(short));
+		voice_dsp_gain (BenchC, Frames * 2, 300);
+	}
+	Gain = Bench_Now () - t0;
+
+	t0 = Bench_Now ();
+	for (i = 0; i < Blocks; i++)
+	{
+		memcpy (BenchC, BenchIn, Frames * 2 * sizeof(short));
+		voice_dsp_downmix (BenchC, Frames, 2, 1);
+	}
+	Mix = Bench_Now () - t0;
+
+	t0 = Bench_Now ();
+	for (i = 0; i < Blocks; i++)
+	{
+		voice_dsp_silence (BenchIn, Frames * 2, 1000, &Stat);
+	}
+	Silence = Bench_Now () - t0;
+
+	Rs = voice_dsp_resampler_create (48000, 44100, 2);
+	t0 = Bench_Now ();
+	for (i = 0; i < Blocks; i++)
+	{
+		voice_dsp_resampler_run (Rs, BenchIn, Frames, BenchC);
+	}
+	Resample = Bench_Now () - t0;
+	voice_dsp_resampler_destroy (Rs);
+
+	// x realtime of 48k stereo
+	printf ("%-5s gain %8.0fx  mix %8.0fx  silence %8.0fx  48k->44.1k %6.0fx\n", Name,
+		Seconds / Gain, Seconds / Mix, Seconds / Silence, Seconds / Resample);
+}
+
+int main (int argc, char *argv[])
+{
+	int			Seconds = 600;
+	const char	*Simd;
+
+	if (argc > 2 && strcmp (argv[1], "-s") == 0)
+	{
+		Seconds = atoi (argv[2]);
+	}
+
+	Simd = voice_dsp_set_simd (1);
+	printf ("kernels: %s\n", Simd);
+
+	Bench_Exact ();
+	if (BenchFail != 0)
+	{
+		printf ("%d mismatches\n", BenchFail);
+		return 1;
+	}
+	printf ("simd and c give the same samples\n");
+
+	Bench_Time ("c", 0, Seconds);
+	Bench_Time (Simd, 1, Seconds);
+
+	return 0;
+}
+
+#endif
@@ -20,35 +20,15 @@
 */
 
 #include "CP_Audio.h"
-#include "UserResample.h"
+#include "voice_dsp.h"
 #include "voice_record.h"
 
 #define VC_RD_SZ (1024*16)
+#define VC_RD_WAIT_MS 100		// srcwait timeout, exitFlag is seen this late at most
+#define VC_RD_POLL_MS 10		// srcread poll when the source has no srcwait, pause after a failed srcwait
+#define VC_RD_BUFFER_MS 4000	// pcm the sink holds while the card stalls
 
-#define aud_trunk_val(min, max, val)	val = ((val)<(min))? (min) : (((val) > (max))? (max) : (val))
-
-typedef struct __WAVE_HEADER1
-{
-    char       					uRiffFcc[4];       // four character code, "RIFF"
-    unsigned int       uFileLen;       // file total length, don't care it
-
-    char       				uWaveFcc[4];       // four character code, "WAVE"
-
-    char				       uFmtFcc[4];        // four character code, "fmt "
-    unsigned int       uFmtDataLen;    // Length of the fmt data (=16)
-    unsigned short   uWavEncodeTag;  // WAVE File Encoding Tag
-    unsigned short   uChannels;      // Channels: 1 = mono, 2 = stereo
-    unsigned int       uSampleRate;    // Samples per second: e.g., 44100
-    unsigned int       uBytesPerSec;   // sample rate * block align
-    unsigned short    uBlockAlign;    // channels * bits/sample / 8
-    unsigned short    uBitsPerSample; // 8 or 16
-
-    char       				uDataFcc[4];       // four character code "data"
-    unsigned int       uSampDataSize;  // Sample data size(n)
-
-} __wave_header_t1;
-
-int voice_pcm_resample(short* in_buf, short* out_buf, int in_rate, int out_rate, int in_chn, int out_chn, int in_len, char* hdle)
+int voice_pcm_resample(short* in_buf, short* out_buf, int in_rate, int out_rate, int in_chn, int out_chn, int in_len, voiceDspResampler_t* hdle)
 {
 	int i;
 	int j;
@@ -59,25 +39,15 @@ int voice_pcm_resample(short* in_buf, short* out_buf, int in_rate, int out_rate,
 			memcpy(out_buf, in_buf, in_len*2*out_chn);
 			return in_len*2*in_chn;
 		} else {
-			return (2*out_chn)*Resample(in_buf, out_buf, in_rate, out_rate, in_len, out_chn, hdle);
+			return (2*out_chn)*voice_dsp_resampler_run(hdle, in_buf, in_len, out_buf);
 		}
 	} else if (in_chn > out_chn) {
-		for (i=0; i<in_len; i++) {
-			for (j=0; j<out_chn; j++) {
-				in_buf[i*out_chn+j] = in_buf[i*in_chn+j];
-			}
-			val = in_buf[i*out_chn];
-			for (; j<in_chn; j++) {
-				val += in_buf[i*in_chn+j];
-			}
-			aud_trunk_val(-32768, 32767, val);
-			in_buf[i*out_chn] = val;
-		} 
+		voice_dsp_downmix(in_buf, in_len, in_chn, out_chn);
 		if (in_rate == out_rate) {
 			memcpy(out_buf, in_buf, in_len*2*out_chn);
 			return in_len*2*out_chn;
 		} else {
-			return (2*out_chn)*Resample(in_buf, out_buf, in_rate, out_rate, in_len, out_chn, hdle);
+			return (2*out_chn)*voice_dsp_resampler_run(hdle, in_buf, in_len, out_buf);
 		}
 	} else {
 		int ret;
@@ -86,7 +56,7 @@ int voice_pcm_resample(short* in_buf, short* out_buf, int in_rate, int out_rate,
 			memcpy(out_buf, in_buf, in_len*2*in_chn);
 			ret = in_len;
 		} else {
-			ret = Resample(in_buf, out_buf, in_rate, out_rate, in_len, in_chn, hdle);
+			ret = voice_dsp_resampler_run(hdle, in_buf, in_len, out_buf);
 		}
 		for (i=ret; i--!=0; ) {
 			for (j=0; j<in_chn; j++) {
@@ -106,36 +76,35 @@ static KRK_TASK_RET_TYPE voice_record_thread(KRK_TASK_ENTRY_ARG arg)
 	voiceRecordHandle_t* hdle = (voiceRecordHandle_t*)arg;
 	CP_AudioIFs* audioIF = (CP_AudioIFs*)hdle->param.audioIf;
 	AUDIO_PARAM audio_para;
-	__wave_header_t1 wavhead;
+	voiceSinkParam_t sink_para;
+	voiceSink_t* sink = NULL;
 	AUDIO_HANDLE audio_hdle = (AUDIO_HANDLE)hdle->param.audioHdle;
 	AUDIO_IN_HANDLE in_hdle = NULL;
 	AUDIO_OUT_HANDLE out_hdle = NULL;
-	char* resample = NULL;
+	voiceDspResampler_t* resample = NULL;
 	
 	int ret;
 	int rsret;
 	int mutetime = 0;
-	int retzerotime = 0;
+	unsigned long lastdata;
 	int unmute = 0;
+	unsigned long overruns = 0;
+	AUDIO_IN_STAT instat;
+	int rschn;
+	voiceDspStat_t stat;
+	voiceSinkStat_t sinkstat;
 	char* buf = malloc(VC_RD_SZ);
-	char* rsbuf = malloc(VC_RD_SZ*8);
-	FILE* fp = fopen(hdle->param.outfile, "wb+");
+	char* rsbuf = NULL;
 
-	mus_printf("voice_record_thread: %s, %d, %d, %d\n", hdle->param.outfile, hdle->param.devsamplerate, hdle->param.channels, hdle->param.mutetime);
+	mus_printf("voice_record_thread: %s, %d, %d, %d, %d\n", hdle->param.outfile, hdle->param.devsamplerate, hdle->param.channels, hdle->param.mutetime, hdle->param.format);
 
-	wavhead.uBitsPerSample = 16;
-	wavhead.uBlockAlign = 2*hdle->param.channels;
-	wavhead.uBytesPerSec = wavhead.uBlockAlign*hdle->param.filesamplerate;
-	wavhead.uChannels = hdle->param.channels;
-	memcpy(wavhead.uDataFcc, "data", 4);
-	wavhead.uFileLen = 0;
-	wavhead.uFmtDataLen = 16;
-	memcpy(wavhead.uFmtFcc, "fmt ", 4);
-	memcpy(wavhead.uRiffFcc, "RIFF ", 4);
-	wavhead.uSampDataSize = 0;
-	wavhead.uSampleRate = hdle->param.filesamplerate;
-	memcpy(wavhead.uWaveFcc, "WAVE ", 4);
-	wavhead.uWavEncodeTag = 1;
+	// mp3 and aac are left to recencoder, they record as wav
+	memset(&sink_para, 0, sizeof(sink_para));
+	sink_para.format = (hdle->param.format == VOICE_REC_PCM)? VOICE_SINK_RAW : ((hdle->param.format == VOICE_REC_ADPCM)? VOICE_SINK_ADPCM : VOICE_SINK_WAV);
+	sink_para.samplerate = hdle->param.filesamplerate;
+	sink_para.channels = hdle->param.channels;
+	sink_para.buffertime = VC_RD_BUFFER_MS;
+	sink = voice_sink_open(hdle->param.outfile, &sink_para);
 	
 	audio_para.CallBack = NULL;
 	audio_para.Channels = hdle->param.channels;
@@ -146,56 +115,70 @@ static KRK_TASK_RET_TYPE voice_record_thread(KRK_TASK_ENTRY_ARG arg)
 	if (audio_hdle != NULL) in_hdle = audioIF->srcopen(audio_hdle, &audio_para);
 	//if (audio_hdle != NULL) out_hdle = audioIF->sinkopen(audio_hdle, &audio_para);
 
-	mus_printf("%x, %x, %x, %x, %x\n", fp, buf, audio_hdle, in_hdle, out_hdle);
+	mus_printf("%x, %x, %x, %x, %x\n", sink, buf, audio_hdle, in_hdle, out_hdle);
 
-	if (fp != NULL 
+	if (sink != NULL 
 		&& buf != NULL
 		&& audio_hdle != NULL
 		//&& out_hdle != NULL
 		&& in_hdle != NULL 
 		)
 	{
-		fwrite(&wavhead, 1, sizeof(__wave_header_t1), fp);
-
-		if (audio_para.SampleRate != hdle->param.filesamplerate || audio_para.Channels != hdle->param.channels)
-			resample = ResampleInit();
+		// the resampler runs on the fewer channels, after a downmix or before an upmix
+		if (audio_para.SampleRate != hdle->param.filesamplerate || audio_para.Channels != hdle->param.channels) {
+			rschn = (audio_para.Channels < hdle->param.channels)? audio_para.Channels : hdle->param.channels;
+			resample = voice_dsp_resampler_create(audio_para.SampleRate, hdle->param.filesamplerate, rschn);
+			if (resample != NULL)
+				rsbuf = malloc(voice_dsp_resampler_max_out(resample, VC_RD_SZ/2/audio_para.Channels)*2*hdle->param.channels);
+			if (rsbuf == NULL) {
+				mus_printf("voice_record_thread: no resampler %d -> %d\n", audio_para.SampleRate, hdle->param.filesamplerate);
+				voice_sink_close(sink, NULL);
+				sink = NULL;
+			}
+		}
 		
-		while (fp != NULL) 
+		lastdata = krk_curTime();
+		while (sink != NULL) 
 		{
 			if (hdle->exitFlag)
 				break;
 		
-			ret = audioIF->srcread(in_hdle, buf, VC_RD_SZ);
+			// a source with srcwait wakes this thread when a buffer is in
+			if (audioIF->srcwait != NULL) {
+				ret = audioIF->srcwait(in_hdle, buf, VC_RD_SZ, VC_RD_WAIT_MS, &instat);
+				if (ret >= 0 && instat.Overruns != overruns) {
+					mus_printf("voice_record_thread: %lu blocks dropped, %lu bytes\n", instat.Overruns - overruns, instat.OverrunBytes);
+					overruns = instat.Overruns;
+				}
+			} else {
+				ret = audioIF->srcread(in_hdle, buf, VC_RD_SZ);
+			}
 			if (ret > 0) {
-				retzerotime = 0;
+				lastdata = krk_curTime();
 				
+				if (hdle->param.gain != 0)
+					voice_dsp_gain((short*)buf, ret/sizeof(short), hdle->param.gain);
+
 				if (hdle->param.read_cb != NULL)
 					hdle->param.read_cb(hdle->param.owner, buf, ret);
 
 				if (resample != NULL) {
 					rsret = voice_pcm_resample((short *)buf,(short *)rsbuf,audio_para.SampleRate,hdle->param.filesamplerate,audio_para.Channels,hdle->param.channels,ret/2/audio_para.Channels, resample);
-					//rsret = 2*hdle->param.channels*Resample((short *)buf,(short *)rsbuf,audio_para.SampleRate,hdle->param.filesamplerate,ret/2/hdle->param.channels,hdle->param.channels,resample);
-					fwrite(rsbuf, 1, rsret, fp);
-					wavhead.uSampDataSize += rsret;
+					if (rsret > 0)
+						voice_sink_write(sink, rsbuf, rsret);
 				} else {
-					fwrite(buf, 1, ret, fp);
-					wavhead.uSampDataSize += ret;
+					voice_sink_write(sink, buf, ret);
 				}
+				voice_sink_get_stat(sink, &sinkstat);
+				krk_os_sema_pend(&hdle->statlock, KRK_OS_WAIT, NULL);
+				hdle->stat = sinkstat;
+				krk_os_sema_post(&hdle->statlock, NULL);
 
-				// check mute
+				// check mute, mutetime counts the quiet samples since the last loud one
 				if (hdle->param.mutetime != 0 && hdle->param.mute_cb != NULL) {
-					int i;
-					for (i=0; i<ret/sizeof(short); i++) {
-						short sample = *((short*)buf+i);
-						if (sample < 0)
-							sample = 0-sample;
-						if (sample > hdle->param.threshold) {
-							mutetime = 0;
-							unmute++;
-						} else {
-							mutetime++;
-						}
-					}
+					voice_dsp_silence((short*)buf, ret/sizeof(short), hdle->param.threshold, &stat);
+					mutetime = (stat.loud != 0)? stat.tail : mutetime + stat.tail;
+					unmute += stat.loud;
 					if (mutetime*1000/hdle->param.channels/audio_para.SampleRate > hdle->param.mutetime) {
 						// mute time fetch
 						mutetime = 0;
@@ -205,31 +188,35 @@ static KRK_TASK_RET_TYPE voice_record_thread(KRK_TASK_ENTRY_ARG arg)
 
 				//memset(buf, 0, VC_RD_SZ);
 				//audioIF->sinkwrite(out_hdle, buf, VC_RD_SZ);
-			} else {
+			} else if (hdle->param.mutetime != 0 && hdle->param.mute_cb != NULL) {
 				//mus_printf("audioIF->srcread %d \n", unmute);
-				retzerotime++;
-				if (retzerotime*10 > hdle->param.mutetime) {
+				// the time really gone without pcm, a wait may return early
+				if (krk_curTime() - lastdata > (unsigned long)hdle->param.mutetime) {
 					// mute time fetch
 					mutetime = 0;
-					retzerotime = 0;
+					lastdata = krk_curTime();
 					hdle->param.mute_cb(hdle->param.owner, &unmute);
 				}
 			}
-			krk_os_sys_sleep(10, NULL);
+			// a failed srcwait returns at once, it must not spin
+			if (audioIF->srcwait == NULL || ret < 0)
+				krk_os_sys_sleep(VC_RD_POLL_MS, NULL);
 		}
 	}
 
-	wavhead.uFileLen = wavhead.uSampDataSize + sizeof(__wave_header_t1) - 8;
-
-	if (resample != NULL) ResampleFinish(resample);
+	if (resample != NULL) voice_dsp_resampler_destroy(resample);
 	if (in_hdle != NULL) audioIF->srcclose(in_hdle);
 	//if (out_hdle != NULL) audioIF->sinkclose(out_hdle);
 	if (buf != NULL) free(buf);
 	if (rsbuf != NULL) free(rsbuf);
-	if (fp != NULL) {
-		fseek(fp, 0, SEEK_SET);
-		fwrite(&wavhead, 1, sizeof(__wave_header_t1), fp);
-		fclose(fp);
+	if (sink != NULL) {
+		voice_sink_close(sink, &sinkstat);
+		krk_os_sema_pend(&hdle->statlock, KRK_OS_WAIT, NULL);
+		hdle->stat = sinkstat;
+		krk_os_sema_post(&hdle->statlock, NULL);
+		mus_printf("voice_record_thread: %llu bytes, %lu writes, %lu/%lu us, queued max %lu of %lu, %llu dropped, error %d\n",
+			sinkstat.written, sinkstat.writes, sinkstat.latavg, sinkstat.latmax,
+			sinkstat.queuedmax, sinkstat.size, sinkstat.dropped, sinkstat.error);
 	}
 	
 	mus_printf("voice_record_thread exit here!\n");
@@ -250,6 +237,11 @@ voiceRecordHandle_t* voice_record_start(voiceRecordParam_t* param)
 	voiceRecordHandle_t* hdle = calloc(1, sizeof(voiceRecordHandle_t));
 	
 	memcpy(&(hdle->param), param, sizeof(voiceRecordParam_t));
+	if (krk_os_sema_create(&(hdle->statlock), "voicestat", 1, NULL) == KRK_OS_RET_FAIL)
+	{
+		mus_printf("Fail to create voice record stat lock\n");
+		KRK_ASSERT(0);
+	}
 	
 	/* create main thread */
 	if (krk_os_task_create(&(hdle->task), "voicerec",voice_record_thread,0x4000,KRK_TASK_PRIORITY_LOW, (void*)hdle) == KRK_OS_RET_FAIL)
@@ -262,6 +254,26 @@ voiceRecordHandle_t* voice_record_start(voiceRecordParam_t* param)
 	return hdle;
 }
 
+/*
+ * Function name  	: voice_record_get_stat
+ * Arguments      	: hdle - voice record handle
+ *					  stat - writer counters as of the last read
+ * Return         	: 0 - succ, <> - error code
+ * Description    	: queue depth and write latency of the recording file
+ *					
+*/
+int voice_record_get_stat(voiceRecordHandle_t* hdle, voiceSinkStat_t* stat)
+{
+	if (hdle != NULL) {
+		krk_os_sema_pend(&(hdle->statlock), KRK_OS_WAIT, NULL);
+		memcpy(stat, &hdle->stat, sizeof(voiceSinkStat_t));
+		krk_os_sema_post(&(hdle->statlock), NULL);
+		return 0;
+	} else {
+		return -1;
+	}
+}
+
 /*
  * Function name  	: voice_record_stop
  * Arguments      	: hdle - voice record handle
@@ -274,6 +286,7 @@ int voice_record_stop(voiceRecordHandle_t* hdle)
 	if (hdle != NULL) {
 		hdle->exitFlag = 1;
 		krk_os_task_destroy(&(hdle->task), NULL);
+		krk_os_sema_destroy(&(hdle->statlock), NULL);
 		free(hdle);
 		mus_printf("voice_record_stop\n");
 		return 0;
@@ -23,6 +23,9 @@
 #define _VOICE_RECORD_H_
 
 #include <k_global.h>
+#include "voice_sink.h"
+
+#define VOICE_REC_GAIN_UNITY	256
 
 /*
 * voice record format
@@ -56,6 +59,7 @@ typedef struct {
 	int format;
 	int mutetime;
 	int threshold;
+	int gain;			// x/256 on the device samples, 0 or VOICE_REC_GAIN_UNITY keeps the level
 	void* audioIf;
 	void* audioHdle;
 	void* owner;
@@ -73,6 +77,8 @@ typedef struct
 	krk_os_task_t task;
 	int					exitFlag;
 	voiceRecordParam_t param;
+	krk_os_sema_t statlock;
+	voiceSinkStat_t stat;		// copied by the record thread after every write, under statlock
 	
 } voiceRecordHandle_t;
 
@@ -89,6 +95,16 @@ extern "C" {
 */
 extern voiceRecordHandle_t* voice_record_start(voiceRecordParam_t* param);
 
+/*
+ * Function name  	: voice_record_get_stat
+ * Arguments      	: hdle - voice record handle
+ *					  stat - writer counters as of the last read
+ * Return         	: 0 - succ, <> - error code
+ * Description    	: queue depth and write latency of the recording file
+ *					
+*/
+extern int voice_record_get_stat(voiceRecordHandle_t* hdle, voiceSinkStat_t* stat);
+
 /*
  * Function name  	: voice_record_stop
  * Arguments      	: hdle - voice record handle
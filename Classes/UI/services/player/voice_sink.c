@@ -0,0 +1,598 @@
+/*
+** Copyright (C) 2011 Multak,Inc. All rights reserved
+**
+** Filename : voice_sink.c
+** Revision : 1.00
+**
+** Description: recording file writer
+**
+**************************************************************
+**
+** History
+**
+** 1.00
+**       first release
+**
+************************ HOWTO *******************************
+**
+** the capture thread is the producer of an AudioRing and the writer thread its
+** consumer, so the pcm is copied once on the way in and written to the file
+** straight from the ring. every write ends on a block boundary of the file,
+** the first one is shorter by the header. only the writer thread touches the
+** file, the header rewrite of a checkpoint included.
+*/
+
+#include <k_global.h>
+#include <errno.h>
+#if defined(_MSC_VER)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "AudioRing.h"
+#include "voice_sink.h"
+
+#define VOICE_SINK_BUFFER_MS		4000
+#define VOICE_SINK_TICK_MS			100		// writer wake up when the pcm trickles, close is seen this late
+#define VOICE_SINK_PAGE				4096
+#define VOICE_SINK_MAX_CHANNELS		8
+#define VOICE_SINK_HEAD_MAX			64
+#define VOICE_SINK_ADPCM_BLOCK		512		// bytes a channel in one adpcm block
+
+struct voiceSink {
+	voiceSinkParam_t param;
+	int framebytes;
+	FILE* fp;
+	AUDIO_RING* ring;
+	krk_os_task_t task;
+	krk_os_sema_t quit;
+	krk_os_sema_t done;
+	krk_os_sema_t lock;				// the writer counters below against voice_sink_get_stat
+
+	// capture thread
+	unsigned long gap;				// dropped pcm still to go in as silence
+	unsigned long queuedmax;
+
+	// writer thread
+	int headsize;
+	unsigned long long offset;		// file bytes, the header included
+	unsigned long long frames;		// pcm frames in the file
+	unsigned long long checked;		// offset at the last checkpoint
+	unsigned long long lastcheck;	// us
+	unsigned long long latsum;
+	unsigned long writes;
+	unsigned long latlast;
+	unsigned long latmax;
+	unsigned long checkpoints;
+	int error;
+
+	// adpcm, whole blocks are encoded from pcm and gathered in out
+	int blockalign;
+	int spb;						// frames a block
+	unsigned char* pcm;
+	int pcmfill;					// bytes
+	unsigned char* out;
+	int outfill;
+	int predictor[VOICE_SINK_MAX_CHANNELS];
+	int index[VOICE_SINK_MAX_CHANNELS];
+};
+
+static const short voice_sink_ima_step[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const signed char voice_sink_ima_index[8] = {
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+//----------------------------------------------------------------------------//
+//- header
+//----------------------------------------------------------------------------//
+static unsigned char* voice_sink_put16(unsigned char* p, unsigned int val)
+{
+	p[0] = (unsigned char)val;
+	p[1] = (unsigned char)(val >> 8);
+	return p + 2;
+}
+
+static unsigned char* voice_sink_put32(unsigned char* p, unsigned long val)
+{
+	p[0] = (unsigned char)val;
+	p[1] = (unsigned char)(val >> 8);
+	p[2] = (unsigned char)(val >> 16);
+	p[3] = (unsigned char)(val >> 24);
+	return p + 4;
+}
+
+static unsigned char* voice_sink_putcc(unsigned char* p, const char* fcc)
+{
+	memcpy(p, fcc, 4);
+	return p + 4;
+}
+
+// a checkpoint counts whole frames or blocks only, the close counts all
+static int voice_sink_header(voiceSink_t* sink, unsigned char* head, int final)
+{
+	unsigned char* p = head;
+	unsigned long long data = sink->offset - sink->headsize;
+	unsigned long long frames = sink->frames;
+	int adpcm = (sink->param.format == VOICE_SINK_ADPCM);
+
+	if (sink->param.format == VOICE_SINK_RAW)
+		return 0;
+
+	if (!final) {
+		if (adpcm) {
+			data -= data%sink->blockalign;
+			frames = data/sink->blockalign*sink->spb;
+		} else {
+			data -= data%sink->framebytes;
+		}
+	}
+	if (data > 0xffffffffUL - VOICE_SINK_HEAD_MAX)
+		data = 0xffffffffUL - VOICE_SINK_HEAD_MAX;
+
+	p = voice_sink_putcc(p, "RIFF");
+	p = voice_sink_put32(p, (unsigned long)data + (adpcm? 52 : 36));
+	p = voice_sink_putcc(p, "WAVE");
+	p = voice_sink_putcc(p, "fmt ");
+	if (adpcm) {
+		p = voice_sink_put32(p, 20);
+		p = voice_sink_put16(p, 0x11);
+		p = voice_sink_put16(p, sink->param.channels);
+		p = voice_sink_put32(p, sink->param.samplerate);
+		p = voice_sink_put32(p, (unsigned long)((long long)sink->param.samplerate*sink->blockalign/sink->spb));
+		p = voice_sink_put16(p, sink->blockalign);
+		p = voice_sink_put16(p, 4);
+		p = voice_sink_put16(p, 2);
+		p = voice_sink_put16(p, sink->spb);
+		p = voice_sink_putcc(p, "fact");
+		p = voice_sink_put32(p, 4);
+		p = voice_sink_put32(p, (unsigned long)frames);
+	} else {
+		p = voice_sink_put32(p, 16);
+		p = voice_sink_put16(p, 1);
+		p = voice_sink_put16(p, sink->param.channels);
+		p = voice_sink_put32(p, sink->param.samplerate);
+		p = voice_sink_put32(p, sink->param.samplerate*sink->framebytes);
+		p = voice_sink_put16(p, sink->framebytes);
+		p = voice_sink_put16(p, 16);
+	}
+	p = voice_sink_putcc(p, "data");
+	p = voice_sink_put32(p, (unsigned long)data);
+
+	return (int)(p - head);
+}
+
+//----------------------------------------------------------------------------//
+//- writer thread
+//----------------------------------------------------------------------------//
+static void voice_sink_put(voiceSink_t* sink, const void* data, int size)
+{
+	unsigned long long t0;
+	unsigned long lat;
+
+	if (sink->error != 0 || size <= 0)
+		return;
+
+	t0 = AudioRing_NowUs();
+	errno = 0;
+	if ((int)fwrite(data, 1, size, sink->fp) != size) {
+		sink->error = (errno != 0)? errno : EIO;
+		mus_printf("voice_sink: write failed %d at %llu, the rest is dropped\n", sink->error, sink->offset);
+		return;
+	}
+	lat = (unsigned long)(AudioRing_NowUs() - t0);
+
+	// 64 bit counters tear on a 32 bit cpu, the reader takes the lock too
+	krk_os_sema_pend(&sink->lock, KRK_OS_WAIT, NULL);
+	sink->offset += size;
+	sink->writes++;
+	sink->latsum += lat;
+	sink->latlast = lat;
+	if (lat > sink->latmax)
+		sink->latmax = lat;
+	krk_os_sema_post(&sink->lock, NULL);
+}
+
+// bytes up to the next block boundary of the file
+static int voice_sink_need(voiceSink_t* sink)
+{
+	return sink->param.blocksize - (int)(sink->offset%sink->param.blocksize);
+}
+
+static void voice_sink_checkpoint(voiceSink_t* sink, int final)
+{
+	unsigned char head[VOICE_SINK_HEAD_MAX];
+	int size;
+	int ret;
+
+	if (sink->error != 0)
+		return;
+
+	size = voice_sink_header(sink, head, final);
+	errno = 0;
+	if (size > 0) {
+		if (fseek(sink->fp, 0, SEEK_SET) != 0
+			|| (int)fwrite(head, 1, size, sink->fp) != size
+			|| fseek(sink->fp, 0, SEEK_END) != 0)
+		{
+			sink->error = (errno != 0)? errno : EIO;
+			mus_printf("voice_sink: header rewrite failed %d\n", sink->error);
+			return;
+		}
+	}
+
+	// the file stays playable up to here even when the power goes
+	errno = 0;
+	ret = fflush(sink->fp);
+#if defined(_MSC_VER)
+	if (ret == 0)
+		ret = _commit(_fileno(sink->fp));
+#else
+	if (ret == 0)
+		ret = fsync(fileno(sink->fp));
+#endif
+	if (ret != 0) {
+		sink->error = (errno != 0)? errno : EIO;
+		mus_printf("voice_sink: sync failed %d at %llu\n", sink->error, sink->offset);
+		return;
+	}
+	krk_os_sema_pend(&sink->lock, KRK_OS_WAIT, NULL);
+	sink->checked = sink->offset;
+	sink->checkpoints++;
+	krk_os_sema_post(&sink->lock, NULL);
+}
+
+static int voice_sink_adpcm_nibble(int* predictor, int* index, int sample)
+{
+	int step = voice_sink_ima_step[*index];
+	int diff = sample - *predictor;
+	int vpdiff = step >> 3;
+	int code = 0;
+
+	if (diff < 0) {
+		code = 8;
+		diff = -diff;
+	}
+	if (diff >= step) {
+		code |= 4;
+		diff -= step;
+		vpdiff += step;
+	}
+	step >>= 1;
+	if (diff >= step) {
+		code |= 2;
+		diff -= step;
+		vpdiff += step;
+	}
+	step >>= 1;
+	if (diff >= step) {
+		code |= 1;
+		vpdiff += step;
+	}
+
+	*predictor += (code & 8)? -vpdiff : vpdiff;
+	if (*predictor > 32767)
+		*predictor = 32767;
+	else if (*predictor < -32768)
+		*predictor = -32768;
+
+	*index += voice_sink_ima_index[code & 7];
+	if (*index < 0)
+		*index = 0;
+	else if (*index > 88)
+		*index = 88;
+
+	return code;
+}
+
+// the first frame goes in the block header, the rest in 8 sample groups a channel
+static void voice_sink_adpcm_block(voiceSink_t* sink, const short* pcm, unsigned char* dst)
+{
+	int ch = sink->param.channels;
+	int c;
+	int g;
+	int k;
+	unsigned char* data;
+
+	memset(dst, 0, sink->blockalign);
+	for (c=0; c<ch; c++) {
+		sink->predictor[c] = pcm[c];
+		voice_sink_put16(dst + 4*c, (unsigned short)pcm[c]);
+		dst[4*c + 2] = (unsigned char)sink->index[c];
+	}
+
+	data = dst + 4*ch;
+	for (g=0; g<(sink->spb - 1)/8; g++) {
+		for (c=0; c<ch; c++) {
+			for (k=0; k<8; k++) {
+				data[k/2] |= voice_sink_adpcm_nibble(&sink->predictor[c], &sink->index[c], pcm[(1 + g*8 + k)*ch + c]) << ((k & 1)*4);
+			}
+			data += 4;
+		}
+	}
+}
+
+// final writes what is left, the last block padded with its last frame
+static void voice_sink_adpcm_flush(voiceSink_t* sink, int final)
+{
+	int need;
+	int full = sink->spb*sink->framebytes;
+
+	if (final && sink->pcmfill > 0) {
+		sink->frames += sink->pcmfill/sink->framebytes;
+		sink->pcmfill -= sink->pcmfill%sink->framebytes;
+		for (; sink->pcmfill>0 && sink->pcmfill<full; sink->pcmfill+=sink->framebytes)
+			memcpy(sink->pcm + sink->pcmfill, sink->pcm + sink->pcmfill - sink->framebytes, sink->framebytes);
+		if (sink->pcmfill == full) {
+			voice_sink_adpcm_block(sink, (const short*)sink->pcm, sink->out + sink->outfill);
+			sink->outfill += sink->blockalign;
+		}
+		sink->pcmfill = 0;
+	}
+
+	while (sink->outfill > 0 && (sink->outfill >= (need = voice_sink_need(sink)) || final)) {
+		if (need > sink->outfill)
+			need = sink->outfill;
+		voice_sink_put(sink, sink->out, need);
+		sink->outfill -= need;
+		memmove(sink->out, sink->out + need, sink->outfill);
+	}
+}
+
+static void voice_sink_drain(voiceSink_t* sink, int final)
+{
+	unsigned long used;
+	unsigned long size;
+	unsigned long take;
+	void* addr;
+	int full;
+
+	if (sink->param.format == VOICE_SINK_ADPCM) {
+		full = sink->spb*sink->framebytes;
+		while ((size = AudioRing_ReadRegion(sink->ring, &addr)) > 0) {
+			take = full - sink->pcmfill;
+			if (take > size)
+				take = size;
+			memcpy(sink->pcm + sink->pcmfill, addr, take);
+			AudioRing_ReadCommit(sink->ring, take);
+			sink->pcmfill += take;
+			if (sink->pcmfill == full) {
+				voice_sink_adpcm_block(sink, (const short*)sink->pcm, sink->out + sink->outfill);
+				sink->outfill += sink->blockalign;
+				sink->frames += sink->spb;
+				sink->pcmfill = 0;
+				voice_sink_adpcm_flush(sink, 0);
+			}
+		}
+		voice_sink_adpcm_flush(sink, final);
+		return;
+	}
+
+	// a region that wraps splits a block in two writes, once a ring round
+	for (;;) {
+		take = voice_sink_need(sink);
+		used = AudioRing_Used(sink->ring);
+		if (used == 0 || (used < take && !final))
+			break;
+		size = AudioRing_ReadRegion(sink->ring, &addr);
+		if (size > take)
+			size = take;
+		voice_sink_put(sink, addr, size);
+		AudioRing_ReadCommit(sink->ring, size);
+		sink->frames = (sink->offset - sink->headsize)/sink->framebytes;
+	}
+}
+
+static KRK_TASK_RET_TYPE voice_sink_thread(KRK_TASK_ENTRY_ARG arg)
+{
+	voiceSink_t* sink = (voiceSink_t*)arg;
+	unsigned long long now;
+	int closing = 0;
+
+	while (!closing) {
+		// the semaphore orders the last pcm of the capture thread before the quit
+		closing = (krk_os_sema_pend(&sink->quit, KRK_OS_NOWAIT, NULL) == KRK_OS_RET_SUCC);
+		if (!closing)
+			AudioRing_WaitData(sink->ring, voice_sink_need(sink), VOICE_SINK_TICK_MS);
+
+		voice_sink_drain(sink, closing);
+
+		now = AudioRing_NowUs();
+		if (closing
+			|| (sink->param.checkpoint > 0 && sink->offset != sink->checked
+				&& now - sink->lastcheck >= (unsigned long long)sink->param.checkpoint*1000))
+		{
+			voice_sink_checkpoint(sink, closing);
+			sink->lastcheck = now;
+		}
+	}
+
+	krk_os_sema_post(&sink->done, NULL);
+	krk_os_task_selfdel();
+
+	return KRK_TASK_RET_VAL;
+}
+
+//----------------------------------------------------------------------------//
+//- interface
+//----------------------------------------------------------------------------//
+static void voice_sink_free(voiceSink_t* sink)
+{
+	if (sink->fp != NULL) fclose(sink->fp);
+	if (sink->ring != NULL) AudioRing_Destroy(sink->ring);
+	if (sink->pcm != NULL) free(sink->pcm);
+	if (sink->out != NULL) free(sink->out);
+	krk_os_sema_destroy(&sink->lock, NULL);
+	free(sink);
+}
+
+voiceSink_t* voice_sink_open(const char* path, voiceSinkParam_t* param)
+{
+	voiceSink_t* sink;
+	unsigned char head[VOICE_SINK_HEAD_MAX];
+	unsigned long bytespersec;
+	unsigned long blocks;
+
+	if (param->channels <= 0 || param->channels > VOICE_SINK_MAX_CHANNELS || param->samplerate <= 0)
+		return NULL;
+
+	sink = calloc(1, sizeof(voiceSink_t));
+	if (sink == NULL)
+		return NULL;
+	if (krk_os_sema_create(&sink->lock, "sinklock", 1, NULL) == KRK_OS_RET_FAIL) {
+		free(sink);
+		return NULL;
+	}
+
+	memcpy(&sink->param, param, sizeof(voiceSinkParam_t));
+	if (sink->param.blocksize <= 0)
+		sink->param.blocksize = VOICE_SINK_BLOCK_SZ;
+	sink->param.blocksize = (sink->param.blocksize + VOICE_SINK_PAGE - 1) & ~(VOICE_SINK_PAGE - 1);
+	if (sink->param.buffertime <= 0)
+		sink->param.buffertime = VOICE_SINK_BUFFER_MS;
+	if (sink->param.checkpoint == 0)
+		sink->param.checkpoint = VOICE_SINK_CHECKPOINT_MS;
+	sink->framebytes = 2*sink->param.channels;
+
+	if (sink->param.format == VOICE_SINK_ADPCM) {
+		sink->blockalign = VOICE_SINK_ADPCM_BLOCK*sink->param.channels;
+		sink->spb = (sink->blockalign - 4*sink->param.channels)*2/sink->param.channels + 1;
+		sink->pcm = malloc(sink->spb*sink->framebytes);
+		sink->out = malloc(sink->param.blocksize + sink->blockalign);
+		if (sink->pcm == NULL || sink->out == NULL) {
+			voice_sink_free(sink);
+			return NULL;
+		}
+	}
+
+	// whole blocks, so a block only wraps when the header shifted it
+	bytespersec = sink->param.samplerate*sink->framebytes;
+	blocks = (unsigned long)(((unsigned long long)bytespersec*sink->param.buffertime/1000 + sink->param.blocksize - 1)/sink->param.blocksize);
+	if (blocks < 2)
+		blocks = 2;
+	sink->ring = AudioRing_Create(blocks*sink->param.blocksize);
+	if (sink->ring == NULL || AudioRing_EnableWait(sink->ring, bytespersec) == -1) {
+		voice_sink_free(sink);
+		return NULL;
+	}
+
+	// the writes are block sized already, stdio would only copy them
+	sink->fp = fopen(path, "wb+");
+	if (sink->fp == NULL) {
+		mus_printf("voice_sink: can't open %s\n", path);
+		voice_sink_free(sink);
+		return NULL;
+	}
+	setvbuf(sink->fp, NULL, _IONBF, 0);
+
+	sink->headsize = voice_sink_header(sink, head, 1);
+	voice_sink_put(sink, head, sink->headsize);
+	sink->checked = sink->offset;
+	sink->lastcheck = AudioRing_NowUs();
+	if (sink->error != 0) {
+		voice_sink_free(sink);
+		return NULL;
+	}
+
+	if (krk_os_sema_create(&sink->quit, "sinkquit", 0, NULL) == KRK_OS_RET_FAIL) {
+		voice_sink_free(sink);
+		return NULL;
+	}
+	if (krk_os_sema_create(&sink->done, "sinkdone", 0, NULL) == KRK_OS_RET_FAIL) {
+		krk_os_sema_destroy(&sink->quit, NULL);
+		voice_sink_free(sink);
+		return NULL;
+	}
+
+	// below the capture thread, it only waits for the card
+	if (krk_os_task_create(&sink->task, "voicesink", voice_sink_thread, 0x4000, KRK_TASK_PRIORITY_LOWLOW, (void*)sink) == KRK_OS_RET_FAIL) {
+		mus_printf("Fail to create voice sink task\n");
+		krk_os_sema_destroy(&sink->quit, NULL);
+		krk_os_sema_destroy(&sink->done, NULL);
+		voice_sink_free(sink);
+		return NULL;
+	}
+
+	return sink;
+}
+
+int voice_sink_write(voiceSink_t* sink, const void* data, int size)
+{
+	unsigned long region;
+	unsigned long used;
+	void* addr;
+
+	// silence for what an earlier overrun dropped goes in first
+	while (sink->gap > 0 && (region = AudioRing_WriteRegion(sink->ring, &addr)) > 0) {
+		if (region > sink->gap)
+			region = sink->gap;
+		memset(addr, 0, region);
+		AudioRing_WriteCommit(sink->ring, region);
+		sink->gap -= region;
+	}
+
+	if (sink->gap > 0 || AudioRing_WriteBlock(sink->ring, data, size) != 0) {
+		if (sink->gap > 0)
+			AudioRing_NoteOverrun(sink->ring, size);
+		sink->gap += size;
+		return -1;
+	}
+
+	used = AudioRing_Used(sink->ring);
+	if (used > sink->queuedmax)
+		sink->queuedmax = used;
+
+	return size;
+}
+
+void voice_sink_get_stat(voiceSink_t* sink, voiceSinkStat_t* stat)
+{
+	AUDIO_RING_STAT ringstat;
+
+	AudioRing_GetStat(sink->ring, &ringstat);
+	stat->queued = ringstat.Used;
+	stat->queuedmax = sink->queuedmax;
+	stat->size = ringstat.Size;
+	stat->dropped = ringstat.OverrunBytes;
+	stat->overruns = ringstat.Overruns;
+
+	krk_os_sema_pend(&sink->lock, KRK_OS_WAIT, NULL);
+	stat->written = sink->offset;
+	stat->writes = sink->writes;
+	stat->latlast = sink->latlast;
+	stat->latmax = sink->latmax;
+	stat->latavg = (sink->writes != 0)? (unsigned long)(sink->latsum/sink->writes) : 0;
+	stat->checkpoints = sink->checkpoints;
+	stat->error = sink->error;
+	krk_os_sema_post(&sink->lock, NULL);
+}
+
+int voice_sink_close(voiceSink_t* sink, voiceSinkStat_t* stat)
+{
+	int ret;
+
+	if (sink == NULL)
+		return -1;
+
+	krk_os_sema_post(&sink->quit, NULL);
+	krk_os_sema_pend(&sink->done, KRK_OS_WAIT, NULL);
+	krk_os_task_destroy(&sink->task, NULL);
+	krk_os_sema_destroy(&sink->quit, NULL);
+	krk_os_sema_destroy(&sink->done, NULL);
+
+	if (stat != NULL)
+		voice_sink_get_stat(sink, stat);
+	ret = sink->error;
+	voice_sink_free(sink);
+
+	return ret;
+}
+
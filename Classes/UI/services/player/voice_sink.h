@@ -0,0 +1,126 @@
+/*
+** Copyright (C) 2011 Multak,Inc. All rights reserved
+**
+** Filename : voice_sink.h
+** Revision : 1.00
+**
+** Description: recording file writer, the capture thread hands pcm over
+**				and a writer thread puts it on the card.
+**
+**************************************************************
+**
+** History
+**
+** 1.00
+**       first release
+**
+************************ HOWTO *******************************
+**
+** voice_sink_write copies into a ring allocated at open and never blocks. the
+** writer thread drains the ring in block sized writes that end on a block
+** boundary of the file, rewrites the header every checkpoint so a crash leaves
+** a playable file, and can encode to ima adpcm on the way. when the card is
+** so slow that the ring fills, the pcm that did not fit is counted and written
+** as silence once there is room again, the file keeps its length.
+*/
+
+#ifndef _VOICE_SINK_H_
+#define _VOICE_SINK_H_
+
+#define VOICE_SINK_BLOCK_SZ			(1024*64)
+#define VOICE_SINK_CHECKPOINT_MS	2000
+
+/*
+* file format
+*/
+typedef enum
+{
+	VOICE_SINK_RAW,			// pcm without a header
+	VOICE_SINK_WAV,			// 16 bit pcm wav
+	VOICE_SINK_ADPCM,		// ima adpcm wav, 4 bits a sample
+
+} voiceSinkFormat_t;
+
+/*
+* voice sink parameters
+*/
+typedef struct {
+	int format;
+	int samplerate;
+	int channels;
+	int blocksize;			// bytes a write, 0 - VOICE_SINK_BLOCK_SZ
+	int buffertime;			// ms of pcm the ring holds, rounded up to blocks
+	int checkpoint;			// ms between header rewrites, 0 - VOICE_SINK_CHECKPOINT_MS, -1 - only at close
+
+} voiceSinkParam_t;
+
+/*
+* voice sink counters
+*/
+typedef struct {
+	unsigned long queued;			// pcm bytes waiting for the writer
+	unsigned long queuedmax;
+	unsigned long size;				// ring bytes
+	unsigned long long written;		// file bytes
+	unsigned long long dropped;		// pcm bytes that did not fit and became silence
+	unsigned long overruns;
+	unsigned long writes;
+	unsigned long latlast;			// us of the last write
+	unsigned long latmax;
+	unsigned long latavg;
+	unsigned long checkpoints;
+	int error;						// 0, or errno of the write that failed, the rest is dropped
+
+} voiceSinkStat_t;
+
+typedef struct voiceSink voiceSink_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Function name  	: voice_sink_open
+ * Arguments      	: path - file, created or truncated
+ *					  param - format and buffering
+ * Return         	: sink, NULL when the file, the memory or the thread fails
+ * Description    	: write the header and start the writer thread
+ *
+*/
+extern voiceSink_t* voice_sink_open(const char* path, voiceSinkParam_t* param);
+
+/*
+ * Function name  	: voice_sink_write
+ * Arguments      	: sink - sink
+ *					  data / size - interleaved 16 bit pcm, whole frames
+ * Return         	: size, -1 when the ring is full and the pcm is dropped
+ * Description    	: copy and return, called from one thread only
+ *
+*/
+extern int voice_sink_write(voiceSink_t* sink, const void* data, int size);
+
+/*
+ * Function name  	: voice_sink_get_stat
+ * Arguments      	: sink - sink
+ *					  stat - counters, latencies of the file writes
+ *
+*/
+extern void voice_sink_get_stat(voiceSink_t* sink, voiceSinkStat_t* stat);
+
+/*
+ * Function name  	: voice_sink_close
+ * Arguments      	: sink - sink
+ *					  stat - final counters, may be NULL
+ * Return         	: 0 - succ, <> - errno of a failed write
+ * Description    	: let the writer drain the ring, write the final header
+ *					  and close the file
+ *
+*/
+extern int voice_sink_close(voiceSink_t* sink, voiceSinkStat_t* stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -20,15 +20,44 @@
 #include <k_global.h>
 #include "recencoder.h"
 
+#define RECENC_MAX_JOBS					4				// each job runs a whole ChaosPlayer
+#define RECENC_PROGRESS_MS				500
+#define RECENC_IDLE_MS						30000			// an idle player is finished after this
+#define RECENC_MAX_NOTIFY				16				// notifies sent per update, the rest wait
+#define RECENC_MAX_HOLD_MS				600000			// live playback holds the jobs this long at most, then one runs
+#define RECENC_UPDATE_LATE_MS			5000			// jobs outstanding and no update for this long, warn
+
+typedef struct s_RecEncHandle RecEncHandle_t;
+typedef struct s_RecEncCBHandle RecEncCBHandle_t;
+
+/*
+* pooled player, set up for one record mode
+*/
+typedef struct s_RecEncWorker
+{
+	void* 								chaosHdle;
+	RecEncHandle_t*				recHdle;
+	krk_os_sema_t					cblock;					// job, notify, stopped and result against the player thread
+	RecEncCBHandle_t*			job;						// NULL when idle
+	int									notify;					// app asked, send the PAUSED/RESUMED feedback
+	int									stopped;				// set by the player thread
+	int									result;
+	int									mixFlag;
+	int									sending;				// PLAY is sent outside the lock
+	int									finish;					// freed while sending, the sender finishes it
+	unsigned long					idleSince;
+} RecEncWorker_t;
+
 /*
 * rec encoder handle
 */
-typedef struct s_RecEncHandle 
+struct s_RecEncHandle
 {
-	ezVector_t* 					cbhdles;
+	ezVector_t* 					cbhdles;				// jobs, first come first served
+	ezVector_t* 					workers;
 	krk_os_sema_t 				vtlock;
 	void*								owner;
-	
+
 	char									cidKey[12];
 	void*								privateKey;
 	int									ringFlag;				// 1, PLAYER_RING_MODE_FIRST_LYRIC, 0, PLAYER_RING_MODE_OFF
@@ -37,20 +66,45 @@ typedef struct s_RecEncHandle
 	int									outlatency;
 	int									bitrate;
 	int									spSound;
-	
+	int									maxJobs;
+	int									live;						// live playback runs, jobs are held
+	unsigned long					liveSince;
+	int									lateWarned;
+	unsigned long					lastTick;
+	unsigned long					lastProgress;
+
 	recEncNotifyCallback_t 	cb;
-	
-} RecEncHandle_t;
+
+};
+
+/*
+* rec encoder callback handle, one encode job, its address is the id
+*/
+struct s_RecEncCBHandle
+{
+	RecEncWorker_t*			worker;				// NULL while queued or done
+	RecEncHandle_t*			recHdle;
+	RecEncoderEncPara_t		para;
+	int								state;					// RecEncoderJobState_et
+	int								userPaused;
+	int								held;
+	int								cancelled;
+	int								result;
+	int								percent;
+	int								reported;				// stop notify sent
+	int								reportedState;		// state of the last progress notify, held as RECENCODER_JOB_HELD
+	unsigned long				activeMs;
+};
 
 /*
-* rec encoder callback handle
+* notify collected under the lock and sent after it
 */
-typedef struct s_RecEncCBHandle 
+typedef struct s_RecEncNotify
 {
-	void* 						chaosHdle;
-	void*						owner;
-	RecEncHandle_t*	recHdle;
-} RecEncCBHandle_t;
+	int						notify;
+	int						result;
+	int						id;
+} RecEncNotify_t;
 
 void *chaos_printf(char* data, void *user)
 {
@@ -60,42 +114,61 @@ void *chaos_printf(char* data, void *user)
 
 void * chaos_msg_cb(PLAYER_MSG ID, void *data, void *user)
 {
-	RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)user;
+	RecEncWorker_t* worker = (RecEncWorker_t*)user;
+	RecEncCBHandle_t* cbhdle;
+	int notify;
 	int result = true;
-	
+
 	if (ID != PLAYER_MSG_FB_EXT_MIDI_SET_SYNC)
 		mus_printf("chaos_msg_cb-> ID=%d\n", ID);
 
+	// the job is only used as the id, destroy may free it after the lock
+	krk_os_sema_pend(&(worker->cblock), KRK_OS_WAIT, NULL);
+	cbhdle = worker->job;
+	notify = worker->notify;
+	if (ID == PLAYER_MSG_FB_CMD_PAUSE || ID == PLAYER_MSG_FB_CMD_RESUME)
+		worker->notify = 0;
+	krk_os_sema_post(&(worker->cblock), NULL);
+
 	switch(ID)
 	{
 		case PLAYER_MSG_FB_CMD_PLAY:
 		{
 			mus_printf("chaos_msg_cb-> Play\n");
-			cbhdle->recHdle->cb(cbhdle->recHdle->owner, RECENCODER_NOTIFY_PLAY, result, (int)cbhdle);
+			if (cbhdle != NULL)
+				worker->recHdle->cb(worker->recHdle->owner, RECENCODER_NOTIFY_PLAY, result, (int)cbhdle);
 			break;
 		}
 		case PLAYER_MSG_FB_CMD_STOP_CAUSED_BY_ERROR:
 		{
-			// wait for app registered callback, for some very fast error stop callback
-			krk_os_sys_sleep(3000, NULL);
 			result = false;
 		}
 		case PLAYER_MSG_FB_CMD_STOP:
 		{
+			// recencoder_update reports it, the job may still be in recencoder_create
 			mus_printf("chaos_msg_cb-> STOP \n");
-			cbhdle->recHdle->cb(cbhdle->recHdle->owner, RECENCODER_NOTIFY_STOPPED, result, (int)cbhdle);
+			krk_os_sema_pend(&(worker->cblock), KRK_OS_WAIT, NULL);
+			worker->result = result;
+			worker->stopped = 1;
+			krk_os_sema_post(&(worker->cblock), NULL);
 			break;
 		}
 		case PLAYER_MSG_FB_CMD_PAUSE:
 		{
 			mus_printf("chaos_msg_cb-> Pause\n");
-			cbhdle->recHdle->cb(cbhdle->recHdle->owner, RECENCODER_NOTIFY_PAUSED, result, (int)cbhdle);
+			if (cbhdle != NULL && notify)
+			{
+				worker->recHdle->cb(worker->recHdle->owner, RECENCODER_NOTIFY_PAUSED, result, (int)cbhdle);
+			}
 			break;
 		}
 		case PLAYER_MSG_FB_CMD_RESUME:
 		{
 			mus_printf("chaos_msg_cb-> Resume\n");
-			cbhdle->recHdle->cb(cbhdle->recHdle->owner, RECENCODER_NOTIFY_RESUMED, result, (int)cbhdle);
+			if (cbhdle != NULL && notify)
+			{
+				worker->recHdle->cb(worker->recHdle->owner, RECENCODER_NOTIFY_RESUMED, result, (int)cbhdle);
+			}
 			break;
 		}
 		default:
@@ -116,94 +189,106 @@ static void recenc_unlock(RecEncHandle_t* hdle)
 	krk_os_sema_post(&(hdle->vtlock), NULL);
 }
 
-void* recencoder_init(RecEncoderInitPara_t* para)
+static RecEncCBHandle_t* recenc_job_at(RecEncHandle_t* h, int i)
 {
-	RecEncHandle_t* hdle = (RecEncHandle_t*)calloc(1, sizeof(RecEncHandle_t));
+	return *(RecEncCBHandle_t**)ez_vector_get(h->cbhdles, i);
+}
 
-	hdle->cbhdles = ez_vector_new(sizeof(RecEncCBHandle_t*), 0);
-	
-	if (krk_os_sema_create(&(hdle->vtlock), "enclock", 1, NULL) == KRK_OS_RET_FAIL)
-	{
-		mus_printf("Fail to create recenc lock\n");
-		KRK_ASSERT(0);
-	}
-	memcpy(hdle->cidKey, para->cidKey, sizeof(hdle->cidKey));
-	hdle->privateKey = para->privateKey;
-	hdle->lameFlag = para->lameFlag;
-	hdle->ringFlag = para->ringFlag;
-	hdle->latency = para->latency;
-	hdle->outlatency = para->outlatency;
-	hdle->bitrate = para->bitrate;
-	hdle->spSound = para->spSound;
-	hdle->cb = para->cb;
-	hdle->owner = para->owner;
-	
-	return hdle;
+static RecEncWorker_t* recenc_worker_at(RecEncHandle_t* h, int i)
+{
+	return *(RecEncWorker_t**)ez_vector_get(h->workers, i);
 }
 
-int recencoder_deinit(void* hdle)
+static RecEncCBHandle_t* recenc_find(RecEncHandle_t* h, int id)
 {
-	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
+	RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)id;
 
-	while (ez_vector_size(h->cbhdles))
-	{
-		RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)ez_vector_get(h->cbhdles, 0);
-		
-		PlayerFinish(cbhdle->chaosHdle);
-		
-		recenc_lock(h);
-		ez_vector_erase(h->cbhdles, 0);
-		recenc_unlock(h);
-	}
-	recenc_lock(h);
-	ez_vector_free(h->cbhdles);
-	recenc_unlock(h);
-	krk_os_sema_destroy(&h->vtlock, NULL);
-	free(h);
+	if (id != 0 && ez_vector_find_pos(h->cbhdles, &cbhdle) != -1)
+		return cbhdle;
+	return NULL;
+}
+
+static void recenc_worker_set_job(RecEncWorker_t* worker, RecEncCBHandle_t* cbhdle)
+{
+	krk_os_sema_pend(&(worker->cblock), KRK_OS_WAIT, NULL);
+	worker->job = cbhdle;
+	worker->notify = 0;
+	worker->stopped = 0;
+	worker->result = true;
+	krk_os_sema_post(&(worker->cblock), NULL);
+}
+
+static void recenc_worker_set_notify(RecEncWorker_t* worker)
+{
+	krk_os_sema_pend(&(worker->cblock), KRK_OS_WAIT, NULL);
+	worker->notify = 1;
+	krk_os_sema_post(&(worker->cblock), NULL);
+}
+
+/*
+ * Function name  	: recenc_limit
+ * Arguments      	: h - rec encoder handle
+ *					  now - krk_curTime
+ * Return         	: jobs that may encode now
+ * Description    	: none while live playback runs, one after it has held
+ *					  the jobs for RECENC_MAX_HOLD_MS, call with the lock held
+ *
+*/
+static int recenc_limit(RecEncHandle_t* h, unsigned long now)
+{
+	if (!h->live)
+		return h->maxJobs;
+	if (now - h->liveSince >= RECENC_MAX_HOLD_MS)
+		return 1;
 	return 0;
 }
 
-int recencoder_create(void* hdle, RecEncoderEncPara_t* para)
+/*
+ * Function name  	: recenc_worker_new
+ * Arguments      	: h - rec encoder handle
+ *					  mixFlag - record mode the player is set up for
+ * Return         	: idle worker, NULL if the player fails
+ * Description    	: create a player and send it everything that is the same
+ *					  for all jobs of this record mode, call with the lock held
+ *
+*/
+static RecEncWorker_t* recenc_worker_new(RecEncHandle_t* h, int mixFlag)
 {
-	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
-	PLAYER_PLAY_MODE PlayMode;
+	RecEncWorker_t* worker;
+	void* chaosHdle = PlayerInit(0);
 	int value = 0;
-	PLAYER_VOCAL_STATUS VocalFade;
-	PLAYER_ENCODER_TYPE Encoder;
-	PLAYER_SOURCE_TYPE	SongSourceType;
-	PLAYER_SOURCE_TYPE	RecSourceType;
-	PLAYER_REC_TYPE RecType = PLAYER_REC_TYPE_REC_ADPCM;
+	PLAYER_PLAY_MODE PlayMode = PLAYER_PLAY_MODE_ENCODE;
+	PLAYER_VOCAL_STATUS VocalFade = PLAYER_VOCAL_OFF;
+	PLAYER_SOURCE_TYPE	SongSourceType = PLAYER_SOURCE_TYPE_FILE;
+	PLAYER_SOURCE_TYPE	RecSourceType = PLAYER_SOURCE_TYPE_FILE;
 	int inChannel = 2;
 	int outChannel = 2;
 	int inRate = 44100;
 	int outRate = 44100;
-	RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)calloc(1, sizeof(RecEncCBHandle_t));	
-	void* chaosHdle = PlayerInit(0);
 	PLAYER_RECORD_MODE recordmode = PLAYER_RECORD_MODE_MIXED_SONG;
 	PLAYER_REPLAY_MODE replaymode = PLAYER_REPLAY_MODE_MIXED_SONG;
 
-	cbhdle->chaosHdle = chaosHdle;
-	cbhdle->recHdle = h;
-	
-	recenc_lock(h);
-	ez_vector_pushback(h->cbhdles, &cbhdle);
-	if (para->latency != 0) {
-		h->latency = para->latency;
-		h->outlatency = para->outLatency;
+	if (chaosHdle == NULL)
+	{
+		mus_printf("recenc_worker_new-> PlayerInit failed\n");
+		return NULL;
 	}
-	recenc_unlock(h);
 
-	mus_printf("recencoder_create->\n");
-	mus_printf("    >mixFlag=%d\n", para->mixFlag);
-	mus_printf("    >MusVol=%d\n", para->MusVol);
-	mus_printf("    >MelodyVol=%d\n", para->MelodyVol);
-	mus_printf("    >RecVol=%d\n", para->RecVol);
-	mus_printf("    >ReverbVol=%d\n", para->ReverbVol);
-	mus_printf("    >spSound=%d\n", h->spSound);
-	mus_printf("    >latency=%d\n", h->latency);
-	mus_printf("    >outlatency=%d\n", h->outlatency);
+	worker = (RecEncWorker_t*)calloc(1, sizeof(RecEncWorker_t));
+	if (krk_os_sema_create(&(worker->cblock), "encwlock", 1, NULL) == KRK_OS_RET_FAIL)
+	{
+		mus_printf("recenc_worker_new-> Fail to create worker lock\n");
+		PlayerFinish(chaosHdle);
+		free(worker);
+		return NULL;
+	}
+	worker->chaosHdle = chaosHdle;
+	worker->recHdle = h;
+	worker->mixFlag = mixFlag;
+	worker->idleSince = krk_curTime();
+	ez_vector_pushback(h->workers, &worker);
 
-	if (para->mixFlag)
+	if (mixFlag)
 	{
 		recordmode = PLAYER_MIXED_RECORD_MODE_VOCAL_ONLY;
 		replaymode = PLAYER_MIXED_REPLAY_MODE_VOCAL_ONLY;
@@ -211,14 +296,10 @@ int recencoder_create(void* hdle, RecEncoderEncPara_t* para)
 
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_RECORD_MODE, &recordmode);
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_REPLAY_MODE, &replaymode);
-	
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_LATENCY, &(h->latency));
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_OUTPUT_LATENCY, &(h->outlatency));
 
-	PlayerMsg(chaosHdle, PLAYER_MSG_SET_FEEDBACK_PRINT_FUNC, (void *)chaos_printf); 
+	PlayerMsg(chaosHdle, PLAYER_MSG_SET_FEEDBACK_PRINT_FUNC, (void *)chaos_printf);
 	PlayerMsg(chaosHdle, PLAYER_MSG_SET_FEEDBACK_MSG_FUNC,(void *)chaos_msg_cb);
-	PlayerMsg(chaosHdle, PLAYER_MSG_SET_FEEDBACK_USER_DATA,(void *)cbhdle);
-	value = 0;
+	PlayerMsg(chaosHdle, PLAYER_MSG_SET_FEEDBACK_USER_DATA,(void *)worker);
 	PlayerMsg(chaosHdle, PLAYER_MSG_SET_MUS_MIDI_ENABLE, (void *)&value);
 
 	if (strlen(h->cidKey) != 0)
@@ -231,35 +312,107 @@ int recencoder_create(void* hdle, RecEncoderEncPara_t* para)
 		mus_printf("imusplayer _MusPlayerCreateRecEncoder, privateKey:%x\n", (unsigned int)(h->privateKey));
 		PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUS_PRIVATE_KEY, (void*)h->privateKey);//����CID�����ܳ�
 	}
-	
-	PlayMode = PLAYER_PLAY_MODE_ENCODE;
-	VocalFade = PLAYER_VOCAL_OFF;
-	if (krk_checksuffix(para->wavePath, "wav") == 0)
+
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MIC_CHANNELS, &(inChannel));
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MIC_SAMPLE_RATE, &(inRate));
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SPK_CHANNELS, &(outChannel));
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SPK_SAMPLE_RATE, &(outRate));
+
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SONG_SOURCE_TYPE, &SongSourceType);
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUS_VOCAL_FADE, &VocalFade);
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_RECORD_SOURCE_TYPE, &RecSourceType);
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_ENCODER_BITRATE, &h->bitrate);
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_PLAY_MODE, &PlayMode);
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_ENCODER_RING_MODE, &h->ringFlag);
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SP_SOUND_ENABLE, &h->spSound);
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUS_REVERB_ENABLE, &value);
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SP_SOUND_AGC_ON, &h->spSound);
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SP_SOUND_COMPRESS_ON, &h->spSound);
+
+	return worker;
+}
+
+static void recenc_worker_free(RecEncHandle_t* h, RecEncWorker_t* worker)
+{
+	int pos = ez_vector_find_pos(h->workers, &worker);
+
+	if (pos != -1)
+		ez_vector_erase(h->workers, pos);
+	recenc_worker_set_job(worker, NULL);
+	// recenc_play finishes it after the PLAY
+	if (worker->sending)
+	{
+		worker->finish = 1;
+		return;
+	}
+	PlayerFinish(worker->chaosHdle);
+	krk_os_sema_destroy(&(worker->cblock), NULL);
+	free(worker);
+}
+
+/*
+ * Function name  	: recenc_play
+ * Arguments      	: h - rec encoder handle
+ *					  started - workers recenc_dispatch started
+ *					  count - number of them
+ * Description    	: send PLAY to the started players, call without the lock,
+ *					  opening the files takes a while and the player may call
+ *					  back from PlayerMsg
+ *
+*/
+static void recenc_play(RecEncHandle_t* h, RecEncWorker_t** started, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
 	{
-		Encoder = PLAYER_ENCODER_TYPE_WAVE;
+		PlayerMsg (started[i]->chaosHdle, PLAYER_MSG_CMD_PLAY, NULL);
 	}
-	else if (krk_checksuffix(para->wavePath, "mp3") == 0)
+
+	recenc_lock(h);
+	for (i = 0; i < count; i++)
+	{
+		started[i]->sending = 0;
+		if (started[i]->finish)
+			recenc_worker_free(h, started[i]);
+	}
+	recenc_unlock(h);
+}
+
+/*
+ * Function name  	: recenc_job_start
+ * Arguments      	: h - rec encoder handle
+ *					  worker - idle worker of the job's record mode
+ *					  cbhdle - queued job
+ * Description    	: send the job's settings, call with the lock held and
+ *					  recenc_play after it
+ *
+*/
+static void recenc_job_start(RecEncHandle_t* h, RecEncWorker_t* worker, RecEncCBHandle_t* cbhdle)
+{
+	void* chaosHdle = worker->chaosHdle;
+	RecEncoderEncPara_t* para = &cbhdle->para;
+	int value = 0;
+	PLAYER_ENCODER_TYPE Encoder = PLAYER_ENCODER_TYPE_WAVE;
+	PLAYER_REC_TYPE RecType = PLAYER_REC_TYPE_REC_ADPCM;
+
+	mus_printf("recenc_job_start-> job=%x player=%x\n", (unsigned int)cbhdle, (unsigned int)chaosHdle);
+
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_LATENCY, &(para->latency));
+	PlayerMsg (chaosHdle, PLAYER_MSG_SET_OUTPUT_LATENCY, &(para->outLatency));
+
+	if (krk_checksuffix(para->wavePath, "mp3") == 0)
 	{
 		if (h->lameFlag)
 			Encoder = PLAYER_ENCODER_TYPE_MP3_LAME;
 		else
 			Encoder = PLAYER_ENCODER_TYPE_MP3_SHINE;
 	}
-	SongSourceType = PLAYER_SOURCE_TYPE_FILE;
-	RecSourceType = PLAYER_SOURCE_TYPE_FILE;
-	
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MIC_CHANNELS, &(inChannel));
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MIC_SAMPLE_RATE, &(inRate));
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SPK_CHANNELS, &(outChannel));
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SPK_SAMPLE_RATE, &(outRate));
 
+	// a pooled player keeps what the last job set, so send the default too
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_ECHO_VOLUME, &para->EchoVol);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SONG_SOURCE_TYPE, &SongSourceType);
-	if (krk_checksuffix(para->filePath, "okf") == 0)
-	{
-		value = 1;
-		PlayerMsg(chaosHdle, PLAYER_MSG_SET_MUS_FORCE_KSC, &value);
-	}
+	value = (krk_checksuffix(para->filePath, "okf") == 0) ? 1 : 0;
+	PlayerMsg(chaosHdle, PLAYER_MSG_SET_MUS_FORCE_KSC, &value);
 	value = 0;
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUSIC_VOLUME, &para->MusVol);
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUS_MIDI_VOLUME, &para->MusVol);
@@ -267,19 +420,10 @@ int recencoder_create(void* hdle, RecEncoderEncPara_t* para)
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUS_MELODY_VOLUME, &para->MelodyVol);
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUSIC_KEY, &para->Key);
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUSIC_TEMPO, &para->Tempo);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUS_VOCAL_FADE, &VocalFade);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_RECORD_SOURCE_TYPE, &RecSourceType);
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_RECORD_VOLUME, &para->RecVol);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_ENCODER_BITRATE, &h->bitrate);
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SONG_NAME, para->songName);
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SINGER_NAME, para->singerName);
 	PlayerMsg (chaosHdle, PLAYER_MSG_SET_ALBUM_NAME, para->albumName);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_PLAY_MODE, &PlayMode);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_ENCODER_RING_MODE, &h->ringFlag);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SP_SOUND_ENABLE, &h->spSound);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUS_REVERB_ENABLE, &value);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SP_SOUND_AGC_ON, &h->spSound);
-	PlayerMsg (chaosHdle, PLAYER_MSG_SET_SP_SOUND_COMPRESS_ON, &h->spSound);
 
 	if (h->spSound)
 	{
@@ -289,7 +433,7 @@ int recencoder_create(void* hdle, RecEncoderEncPara_t* para)
 			PlayerMsg (chaosHdle, PLAYER_MSG_SET_SP_SOUND_MUSIC_VOL, &value);
 			PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUSIC_VOLUME, &para->MusVol);
 		}
-		else 
+		else
 		{
 			PlayerMsg (chaosHdle, PLAYER_MSG_SET_SP_SOUND_MUSIC_VOL, &para->MusVol);
 			PlayerMsg (chaosHdle, PLAYER_MSG_SET_MUSIC_VOLUME, &value);
@@ -324,7 +468,185 @@ int recencoder_create(void* hdle, RecEncoderEncPara_t* para)
 		PlayerMsg (chaosHdle, PLAYER_MSG_SET_ENCODE_PATH, para->wavePath);
 	}
 
-	PlayerMsg (chaosHdle, PLAYER_MSG_CMD_PLAY, NULL);
+	recenc_worker_set_job(worker, cbhdle);
+	worker->sending = 1;
+	cbhdle->worker = worker;
+	cbhdle->state = RECENCODER_JOB_RUNNING;
+}
+
+/*
+ * Function name  	: recenc_dispatch
+ * Arguments      	: h - rec encoder handle
+ *					  started - RECENC_MAX_JOBS workers, filled with the ones started
+ * Return         	: number of started workers, recenc_play them after the unlock
+ * Description    	: start queued jobs in order while less than maxJobs have a
+ *					  player and less than recenc_limit encode, call with the
+ *					  lock held
+ *
+*/
+static int recenc_dispatch(RecEncHandle_t* h, RecEncWorker_t** started)
+{
+	int limit = recenc_limit(h, krk_curTime());
+	int running = 0;
+	int active = 0;
+	int count = 0;
+	int i;
+	int j;
+
+	for (i = 0; i < ez_vector_size(h->workers); i++)
+	{
+		RecEncCBHandle_t* cbhdle = recenc_worker_at(h, i)->job;
+
+		if (cbhdle != NULL)
+		{
+			running++;
+			if (!cbhdle->held && !cbhdle->userPaused)
+				active++;
+		}
+	}
+
+	for (i = 0; i < ez_vector_size(h->cbhdles) && running < h->maxJobs && active < limit; i++)
+	{
+		RecEncCBHandle_t* cbhdle = recenc_job_at(h, i);
+		RecEncWorker_t* worker = NULL;
+		RecEncWorker_t* spare = NULL;
+
+		if (cbhdle->state != RECENCODER_JOB_QUEUED || cbhdle->userPaused)
+			continue;
+
+		for (j = 0; j < ez_vector_size(h->workers); j++)
+		{
+			RecEncWorker_t* w = recenc_worker_at(h, j);
+			if (w->job == NULL)
+			{
+				if (w->mixFlag == cbhdle->para.mixFlag)
+				{
+					worker = w;
+					break;
+				}
+				spare = w;
+			}
+		}
+
+		if (worker == NULL)
+		{
+			// the pool holds maxJobs players at most, swap an idle one of the other mode
+			if (spare != NULL && ez_vector_size(h->workers) >= h->maxJobs)
+				recenc_worker_free(h, spare);
+			worker = recenc_worker_new(h, cbhdle->para.mixFlag);
+		}
+
+		if (worker == NULL)
+		{
+			cbhdle->state = RECENCODER_JOB_DONE;
+			cbhdle->result = false;
+			continue;
+		}
+
+		recenc_job_start(h, worker, cbhdle);
+		started[count++] = worker;
+		running++;
+		active++;
+	}
+	return count;
+}
+
+void* recencoder_init(RecEncoderInitPara_t* para)
+{
+	RecEncHandle_t* hdle = (RecEncHandle_t*)calloc(1, sizeof(RecEncHandle_t));
+
+	hdle->cbhdles = ez_vector_new(sizeof(RecEncCBHandle_t*), 0);
+	hdle->workers = ez_vector_new(sizeof(RecEncWorker_t*), 0);
+
+	if (krk_os_sema_create(&(hdle->vtlock), "enclock", 1, NULL) == KRK_OS_RET_FAIL)
+	{
+		mus_printf("Fail to create recenc lock\n");
+		KRK_ASSERT(0);
+	}
+	memcpy(hdle->cidKey, para->cidKey, sizeof(hdle->cidKey));
+	hdle->privateKey = para->privateKey;
+	hdle->lameFlag = para->lameFlag;
+	hdle->ringFlag = para->ringFlag;
+	hdle->latency = para->latency;
+	hdle->outlatency = para->outlatency;
+	hdle->bitrate = para->bitrate;
+	hdle->spSound = para->spSound;
+	hdle->maxJobs = para->maxJobs;
+	if (hdle->maxJobs <= 0)
+		hdle->maxJobs = 1;
+	if (hdle->maxJobs > RECENC_MAX_JOBS)
+		hdle->maxJobs = RECENC_MAX_JOBS;
+	hdle->cb = para->cb;
+	hdle->owner = para->owner;
+
+	return hdle;
+}
+
+int recencoder_deinit(void* hdle)
+{
+	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
+
+	recenc_lock(h);
+	while (ez_vector_size(h->workers))
+	{
+		recenc_worker_free(h, recenc_worker_at(h, 0));
+	}
+	while (ez_vector_size(h->cbhdles))
+	{
+		free(recenc_job_at(h, 0));
+		ez_vector_erase(h->cbhdles, 0);
+	}
+	ez_vector_free(h->workers);
+	ez_vector_free(h->cbhdles);
+	recenc_unlock(h);
+	krk_os_sema_destroy(&h->vtlock, NULL);
+	free(h);
+	return 0;
+}
+
+int recencoder_create(void* hdle, RecEncoderEncPara_t* para)
+{
+	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
+	RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)calloc(1, sizeof(RecEncCBHandle_t));
+
+	RecEncWorker_t* started[RECENC_MAX_JOBS];
+	unsigned long now = krk_curTime();
+	int count;
+
+	cbhdle->recHdle = h;
+	cbhdle->state = RECENCODER_JOB_QUEUED;
+	cbhdle->reportedState = RECENCODER_JOB_QUEUED;
+	memcpy(&cbhdle->para, para, sizeof(cbhdle->para));
+
+	recenc_lock(h);
+	// STOPPED, CANCELLED and PROGRESS only come from recencoder_update
+	if (ez_vector_size(h->cbhdles) != 0 && h->lastTick != 0 && now - h->lastTick > RECENC_UPDATE_LATE_MS && !h->lateWarned)
+	{
+		mus_printf("recencoder_create-> recencoder_update is not called, jobs are never reported done\n");
+		h->lateWarned = 1;
+	}
+
+	if (para->latency != 0) {
+		h->latency = para->latency;
+		h->outlatency = para->outLatency;
+	}
+	cbhdle->para.latency = h->latency;
+	cbhdle->para.outLatency = h->outlatency;
+
+	mus_printf("recencoder_create->\n");
+	mus_printf("    >mixFlag=%d\n", para->mixFlag);
+	mus_printf("    >MusVol=%d\n", para->MusVol);
+	mus_printf("    >MelodyVol=%d\n", para->MelodyVol);
+	mus_printf("    >RecVol=%d\n", para->RecVol);
+	mus_printf("    >ReverbVol=%d\n", para->ReverbVol);
+	mus_printf("    >spSound=%d\n", h->spSound);
+	mus_printf("    >latency=%d\n", h->latency);
+	mus_printf("    >outlatency=%d\n", h->outlatency);
+
+	ez_vector_pushback(h->cbhdles, &cbhdle);
+	count = recenc_dispatch(h, started);
+	recenc_unlock(h);
+	recenc_play(h, started, count);
 
 	return (int)cbhdle;
 }
@@ -333,17 +655,22 @@ int recencoder_create(void* hdle, RecEncoderEncPara_t* para)
 int recencoder_destroy(void* hdle, int id)
 {
 	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
-	RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)id;
-	
-	PlayerFinish(cbhdle->chaosHdle);
-	
+	RecEncCBHandle_t* cbhdle;
+	RecEncWorker_t* started[RECENC_MAX_JOBS];
+	int count;
+
 	recenc_lock(h);
-	id = ez_vector_find_pos(h->cbhdles, &cbhdle);
-	if (id != -1)
+	cbhdle = recenc_find(h, id);
+	if (cbhdle != NULL)
 	{
-		ez_vector_erase(h->cbhdles, id);
+		// a running job is finished hard, its player is not reused
+		if (cbhdle->worker != NULL)
+			recenc_worker_free(h, cbhdle->worker);
+		ez_vector_erase(h->cbhdles, ez_vector_find_pos(h->cbhdles, &cbhdle));
 		free(cbhdle);
+		count = recenc_dispatch(h, started);
 		recenc_unlock(h);
+		recenc_play(h, started, count);
 		return 0;
 	}
 	recenc_unlock(h);
@@ -352,43 +679,369 @@ int recencoder_destroy(void* hdle, int id)
 
 int recencoder_pause(void* hdle, int id)
 {
-	if (id != 0)
+	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
+	RecEncCBHandle_t* cbhdle;
+	int ret = -1;
+	int notify = 0;
+
+	recenc_lock(h);
+	cbhdle = recenc_find(h, id);
+	if (cbhdle != NULL && cbhdle->state != RECENCODER_JOB_DONE && !cbhdle->userPaused)
 	{
-		RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)id;
-		return PlayerMsg (cbhdle->chaosHdle, PLAYER_MSG_CMD_PAUSE, NULL);
+		cbhdle->userPaused = 1;
+		if (cbhdle->worker != NULL)
+			cbhdle->state = RECENCODER_JOB_PAUSED;
+		if (cbhdle->worker != NULL && !cbhdle->held)
+		{
+			recenc_worker_set_notify(cbhdle->worker);
+			ret = PlayerMsg (cbhdle->worker->chaosHdle, PLAYER_MSG_CMD_PAUSE, NULL);
+		}
+		else
+		{
+			// queued or held, nothing runs that could be paused
+			notify = 1;
+			ret = 0;
+		}
 	}
-	return -1;
+	recenc_unlock(h);
+
+	if (notify)
+		h->cb(h->owner, RECENCODER_NOTIFY_PAUSED, true, id);
+	return ret;
 }
 
 int recencoder_resume(void* hdle, int id)
 {
-	if (id != 0)
+	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
+	RecEncCBHandle_t* cbhdle;
+	RecEncWorker_t* started[RECENC_MAX_JOBS];
+	int count = 0;
+	int ret = -1;
+	int notify = 0;
+
+	recenc_lock(h);
+	cbhdle = recenc_find(h, id);
+	if (cbhdle != NULL && cbhdle->state != RECENCODER_JOB_DONE && cbhdle->userPaused)
 	{
-		RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)id;
-		return PlayerMsg (cbhdle->chaosHdle, PLAYER_MSG_CMD_RESUME, NULL);
+		cbhdle->userPaused = 0;
+		if (cbhdle->worker != NULL)
+			cbhdle->state = RECENCODER_JOB_RUNNING;
+		if (cbhdle->worker != NULL && !cbhdle->held)
+		{
+			recenc_worker_set_notify(cbhdle->worker);
+			ret = PlayerMsg (cbhdle->worker->chaosHdle, PLAYER_MSG_CMD_RESUME, NULL);
+		}
+		else
+		{
+			notify = 1;
+			ret = 0;
+			count = recenc_dispatch(h, started);
+		}
 	}
-	return -1;
+	recenc_unlock(h);
+	recenc_play(h, started, count);
+
+	if (notify)
+		h->cb(h->owner, RECENCODER_NOTIFY_RESUMED, true, id);
+	return ret;
 }
 
-int recencoder_stop(void* hdle, int id)
+static int recenc_stop(RecEncHandle_t* h, int id, int cancel)
 {
-	if (id != 0)
+	RecEncCBHandle_t* cbhdle;
+	int ret = -1;
+
+	recenc_lock(h);
+	cbhdle = recenc_find(h, id);
+	if (cbhdle != NULL && cbhdle->state != RECENCODER_JOB_DONE)
 	{
-		RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)id;
-		return PlayerMsg (cbhdle->chaosHdle, PLAYER_MSG_CMD_STOP, NULL);
+		cbhdle->cancelled = cancel;
+		if (cbhdle->worker != NULL)
+		{
+			ret = PlayerMsg (cbhdle->worker->chaosHdle, PLAYER_MSG_CMD_STOP, NULL);
+		}
+		else
+		{
+			// never started, recencoder_update sends the notify
+			cbhdle->state = RECENCODER_JOB_DONE;
+			cbhdle->result = false;
+			ret = 0;
+		}
 	}
-	return -1;
+	recenc_unlock(h);
+	return ret;
+}
+
+int recencoder_stop(void* hdle, int id)
+{
+	return recenc_stop((RecEncHandle_t*)hdle, id, 0);
+}
+
+/*
+ * Function name  	: recencoder_cancel
+ * Arguments      	: hdle - rec encoder handle
+ *					  id - job
+ * Return         	: 0 - succ, -1 - no such job or done already
+ * Description    	: stop the job and delete its output file, the job gets
+ *					  RECENCODER_NOTIFY_CANCELLED instead of STOPPED
+ *
+*/
+int recencoder_cancel(void* hdle, int id)
+{
+	return recenc_stop((RecEncHandle_t*)hdle, id, 1);
+}
+
+/*
+ * Function name  	: recencoder_setlive
+ * Arguments      	: hdle - rec encoder handle
+ *					  live - 1 while live playback runs
+ * Description    	: running jobs are paused and queued ones wait while live
+ *					  playback runs, the players can't run below its priority.
+ *					  after RECENC_MAX_HOLD_MS of playback one job encodes
+ *					  along with it, the queue is not held forever
+ *
+*/
+int recencoder_setlive(void* hdle, int live)
+{
+	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
+
+	recenc_lock(h);
+	if (live && !h->live)
+		h->liveSince = krk_curTime();
+	h->live = live ? 1 : 0;
+	recenc_unlock(h);
+	return 0;
 }
 
 int recencoder_getpercent(void* hdle, int id)
 {
-	if (id != 0)
+	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
+	RecEncCBHandle_t* cbhdle;
+	int percent = 0;
+
+	recenc_lock(h);
+	cbhdle = recenc_find(h, id);
+	if (cbhdle != NULL)
 	{
-		RecEncCBHandle_t* cbhdle = (RecEncCBHandle_t*)id;
-		int percent = 0;
-		PlayerMsg (cbhdle->chaosHdle, PLAYER_MSG_GET_ENCODE_PERCENT, &percent);
-		return percent;
+		if (cbhdle->worker != NULL)
+			PlayerMsg (cbhdle->worker->chaosHdle, PLAYER_MSG_GET_ENCODE_PERCENT, &cbhdle->percent);
+		percent = cbhdle->percent;
 	}
+	recenc_unlock(h);
+	return percent;
+}
+
+int recencoder_getprogress(void* hdle, int id, RecEncoderProgress_t* progress)
+{
+	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
+	RecEncCBHandle_t* cbhdle;
+	int i;
+
+	memset(progress, 0, sizeof(RecEncoderProgress_t));
+	progress->eta = -1;
+
+	recenc_lock(h);
+	cbhdle = recenc_find(h, id);
+	if (cbhdle == NULL)
+	{
+		recenc_unlock(h);
+		return -1;
+	}
+
+	progress->state = cbhdle->state;
+	if (cbhdle->held)
+		progress->state = RECENCODER_JOB_HELD;
+	progress->percent = cbhdle->percent;
+
+	if (cbhdle->state == RECENCODER_JOB_DONE)
+	{
+		progress->eta = 0;
+	}
+	else if (cbhdle->percent > 0 && cbhdle->percent < 100)
+	{
+		// encode speed so far, only the time the job really ran counts
+		progress->eta = (int)(cbhdle->activeMs * (100 - cbhdle->percent) / cbhdle->percent);
+	}
+
+	if (cbhdle->state == RECENCODER_JOB_QUEUED)
+	{
+		for (i = 0; i < ez_vector_size(h->cbhdles) && recenc_job_at(h, i) != cbhdle; i++)
+		{
+			if (recenc_job_at(h, i)->state == RECENCODER_JOB_QUEUED)
+				progress->position++;
+		}
+		progress->position++;
+	}
+	recenc_unlock(h);
 	return 0;
 }
 
+/*
+ * Function name  	: recencoder_update
+ * Arguments      	: hdle - rec encoder handle
+ *					  timeElapsed - not used, the clock is krk_curTime
+ * Description    	: called by the service update, collects finished jobs,
+ *					  holds or releases jobs around live playback, starts
+ *					  queued jobs and reports progress. the only place that
+ *					  sends STOPPED, CANCELLED and PROGRESS, the player thread
+ *					  just marks its worker stopped
+ *
+*/
+int recencoder_update(void* hdle, int timeElapsed)
+{
+	RecEncHandle_t* h = (RecEncHandle_t*)hdle;
+	RecEncNotify_t notifies[RECENC_MAX_NOTIFY];
+	RecEncWorker_t* started[RECENC_MAX_JOBS];
+	int startCount;
+	int count = 0;
+	unsigned long now = krk_curTime();
+	unsigned long delta;
+	int limit;
+	int active = 0;
+	int progress = 0;
+	int i;
+
+	recenc_lock(h);
+	delta = (h->lastTick != 0) ? now - h->lastTick : 0;
+	h->lastTick = now;
+	h->lateWarned = 0;
+
+	for (i = 0; i < ez_vector_size(h->workers); i++)
+	{
+		RecEncWorker_t* worker = recenc_worker_at(h, i);
+		RecEncCBHandle_t* cbhdle = worker->job;
+		int stopped;
+		int result;
+
+		krk_os_sema_pend(&(worker->cblock), KRK_OS_WAIT, NULL);
+		stopped = worker->stopped;
+		result = worker->result;
+		krk_os_sema_post(&(worker->cblock), NULL);
+
+		if (cbhdle != NULL && stopped)
+		{
+			cbhdle->worker = NULL;
+			cbhdle->state = RECENCODER_JOB_DONE;
+			cbhdle->held = 0;
+			cbhdle->result = result;
+			if (cbhdle->cancelled)
+			{
+				mus_printf("recencoder_update-> cancelled, remove %s\n", cbhdle->para.wavePath);
+				remove(cbhdle->para.wavePath);
+			}
+			else if (result)
+			{
+				cbhdle->percent = 100;
+			}
+			recenc_worker_set_job(worker, NULL);
+			worker->idleSince = now;
+
+			// a player that stopped on an error is not trusted with the next job
+			if (!result)
+			{
+				recenc_worker_free(h, worker);
+				i--;
+			}
+		}
+		else if (cbhdle == NULL && now - worker->idleSince > RECENC_IDLE_MS)
+		{
+			recenc_worker_free(h, worker);
+			i--;
+		}
+	}
+
+	// the oldest jobs run up to the limit, the others are held
+	limit = recenc_limit(h, now);
+	for (i = 0; i < ez_vector_size(h->cbhdles); i++)
+	{
+		RecEncCBHandle_t* cbhdle = recenc_job_at(h, i);
+
+		if (cbhdle->worker == NULL)
+			continue;
+
+		if (active >= limit && !cbhdle->held)
+		{
+			cbhdle->held = 1;
+			if (!cbhdle->userPaused)
+				PlayerMsg (cbhdle->worker->chaosHdle, PLAYER_MSG_CMD_PAUSE, NULL);
+		}
+		else if (active < limit && cbhdle->held)
+		{
+			cbhdle->held = 0;
+			if (!cbhdle->userPaused)
+				PlayerMsg (cbhdle->worker->chaosHdle, PLAYER_MSG_CMD_RESUME, NULL);
+		}
+
+		if (!cbhdle->held && !cbhdle->userPaused)
+		{
+			cbhdle->activeMs += delta;
+			active++;
+		}
+	}
+
+	startCount = recenc_dispatch(h, started);
+
+	if (now - h->lastProgress >= RECENC_PROGRESS_MS)
+	{
+		h->lastProgress = now;
+		progress = 1;
+	}
+
+	for (i = 0; i < ez_vector_size(h->cbhdles) && count < RECENC_MAX_NOTIFY; i++)
+	{
+		RecEncCBHandle_t* cbhdle = recenc_job_at(h, i);
+
+		if (cbhdle->state == RECENCODER_JOB_DONE)
+		{
+			if (!cbhdle->reported)
+			{
+				cbhdle->reported = 1;
+				notifies[count].notify = cbhdle->cancelled ? RECENCODER_NOTIFY_CANCELLED : RECENCODER_NOTIFY_STOPPED;
+				notifies[count].result = cbhdle->cancelled ? true : cbhdle->result;
+				notifies[count].id = (int)cbhdle;
+				count++;
+			}
+		}
+		else
+		{
+			// the state as recencoder_getprogress reports it, a job that
+			// starts, is held or released is reported without waiting for
+			// the next percent
+			int state = cbhdle->held ? RECENCODER_JOB_HELD : cbhdle->state;
+			int changed = 0;
+
+			if (progress && cbhdle->worker != NULL)
+			{
+				int percent = cbhdle->percent;
+
+				PlayerMsg (cbhdle->worker->chaosHdle, PLAYER_MSG_GET_ENCODE_PERCENT, &percent);
+				if (percent != cbhdle->percent)
+				{
+					cbhdle->percent = percent;
+					changed = 1;
+				}
+			}
+			if (state != cbhdle->reportedState)
+			{
+				cbhdle->reportedState = state;
+				changed = 1;
+			}
+			if (changed)
+			{
+				notifies[count].notify = RECENCODER_NOTIFY_PROGRESS;
+				notifies[count].result = true;
+				notifies[count].id = (int)cbhdle;
+				count++;
+			}
+		}
+	}
+	recenc_unlock(h);
+	recenc_play(h, started, startCount);
+
+	// outside the lock, the app may destroy the job in its handler
+	for (i = 0; i < count; i++)
+	{
+		h->cb(h->owner, notifies[i].notify, notifies[i].result, notifies[i].id);
+	}
+	return 0;
+}
@@ -36,10 +36,26 @@ typedef enum {
 	RECENCODER_NOTIFY_PAUSED, 
 	RECENCODER_NOTIFY_RESUMED, 
 	RECENCODER_NOTIFY_STOPPED,
+	RECENCODER_NOTIFY_PROGRESS,
+	RECENCODER_NOTIFY_CANCELLED,
 
 	RECENCODER_NOTIFY_COUNT,
 }RecEncoderNotify_et;
 
+/*
+*	rec encoder job state
+*/
+typedef enum {
+
+	RECENCODER_JOB_QUEUED = 0,			// waits for a free player
+	RECENCODER_JOB_RUNNING,
+	RECENCODER_JOB_PAUSED,					// paused by the app
+	RECENCODER_JOB_HELD,						// paused while live playback runs, for a while at most
+	RECENCODER_JOB_DONE,
+
+	RECENCODER_JOB_COUNT,
+}RecEncoderJobState_et;
+
 /*
 * rec encoder event callback
 */
@@ -57,6 +73,7 @@ typedef struct {
 	int										outlatency;
 	int										bitrate;
 	int										spSound;
+	int										maxJobs;				// jobs encoding at the same time, 0 - 1
 
 	void*									owner;
 	recEncNotifyCallback_t 		cb;
@@ -90,6 +107,17 @@ typedef struct {
 	
 }RecEncoderEncPara_t;
 
+/*
+* Rec encoder job progress
+*/
+typedef struct {
+	int						state;				// RecEncoderJobState_et
+	int						percent;
+	int						eta;					// ms left, -1 - not known yet
+	int						position;			// place in the queue, 1 - starts next, 0 - not queued
+
+}RecEncoderProgress_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -102,6 +130,11 @@ extern int recencoder_pause(void* hdle, int id);
 extern int recencoder_resume(void* hdle, int id);
 extern int recencoder_stop(void* hdle, int id);
 extern int recencoder_getpercent(void* hdle, int id);
+extern int recencoder_cancel(void* hdle, int id);
+extern int recencoder_setlive(void* hdle, int live);
+extern int recencoder_getprogress(void* hdle, int id, RecEncoderProgress_t* progress);
+// must be called regularly, it is the only place that sends STOPPED, CANCELLED and PROGRESS
+extern int recencoder_update(void* hdle, int timeElapsed);
 
 #ifdef __cplusplus
 }
@@ -53,6 +53,18 @@ ezServiceValMap_t gValMapEncoderSongType[] =
 	{PLAYER_SONG_TYPE_OKF_MP3, ENC_CMD_ENCODE_SONG_TYPE_OKFMP3},
 };
 
+/*
+* progress event state names, indexed by RecEncoderJobState_et
+*/
+static const char* gEncJobStateNames[RECENCODER_JOB_COUNT] = 
+{
+	ENC_EVENT_STATE_QUEUED,
+	ENC_EVENT_STATE_RUNNING,
+	ENC_EVENT_STATE_PAUSED,
+	ENC_EVENT_STATE_HELD,
+	ENC_EVENT_STATE_DONE,
+};
+
 //----------------------------------------------------------------------------//
 static void recencoder_notify_callback(void* owner, int notify, int result, int id)
 {
@@ -83,6 +95,26 @@ static void recencoder_notify_callback(void* owner, int notify, int result, int
 			sprintf(eventname, "%s-%d", ENC_EVENT_STOPPED, id);
 			break;
 		}
+		case RECENCODER_NOTIFY_CANCELLED:
+		{
+			sprintf(eventname, "%s-%d", ENC_EVENT_CANCELLED, id);
+			break;
+		}
+		case RECENCODER_NOTIFY_PROGRESS:
+		{
+			RecEncoderProgress_t progress;
+			char sval[32];
+
+			sprintf(eventname, "%s-%d", ENC_EVENT_PROGRESS, id);
+			if (recencoder_getprogress(hdle->doer, id, &progress) != 0)
+				return;
+			itoa(progress.percent, sval, 10);
+			hdle->setEventPara(hdle, eventname, ENC_EVENT_ENCODER_PERCENT, sval);
+			itoa(progress.eta, sval, 10);
+			hdle->setEventPara(hdle, eventname, ENC_EVENT_ENCODER_ETA, sval);
+			hdle->setEventPara(hdle, eventname, ENC_EVENT_ENCODER_STATE, gEncJobStateNames[progress.state]);
+			break;
+		}
 		default:
 		{
 			return;
@@ -100,6 +132,16 @@ static void recencoder_notify_callback(void* owner, int notify, int result, int
 	}
 }
 
+//----------------------------------------------------------------------------//
+static int recencoder_service_update(ezServiceHandle_t* hdle, int timeElapsed)
+{
+	if (hdle->doer != NULL)
+	{
+		return recencoder_update(hdle->doer, timeElapsed);
+	}
+	return -1;
+}
+
 //----------------------------------------------------------------------------//
 static int recencoder_service_init(ezServiceHandle_t* hdle, const char* cmdname, const char* para)
 {
@@ -120,12 +162,14 @@ static int recencoder_service_init(ezServiceHandle_t* hdle, const char* cmdname,
 		hdle->getCmdParaValueInt(hdle, cmdname, ENC_CMD_ENCODE_OUTLATENCY, &(initPara.outlatency));
 		hdle->getCmdParaValueInt(hdle, cmdname, ENC_CMD_ENCODE_BITRATE, &(initPara.bitrate));
 		hdle->getCmdParaValueInt(hdle, cmdname, ENC_CMD_ENCODE_SPSOUND, &(initPara.spSound));
+		hdle->getCmdParaValueInt(hdle, cmdname, ENC_CMD_ENCODE_MAXJOBS, &(initPara.maxJobs));
 		hdle->getCmdParaValueFromMap(hdle, cmdname, ENC_CMD_ENCODE_PRIVATEKEY, gValMapEncPrivateKeys, sizeof(gValMapEncPrivateKeys), (int*)(&(initPara.privateKey)));
 		hdle->getCmdParaValueStr(hdle, cmdname, ENC_CMD_ENCODE_CIDKEY, initPara.cidKey, sizeof(initPara.cidKey));
 		
 		hdle->doer = recencoder_init(&initPara);
 		if (hdle->doer != NULL)
 		{
+			hdle->setUserUpdate(hdle, recencoder_service_update);
 			result = ezServiceEvent_Succ;
 			ret = ezService_Succ;
 		}
@@ -150,6 +194,7 @@ static int recencoder_service_deinit(ezServiceHandle_t* hdle, const char* cmdnam
 	if (hdle->doer != NULL)
 	{
 		ret = recencoder_deinit(hdle->doer);
+		hdle->doer = NULL;
 		result = ezServiceEvent_Succ;
 	}
 	else
@@ -342,6 +387,60 @@ static int recencoder_service_getpercent(ezServiceHandle_t* hdle, const char* cm
 }
 
 
+//----------------------------------------------------------------------------//
+static int recencoder_service_cancelencoder(ezServiceHandle_t* hdle, const char* cmdname, const char* para)
+{
+	ezServiceEventResult_et result = ezServiceEvent_Fail;
+	int ret = -1;
+	if (hdle->doer != NULL)
+	{
+		if (para != NULL)
+		{
+			int id = atoi(para);
+			ret = recencoder_cancel(hdle->doer, id);
+			if (ret == 0)
+				result = ezServiceEvent_Succ;
+		}
+		else
+		{
+			_WARN_NO_PARA(hdle->name, ENC_EVENT_CANCEL);
+		}
+	}
+	else
+	{
+		_WARN_NO_INIT(hdle->name);
+	}
+	hdle->pushEvent(hdle, ENC_EVENT_CANCEL, result);
+	return ret;
+}
+
+
+//----------------------------------------------------------------------------//
+static int recencoder_service_setlive(ezServiceHandle_t* hdle, const char* cmdname, const char* para)
+{
+	ezServiceEventResult_et result = ezServiceEvent_Fail;
+	int ret = -1;
+	if (hdle->doer != NULL)
+	{
+		if (para != NULL)
+		{
+			ret = recencoder_setlive(hdle->doer, atoi(para));
+			result = ezServiceEvent_Succ;
+		}
+		else
+		{
+			_WARN_NO_PARA(hdle->name, ENC_EVENT_SETLIVE);
+		}
+	}
+	else
+	{
+		_WARN_NO_INIT(hdle->name);
+	}
+	hdle->pushEvent(hdle, ENC_EVENT_SETLIVE, result);
+	return ret;
+}
+
+
 //----------------------------------------------------------------------------//
 EZ_SERVICE_BEGIN_CMD_EXEC_MAP(recencoderService) 
 	EZ_SERVICE_ADD_CMD_EXEC(ENC_CMD_INIT,							recencoder_service_init)
@@ -352,6 +451,8 @@ EZ_SERVICE_BEGIN_CMD_EXEC_MAP(recencoderService)
 	EZ_SERVICE_ADD_CMD_EXEC(ENC_CMD_PAUSE,						recencoder_service_pauseencoder)
 	EZ_SERVICE_ADD_CMD_EXEC(ENC_CMD_RESUME,						recencoder_service_resumeencoder)
 	EZ_SERVICE_ADD_CMD_EXEC(ENC_CMD_GETPERCENT,				recencoder_service_getpercent)
+	EZ_SERVICE_ADD_CMD_EXEC(ENC_CMD_CANCEL,						recencoder_service_cancelencoder)
+	EZ_SERVICE_ADD_CMD_EXEC(ENC_CMD_SETLIVE,						recencoder_service_setlive)
 EZ_SERVICE_END_CMD_EXEC_MAP()
 //----------------------------------------------------------------------------//
 
@@ -33,7 +33,9 @@
 **				hdle->setEventCallback(hdle, "paused", handleServiceEncoderCallback);
 **				hdle->setEventCallback(hdle, "resumed", handleServiceEncoderCallback);
 **
-** step3: call service update in your render, timer or some thread, 
+** step3: call service update in your render, timer or some thread, it starts queued
+**			encoders and sends the progress events. the stopped and cancelled events
+**			are sent from the update only, without it an encoder is never reported done
 **
 **				hdle->update(hdle, timeElapsed);
 **
@@ -50,6 +52,7 @@
 **				hdle->setCmdPara(hdle, "init", "bitrate", "128");
 **				hdle->setCmdPara(hdle, "init", "latency", "200");
 **				hdle->setCmdPara(hdle, "init", "outlatency", "100");
+**				hdle->setCmdPara(hdle, "init", "maxjobs", "1");
 **				hdle->exec(hdle, "init", NULL);
 **
 ** step5: create a new encoder:
@@ -71,11 +74,17 @@
 **				hdle->setCmdPara(hdle, "create", "rec", "100");
 **				id = hdle->exec(hdle, "create", NULL);
 **
-** step6: read percentage of encode process
+**			the encoder is queued, at most maxjobs encoders run at the same time
+**
+** step6: read percentage of encode process, or wait for the progress event
 **
 **				itoa(id, sval, 10);
 **				percent = hdle->exec(hdle, "getpercent", sval);
 **
+**			tell the service when live playback starts and ends, encoders wait meanwhile
+**
+**				hdle->exec(hdle, "setlive", "1");
+**
 ** step7: destroy encoder after finished, normally do it in ENC_EVENT_STOPPED callback
 **
 **				itoa(id, sval, 10);
@@ -103,6 +112,7 @@
 **				hdle->setCmdPara(hdle, "init", "bitrate", "128");
 **				hdle->setCmdPara(hdle, "init", "latency", "200");
 **				hdle->setCmdPara(hdle, "init", "outlatency", "100");
+**				hdle->setCmdPara(hdle, "init", "maxjobs", "1");
 **				hdle->exec(hdle, "init", NULL);
 **
 ** ----------------------------------------------------------
@@ -153,6 +163,18 @@
 **				percent = hdle->exec(hdle, "getpercent", sval);
 **
 ** ----------------------------------------------------------
+**	cancel, stop the encoder and delete its out file
+**
+**				itoa(id, sval, 10);
+**				hdle->exec(hdle, "cancel", sval);
+**
+** ----------------------------------------------------------
+**	setlive, 1 - live playback runs, encoders are held, 0 - ended
+**			after 10 minutes of playback one encoder runs along with it
+**
+**				hdle->exec(hdle, "setlive", "1");
+**
+** ----------------------------------------------------------
 ** ----------------------------------------------------------
 **
 ** EVENT DEMES
@@ -166,6 +188,19 @@
 **				hdle->exec(hdle, "destroy", pid);
 **				
 ** ----------------------------------------------------------
+** progress, every 500ms while the percent changes, and at once when the state changes
+**
+**				percent = hdle->getEventParaValue(hdle, "progress-xxx", "percent");
+**				eta = hdle->getEventParaValue(hdle, "progress-xxx", "eta");			// ms, -1 not known yet
+**				state = hdle->getEventParaValue(hdle, "progress-xxx", "state");		// queued, running, paused, held, done
+**
+** ----------------------------------------------------------
+** cancelled, comes instead of stopped after cancel
+**
+**				pid = hdle->getEventParaValue(hdle, "cancelled-xxx", "id");
+**				hdle->exec(hdle, "destroy", pid);
+**				
+** ----------------------------------------------------------
 */
 
 #ifndef _RECENCODER_SERVICE_H_
@@ -186,6 +221,8 @@
 #define ENC_CMD_PAUSE						"pause"
 #define ENC_CMD_RESUME					"resume"
 #define ENC_CMD_GETPERCENT			"getpercent"
+#define ENC_CMD_CANCEL						"cancel"
+#define ENC_CMD_SETLIVE						"setlive"
 
 /*
 *	createencoder cmd parameters name
@@ -214,6 +251,7 @@
 #define ENC_CMD_ENCODE_OUTLATENCY			"outlatency"				// format: outlatency=128
 #define ENC_CMD_ENCODE_MIXFLAG					"mixflag"				// format: mixflag=1
 #define ENC_CMD_ENCODE_SPSOUND				"spsound"				// format: spsound=1
+#define ENC_CMD_ENCODE_MAXJOBS				"maxjobs"				// format: maxjobs=2
 
 /*
 *	createencoder cmd songtype parameter values
@@ -247,16 +285,32 @@
 #define ENC_EVENT_PAUSE						ENC_CMD_PAUSE
 #define ENC_EVENT_RESUME						ENC_CMD_RESUME
 #define ENC_EVENT_GETPERCENT			ENC_CMD_GETPERCENT
+#define ENC_EVENT_CANCEL						ENC_CMD_CANCEL
+#define ENC_EVENT_SETLIVE					ENC_CMD_SETLIVE
 
 #define ENC_EVENT_PLAY							"play"
 #define ENC_EVENT_STOPPED					"stopped"
 #define ENC_EVENT_PAUSED						"paused"
 #define ENC_EVENT_RESUMED					"resumed"
+#define ENC_EVENT_PROGRESS				"progress"
+#define ENC_EVENT_CANCELLED				"cancelled"
 
 /*
 *	encodend event parameter
 */
 #define ENC_EVENT_ENCODER_ID				"id"
+#define ENC_EVENT_ENCODER_PERCENT		"percent"
+#define ENC_EVENT_ENCODER_ETA			"eta"
+#define ENC_EVENT_ENCODER_STATE			"state"
+
+/*
+*	progress event state values
+*/
+#define ENC_EVENT_STATE_QUEUED			"queued"
+#define ENC_EVENT_STATE_RUNNING			"running"
+#define ENC_EVENT_STATE_PAUSED			"paused"
+#define ENC_EVENT_STATE_HELD				"held"
+#define ENC_EVENT_STATE_DONE				"done"
 
 #ifdef __cplusplus
 extern "C" {
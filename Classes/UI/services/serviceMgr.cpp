@@ -28,17 +28,18 @@ typedef struct
 	const char* 				name;
 	ezServiceRegistry_t*  	registry;
 	ezServiceHandle_t*	hdle;
+	ezServiceTypedRegistry_t*	typed;
 } JniServiceRegistry_t;
 
 JniServiceRegistry_t gezServices[] = 
 {
-	{"system", 			systemService, 		NULL},
-	{"config", 			configService, 		NULL},
-	{"player", 			playerService, 		NULL},
-	{"recencoder",	recencoderService,	NULL},
-	/*{"localdb", 			localdbService, 		NULL},
-	{"kkedev", 			kkedevService, 		NULL},
-	{"net",					netService,				NULL},*/
+	{"system", 			systemService, 		NULL,	NULL},
+	{"config", 			configService, 		NULL,	NULL},
+	{"player", 			playerService, 		NULL,	playerTypedService},
+	{"recencoder",	recencoderService,	NULL,	NULL},
+	/*{"localdb", 			localdbService, 		NULL,	NULL},
+	{"kkedev", 			kkedevService, 		NULL,	NULL},
+	{"net",					netService,				NULL,	NULL},*/
 };
 
 /*
@@ -110,4 +111,61 @@ ezServiceHandle_t* serviceMgr_get(const char* name)
 	return NULL;
 }
 
+/*
+ * Function name  	: serviceMgr_getTyped
+ * Arguments      	: name - service name, count - output command count, may be NULL
+ * Return         	: typed registry, entry i is typed command i, NULL if the service has none
+ * Description    	: get the typed command table of a service, look it up once and keep it
+ *					
+*/
+ezServiceTypedRegistry_t* serviceMgr_getTyped(const char* name, int* count)
+{
+	ezServiceTypedRegistry_t* typed = NULL;
+	int i;
+
+	for (i=0; i<sizeof(gezServices)/sizeof(JniServiceRegistry_t); i++)
+	{
+		if (stricmp(gezServices[i].name, name) == 0)
+		{
+			typed = gezServices[i].typed;
+			break;
+		}
+	}
+	if (count != NULL)
+		*count = 0;
+	if (typed == NULL)
+		return NULL;
+
+	for (i=0; typed[i].exec != NULL; i++)
+	{
+		if (typed[i].id != i)
+		{
+			service_printf("= typed registry of service[%s] out of order at [%s]\n", name, typed[i].name);
+			return NULL;
+		}
+	}
+	if (count != NULL)
+		*count = i;
+	return typed;
+}
 
+/*
+ * Function name  	: serviceMgr_internCmd
+ * Arguments      	: typed - typed registry, cmd - string cmd name
+ * Return         	: typed command id, -1 if the cmd has no typed execution
+ * Description    	: map a string cmd name to its typed id, call it once and keep the id
+ *					
+*/
+int serviceMgr_internCmd(ezServiceTypedRegistry_t* typed, const char* cmd)
+{
+	int i;
+
+	if (typed == NULL || cmd == NULL)
+		return -1;
+	for (i=0; typed[i].exec != NULL; i++)
+	{
+		if (stricmp(typed[i].name, cmd) == 0)
+			return typed[i].id;
+	}
+	return -1;
+}
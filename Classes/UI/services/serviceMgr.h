@@ -26,6 +26,7 @@
 #include <recencoder/recencoder_service.h>
 //#include <services/localdb/localdb_service.h>
 #include <system/system_service.h>
+#include <serviceTyped.h>
 //#include <services/kkedev/kkedev_service.h>
 //#include <services/net/net_service.h>
 
@@ -60,6 +61,39 @@ extern int serviceMgr_destroy(ezServiceHandle_t* hdle);
 */
 extern ezServiceHandle_t* serviceMgr_get(const char* name);
 
+/*
+ * Function name  	: serviceMgr_getTyped
+ * Arguments      	: name - service name, count - output command count, may be NULL
+ * Return         	: typed registry, NULL if the service has no typed commands
+ * Description    	: get the typed command table of a service
+ *					
+*/
+extern ezServiceTypedRegistry_t* serviceMgr_getTyped(const char* name, int* count);
+
+/*
+ * Function name  	: serviceMgr_internCmd
+ * Arguments      	: typed - typed registry, cmd - string cmd name
+ * Return         	: typed command id, -1 if none
+ * Description    	: map a string cmd name to its typed command id
+ *					
+*/
+extern int serviceMgr_internCmd(ezServiceTypedRegistry_t* typed, const char* cmd);
+
+/*
+ * Function name  	: serviceMgr_execTyped
+ * Arguments      	: hdle - service handle, typed - typed registry of the service
+ *									count - command count, cmd - typed command id, para - typed parameters
+ * Return         	: result of the command, ezService_Err for an unknown id
+ * Description    	: run a typed command, no lookup and no allocation
+ *					
+*/
+static inline int serviceMgr_execTyped(ezServiceHandle_t* hdle, ezServiceTypedRegistry_t* typed, int count, int cmd, ezServiceTypedPara_t* para)
+{
+	if (hdle == NULL || typed == NULL || cmd < 0 || cmd >= count)
+		return ezService_Err;
+	return typed[cmd].exec(hdle, para);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,96 @@
+/*
+** Copyright (C) 2011 Multak,Inc. All rights reserved
+**
+** Filename : serviceTyped.h
+** Revision : 1.00
+**
+** Description: typed command channel for services
+**
+**************************************************************
+**
+** History
+**
+** 1.00
+**       modified by yucx
+** 1.01
+**       modified by ...
+**
+************************ HOWTO *******************************
+**
+**	the string channel (exec/setCmdPara/getEventParaValue) keeps every value as a
+**	string in the service maps. frequent calls (play time, state, volume ...) can go
+**	through the typed channel instead:
+**
+**	step1: number the commands of a service from 0, in the service header
+**
+**				typedef enum { XXX_TCMD_GETTIME = 0, XXX_TCMD_SETVOL, XXX_TCMD_COUNT } xxxTypedCmd_et;
+**
+**	step2: register the typed executions in the same order as the ids
+**
+**				EZ_SERVICE_BEGIN_TYPED_EXEC_MAP(xxxTypedService)
+**					EZ_SERVICE_ADD_TYPED_EXEC(XXX_TCMD_GETTIME,	XXX_CMD_GETTIME,	xxx_service_tgettime)
+**					EZ_SERVICE_ADD_TYPED_EXEC(XXX_TCMD_SETVOL,		XXX_CMD_SETVOL,		xxx_service_tsetvol)
+**				EZ_SERVICE_END_TYPED_EXEC_MAP()
+**
+**	step3: add the map to gezServices in serviceMgr.cpp
+**
+**	step4: call it, nothing is allocated or converted to string on the way
+**
+**				typed = serviceMgr_getTyped("xxx", &count);		// once
+**				...
+**				ezServiceTypedPara_t para;
+**				para.ival[0] = 50;
+**				ret = serviceMgr_execTyped(hdle, typed, count, XXX_TCMD_SETVOL, &para);
+**
+**			or MKService::execTyped() in the UI modules
+**
+**	typed executions run on the caller thread, like the string 'exec' of commands
+**	which only read or set player state. they push the same events as the string
+**	command they stand for, and outputs are also returned in para->oval/ostr.
+**
+*/
+
+#ifndef _SERVICE_TYPED_H_
+#define _SERVICE_TYPED_H_
+
+#include <stddef.h>
+#include <lib/ezbase/ez_service.h>
+
+#define EZ_SERVICE_TYPED_MAX_INT				(8)
+#define EZ_SERVICE_TYPED_MAX_STR				(4)
+#define EZ_SERVICE_TYPED_MAX_OUT				(256)
+
+#define EZ_SERVICE_BEGIN_TYPED_EXEC_MAP(srv)		ezServiceTypedRegistry_t srv[] = {
+#define EZ_SERVICE_ADD_TYPED_EXEC(id, name, exec)	{id,name,exec},
+#define EZ_SERVICE_END_TYPED_EXEC_MAP()				{-1,"NULL",NULL}};
+
+#define EZ_SERVICE_TYPED_REGISTRY_DECLARE(srv)		extern ezServiceTypedRegistry_t srv[]
+
+/*
+* typed command parameter, fixed layout, lives on the caller stack
+*/
+typedef struct
+{
+	int										ival[EZ_SERVICE_TYPED_MAX_INT];		// input integers
+	const char*							sval[EZ_SERVICE_TYPED_MAX_STR];		// input strings, owned by caller
+	int										oval[EZ_SERVICE_TYPED_MAX_INT];		// output integers
+	char									ostr[EZ_SERVICE_TYPED_MAX_OUT];		// output string
+
+} ezServiceTypedPara_t;
+
+/*
+* typed cmd execution callback in registry
+*/
+typedef int (*ezServiceTypedRegistry_exec_t)(ezServiceHandle_t*, ezServiceTypedPara_t*);
+
+/*
+* typed registry, entry i must have id i
+*/
+typedef struct
+{
+	int										id;
+	const char*							name;		// same name as the string cmd
+	ezServiceTypedRegistry_exec_t	exec;
+} ezServiceTypedRegistry_t;
+
+#endif
@@ -0,0 +1,323 @@
+/*
+** Copyright (C) 2011 Multak,Inc. All rights reserved
+**
+** Filename : serviceTypedBench.cpp
+** Revision : 1.00
+**
+** Description: standalone benchmark for the typed command channel, not part of the app
+**
+**************************************************************
+**
+** History
+**
+** 1.00
+**       modified by yucx
+** 1.01
+**       modified by ...
+**
+************************ HOWTO *******************************
+**
+**	compares calls per second of the string channel and the typed channel for the
+**	player calls the UI makes every frame (setvol, getplaytime, getstate).
+**	ezbase is a prebuilt library, so the string channel here is a model of it: a
+**	service handle whose methods keep cmd/event parameters as malloc'ed strings in
+**	name lists, called the way MKService does with std::string arguments.
+**
+**	build:	g++ -O2 -DSERVICE_TYPED_BENCH -D_ANDROID_PLATFORM_ -I../../KRKLib/include -I. serviceTypedBench.cpp
+**	run:	./a.out [calls]		(default 1000000)
+**
+*/
+
+#ifdef SERVICE_TYPED_BENCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <lib/ezbase/ez_player.h>
+#include <serviceMgr.h>
+
+#define BENCH_VOL_COUNT		4
+
+typedef struct {
+	std::string name;
+	std::vector<ezServicePara_t> para;
+} BenchList_t;
+
+typedef struct {
+	int playTime;
+	int state;
+	int vol[BENCH_VOL_COUNT];
+} BenchPlayer_t;
+
+static const char* gBenchVolNames[BENCH_VOL_COUNT] = {"total", "accom", "voice", "mic1"};
+static std::vector<BenchList_t> gBenchCmds;
+static std::vector<BenchList_t> gBenchEvents;
+static BenchPlayer_t gBenchPlayer;
+
+//----------------------------------------------------------------------------//
+static long long benchNowUs(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+//----------------------------------------------------------------------------//
+//- string channel model
+//----------------------------------------------------------------------------//
+static BenchList_t* benchList(std::vector<BenchList_t>& lists, const char* name)
+{
+	for (size_t i = 0; i < lists.size(); i++) {
+		if (strcasecmp(lists[i].name.c_str(), name) == 0)
+			return &lists[i];
+	}
+	lists.push_back(BenchList_t());
+	lists.back().name = name;
+	return &lists.back();
+}
+
+static ezServiceReturn_et benchSetPara(std::vector<BenchList_t>& lists, const char* name, const char* para, const char* value)
+{
+	BenchList_t* list = benchList(lists, name);
+	for (size_t i = 0; i < list->para.size(); i++) {
+		if (strcasecmp(list->para[i].name, para) == 0) {
+			free(list->para[i].value);
+			list->para[i].value = strdup(value);
+			return ezService_Succ;
+		}
+	}
+	ezServicePara_t p = {strdup(para), strdup(value)};
+	list->para.push_back(p);
+	return ezService_Succ;
+}
+
+static const char* benchGetPara(std::vector<BenchList_t>& lists, const char* name, const char* para)
+{
+	BenchList_t* list = benchList(lists, name);
+	for (size_t i = 0; i < list->para.size(); i++) {
+		if (strcasecmp(list->para[i].name, para) == 0)
+			return list->para[i].value;
+	}
+	return NULL;
+}
+
+static ezServiceReturn_et benchSetCmdPara(ezServiceHandle_t* /*hdle*/, const char* cmd, const char* para, const char* value)
+{
+	return benchSetPara(gBenchCmds, cmd, para, value);
+}
+
+static ezServicePara_t* benchGetCmdPara(ezServiceHandle_t* /*hdle*/, const char* cmd, int pos)
+{
+	BenchList_t* list = benchList(gBenchCmds, cmd);
+	return (pos < (int)list->para.size())? &list->para[pos] : NULL;
+}
+
+static ezServiceReturn_et benchClearCmdPara(ezServiceHandle_t* /*hdle*/, const char* cmd)
+{
+	BenchList_t* list = benchList(gBenchCmds, cmd);
+	for (size_t i = 0; i < list->para.size(); i++) {
+		free(list->para[i].name);
+		free(list->para[i].value);
+	}
+	list->para.clear();
+	return ezService_Succ;
+}
+
+static ezServiceReturn_et benchSetEventPara(ezServiceHandle_t* /*hdle*/, const char* event, const char* para, const char* value)
+{
+	return benchSetPara(gBenchEvents, event, para, value);
+}
+
+static const char* benchGetEventParaValue(ezServiceHandle_t* /*hdle*/, const char* event, const char* para)
+{
+	return benchGetPara(gBenchEvents, event, para);
+}
+
+static ezServiceReturn_et benchPushEvent(ezServiceHandle_t* /*hdle*/, const char* event, ezServiceEventResult_et /*result*/)
+{
+	benchList(gBenchEvents, event);
+	return ezService_Succ;
+}
+
+//----------------------------------------------------------------------------//
+static int benchSetvol(ezServiceHandle_t* hdle, const char* cmdname, const char* /*para*/)
+{
+	for (int i = 0; i < EZPLAYER_VOL_COUNT; i++) {
+		ezServicePara_t* p = hdle->getCmdPara(hdle, cmdname, i);
+		if (p == NULL)
+			break;
+		for (int j = 0; j < BENCH_VOL_COUNT; j++) {
+			if (strcasecmp(gBenchVolNames[j], p->name) == 0) {
+				gBenchPlayer.vol[j] = atoi(p->value);
+				break;
+			}
+		}
+	}
+	hdle->clearCmdPara(hdle, cmdname);
+	return ezService_Succ;
+}
+
+static int benchGetplaytime(ezServiceHandle_t* hdle, const char* cmdname, const char* /*para*/)
+{
+	hdle->pushEvent(hdle, cmdname, ezServiceEvent_Succ);
+	return gBenchPlayer.playTime++;
+}
+
+static int benchGetstate(ezServiceHandle_t* hdle, const char* cmdname, const char* /*para*/)
+{
+	hdle->setEventPara(hdle, cmdname, "state", (gBenchPlayer.state == EZPLAYER_STATE_PLAYING)? "playing" : "stopped");
+	hdle->pushEvent(hdle, cmdname, ezServiceEvent_Succ);
+	return ezService_Succ;
+}
+
+static ezServiceRegistry_t gBenchRegistry[] = {
+	{"init", NULL}, {"deinit", NULL}, {"initaudio", NULL}, {"initview", NULL}, {"updateview", NULL},
+	{"play", NULL}, {"stop", NULL}, {"pause", NULL}, {"resume", NULL}, {"seektime", NULL},
+	{"setvol", benchSetvol}, {"setmute", NULL}, {"setvocal", NULL}, {"setmic", NULL},
+	{"getplaytime", benchGetplaytime}, {"gettotaltime", NULL}, {"getstate", benchGetstate},
+	{"NULL", NULL}
+};
+
+static ezServiceReturn_et benchExec(ezServiceHandle_t* hdle, const char* cmd, const char* para)
+{
+	for (int i = 0; gBenchRegistry[i].exec != NULL || strcmp(gBenchRegistry[i].name, "NULL") != 0; i++) {
+		if (gBenchRegistry[i].exec != NULL && strcasecmp(gBenchRegistry[i].name, cmd) == 0)
+			return (ezServiceReturn_et)gBenchRegistry[i].exec(hdle, cmd, para);
+	}
+	return ezService_Err;
+}
+
+//----------------------------------------------------------------------------//
+//- typed channel
+//----------------------------------------------------------------------------//
+enum {BENCH_TCMD_SETVOL = 0, BENCH_TCMD_GETPLAYTIME, BENCH_TCMD_GETSTATE, BENCH_TCMD_COUNT};
+
+static int benchTsetvol(ezServiceHandle_t* hdle, ezServiceTypedPara_t* para)
+{
+	if (para->ival[0] < 0 || para->ival[0] >= BENCH_VOL_COUNT) {
+		hdle->pushEvent(hdle, "setvol", ezServiceEvent_Fail);
+		return ezService_Err;
+	}
+	gBenchPlayer.vol[para->ival[0]] = para->ival[1];
+	return ezService_Succ;
+}
+
+static int benchTgetplaytime(ezServiceHandle_t* hdle, ezServiceTypedPara_t* /*para*/)
+{
+	hdle->pushEvent(hdle, "getplaytime", ezServiceEvent_Succ);
+	return gBenchPlayer.playTime++;
+}
+
+static int benchTgetstate(ezServiceHandle_t* hdle, ezServiceTypedPara_t* para)
+{
+	para->oval[0] = gBenchPlayer.state;
+	strcpy(para->ostr, (gBenchPlayer.state == EZPLAYER_STATE_PLAYING)? "playing" : "stopped");
+	hdle->setEventPara(hdle, "getstate", "state", para->ostr);
+	hdle->pushEvent(hdle, "getstate", ezServiceEvent_Succ);
+	return ezService_Succ;
+}
+
+EZ_SERVICE_BEGIN_TYPED_EXEC_MAP(gBenchTyped)
+	EZ_SERVICE_ADD_TYPED_EXEC(BENCH_TCMD_SETVOL,			"setvol",			benchTsetvol)
+	EZ_SERVICE_ADD_TYPED_EXEC(BENCH_TCMD_GETPLAYTIME,	"getplaytime",	benchTgetplaytime)
+	EZ_SERVICE_ADD_TYPED_EXEC(BENCH_TCMD_GETSTATE,		"getstate",		benchTgetstate)
+EZ_SERVICE_END_TYPED_EXEC_MAP()
+
+//----------------------------------------------------------------------------//
+//- the MKPlayer calls on both channels
+//----------------------------------------------------------------------------//
+static const std::string gCmdSetVol = "setvol";
+static const std::string gCmdGetPlayTime = "getplaytime";
+static const std::string gCmdGetState = "getstate";
+static const std::string gParaState = "state";
+static const std::string gNullStr = "";
+
+static std::string benchValueOf(int val)
+{
+	char tmp[32];
+	sprintf(tmp, "%d", val);
+	return std::string(tmp);
+}
+
+static int stringSetVol(ezServiceHandle_t* hdle, const std::string& type, int value)
+{
+	hdle->setCmdPara(hdle, gCmdSetVol.c_str(), type.c_str(), benchValueOf(value).c_str());
+	return hdle->exec(hdle, gCmdSetVol.c_str(), gNullStr.c_str());
+}
+
+static int stringGetPlayTime(ezServiceHandle_t* hdle)
+{
+	return hdle->exec(hdle, gCmdGetPlayTime.c_str(), gNullStr.c_str());
+}
+
+static std::string stringGetPlayState(ezServiceHandle_t* hdle)
+{
+	if (hdle->exec(hdle, gCmdGetState.c_str(), gNullStr.c_str()) == 0) {
+		const char* val = hdle->getEventParaValue(hdle, gCmdGetState.c_str(), gParaState.c_str());
+		return (val != NULL)? std::string(val) : gNullStr;
+	}
+	return "";
+}
+
+static int typedSetVol(ezServiceHandle_t* hdle, int type, int value)
+{
+	ezServiceTypedPara_t para;
+	para.ival[0] = type;
+	para.ival[1] = value;
+	return serviceMgr_execTyped(hdle, gBenchTyped, BENCH_TCMD_COUNT, BENCH_TCMD_SETVOL, &para);
+}
+
+//----------------------------------------------------------------------------//
+int main(int argc, char* argv[])
+{
+	int calls = (argc > 1)? atoi(argv[1]) : 1000000;
+	ezServiceHandle_t hdle;
+	ezServiceTypedPara_t para;
+	long long t0, usString, usTyped, check;
+	std::string state;
+	int i;
+
+	memset(&hdle, 0, sizeof(hdle));
+	strcpy(hdle.name, "player");
+	hdle.exec = benchExec;
+	hdle.setCmdPara = benchSetCmdPara;
+	hdle.getCmdPara = benchGetCmdPara;
+	hdle.clearCmdPara = benchClearCmdPara;
+	hdle.setEventPara = benchSetEventPara;
+	hdle.getEventParaValue = benchGetEventParaValue;
+	hdle.pushEvent = benchPushEvent;
+	gBenchPlayer.state = EZPLAYER_STATE_PLAYING;
+
+	// string channel: setvol + getplaytime + getstate per round
+	check = 0;
+	t0 = benchNowUs();
+	for (i = 0; i < calls / 3; i++) {
+		stringSetVol(&hdle, gBenchVolNames[i % BENCH_VOL_COUNT], i % 100);
+		check += stringGetPlayTime(&hdle);
+		state = stringGetPlayState(&hdle);
+		check += state.size();
+	}
+	usString = benchNowUs() - t0;
+
+	check = 0;
+	t0 = benchNowUs();
+	for (i = 0; i < calls / 3; i++) {
+		typedSetVol(&hdle, i % BENCH_VOL_COUNT, i % 100);
+		check += serviceMgr_execTyped(&hdle, gBenchTyped, BENCH_TCMD_COUNT, BENCH_TCMD_GETPLAYTIME, &para);
+		if (serviceMgr_execTyped(&hdle, gBenchTyped, BENCH_TCMD_COUNT, BENCH_TCMD_GETSTATE, &para) == 0)
+			state = para.ostr;
+		check += state.size();
+	}
+	usTyped = benchNowUs() - t0;
+
+	printf("calls[%d] string[%lldms %.0f calls/s] typed[%lldms %.0f calls/s] x%.1f (check %lld)\n",
+		(i * 3), usString / 1000, (i * 3) * 1e6 / (usString ? usString : 1),
+		usTyped / 1000, (i * 3) * 1e6 / (usTyped ? usTyped : 1), (double)usString / (usTyped ? usTyped : 1), check);
+	return 0;
+}
+
+#endif
@@ -0,0 +1,670 @@
+/*
+** Copyright (C) 2011 Multak,Inc. All rights reserved
+**
+** Filename : file_copy.c
+** Revision : 1.00
+**
+** Description: file and folder copy for song import and update
+**
+**************************************************************
+**
+** History
+**
+** 1.00
+**       first release
+**
+************************ HOWTO *******************************
+**
+** the batch thread scans the source first so the progress has a total, then
+** copies file by file. a file is copied with copy_file_range, sendfile or the
+** read/write pair, whichever works first, the kernel calls and the writes go
+** in chunks so a cancel is seen soon. the page cache of both files is dropped
+** after a file, thousands of songs would push the ui out of memory otherwise.
+*/
+
+#include <k_global.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(_MSC_VER)
+#include <io.h>
+#include <sys/utime.h>
+#define ftruncate					_chsize
+#else
+#include <unistd.h>
+#include <utime.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/sendfile.h>
+#endif
+#include <lib/ezbase/ez_vector.h>
+
+#include "file_copy.h"
+
+#ifndef O_BINARY
+#define O_BINARY					0
+#endif
+#ifndef ECANCELED
+#define ECANCELED					125
+#endif
+
+#define FILE_COPY_SMALL_SZ			FILE_COPY_BLOCK_SZ		// a file this small is not worth the reader thread
+
+typedef struct {
+	char src[FILE_COPY_PATH_SZ];
+	char dst[FILE_COPY_PATH_SZ];
+
+} fileCopyItem_t;
+
+struct fileCopy {
+	ezVector_t* items;				// fileCopyItem_t, filled by the scan
+	char src[FILE_COPY_PATH_SZ];
+	char dst[FILE_COPY_PATH_SZ];
+	int resume;						// skip complete files and go on with .part files, asked by the caller
+	volatile int cancel;
+	unsigned char* buf[2];			// read/write path, allocated on first use
+	krk_os_task_t task;
+	krk_os_sema_t lock;				// stat
+	krk_os_sema_t done;
+	unsigned long start;			// ms
+	int scanned;
+	fileCopyStat_t stat;
+};
+
+/*
+* reader thread of the read/write path, fills the two buffers in turn
+*/
+typedef struct {
+	fileCopy_t* fc;
+	int fd;
+	int len[2];
+	int error;
+	volatile int abort;
+	krk_os_task_t task;
+	krk_os_sema_t empty;
+	krk_os_sema_t full;
+	krk_os_sema_t done;
+
+} fileCopyReader_t;
+
+#if defined(__linux__) && defined(__NR_copy_file_range)
+static int file_copy_range_broken = 0;			// ENOSYS once, the kernel is too old
+#endif
+
+static void file_copy_add(fileCopy_t* fc, long n)
+{
+	krk_os_sema_pend(&fc->lock, KRK_OS_WAIT, NULL);
+	fc->stat.done += n;
+	fc->stat.copied += n;
+	krk_os_sema_post(&fc->lock, NULL);
+}
+
+static void file_copy_set_method(fileCopy_t* fc, int method)
+{
+	krk_os_sema_pend(&fc->lock, KRK_OS_WAIT, NULL);
+	fc->stat.method = method;
+	krk_os_sema_post(&fc->lock, NULL);
+}
+
+static int file_copy_write(int fd, const unsigned char* buf, int len)
+{
+	int n;
+
+	while (len > 0) {
+		n = write(fd, buf, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return (n < 0) ? errno : ENOSPC;
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int file_copy_read(int fd, unsigned char* buf, int len)
+{
+	int n;
+
+	do {
+		n = read(fd, buf, len);
+	} while (n < 0 && errno == EINTR);
+	return n;
+}
+
+#if defined(__linux__)
+/*
+* copy in the kernel, 0 - done or left to the read/write path from the current
+* offsets, <> - errno
+*/
+static int file_copy_kernel(fileCopy_t* fc, int in, int out, long long left)
+{
+	int method = FILE_COPY_SENDFILE;
+	ssize_t n;
+	size_t chunk;
+
+#if defined(__NR_copy_file_range)
+	if (!file_copy_range_broken)
+		method = FILE_COPY_RANGE;
+#endif
+	file_copy_set_method(fc, method);
+
+	while (left > 0) {
+		if (fc->cancel)
+			return ECANCELED;
+
+		chunk = (left > FILE_COPY_CHUNK_SZ) ? FILE_COPY_CHUNK_SZ : (size_t)left;
+#if defined(__NR_copy_file_range)
+		if (method == FILE_COPY_RANGE)
+			n = syscall(__NR_copy_file_range, in, NULL, out, NULL, chunk, 0);
+		else
+#endif
+			n = sendfile(out, in, NULL, chunk);
+
+		if (n > 0) {
+			left -= n;
+			file_copy_add(fc, n);
+			continue;
+		}
+		if (n == 0)
+			return 0;							// the source got shorter, read/write sees the end
+		if (errno == EINTR)
+			continue;
+
+		// the offsets stay right after a failed call, the next way goes on from there
+		if (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EBADF) {
+#if defined(__NR_copy_file_range)
+			if (method == FILE_COPY_RANGE) {
+				if (errno == ENOSYS)
+					file_copy_range_broken = 1;
+				method = FILE_COPY_SENDFILE;
+				file_copy_set_method(fc, method);
+				continue;
+			}
+#endif
+			return 0;
+		}
+		return errno;
+	}
+	return 0;
+}
+#endif
+
+static KRK_TASK_RET_TYPE file_copy_reader_thread(KRK_TASK_ENTRY_ARG arg)
+{
+	fileCopyReader_t* rd = (fileCopyReader_t*)arg;
+	int i = 0;
+	int n;
+
+	for (;;) {
+		krk_os_sema_pend(&rd->empty, KRK_OS_WAIT, NULL);
+		n = 0;
+		if (!rd->abort) {
+			n = file_copy_read(rd->fd, rd->fc->buf[i], FILE_COPY_BLOCK_SZ);
+			if (n < 0) {
+				rd->error = errno;
+				n = 0;
+			}
+		}
+		rd->len[i] = n;
+		krk_os_sema_post(&rd->full, NULL);
+		if (n == 0)
+			break;
+		i ^= 1;
+	}
+
+	krk_os_sema_post(&rd->done, NULL);
+	krk_os_task_selfdel();
+
+	return KRK_TASK_RET_VAL;
+}
+
+/*
+* read/write from the current offsets to the end of in, the writes of one buffer
+* overlap the read of the other
+*/
+static int file_copy_rw(fileCopy_t* fc, int in, int out, long long left)
+{
+	fileCopyReader_t rd;
+	int ret = 0;
+	int i = 0;
+	int n;
+
+	file_copy_set_method(fc, FILE_COPY_RW);
+
+	if (fc->buf[0] == NULL) {
+		fc->buf[0] = (unsigned char*)malloc(FILE_COPY_BLOCK_SZ);
+		fc->buf[1] = (unsigned char*)malloc(FILE_COPY_BLOCK_SZ);
+		if (fc->buf[0] == NULL || fc->buf[1] == NULL) {
+			free(fc->buf[0]);
+			free(fc->buf[1]);
+			fc->buf[0] = fc->buf[1] = NULL;
+			return ENOMEM;
+		}
+	}
+
+	memset(&rd, 0, sizeof(rd));
+	rd.fc = fc;
+	rd.fd = in;
+	if (left <= FILE_COPY_SMALL_SZ
+		|| krk_os_sema_create(&rd.empty, "cpyempty", 2, NULL) == KRK_OS_RET_FAIL)
+	{
+		// one buffer on this thread
+		while (ret == 0 && (n = file_copy_read(in, fc->buf[0], FILE_COPY_BLOCK_SZ)) != 0) {
+			if (n < 0)
+				ret = errno;
+			else if (fc->cancel)
+				ret = ECANCELED;
+			else if ((ret = file_copy_write(out, fc->buf[0], n)) == 0)
+				file_copy_add(fc, n);
+		}
+		return ret;
+	}
+	krk_os_sema_create(&rd.full, "cpyfull", 0, NULL);
+	krk_os_sema_create(&rd.done, "cpydone", 0, NULL);
+	if (krk_os_task_create(&rd.task, "filecopyrd", file_copy_reader_thread, 0x4000, KRK_TASK_PRIORITY_LOW, (void*)&rd) == KRK_OS_RET_FAIL) {
+		krk_os_sema_destroy(&rd.empty, NULL);
+		krk_os_sema_destroy(&rd.full, NULL);
+		krk_os_sema_destroy(&rd.done, NULL);
+		return file_copy_rw(fc, in, out, 0);
+	}
+
+	// after an error the buffers are still taken until the reader sees abort
+	for (;;) {
+		krk_os_sema_pend(&rd.full, KRK_OS_WAIT, NULL);
+		n = rd.len[i];
+		if (n == 0)
+			break;
+		if (ret == 0 && fc->cancel)
+			ret = ECANCELED;
+		if (ret == 0 && (ret = file_copy_write(out, fc->buf[i], n)) == 0)
+			file_copy_add(fc, n);
+		if (ret != 0)
+			rd.abort = 1;
+		krk_os_sema_post(&rd.empty, NULL);
+		i ^= 1;
+	}
+
+	krk_os_sema_pend(&rd.done, KRK_OS_WAIT, NULL);
+	krk_os_task_destroy(&rd.task, NULL);
+	krk_os_sema_destroy(&rd.empty, NULL);
+	krk_os_sema_destroy(&rd.full, NULL);
+	krk_os_sema_destroy(&rd.done, NULL);
+
+	if (ret == 0)
+		ret = rd.error;
+	return ret;
+}
+
+static void file_copy_advise(int fd, int advice)
+{
+#if defined(__linux__)
+	posix_fadvise(fd, 0, 0, advice);
+#endif
+}
+
+/*
+* the source a .part file was made from, 0 - the same size and time
+*/
+static int file_copy_partinfo_check(const char* info, const struct stat* src)
+{
+	FILE* fp = fopen(info, "r");
+	long long size = -1;
+	long long mtime = -1;
+
+	if (fp == NULL)
+		return -1;
+	if (fscanf(fp, "%lld %lld", &size, &mtime) != 2)
+		size = -1;
+	fclose(fp);
+	return (size == (long long)src->st_size && mtime == (long long)src->st_mtime) ? 0 : -1;
+}
+
+static int file_copy_partinfo_write(const char* info, const struct stat* src)
+{
+	FILE* fp = fopen(info, "w");
+	int ret = 0;
+
+	if (fp == NULL)
+		return errno;
+	fprintf(fp, "%lld %lld\n", (long long)src->st_size, (long long)src->st_mtime);
+	if (fclose(fp) != 0)
+		ret = errno;
+	return ret;
+}
+
+/*
+ * Function name  	: file_copy_one
+ * Arguments      	: fc - batch, counters and cancel
+ *					  dst / src - files
+ * Return         	: 0 - succ, <> - errno
+ * Description    	: copy to dst.part and rename it, dst gets the time of src.
+ *					  with resume a dst of the same size and time is skipped and
+ *					  a dst.part of the same source goes on
+ *
+*/
+static int file_copy_one(fileCopy_t* fc, const char* dst, const char* src)
+{
+	char part[FILE_COPY_PATH_SZ + 8];
+	char info[FILE_COPY_PATH_SZ + 12];
+	struct stat srcst;
+	struct stat st;
+	struct utimbuf times;
+	long long size;
+	long long offset = 0;
+	int in;
+	int out;
+	int ret = 0;
+
+	in = open(src, O_RDONLY | O_BINARY);
+	if (in < 0)
+		return errno;
+	if (fstat(in, &srcst) != 0) {
+		ret = errno;
+		close(in);
+		return ret;
+	}
+	size = srcst.st_size;
+
+	krk_os_sema_pend(&fc->lock, KRK_OS_WAIT, NULL);
+	strncpy(fc->stat.current, src, sizeof(fc->stat.current) - 1);
+	krk_os_sema_post(&fc->lock, NULL);
+
+	if (fc->resume && stat(dst, &st) == 0 && st.st_size == size && st.st_mtime == srcst.st_mtime) {
+		close(in);
+		krk_os_sema_pend(&fc->lock, KRK_OS_WAIT, NULL);
+		fc->stat.done += size;
+		fc->stat.skipped++;
+		krk_os_sema_post(&fc->lock, NULL);
+		return 0;
+	}
+
+	file_copy_set_method(fc, FILE_COPY_NONE);
+	sprintf(part, "%s%s", dst, FILE_COPY_PART_EXT);
+	sprintf(info, "%s%s", dst, FILE_COPY_PARTINFO_EXT);
+	// a .part of another version of the source starts again
+	if (fc->resume && stat(part, &st) == 0 && file_copy_partinfo_check(info, &srcst) == 0) {
+		offset = (st.st_size < size) ? st.st_size : size;
+		offset -= offset % FILE_COPY_RESUME_ALIGN;
+	}
+	if (fc->resume && offset == 0 && (ret = file_copy_partinfo_write(info, &srcst)) != 0) {
+		close(in);
+		return ret;
+	}
+
+	out = open(part, O_WRONLY | O_CREAT | O_BINARY | (offset == 0 ? O_TRUNC : 0), 0666);
+	if (out < 0) {
+		ret = errno;
+		close(in);
+		return ret;
+	}
+	if (offset > 0) {
+		mus_printf("file_copy_one-> %s goes on at %lld\n", part, offset);
+		if (ftruncate(out, offset) != 0
+			|| lseek(in, offset, SEEK_SET) != offset
+			|| lseek(out, offset, SEEK_SET) != offset)
+		{
+			offset = 0;
+			ret = (ftruncate(out, 0) == 0) ? 0 : errno;
+			lseek(in, 0, SEEK_SET);
+			lseek(out, 0, SEEK_SET);
+		}
+		krk_os_sema_pend(&fc->lock, KRK_OS_WAIT, NULL);
+		fc->stat.done += offset;
+		krk_os_sema_post(&fc->lock, NULL);
+	}
+#if defined(__linux__)
+	file_copy_advise(in, POSIX_FADV_SEQUENTIAL);
+	if (ret == 0)
+		ret = file_copy_kernel(fc, in, out, size - offset);
+#endif
+	// what the kernel left, or all of it, a source that grew is read to its end
+	if (ret == 0 && (fc->stat.method == FILE_COPY_NONE || lseek(in, 0, SEEK_CUR) < size))
+	{
+		ret = file_copy_rw(fc, in, out, size - lseek(in, 0, SEEK_CUR));
+	}
+#if defined(_MSC_VER)
+	if (ret == 0 && _commit(out) != 0)
+#else
+	if (ret == 0 && fsync(out) != 0)
+#endif
+		ret = errno;
+
+#if defined(__linux__)
+	file_copy_advise(in, POSIX_FADV_DONTNEED);
+	file_copy_advise(out, POSIX_FADV_DONTNEED);
+#endif
+	close(in);
+	if (close(out) != 0 && ret == 0)
+		ret = errno;
+
+	if (ret == 0) {
+		remove(dst);
+		if (rename(part, dst) != 0)
+			ret = errno;
+	}
+	if (ret == 0) {
+		// the time is what a later resume compares
+		times.actime = srcst.st_atime;
+		times.modtime = srcst.st_mtime;
+		if (utime(dst, &times) != 0)
+			mus_printf("file_copy_one-> %s keeps its own time, errno %d\n", dst, errno);
+		if (fc->resume)
+			remove(info);
+	}
+	if (ret != 0 && !fc->resume)
+		remove(part);
+	return ret;
+}
+
+static int file_copy_isdir(const char* path)
+{
+	struct stat st;
+
+	return (stat(path, &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR);
+}
+
+/*
+* collect the files, folders of dst are made on the way
+*/
+static int file_copy_scan(fileCopy_t* fc, const char* dst, const char* src)
+{
+	fileCopyItem_t item;
+	struct stat st;
+	struct dirent* entry;
+	DIR* dir;
+	const char* name;
+	char subsrc[FILE_COPY_PATH_SZ];
+	char subdst[FILE_COPY_PATH_SZ];
+	int ret = 0;
+
+	if (fc->cancel)
+		return ECANCELED;
+
+	if (!file_copy_isdir(src)) {
+		if (stat(src, &st) != 0)
+			return errno;
+		strcpy(item.src, src);
+		strcpy(item.dst, dst);
+		ez_vector_pushback(fc->items, &item);
+		krk_os_sema_pend(&fc->lock, KRK_OS_WAIT, NULL);
+		fc->stat.total += st.st_size;
+		fc->stat.files++;
+		krk_os_sema_post(&fc->lock, NULL);
+		return 0;
+	}
+
+	if (!file_copy_isdir(dst) && mkdir(dst, 0777) != 0)
+		return errno;
+	if ((dir = opendir(src)) == NULL)
+		return errno;
+
+	while (ret == 0 && (entry = readdir(dir)) != NULL) {
+		name = krk_get_entry_name(entry);
+		if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+			continue;
+		if (snprintf(subsrc, sizeof(subsrc), "%s/%s", src, name) >= (int)sizeof(subsrc)
+			|| snprintf(subdst, sizeof(subdst), "%s/%s", dst, name) >= (int)sizeof(subdst) - 8)
+		{
+			ret = ENAMETOOLONG;
+			break;
+		}
+		ret = file_copy_scan(fc, subdst, subsrc);
+	}
+	closedir(dir);
+	return ret;
+}
+
+static KRK_TASK_RET_TYPE file_copy_thread(KRK_TASK_ENTRY_ARG arg)
+{
+	fileCopy_t* fc = (fileCopy_t*)arg;
+	int ret;
+	int i;
+
+	ret = file_copy_scan(fc, fc->dst, fc->src);
+	fc->scanned = 1;
+	mus_printf("file_copy_thread-> %d files, %llu bytes, ret %d\n", fc->stat.files, fc->stat.total, ret);
+
+	for (i = 0; ret == 0 && i < ez_vector_size(fc->items); i++) {
+		fileCopyItem_t* item = (fileCopyItem_t*)ez_vector_get(fc->items, i);
+
+		ret = file_copy_one(fc, item->dst, item->src);
+		if (ret == 0) {
+			krk_os_sema_pend(&fc->lock, KRK_OS_WAIT, NULL);
+			fc->stat.filesdone++;
+			krk_os_sema_post(&fc->lock, NULL);
+		}
+		else {
+			mus_printf("file_copy_thread-> %s failed, errno %d\n", item->src, ret);
+		}
+	}
+
+	krk_os_sema_pend(&fc->lock, KRK_OS_WAIT, NULL);
+	fc->stat.error = ret;
+	fc->stat.running = 0;
+	krk_os_sema_post(&fc->lock, NULL);
+
+	krk_os_sema_post(&fc->done, NULL);
+	krk_os_task_selfdel();
+
+	return KRK_TASK_RET_VAL;
+}
+
+static fileCopy_t* file_copy_new(const char* dst, const char* src)
+{
+	fileCopy_t* fc = (fileCopy_t*)calloc(1, sizeof(fileCopy_t));
+
+	if (fc == NULL)
+		return NULL;
+	if (krk_os_sema_create(&fc->lock, "filecopy", 1, NULL) == KRK_OS_RET_FAIL) {
+		free(fc);
+		return NULL;
+	}
+	strncpy(fc->src, src, sizeof(fc->src) - 1);
+	strncpy(fc->dst, dst, sizeof(fc->dst) - 1);
+	fc->start = krk_curTime();
+	fc->stat.eta = -1;
+	return fc;
+}
+
+static void file_copy_free(fileCopy_t* fc)
+{
+	if (fc->items != NULL)
+		ez_vector_free(fc->items);
+	free(fc->buf[0]);
+	free(fc->buf[1]);
+	krk_os_sema_destroy(&fc->lock, NULL);
+	free(fc);
+}
+
+//----------------------------------------------------------------------------//
+//- interface
+//----------------------------------------------------------------------------//
+int file_copy_file(const char* dst, const char* src)
+{
+	fileCopy_t* fc = file_copy_new(dst, src);
+	int ret;
+
+	if (fc == NULL)
+		return ENOMEM;
+	ret = file_copy_one(fc, dst, src);
+	file_copy_free(fc);
+	return ret;
+}
+
+fileCopy_t* file_copy_start(const char* dst, const char* src, int resume)
+{
+	fileCopy_t* fc;
+	struct stat st;
+	const char* name;
+
+	if (stat(src, &st) != 0) {
+		mus_printf("file_copy_start-> no %s\n", src);
+		return NULL;
+	}
+	if ((fc = file_copy_new(dst, src)) == NULL)
+		return NULL;
+
+	// a file into a folder keeps its name
+	if (!file_copy_isdir(src) && file_copy_isdir(dst)) {
+		name = strrchr(src, '/');
+		if (name == NULL || strrchr(name, '\\') != NULL)
+			name = strrchr(src, '\\');
+		name = (name != NULL) ? name + 1 : src;
+		snprintf(fc->dst, sizeof(fc->dst), "%s/%s", dst, name);
+	}
+
+	fc->resume = resume;
+	fc->stat.running = 1;
+	fc->items = ez_vector_new(sizeof(fileCopyItem_t), 0);
+	if (krk_os_sema_create(&fc->done, "filecopydone", 0, NULL) == KRK_OS_RET_FAIL) {
+		file_copy_free(fc);
+		return NULL;
+	}
+	// the scan recurses with two paths a folder level
+	if (krk_os_task_create(&fc->task, "filecopy", file_copy_thread, 0x20000, KRK_TASK_PRIORITY_LOW, (void*)fc) == KRK_OS_RET_FAIL) {
+		krk_os_sema_destroy(&fc->done, NULL);
+		file_copy_free(fc);
+		return NULL;
+	}
+	return fc;
+}
+
+void file_copy_get_stat(fileCopy_t* fc, fileCopyStat_t* stat)
+{
+	unsigned long ms = krk_curTime() - fc->start;
+
+	krk_os_sema_pend(&fc->lock, KRK_OS_WAIT, NULL);
+	memcpy(stat, &fc->stat, sizeof(fileCopyStat_t));
+	krk_os_sema_post(&fc->lock, NULL);
+
+	stat->rate = (ms > 0) ? (unsigned long)(stat->copied*1000/ms) : 0;
+	stat->eta = -1;
+	if (!stat->running)
+		stat->eta = 0;
+	else if (fc->scanned && stat->rate > 0)
+		stat->eta = (long)((stat->total - stat->done)*1000/stat->rate);
+}
+
+void file_copy_cancel(fileCopy_t* fc)
+{
+	fc->cancel = 1;
+}
+
+int file_copy_finish(fileCopy_t* fc, fileCopyStat_t* stat)
+{
+	int ret;
+
+	krk_os_sema_pend(&fc->done, KRK_OS_WAIT, NULL);
+	krk_os_task_destroy(&fc->task, NULL);
+	krk_os_sema_destroy(&fc->done, NULL);
+
+	if (stat != NULL)
+		file_copy_get_stat(fc, stat);
+	ret = fc->stat.error;
+	mus_printf("file_copy_finish-> %llu bytes in %lums, ret %d\n", fc->stat.copied, krk_curTime() - fc->start, ret);
+	file_copy_free(fc);
+	return ret;
+}
+
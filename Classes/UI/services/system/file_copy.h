@@ -0,0 +1,139 @@
+/*
+** Copyright (C) 2011 Multak,Inc. All rights reserved
+**
+** Filename : file_copy.h
+** Revision : 1.00
+**
+** Description: file and folder copy for song import and update
+**
+**************************************************************
+**
+** History
+**
+** 1.00
+**       first release
+**
+************************ HOWTO *******************************
+**
+** a file is copied by the kernel when it can, copy_file_range first and
+** sendfile when the two files are on different file systems. when neither
+** works the data goes through two large buffers, a reader thread fills one
+** while the other is written.
+**
+** a batch copies a file or a whole folder on a worker thread. every file is
+** written to <name>.part and renamed when complete, the copy gets the time of
+** its source. a batch started with resume after a cancel, a pulled stick or a
+** power loss skips the files that are there with the size and time of their
+** source, and goes on with a .part file where it stopped when <name>.partinfo
+** says it was made from the same source.
+**
+**				fc = file_copy_start("/mnt/sdcard/KARAOKE/SONG", "/mnt/usb/SONG", 1);
+**				...
+**				file_copy_get_stat(fc, &stat);		// in a timer, for a progress bar
+**				...
+**				ret = file_copy_finish(fc, &stat);
+*/
+
+#ifndef _FILE_COPY_H_
+#define _FILE_COPY_H_
+
+#define FILE_COPY_PATH_SZ				512
+#define FILE_COPY_BLOCK_SZ			(1024*1024)				// a buffer of the read/write path
+#define FILE_COPY_CHUNK_SZ			(1024*1024*8)			// a kernel copy call, cancel is seen this often
+#define FILE_COPY_RESUME_ALIGN		(1024*64)				// a .part file goes on from a multiple of this
+#define FILE_COPY_PART_EXT			".part"
+#define FILE_COPY_PARTINFO_EXT		".partinfo"				// size and time of the source of the .part
+
+/*
+* how the last file was copied
+*/
+typedef enum
+{
+	FILE_COPY_NONE,
+	FILE_COPY_RANGE,				// copy_file_range, the data stays in the kernel
+	FILE_COPY_SENDFILE,				// sendfile, the data stays in the kernel
+	FILE_COPY_RW,					// read/write through two buffers
+
+} fileCopyMethod_t;
+
+/*
+* file copy counters
+*/
+typedef struct {
+	unsigned long long total;			// bytes of all files
+	unsigned long long done;			// bytes copied or skipped
+	unsigned long long copied;			// bytes copied by this run
+	int files;
+	int filesdone;
+	int skipped;					// files complete from a former run, resume only
+	unsigned long rate;				// bytes a second of this run
+	long eta;						// ms left, -1 - not known yet
+	int method;						// fileCopyMethod_t of the current file
+	int running;
+	int error;						// 0, or errno that stopped the batch
+	char current[FILE_COPY_PATH_SZ];
+
+} fileCopyStat_t;
+
+typedef struct fileCopy fileCopy_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Function name  	: file_copy_file
+ * Arguments      	: dst - destiny file, replaced
+ *					  src - source file
+ * Return         	: 0 - succ, <> - errno
+ * Description    	: copy one file on the calling thread
+ *
+*/
+extern int file_copy_file(const char* dst, const char* src);
+
+/*
+ * Function name  	: file_copy_start
+ * Arguments      	: dst - destiny file or folder
+ *					  src - source file or folder, a folder is copied with
+ *							its sub folders into dst
+ *					  resume - 1, skip the files complete from a former run and
+ *							go on with their .part files, 0, copy every file
+ * Return         	: batch, NULL when src is missing or the thread fails
+ * Description    	: start the batch on a worker thread
+ *
+*/
+extern fileCopy_t* file_copy_start(const char* dst, const char* src, int resume);
+
+/*
+ * Function name  	: file_copy_get_stat
+ * Arguments      	: fc - batch
+ *					  stat - counters
+ *
+*/
+extern void file_copy_get_stat(fileCopy_t* fc, fileCopyStat_t* stat);
+
+/*
+ * Function name  	: file_copy_cancel
+ * Arguments      	: fc - batch
+ * Description    	: stop after the current chunk, the .part file stays for
+ *					  the next run
+ *
+*/
+extern void file_copy_cancel(fileCopy_t* fc);
+
+/*
+ * Function name  	: file_copy_finish
+ * Arguments      	: fc - batch
+ *					  stat - final counters, may be NULL
+ * Return         	: 0 - succ, ECANCELED - cancelled, <> - errno
+ * Description    	: wait for the batch and free it
+ *
+*/
+extern int file_copy_finish(fileCopy_t* fc, fileCopyStat_t* stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -23,6 +23,7 @@
 #include <lib/ezbase/ez_config.h>
 #include <system/system_service.h>
 #include "archConfig.h"
+#include "file_copy.h"
 
 #include "CEGUI.h"
 
@@ -31,6 +32,7 @@
 															service_printf("==================================\n");}
 
 #define SYS_RES_PATH_MAX 256
+#define SYS_XCOPY_PROGRESS_MS 500
 
 /*
 *========================================
@@ -43,10 +45,65 @@ typedef struct
 	int						screenWidth;
 	int						screenHeight;
 	gdi_texture_t 		bgPic;
-	
+	fileCopy_t*			copy;					// async xcopy
+	unsigned long		copyTick;
 	
 } systemServiceHandle_t;
 
+//----------------------------------------------------------------------------//
+static void system_service_xcopy_progress(ezServiceHandle_t* hdle, fileCopyStat_t* stat)
+{
+	char sval[32];
+
+	sprintf(sval, "%llu", stat->done);
+	hdle->setEventPara(hdle, SYS_EVENT_XCOPYPROGRESS, SYS_EVENT_XCOPY_DONE, sval);
+	sprintf(sval, "%llu", stat->total);
+	hdle->setEventPara(hdle, SYS_EVENT_XCOPYPROGRESS, SYS_EVENT_XCOPY_TOTAL, sval);
+	sprintf(sval, "%lu", stat->rate);
+	hdle->setEventPara(hdle, SYS_EVENT_XCOPYPROGRESS, SYS_EVENT_XCOPY_RATE, sval);
+	sprintf(sval, "%ld", stat->eta);
+	hdle->setEventPara(hdle, SYS_EVENT_XCOPYPROGRESS, SYS_EVENT_XCOPY_ETA, sval);
+	sprintf(sval, "%d", stat->files);
+	hdle->setEventPara(hdle, SYS_EVENT_XCOPYPROGRESS, SYS_EVENT_XCOPY_FILES, sval);
+	sprintf(sval, "%d", stat->filesdone + stat->skipped);
+	hdle->setEventPara(hdle, SYS_EVENT_XCOPYPROGRESS, SYS_EVENT_XCOPY_FILESDONE, sval);
+	hdle->setEventPara(hdle, SYS_EVENT_XCOPYPROGRESS, SYS_EVENT_XCOPY_CURRENT, stat->current);
+	hdle->pushEvent(hdle, SYS_EVENT_XCOPYPROGRESS, ezServiceEvent_Succ);
+}
+
+//----------------------------------------------------------------------------//
+static int system_service_update(ezServiceHandle_t* hdle, int timeElapsed)
+{
+	systemServiceHandle_t* syshdle = (systemServiceHandle_t*)hdle->doer;
+	fileCopyStat_t stat;
+	unsigned long now;
+	char sval[32];
+	int ret;
+
+	if (syshdle == NULL || syshdle->copy == NULL)
+		return -1;
+
+	file_copy_get_stat(syshdle->copy, &stat);
+	if (stat.running)
+	{
+		now = krk_curTime();
+		if (now - syshdle->copyTick >= SYS_XCOPY_PROGRESS_MS)
+		{
+			syshdle->copyTick = now;
+			system_service_xcopy_progress(hdle, &stat);
+		}
+		return 0;
+	}
+
+	ret = file_copy_finish(syshdle->copy, &stat);
+	syshdle->copy = NULL;
+	system_service_xcopy_progress(hdle, &stat);
+	sprintf(sval, "%d", ret);
+	hdle->setEventPara(hdle, SYS_EVENT_XCOPYDONE, SYS_EVENT_XCOPY_ERROR, sval);
+	hdle->pushEvent(hdle, SYS_EVENT_XCOPYDONE, (ret == 0)? ezServiceEvent_Succ : ezServiceEvent_Fail);
+	return 0;
+}
+
 //----------------------------------------------------------------------------//
 static int system_service_init(ezServiceHandle_t* hdle, const char* cmdname, const char* para)
 {
@@ -84,6 +141,7 @@ static int system_service_init(ezServiceHandle_t* hdle, const char* cmdname, con
 			}
 			strncpy(syshdle->resPath, respath, sizeof(syshdle->resPath));
 			hdle->doer = (void*)syshdle;
+			hdle->setUserUpdate(hdle, system_service_update);
 			result = ezServiceEvent_Succ;
 		}
 		else
@@ -107,6 +165,12 @@ static int system_service_deinit(ezServiceHandle_t* hdle, const char* cmdname, c
 	ezServiceEventResult_et result = ezServiceEvent_Fail;
 	if (hdle->doer != NULL)
 	{
+		systemServiceHandle_t* syshdle = (systemServiceHandle_t*)(hdle->doer);
+		if (syshdle->copy != NULL)
+		{
+			file_copy_cancel(syshdle->copy);
+			file_copy_finish(syshdle->copy, NULL);
+		}
 		krk_arch_deinit();
 		free(hdle->doer);
 		hdle->doer = NULL;
@@ -402,8 +466,13 @@ static int system_service_xcopy(ezServiceHandle_t* hdle, const char* cmdname, co
 {
 	if (hdle->doer != NULL)
 	{
+		systemServiceHandle_t* syshdle = (systemServiceHandle_t*)(hdle->doer);
 		const char* src = hdle->getCmdParaValue(hdle, cmdname, SYS_CMD_XCOPY_SRC);
 		const char* dst = hdle->getCmdParaValue(hdle, cmdname, SYS_CMD_XCOPY_DST);
+		int async = 0;
+		int resume = 0;
+		fileCopy_t* copy;
+		char sval[32];
 		int ret;
 		
 		if (src == NULL) {
@@ -416,9 +485,35 @@ static int system_service_xcopy(ezServiceHandle_t* hdle, const char* cmdname, co
 			hdle->pushEvent(hdle, SYS_EVENT_XCOPY, ezServiceEvent_Fail);
 			return ezService_Err;
 		}
-		ret = krk_xcopy(dst, src, 1024*256, NULL);
-		hdle->pushEvent(hdle, SYS_EVENT_XCOPY, (ret==ezService_Succ)? ezServiceEvent_Succ : ezServiceEvent_Fail);
-		return ret;
+		if (syshdle->copy != NULL) {
+			service_printf("system_service_xcopy -> BUSY \n");
+			hdle->pushEvent(hdle, SYS_EVENT_XCOPY, ezServiceEvent_Fail);
+			return ezService_Err;
+		}
+		hdle->getCmdParaValueInt(hdle, cmdname, SYS_CMD_XCOPY_ASYNC, &async);
+		hdle->removeCmdPara(hdle, cmdname, SYS_CMD_XCOPY_ASYNC);
+		hdle->getCmdParaValueInt(hdle, cmdname, SYS_CMD_XCOPY_RESUME, &resume);
+		hdle->removeCmdPara(hdle, cmdname, SYS_CMD_XCOPY_RESUME);
+
+		copy = file_copy_start(dst, src, resume);
+		if (copy == NULL) {
+			hdle->pushEvent(hdle, SYS_EVENT_XCOPY, ezServiceEvent_Fail);
+			return ezService_Err;
+		}
+		if (async) {
+			syshdle->copy = copy;
+			syshdle->copyTick = krk_curTime();
+			hdle->pushEvent(hdle, SYS_EVENT_XCOPY, ezServiceEvent_Succ);
+			return ezService_Succ;
+		}
+		// the errno goes with the event, the command returns the service result
+		ret = file_copy_finish(copy, NULL);
+		if (ret != 0)
+			service_printf("system_service_xcopy -> errno %d \n", ret);
+		sprintf(sval, "%d", ret);
+		hdle->setEventPara(hdle, SYS_EVENT_XCOPY, SYS_EVENT_XCOPY_ERROR, sval);
+		hdle->pushEvent(hdle, SYS_EVENT_XCOPY, (ret == 0)? ezServiceEvent_Succ : ezServiceEvent_Fail);
+		return (ret == 0)? ezService_Succ : ezService_Err;
 	}
 	hdle->pushEvent(hdle, SYS_EVENT_XCOPY, ezServiceEvent_Fail);
 	return ezService_Err;
@@ -445,6 +540,23 @@ static int system_service_xremove(ezServiceHandle_t* hdle, const char* cmdname,
 	return ezService_Err;
 }
 
+//----------------------------------------------------------------------------//
+static int system_service_xcopycancel(ezServiceHandle_t* hdle, const char* cmdname, const char* para)
+{
+	if (hdle->doer != NULL)
+	{
+		systemServiceHandle_t* syshdle = (systemServiceHandle_t*)(hdle->doer);
+		
+		if (syshdle->copy != NULL) {
+			file_copy_cancel(syshdle->copy);
+			hdle->pushEvent(hdle, SYS_EVENT_XCOPYCANCEL, ezServiceEvent_Succ);
+			return ezService_Succ;
+		}
+	}
+	hdle->pushEvent(hdle, SYS_EVENT_XCOPYCANCEL, ezServiceEvent_Fail);
+	return ezService_Err;
+}
+
 //----------------------------------------------------------------------------//
 EZ_SERVICE_BEGIN_CMD_EXEC_MAP(systemService) 
 	EZ_SERVICE_ADD_CMD_EXEC(SYS_CMD_INIT,						system_service_init)
@@ -458,6 +570,7 @@ EZ_SERVICE_BEGIN_CMD_EXEC_MAP(systemService)
 	EZ_SERVICE_ADD_CMD_EXEC(SYS_CMD_RENDERSCRBG,	system_service_renderscrbg)
 	EZ_SERVICE_ADD_CMD_EXEC(SYS_CMD_XCOPY,					system_service_xcopy)
 	EZ_SERVICE_ADD_CMD_EXEC(SYS_CMD_XREMOVE,			system_service_xremove)
+	EZ_SERVICE_ADD_CMD_EXEC(SYS_CMD_XCOPYCANCEL,		system_service_xcopycancel)
 EZ_SERVICE_END_CMD_EXEC_MAP()
 //----------------------------------------------------------------------------//
 
@@ -43,6 +43,25 @@
 **											hdle->exec(hdle, "setscreen", NULL);
 **
 ** ----------------------------------------------------------
+**	xcopy, copy a file or a folder, every file is copied again
+**											hdle->setCmdPara(hdle, "xcopy", "src", "/mnt/usb/SONG");
+**											hdle->setCmdPara(hdle, "xcopy", "dst", "/mnt/sdcard/KARAOKE/SONG");
+**											hdle->exec(hdle, "xcopy", NULL);
+**
+**	with resume=1 an xcopy that is run again after a cancel or a failure skips
+**	the files already there with the size and time of their source and goes on
+**	with the last one
+**											hdle->setCmdPara(hdle, "xcopy", "resume", "1");
+**
+**	with async=1 xcopy returns at once, the copy runs on a thread and the
+**	service update sends xcopyprogress and xcopydone
+**											hdle->setCmdPara(hdle, "xcopy", "async", "1");
+**
+** ----------------------------------------------------------
+**	xcopycancel, stop the async xcopy, xcopydone follows
+**											hdle->exec(hdle, "xcopycancel", NULL);
+**
+** ----------------------------------------------------------
 **
 ** EVENT DEMES
 **
@@ -50,6 +69,24 @@
 **	you can call queryEvent to get cmd result, 0: fail, 1: succ, -1: no event
 **
 ** ----------------------------------------------------------
+**	xcopy, a sync xcopy ended, fail after an error
+**											err = hdle->getEventParaValue(hdle, "xcopy", "error");				// errno
+**
+** ----------------------------------------------------------
+**	xcopyprogress, every 500ms while an async xcopy runs
+**											done = hdle->getEventParaValue(hdle, "xcopyprogress", "done");		// bytes
+**											total = hdle->getEventParaValue(hdle, "xcopyprogress", "total");
+**											rate = hdle->getEventParaValue(hdle, "xcopyprogress", "rate");		// bytes a second
+**											eta = hdle->getEventParaValue(hdle, "xcopyprogress", "eta");			// ms, -1 not known yet
+**											files = hdle->getEventParaValue(hdle, "xcopyprogress", "files");
+**											filesdone = hdle->getEventParaValue(hdle, "xcopyprogress", "filesdone");
+**											current = hdle->getEventParaValue(hdle, "xcopyprogress", "current");
+**
+** ----------------------------------------------------------
+**	xcopydone, the async xcopy ended, fail after an error or a cancel
+**											err = hdle->getEventParaValue(hdle, "xcopydone", "error");			// errno
+**
+** ----------------------------------------------------------
 */
 
 #ifndef _SYSTEM_SERVICE_H_
@@ -73,6 +110,7 @@
 #define SYS_CMD_RENDERSCRBG					"renderscreenbg"
 #define SYS_CMD_XCOPY								"xcopy"
 #define SYS_CMD_XREMOVE							"xremove"
+#define SYS_CMD_XCOPYCANCEL					"xcopycancel"
 
 /*
 *	init cmd parameters name
@@ -97,6 +135,8 @@
 */
 #define SYS_CMD_XCOPY_SRC					"src"					// format: src=/mnt/sdcard/file1.bin
 #define SYS_CMD_XCOPY_DST					"dst"				// format: dst=/mnt/sdcard/file2.bin
+#define SYS_CMD_XCOPY_ASYNC				"async"			// format: async=1
+#define SYS_CMD_XCOPY_RESUME				"resume"			// format: resume=1
 
 /*
 *========================================
@@ -114,6 +154,21 @@
 #define SYS_EVENT_RENDERSCRBG				SYS_CMD_RENDERSCRBG
 #define SYS_EVENT_XCOPY							SYS_CMD_XCOPY
 #define SYS_EVENT_XREMOVE						SYS_CMD_XREMOVE
+#define SYS_EVENT_XCOPYCANCEL				SYS_CMD_XCOPYCANCEL
+#define SYS_EVENT_XCOPYPROGRESS			"xcopyprogress"
+#define SYS_EVENT_XCOPYDONE					"xcopydone"
+
+/*
+*	xcopy event parameters name
+*/
+#define SYS_EVENT_XCOPY_DONE					"done"
+#define SYS_EVENT_XCOPY_TOTAL				"total"
+#define SYS_EVENT_XCOPY_RATE					"rate"
+#define SYS_EVENT_XCOPY_ETA					"eta"
+#define SYS_EVENT_XCOPY_FILES				"files"
+#define SYS_EVENT_XCOPY_FILESDONE		"filesdone"
+#define SYS_EVENT_XCOPY_CURRENT			"current"
+#define SYS_EVENT_XCOPY_ERROR				"error"
 
 #ifdef __cplusplus
 extern "C" {